@@ -0,0 +1,442 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QStringList>
+#include <QtTest>
+#include <iterator>
+#include <vector>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/session.hpp>
+#include "benchmark.h"
+#include "json.h"
+#include "filterparserthread.h"
+#include "torrentcontentmodel.h"
+#include "rssdownloadrule.h"
+#include "torrentpersistentdata.h"
+#include "eventmanager.h"
+#include "qbtsession.h"
+#include "misc.h"
+
+const qint64 FILE_SIZE = 65536;
+const int PIECE_SIZE = 4 * 1024 * 1024;
+
+// Fixture sizes shared by all the benchmarks
+static void addSizes() {
+  QTest::addColumn<int>("count");
+  QTest::newRow("1k") << 1000;
+  QTest::newRow("10k") << 10000;
+  QTest::newRow("100k") << 100000;
+}
+
+// Same, the resume data being accessed in a batch or not. Every
+// access outside of a batch reads the whole resume file, only the
+// smallest fixture is run that way.
+static void addStoreSizes() {
+  QTest::addColumn<int>("count");
+  QTest::addColumn<bool>("batched");
+  QTest::newRow("1k-unbatched") << 1000 << false;
+  QTest::newRow("1k") << 1000 << true;
+  QTest::newRow("10k") << 10000 << true;
+  QTest::newRow("100k") << 100000 << true;
+}
+
+static QString fakeHash(int i) {
+  return QString("%1").arg(i, 40, 16, QChar('0'));
+}
+
+static QStringList fakeHashes(int count) {
+  QStringList hashes;
+  for (int i = 0; i < count; ++i)
+    hashes << fakeHash(i);
+  return hashes;
+}
+
+// One /24 range per rule
+static QString fakeRange(int i, const QString &sep) {
+  const QString prefix = QString("%1.%2.%3.").arg(1 + ((i >> 16) & 0xFF)).arg((i >> 8) & 0xFF).arg(i & 0xFF);
+  return prefix + "0" + sep + prefix + "255";
+}
+
+// Multi-file torrent, 100 files per folder
+static boost::intrusive_ptr<libtorrent::torrent_info> fakeTorrent(const QString &name, int nb_files) {
+  libtorrent::file_storage fs;
+  for (int i = 0; i < nb_files; ++i) {
+    const QString path = name + "/folder" + QString::number(i / 100) + "/file" + QString::number(i) + ".bin";
+    fs.add_file(path.toUtf8().constData(), FILE_SIZE);
+  }
+  libtorrent::create_torrent ct(fs, PIECE_SIZE);
+  std::vector<char> buf;
+  libtorrent::bencode(std::back_inserter(buf), ct.generate());
+  return new libtorrent::torrent_info(&buf[0], buf.size());
+}
+
+// Transfer list entry as sent to the Web UI
+static QVariantMap fakeEvent(int i) {
+  QVariantMap event;
+  event["hash"] = fakeHash(i);
+  event["name"] = QString("Torrent %1").arg(i);
+  event["state"] = (i % 3) ? "stalledUP" : "downloading";
+  event["label"] = QString();
+  event["size"] = Q_INT64_C(1503238553);
+  event["progress"] = (i % 100) / 100.;
+  event["dlspeed"] = 12800;
+  event["upspeed"] = 3276;
+  event["priority"] = i;
+  event["num_seeds"] = 12;
+  event["num_complete"] = 230;
+  event["num_leechs"] = 3;
+  event["num_incomplete"] = 45;
+  event["seed"] = (i % 3) != 0;
+  event["ratio"] = 0.8;
+  event["eta"] = 4320;
+  return event;
+}
+
+static void removeDir(const QString &path) {
+  QDir dir(path);
+  foreach (const QFileInfo &info, dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden)) {
+    if (info.isDir())
+      removeDir(info.absoluteFilePath());
+    else
+      QFile::remove(info.absoluteFilePath());
+  }
+  QDir().rmdir(path);
+}
+
+// The native settings cannot be moved on Mac OS X
+#ifdef Q_WS_MAC
+#define SKIP_IF_SETTINGS_NOT_REDIRECTED() QSKIP("Would modify the user settings", SkipAll)
+#else
+#define SKIP_IF_SETTINGS_NOT_REDIRECTED() do {} while (0)
+#endif
+
+void Benchmark::initTestCase() {
+  m_tempPath = QDir::temp().absoluteFilePath(QString("qbittorrent-benchmark-%1").arg(QCoreApplication::applicationPid()));
+  QVERIFY(QDir().mkpath(m_tempPath));
+  // Keeps the settings and the resume data of the user out of reach
+  QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, m_tempPath);
+  QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope, m_tempPath);
+}
+
+void Benchmark::cleanupTestCase() {
+  QBtSession::drop();
+  removeDir(m_tempPath);
+}
+
+QString Benchmark::fixturePath(const QString &name) const {
+  return QDir(m_tempPath).absoluteFilePath(name);
+}
+
+void Benchmark::toJson_data() {
+  addSizes();
+}
+
+void Benchmark::toJson() {
+  QFETCH(int, count);
+  QList<QVariantMap> events;
+  for (int i = 0; i < count; ++i)
+    events << fakeEvent(i);
+  QString json;
+  QBENCHMARK {
+    json = json::toJson(events);
+  }
+  QVERIFY(json.startsWith("["));
+}
+
+void Benchmark::parseDATFilterFile_data() {
+  addSizes();
+}
+
+void Benchmark::parseDATFilterFile() {
+  QFETCH(int, count);
+  const QString path = fixturePath("ipfilter.dat");
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  for (int i = 0; i < count; ++i)
+    file.write(QString("%1 , 000 , Range %2\n").arg(fakeRange(i, " - ")).arg(i).toAscii());
+  file.close();
+  FilterParserThread parser(0, 0);
+  int rules = 0;
+  QBENCHMARK {
+    rules = parser.parseDATFilterFile(path);
+  }
+  QCOMPARE(rules, count);
+}
+
+void Benchmark::parseP2PFilterFile_data() {
+  addSizes();
+}
+
+void Benchmark::parseP2PFilterFile() {
+  QFETCH(int, count);
+  const QString path = fixturePath("ipfilter.p2p");
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  for (int i = 0; i < count; ++i)
+    file.write(QString("Range %1:%2\n").arg(i).arg(fakeRange(i, "-")).toAscii());
+  file.close();
+  FilterParserThread parser(0, 0);
+  int rules = 0;
+  QBENCHMARK {
+    rules = parser.parseP2PFilterFile(path);
+  }
+  QCOMPARE(rules, count);
+}
+
+void Benchmark::parseP2BFilterFile_data() {
+  addSizes();
+}
+
+// Version 2: zero terminated name, then the range in network byte order
+void Benchmark::parseP2BFilterFile() {
+  QFETCH(int, count);
+  const QString path = fixturePath("ipfilter.p2b");
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  QDataStream stream(&file);
+  stream.writeRawData("\xFF\xFF\xFF\xFFP2B\x02", 8);
+  for (int i = 0; i < count; ++i) {
+    const QByteArray name = QString("Range %1").arg(i).toAscii();
+    stream.writeRawData(name.constData(), name.size() + 1);
+    const quint32 first = ((1 + ((i >> 16) & 0xFF)) << 24) | ((i & 0xFFFF) << 8);
+    stream << first << (first | 0xFF);
+  }
+  file.close();
+  FilterParserThread parser(0, 0);
+  int rules = 0;
+  QBENCHMARK {
+    rules = parser.parseP2BFilterFile(path);
+  }
+  QCOMPARE(rules, count);
+}
+
+void Benchmark::setupModelData_data() {
+  addSizes();
+}
+
+void Benchmark::setupModelData() {
+  QFETCH(int, count);
+  const boost::intrusive_ptr<libtorrent::torrent_info> t = fakeTorrent("content", count);
+  QBENCHMARK {
+    TorrentContentModel model;
+    model.setupModelData(*t);
+  }
+}
+
+void Benchmark::updateFilesProgress_data() {
+  addSizes();
+}
+
+void Benchmark::updateFilesProgress() {
+  QFETCH(int, count);
+  const boost::intrusive_ptr<libtorrent::torrent_info> t = fakeTorrent("content", count);
+  TorrentContentModel model;
+  model.setupModelData(*t);
+  std::vector<libtorrent::size_type> fp(count);
+  for (int i = 0; i < count; ++i)
+    fp[i] = (i * 7919LL) % FILE_SIZE;
+  QBENCHMARK {
+    model.updateFilesProgress(fp);
+  }
+}
+
+void Benchmark::rssRuleMatches_data() {
+  QTest::addColumn<int>("count");
+  QTest::addColumn<bool>("regex");
+  QTest::newRow("1k-wildcard") << 1000 << false;
+  QTest::newRow("10k-wildcard") << 10000 << false;
+  QTest::newRow("100k-wildcard") << 100000 << false;
+  QTest::newRow("1k-regex") << 1000 << true;
+  QTest::newRow("10k-regex") << 10000 << true;
+  QTest::newRow("100k-regex") << 100000 << true;
+}
+
+void Benchmark::rssRuleMatches() {
+  QFETCH(int, count);
+  QFETCH(bool, regex);
+  static const char *qualities[] = {"720p HDTV x264", "1080p WEB-DL", "720p WEB-DL", "CAM XviD"};
+  QStringList titles;
+  for (int i = 0; i < count; ++i)
+    titles << QString("Show %1 S%2E%3 %4").arg(i % 50).arg(i % 12, 2, 10, QChar('0'))
+              .arg(i % 24, 2, 10, QChar('0')).arg(QString::fromLatin1(qualities[i % 4]));
+  RssDownloadRule rule;
+  rule.setUseRegex(regex);
+  if (regex) {
+    rule.setMustContain("show \\d+ s\\d\\de\\d\\d .*720p");
+    rule.setMustNotContain("hdtv|cam");
+  } else {
+    rule.setMustContain("show*720p");
+    rule.setMustNotContain("hdtv|cam");
+  }
+  int matches = 0;
+  QBENCHMARK {
+    matches = 0;
+    foreach (const QString &title, titles) {
+      if (rule.matches(title))
+        ++matches;
+    }
+  }
+  QVERIFY(matches > 0);
+}
+
+void Benchmark::saveLabel_data() {
+  addStoreSizes();
+}
+
+void Benchmark::saveLabel() {
+  SKIP_IF_SETTINGS_NOT_REDIRECTED();
+  QFETCH(int, count);
+  QFETCH(bool, batched);
+  const QStringList hashes = fakeHashes(count);
+  QBENCHMARK {
+    if (batched)
+      TorrentResumeStore::beginBatch();
+    foreach (const QString &hash, hashes)
+      TorrentPersistentData::saveLabel(hash, "label");
+    if (batched)
+      TorrentResumeStore::endBatch();
+  }
+  TorrentResumeBatch batch;
+  foreach (const QString &hash, hashes)
+    TorrentPersistentData::deletePersistentData(hash);
+}
+
+void Benchmark::getLabel_data() {
+  addStoreSizes();
+}
+
+void Benchmark::getLabel() {
+  SKIP_IF_SETTINGS_NOT_REDIRECTED();
+  QFETCH(int, count);
+  QFETCH(bool, batched);
+  const QStringList hashes = fakeHashes(count);
+  {
+    TorrentResumeBatch batch;
+    foreach (const QString &hash, hashes)
+      TorrentPersistentData::saveLabel(hash, "label");
+  }
+  int labeled = 0;
+  QBENCHMARK {
+    labeled = 0;
+    if (batched)
+      TorrentResumeStore::beginBatch();
+    foreach (const QString &hash, hashes) {
+      if (!TorrentPersistentData::getLabel(hash).isEmpty())
+        ++labeled;
+    }
+    if (batched)
+      TorrentResumeStore::endBatch();
+  }
+  QCOMPARE(labeled, count);
+  TorrentResumeBatch batch;
+  foreach (const QString &hash, hashes)
+    TorrentPersistentData::deletePersistentData(hash);
+}
+
+void Benchmark::friendlyUnit_data() {
+  addSizes();
+}
+
+void Benchmark::friendlyUnit() {
+  QFETCH(int, count);
+  std::vector<qreal> values(count);
+  for (int i = 0; i < count; ++i)
+    values[i] = i * 1234567.;
+  QString str;
+  QBENCHMARK {
+    for (int i = 0; i < count; ++i)
+      str = misc::friendlyUnit(values[i]);
+  }
+  QVERIFY(!str.isEmpty());
+}
+
+void Benchmark::userFriendlyDuration_data() {
+  addSizes();
+}
+
+void Benchmark::userFriendlyDuration() {
+  QFETCH(int, count);
+  QString str;
+  QBENCHMARK {
+    for (int i = 0; i < count; ++i)
+      str = misc::userFriendlyDuration(i * 37LL);
+  }
+  QVERIFY(!str.isEmpty());
+}
+
+void Benchmark::modifiedTorrent_data() {
+  addSizes();
+}
+
+// One Web UI refresh (see HttpServer::onTimer()) of paused torrents.
+// After the first pass, the torrents are unchanged.
+void Benchmark::modifiedTorrent() {
+  SKIP_IF_SETTINGS_NOT_REDIRECTED();
+  QFETCH(int, count);
+  libtorrent::session *s = QBtSession::instance()->getSession();
+  QList<QTorrentHandle> handles;
+  for (int i = 0; i < count; ++i) {
+    libtorrent::add_torrent_params p;
+    p.ti = fakeTorrent(QString("torrent%1").arg(i), 1);
+    p.save_path = m_tempPath.toLocal8Bit().constData();
+    p.paused = true;
+    p.auto_managed = false;
+    p.duplicate_is_error = false;
+    handles << QTorrentHandle(s->add_torrent(p));
+  }
+  EventManager manager(0);
+  QBENCHMARK {
+    TorrentResumeBatch batch;
+    foreach (const QTorrentHandle &h, handles)
+      manager.modifiedTorrent(h);
+  }
+  QCOMPARE(manager.filterTorrents(QString(), QString(), QString()).size(), count);
+  foreach (const QTorrentHandle &h, handles)
+    s->remove_torrent(h);
+}
+
+int main(int argc, char *argv[]) {
+  // No display needed
+  QApplication app(argc, argv, false);
+  app.setApplicationName("qBittorrent-benchmark");
+  // XML results unless another format is asked for
+  QStringList args = app.arguments();
+  const bool text = args.removeAll("-txt") > 0;
+  if (!text && !args.contains("-xml") && !args.contains("-lightxml") && !args.contains("-xunitxml"))
+    args << "-xml";
+  Benchmark benchmark;
+  return QTest::qExec(&benchmark, args);
+}
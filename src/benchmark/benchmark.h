@@ -0,0 +1,81 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QObject>
+#include <QString>
+
+// Micro-benchmarks of the code paths whose cost grows with the number
+// of torrents, files, filter rules or RSS articles. Each benchmark is
+// run on synthetic fixtures of 1k, 10k and 100k items.
+// The results are written as QTestLib XML unless another output
+// format is given on the command line (-txt for plain text).
+class Benchmark : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void toJson_data();
+  void toJson();
+  void parseDATFilterFile_data();
+  void parseDATFilterFile();
+  void parseP2PFilterFile_data();
+  void parseP2PFilterFile();
+  void parseP2BFilterFile_data();
+  void parseP2BFilterFile();
+  void setupModelData_data();
+  void setupModelData();
+  void updateFilesProgress_data();
+  void updateFilesProgress();
+  void rssRuleMatches_data();
+  void rssRuleMatches();
+  void saveLabel_data();
+  void saveLabel();
+  void getLabel_data();
+  void getLabel();
+  void friendlyUnit_data();
+  void friendlyUnit();
+  void userFriendlyDuration_data();
+  void userFriendlyDuration();
+  void modifiedTorrent_data();
+  void modifiedTorrent();
+
+private:
+  QString fixturePath(const QString &name) const;
+
+private:
+  QString m_tempPath;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,5 @@
+INCLUDEPATH += $$PWD
+
+HEADERS += $$PWD/benchmark.h
+
+SOURCES += $$PWD/benchmark.cpp
@@ -41,78 +41,209 @@
 #include "rsssettings.h"
 #endif
 #include "qinisettings.h"
+#include "misc.h"
+
+// Maximum number of simultaneous connections to a single host
+const int MAX_CONNECTIONS_PER_HOST = 4;
+// Maximum number of simultaneous downloads
+const int MAX_ACTIVE_DOWNLOADS = 16;
+const int MAX_REDIRECTIONS = 10;
+// More than 1MB, this is probably not a torrent file
+const qint64 MAX_TORRENT_SIZE = 1048576;
+
+int DownloadThread::s_settingsGeneration = 0;
+
+/** Download Handler **/
+
+DownloadHandler::DownloadHandler(const QString &url, qint64 limit, Destination destination, DownloadThread *parent) :
+  QObject(parent), m_url(url), m_currentUrl(url), m_limit(limit), m_destination(destination),
+  m_redirections(0), m_bytesReceived(0), m_file(0)
+{
+  m_host = QUrl::fromEncoded(url.toUtf8()).host();
+}
+
+DownloadHandler::~DownloadHandler() {
+  if (m_file) {
+    // Download did not complete, get rid of the partial file
+    m_file->setAutoRemove(true);
+    delete m_file;
+  }
+}
+
+bool DownloadHandler::openSink() {
+  if (m_destination == TO_MEMORY)
+    return true;
+  m_file = new QTemporaryFile;
+  m_file->setAutoRemove(false);
+  if (!m_file->open()) {
+    delete m_file;
+    m_file = 0;
+    return false;
+  }
+  qDebug("Temporary filename is: %s", qPrintable(m_file->fileName()));
+  return true;
+}
+
+bool DownloadHandler::writeToSink(const QByteArray &chunk) {
+  m_bytesReceived += chunk.size();
+  if (m_limit > 0 && m_bytesReceived > m_limit)
+    return false;
+  if (m_destination == TO_MEMORY) {
+    m_data.append(chunk);
+    return true;
+  }
+  Q_ASSERT(m_file);
+  return m_file->write(chunk) == chunk.size();
+}
+
+void DownloadHandler::resetSink() {
+  m_bytesReceived = 0;
+  m_data.clear();
+  if (m_file) {
+    m_file->resize(0);
+    m_file->seek(0);
+  }
+}
 
 /** Download Thread **/
 
-DownloadThread::DownloadThread(QObject* parent) : QObject(parent) {
+DownloadThread::DownloadThread(QObject* parent) : QObject(parent),
+  m_activeDownloads(0), m_startScheduled(false), m_settingsGeneration(-1) {
   connect(&m_networkManager, SIGNAL(finished (QNetworkReply*)), this, SLOT(processDlFinished(QNetworkReply*)));
 #ifndef QT_NO_OPENSSL
   connect(&m_networkManager, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)), this, SLOT(ignoreSslErrors(QNetworkReply*,QList<QSslError>)));
 #endif
+  connect(SettingsStorage::instance(), SIGNAL(changed(QString)), SLOT(handleSettingChanged(QString)));
 }
 
-void DownloadThread::processDlFinished(QNetworkReply* reply) {
-  QString url = reply->url().toString();
-  qDebug("Download finished: %s", qPrintable(url));
-  // Check if the request was successful
-  if (reply->error() != QNetworkReply::NoError) {
-    // Failure
-    qDebug("Download failure (%s), reason: %s", qPrintable(url), qPrintable(errorCodeToString(reply->error())));
-    emit downloadFailure(url, errorCodeToString(reply->error()));
-    reply->deleteLater();
-    return;
+DownloadThread::~DownloadThread() {
+  // Replies are children of the network manager, make sure
+  // they do not call us back while we are being destroyed
+  disconnect(&m_networkManager, 0, this, 0);
+  foreach (QNetworkReply *reply, m_activeReplies.keys()) {
+    disconnect(reply, 0, this, 0);
+    reply->abort();
   }
-  // Check if the server ask us to redirect somewhere lese
-  const QVariant redirection = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
-  if (redirection.isValid()) {
-    // We should redirect
-    QUrl newUrl = redirection.toUrl();
-    // Resolve relative urls
-    if (newUrl.isRelative())
-        newUrl = reply->url().resolved(newUrl);
-    const QString newUrlString = newUrl.toString();
-    qDebug("Redirecting from %s to %s", qPrintable(url), qPrintable(newUrlString));
-    m_redirectMapping.insert(newUrlString, url);
-    downloadUrl(newUrlString);
-    reply->deleteLater();
+}
+
+void DownloadThread::invalidateSettings() {
+  ++s_settingsGeneration;
+}
+
+void DownloadThread::handleSettingChanged(const QString &key) {
+  if (key.startsWith("Preferences/Connection/Proxy") || key == "Rss/hosts_cookies")
+    invalidateSettings();
+}
+
+void DownloadThread::updateSettings() {
+  if (m_settingsGeneration == s_settingsGeneration)
+    return;
+  qDebug("Download settings changed, reloading proxy and cookies");
+  m_settingsGeneration = s_settingsGeneration;
+  applyProxySettings();
+  m_cookieHosts.clear();
+}
+
+void DownloadThread::processReadyRead() {
+  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+  if (!reply) return;
+  DownloadHandler *handler = m_activeReplies.value(reply, 0);
+  if (!handler || !handler->m_error.isEmpty()) return;
+  const QByteArray chunk = reply->readAll();
+  // Body of a redirection is of no interest
+  if (reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid())
+    return;
+  // Content-Length is known beforehand, no need to wait for the data
+  const qint64 bytesTotal = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+  if (handler->m_limit > 0 && bytesTotal > handler->m_limit) {
+    handler->m_error = tr("The file size is %1. It exceeds the download limit of %2.").arg(misc::friendlyUnit(bytesTotal)).arg(misc::friendlyUnit(handler->m_limit));
+    reply->abort();
     return;
   }
-  // Checking if it was redirected, restoring initial URL
-  if (m_redirectMapping.contains(url)) {
-    url = m_redirectMapping.take(url);
+  if (!handler->writeToSink(chunk)) {
+    if (handler->m_limit > 0 && handler->m_bytesReceived > handler->m_limit)
+      handler->m_error = tr("The file size exceeds the download limit of %1.").arg(misc::friendlyUnit(handler->m_limit));
+    else
+      handler->m_error = tr("I/O Error");
+    reply->abort();
   }
-  // Success
-  QTemporaryFile *tmpfile = new QTemporaryFile;
-  tmpfile->setAutoRemove(false);
-  if (tmpfile->open()) {
-    QString filePath = tmpfile->fileName();
-    qDebug("Temporary filename is: %s", qPrintable(filePath));
-    if (reply->isOpen() || reply->open(QIODevice::ReadOnly)) {
-      // TODO: Support GZIP compression
-      tmpfile->write(reply->readAll());
-      tmpfile->close();
-      // XXX: tmpfile needs to be deleted on Windows before using the file
-      // or it will complain that the file is used by another process.
-      delete tmpfile;
-      // Send finished signal
-      emit downloadFinished(url, filePath);
+}
+
+void DownloadThread::processDlFinished(QNetworkReply* reply) {
+  DownloadHandler *handler = m_activeReplies.take(reply);
+  reply->deleteLater();
+  if (!handler) return;
+  releaseSlot(handler->m_host);
+  const QString url = reply->url().toString();
+  qDebug("Download finished: %s", qPrintable(url));
+  if (!handler->m_error.isEmpty()) {
+    // Aborted by us (size limit or I/O error)
+    failHandler(handler, handler->m_error);
+  } else if (reply->error() != QNetworkReply::NoError) {
+    // Failure
+    qDebug("Download failure (%s), reason: %s", qPrintable(url), qPrintable(errorCodeToString(reply->error())));
+    failHandler(handler, errorCodeToString(reply->error()));
+  } else {
+    // Check if the server ask us to redirect somewhere else
+    const QVariant redirection = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
+    if (redirection.isValid()) {
+      if (++handler->m_redirections > MAX_REDIRECTIONS) {
+        failHandler(handler, tr("Too many redirections"));
+      } else {
+        // We should redirect
+        QUrl newUrl = redirection.toUrl();
+        // Resolve relative urls
+        if (newUrl.isRelative())
+          newUrl = reply->url().resolved(newUrl);
+        const QString newUrlString = newUrl.toString();
+        qDebug("Redirecting from %s to %s", qPrintable(url), qPrintable(newUrlString));
+        handler->resetSink();
+        // The redirection may point to another host
+        handler->m_host = newUrl.host();
+        handler->m_currentUrl = newUrlString;
+        m_pendingDownloads[handler->m_host].enqueue(handler);
+      }
     } else {
-      delete tmpfile;
-      // Error when reading the request
-      emit downloadFailure(url, tr("I/O Error"));
+      // Read what is left in the buffer
+      if (reply->bytesAvailable() > 0 && !handler->writeToSink(reply->readAll()))
+        failHandler(handler, tr("I/O Error"));
+      else
+        finishHandler(handler);
     }
+  }
+  startPendingDownloads();
+}
+
+void DownloadThread::finishHandler(DownloadHandler *handler) {
+  if (handler->m_destination == DownloadHandler::TO_MEMORY) {
+    emit handler->dataDownloaded(handler->m_url, handler->m_data);
   } else {
-    delete tmpfile;
-    emit downloadFailure(url, tr("I/O Error"));
+    Q_ASSERT(handler->m_file);
+    const QString filePath = handler->m_file->fileName();
+    handler->m_file->close();
+    // XXX: tmpfile needs to be deleted on Windows before using the file
+    // or it will complain that the file is used by another process.
+    delete handler->m_file;
+    handler->m_file = 0;
+    emit handler->downloadFinished(handler->m_url, filePath);
+    emit downloadFinished(handler->m_url, filePath);
   }
-  // Clean up
-  reply->deleteLater();
+  handler->deleteLater();
+}
+
+void DownloadThread::failHandler(DownloadHandler *handler, const QString &reason) {
+  emit handler->downloadFailure(handler->m_url, reason);
+  emit downloadFailure(handler->m_url, reason);
+  handler->deleteLater();
 }
 
 #ifndef DISABLE_GUI
-void DownloadThread::loadCookies(const QString &host_name, QString url) {
+void DownloadThread::loadCookies(const QString &host_name, const QString &url) {
+  // Cookies are already in the jar, unless settings changed since
+  if (m_cookieHosts.contains(host_name))
+    return;
+  m_cookieHosts << host_name;
   const QList<QByteArray> raw_cookies = RssSettings().getHostNameCookies(host_name);
-  QNetworkCookieJar *cookie_jar = m_networkManager.cookieJar();
   QList<QNetworkCookie> cookies;
   qDebug("Loading cookies for host name: %s", qPrintable(host_name));
   foreach (const QByteArray& raw_cookie, raw_cookies) {
@@ -122,26 +253,68 @@ void DownloadThread::loadCookies(const QString &host_name, QString url) {
       cookies << QNetworkCookie(cookie_parts.first(), cookie_parts.last());
     }
   }
-  cookie_jar->setCookiesFromUrl(cookies, url);
-  m_networkManager.setCookieJar(cookie_jar);
+  if (!cookies.isEmpty())
+    m_networkManager.cookieJar()->setCookiesFromUrl(cookies, url);
 }
 #endif
 
-void DownloadThread::downloadTorrentUrl(const QString &url) {
-  // Process request
-  QNetworkReply *reply = downloadUrl(url);
-  connect(reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(checkDownloadSize(qint64,qint64)));
+DownloadHandler* DownloadThread::downloadTorrentUrl(const QString &url, DownloadHandler::Destination destination) {
+  return downloadUrl(url, MAX_TORRENT_SIZE, destination);
 }
 
-QNetworkReply* DownloadThread::downloadUrl(const QString &url) {
-  // Update proxy settings
-  applyProxySettings();
+DownloadHandler* DownloadThread::downloadUrl(const QString &url, qint64 limit, DownloadHandler::Destination destination) {
+  DownloadHandler *handler = new DownloadHandler(url, limit, destination, this);
+  qDebug("Queueing download of %s", qPrintable(url));
+  m_pendingDownloads[handler->m_host].enqueue(handler);
+  // Start asynchronously so that the caller has a chance
+  // to connect to the handler signals
+  if (!m_startScheduled) {
+    m_startScheduled = true;
+    QMetaObject::invokeMethod(this, "startPendingDownloads", Qt::QueuedConnection);
+  }
+  return handler;
+}
+
+void DownloadThread::startPendingDownloads() {
+  m_startScheduled = false;
+  if (m_activeDownloads >= MAX_ACTIVE_DOWNLOADS || m_pendingDownloads.isEmpty())
+    return;
+  QHash<QString, QQueue<DownloadHandler*> >::iterator it = m_pendingDownloads.begin();
+  while (it != m_pendingDownloads.end() && m_activeDownloads < MAX_ACTIVE_DOWNLOADS) {
+    const QString &host = it.key();
+    QQueue<DownloadHandler*> &queue = it.value();
+    while (!queue.isEmpty() && m_activeDownloads < MAX_ACTIVE_DOWNLOADS
+           && m_activeDownloadsPerHost.value(host, 0) < MAX_CONNECTIONS_PER_HOST) {
+      startDownload(queue.dequeue());
+    }
+    if (queue.isEmpty())
+      it = m_pendingDownloads.erase(it);
+    else
+      ++it;
+  }
+}
+
+void DownloadThread::releaseSlot(const QString &host) {
+  --m_activeDownloads;
+  QHash<QString, int>::iterator it = m_activeDownloadsPerHost.find(host);
+  Q_ASSERT(it != m_activeDownloadsPerHost.end());
+  if (--it.value() <= 0)
+    m_activeDownloadsPerHost.erase(it);
+}
+
+void DownloadThread::startDownload(DownloadHandler *handler) {
+  const QString &url = handler->m_currentUrl;
+  // Reload proxy settings and cookies only if they changed
+  updateSettings();
 #ifndef DISABLE_GUI
   // Load cookies
-  QString host_name = QUrl::fromEncoded(url.toUtf8()).host();
-  if (!host_name.isEmpty())
-    loadCookies(host_name, url);
+  if (!handler->m_host.isEmpty())
+    loadCookies(handler->m_host, url);
 #endif
+  if (!handler->m_file && !handler->openSink()) {
+    failHandler(handler, tr("I/O Error"));
+    return;
+  }
   // Process download request
   qDebug("url is %s", qPrintable(url));
   const QUrl qurl = QUrl::fromEncoded(url.toUtf8());
@@ -150,33 +323,11 @@ QNetworkReply* DownloadThread::downloadUrl(const QString &url) {
   // Web server banning
   request.setRawHeader("User-Agent", "Mozilla/5.0 (X11; U; Linux i686 (x86_64); en-US; rv:1.9.1.5) Gecko/20091102 Firefox/3.5.5");
   qDebug("Downloading %s...", request.url().toEncoded().data());
-  qDebug("%d cookies for this URL", m_networkManager.cookieJar()->cookiesForUrl(url).size());
-  for (int i=0; i<m_networkManager.cookieJar()->cookiesForUrl(url).size(); ++i) {
-    qDebug("%s=%s", m_networkManager.cookieJar()->cookiesForUrl(url).at(i).name().data(), m_networkManager.cookieJar()->cookiesForUrl(url).at(i).value().data());
-    qDebug("Domain: %s, Path: %s", qPrintable(m_networkManager.cookieJar()->cookiesForUrl(url).at(i).domain()), qPrintable(m_networkManager.cookieJar()->cookiesForUrl(url).at(i).path()));
-  }
-  return m_networkManager.get(request);
-}
-
-void DownloadThread::checkDownloadSize(qint64 bytesReceived, qint64 bytesTotal) {
-  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-  if (!reply) return;
-  if (bytesTotal > 0) {
-    // Total number of bytes is available
-    if (bytesTotal > 1048576) {
-      // More than 1MB, this is probably not a torrent file, aborting...
-      reply->abort();
-      reply->deleteLater();
-    } else {
-      disconnect(reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(checkDownloadSize(qint64,qint64)));
-    }
-  } else {
-    if (bytesReceived  > 1048576) {
-      // More than 1MB, this is probably not a torrent file, aborting...
-      reply->abort();
-      reply->deleteLater();
-    }
-  }
+  QNetworkReply *reply = m_networkManager.get(request);
+  m_activeReplies.insert(reply, handler);
+  ++m_activeDownloads;
+  ++m_activeDownloadsPerHost[handler->m_host];
+  connect(reply, SIGNAL(readyRead()), SLOT(processReadyRead()));
 }
 
 void DownloadThread::applyProxySettings() {
@@ -32,22 +32,70 @@
 #define DOWNLOADTHREAD_H
 
 #include <QNetworkReply>
+#include <QNetworkAccessManager>
 #include <QObject>
 #include <QHash>
+#include <QSet>
+#include <QQueue>
 #include <QSslError>
 
 QT_BEGIN_NAMESPACE
-class QNetworkAccessManager;
+class QTemporaryFile;
 QT_END_NAMESPACE
 
+class DownloadThread;
+
+/*
+ * Represents a single URL download. Signals are only
+ * emitted for this request, callers no longer need to
+ * filter the broadcast signals of DownloadThread by URL.
+ */
+class DownloadHandler : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(DownloadHandler)
+  friend class DownloadThread;
+
+public:
+  enum Destination { TO_FILE, TO_MEMORY };
+
+  QString url() const { return m_url; }
+  Destination destination() const { return m_destination; }
+
+signals:
+  void downloadFinished(const QString &url, const QString &file_path);
+  void dataDownloaded(const QString &url, const QByteArray &data);
+  void downloadFailure(const QString &url, const QString &reason);
+
+private:
+  DownloadHandler(const QString &url, qint64 limit, Destination destination, DownloadThread *parent);
+  ~DownloadHandler();
+  bool openSink();
+  bool writeToSink(const QByteArray &chunk);
+  void resetSink();
+
+private:
+  QString m_url;
+  QString m_currentUrl; // differs from m_url after a redirection
+  QString m_host;
+  qint64 m_limit;
+  Destination m_destination;
+  int m_redirections;
+  qint64 m_bytesReceived;
+  QString m_error;
+  QTemporaryFile *m_file;
+  QByteArray m_data;
+};
+
 class DownloadThread : public QObject {
   Q_OBJECT
 
 public:
   DownloadThread(QObject* parent = 0);
-  QNetworkReply* downloadUrl(const QString &url);
-  void downloadTorrentUrl(const QString &url);
-  //void setProxy(QString IP, int port, QString username, QString password);
+  ~DownloadThread();
+  DownloadHandler* downloadUrl(const QString &url, qint64 limit = 0, DownloadHandler::Destination destination = DownloadHandler::TO_FILE);
+  DownloadHandler* downloadTorrentUrl(const QString &url, DownloadHandler::Destination destination = DownloadHandler::TO_FILE);
+  // Proxy and cookies are cached, this must be called when they change
+  static void invalidateSettings();
 
 signals:
   void downloadFinished(const QString &url, const QString &file_path);
@@ -55,7 +103,9 @@ signals:
 
 private slots:
   void processDlFinished(QNetworkReply* reply);
-  void checkDownloadSize(qint64 bytesReceived, qint64 bytesTotal);
+  void processReadyRead();
+  void startPendingDownloads();
+  void handleSettingChanged(const QString &key);
 #ifndef QT_NO_OPENSSL
   void ignoreSslErrors(QNetworkReply*,const QList<QSslError>&);
 #endif
@@ -63,13 +113,27 @@ private slots:
 private:
   QString errorCodeToString(QNetworkReply::NetworkError status);
   void applyProxySettings();
+  void updateSettings();
 #ifndef DISABLE_GUI
-  void loadCookies(const QString &host_name, QString url);
+  void loadCookies(const QString &host_name, const QString &url);
 #endif
+  void startDownload(DownloadHandler *handler);
+  void releaseSlot(const QString &host);
+  void finishHandler(DownloadHandler *handler);
+  void failHandler(DownloadHandler *handler, const QString &reason);
 
 private:
   QNetworkAccessManager m_networkManager;
-  QHash<QString, QString> m_redirectMapping;
+  // Requests waiting for a free connection slot, per host
+  QHash<QString, QQueue<DownloadHandler*> > m_pendingDownloads;
+  QHash<QString, int> m_activeDownloadsPerHost;
+  QHash<QNetworkReply*, DownloadHandler*> m_activeReplies;
+  int m_activeDownloads;
+  bool m_startScheduled;
+  // Cached settings
+  int m_settingsGeneration;
+  QSet<QString> m_cookieHosts;
+  static int s_settingsGeneration;
 
 };
 
@@ -28,19 +28,18 @@
  * Contact : chris@qbittorrent.org
  */
 
-#include <QListWidgetItem>
-#include <QLabel>
 #include "executionlog.h"
 #include "ui_executionlog.h"
 #include "qbtsession.h"
 #include "iconprovider.h"
 #include "loglistwidget.h"
+#include "logmodel.h"
 
 ExecutionLog::ExecutionLog(QWidget *parent) :
   QWidget(parent),
   ui(new Ui::ExecutionLog),
-  m_logList(new LogListWidget(MAX_LOG_MESSAGES)),
-  m_banList(new LogListWidget(MAX_LOG_MESSAGES))
+  m_logList(new LogListWidget),
+  m_banList(new LogListWidget)
 {
     ui->setupUi(this);
 
@@ -49,14 +48,12 @@ ExecutionLog::ExecutionLog(QWidget *parent) :
     ui->tabGeneral->layout()->addWidget(m_logList);
     ui->tabBan->layout()->addWidget(m_banList);
 
-    const QStringList log_msgs = QBtSession::instance()->getConsoleMessages();
-    foreach (const QString& msg, log_msgs)
-      addLogMessage(msg);
-    const QStringList ban_msgs = QBtSession::instance()->getPeerBanMessages();
-    foreach (const QString& msg, ban_msgs)
-      addBanMessage(msg);
-    connect(QBtSession::instance(), SIGNAL(newConsoleMessage(QString)), SLOT(addLogMessage(QString)));
-    connect(QBtSession::instance(), SIGNAL(newBanMessage(QString)), SLOT(addBanMessage(QString)));
+    LogModel *log_model = new LogModel(&QBtSession::instance()->log(), this);
+    LogModel *ban_model = new LogModel(&QBtSession::instance()->peerLog(), this);
+    m_logList->setModel(log_model);
+    m_banList->setModel(ban_model);
+    connect(QBtSession::instance(), SIGNAL(newLogRecord()), log_model, SLOT(scheduleRefresh()));
+    connect(QBtSession::instance(), SIGNAL(newPeerLogRecord()), ban_model, SLOT(scheduleRefresh()));
 }
 
 ExecutionLog::~ExecutionLog()
@@ -65,13 +62,3 @@ ExecutionLog::~ExecutionLog()
   delete m_banList;
   delete ui;
 }
-
-void ExecutionLog::addLogMessage(const QString &msg)
-{
-  m_logList->appendLine(msg);
-}
-
-void ExecutionLog::addBanMessage(const QString &msg)
-{
-  m_banList->appendLine(msg);
-}
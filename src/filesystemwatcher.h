@@ -7,9 +7,19 @@
 #include <QPointer>
 #include <QStringList>
 #include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDateTime>
+
+#ifdef Q_OS_LINUX
+#include <QSocketNotifier>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 #ifndef Q_WS_WIN
-#include <QSet>
 #include <iostream>
 #include <errno.h>
 #if defined(Q_WS_MAC) || defined(Q_OS_FREEBSD)
@@ -37,20 +47,109 @@
 
 const int WATCH_INTERVAL = 10000; // 10 sec
 const int MAX_PARTIAL_RETRIES = 5;
+// Changes are batched during this interval
+const int DEBOUNCE_INTERVAL = 500;
+// A steady stream of changes is still processed after this delay
+const int MAX_DEBOUNCE_DELAY = 5000;
+
+/*
+ * Checks the validity of torrent files in a separate thread
+ * so that big drop folders do not block the user interface.
+ */
+class TorrentFileChecker : public QThread {
+  Q_OBJECT
+
+public:
+  TorrentFileChecker(QObject *parent): QThread(parent), m_running(false), m_abort(false) {}
+
+  ~TorrentFileChecker() {
+    m_abort = true;
+    wait();
+  }
+
+  void check(const QStringList &paths) {
+    if (paths.isEmpty())
+      return;
+    QMutexLocker locker(&m_mutex);
+    foreach (const QString &path, paths)
+      m_pendingPaths << path;
+    if (!m_running) {
+      m_running = true;
+      // Make sure the previous run is over
+      wait();
+      start(QThread::LowPriority);
+    }
+  }
+
+signals:
+  void filesChecked(const QStringList &valid_paths, const QStringList &partial_paths);
+
+protected:
+  void run() {
+    forever {
+      QSet<QString> paths;
+      {
+        QMutexLocker locker(&m_mutex);
+        if (m_pendingPaths.isEmpty() || m_abort) {
+          m_running = false;
+          return;
+        }
+        paths = m_pendingPaths;
+        m_pendingPaths.clear();
+      }
+      QStringList valid_paths;
+      QStringList partial_paths;
+      foreach (const QString &path, paths) {
+        if (m_abort) return;
+        if (misc::isValidTorrentFile(path))
+          valid_paths << path;
+        else if (QFile::exists(path))
+          partial_paths << path;
+      }
+      emit filesChecked(valid_paths, partial_paths);
+    }
+  }
+
+private:
+  QMutex m_mutex;
+  QSet<QString> m_pendingPaths;
+  bool m_running;
+  bool m_abort;
+};
 
 /*
  * Subclassing QFileSystemWatcher in order to support Network File
  * System watching (NFS, CIFS) on Linux and Mac OS.
+ *
+ * On Linux, local folders are watched using inotify, which reports
+ * the files that were written or moved into the folder. Otherwise,
+ * the folder content is compared to a snapshot of the file sizes and
+ * modification times so that only new or modified files are reported.
  */
 class FileSystemWatcher: public QFileSystemWatcher {
   Q_OBJECT
 
 private:
+  // Size and modification time of the files in a folder
+  typedef QHash<QString, QPair<qint64, uint> > FolderSnapshot;
+
 #ifndef Q_WS_WIN
   QList<QDir> watched_folders;
   QPointer<QTimer> watch_timer;
+#endif
+#ifdef Q_OS_LINUX
+  int m_inotifyFd;
+  QPointer<QSocketNotifier> m_inotifyNotifier;
+  QHash<int, QString> m_inotifyWatches;
 #endif
   QStringList m_filters;
+  QHash<QString, FolderSnapshot> m_snapshots;
+  // Pending changes
+  QSet<QString> m_changedFolders;
+  QSet<QString> m_changedFiles;
+  QTimer m_debounceTimer;
+  QTime m_firstChangeTime; // Of the oldest pending change
+  TorrentFileChecker *m_checker;
   // Partial torrents
   QHash<QString, int> m_partialTorrents;
   QPointer<QTimer> m_partialTorrentTimer;
@@ -119,16 +218,37 @@ private:
 public:
   FileSystemWatcher(QObject *parent): QFileSystemWatcher(parent) {
     m_filters << "*.torrent";
+    m_debounceTimer.setSingleShot(true);
+    m_debounceTimer.setInterval(DEBOUNCE_INTERVAL);
+    connect(&m_debounceTimer, SIGNAL(timeout()), this, SLOT(processChanges()));
+    m_checker = new TorrentFileChecker(this);
+    connect(m_checker, SIGNAL(filesChecked(QStringList,QStringList)), this, SLOT(handleCheckedFiles(QStringList,QStringList)));
     connect(this, SIGNAL(directoryChanged(QString)), this, SLOT(scanLocalFolder(QString)));
+#ifdef Q_OS_LINUX
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0) {
+      m_inotifyNotifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+      connect(m_inotifyNotifier, SIGNAL(activated(int)), this, SLOT(readInotifyEvents()));
+    } else {
+      std::cerr << "Error: inotify_init1() failed, falling back to directory scans." << std::endl;
+    }
+#endif
   }
 
   ~FileSystemWatcher() {
 #ifndef Q_WS_WIN
     if (watch_timer)
       delete watch_timer;
+#endif
+#ifdef Q_OS_LINUX
+    if (m_inotifyNotifier)
+      delete m_inotifyNotifier;
+    if (m_inotifyFd >= 0)
+      ::close(m_inotifyFd);
 #endif
     if (m_partialTorrentTimer)
       delete m_partialTorrentTimer;
+    delete m_checker;
   }
 
   QStringList directories() const {
@@ -138,6 +258,9 @@ public:
       foreach (const QDir &dir, watched_folders)
         dirs << dir.canonicalPath();
     }
+#endif
+#ifdef Q_OS_LINUX
+    dirs << m_inotifyWatches.values();
 #endif
     dirs << QFileSystemWatcher::directories();
     return dirs;
@@ -160,18 +283,35 @@ public:
         connect(watch_timer, SIGNAL(timeout()), this, SLOT(scanNetworkFolders()));
         watch_timer->start(WATCH_INTERVAL); // 5 sec
       }
-    } else {
+      // Take the initial snapshot
+      scanNetworkFolders();
+      return;
+    }
 #endif
-      // Normal mode
-      qDebug("FS Watching is watching %s in normal mode", qPrintable(path));
-      QFileSystemWatcher::addPath(path);
-      scanLocalFolder(path);
-#ifndef Q_WS_WIN
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+      const int wd = inotify_add_watch(m_inotifyFd, QFile::encodeName(path).constData(), IN_CLOSE_WRITE | IN_MOVED_TO);
+      if (wd >= 0) {
+        qDebug("FS Watching is watching %s using inotify", qPrintable(path));
+        m_inotifyWatches.insert(wd, path);
+        // Report the files that are already there
+        QStringList torrents;
+        foreach (const QString &file, QDir(path).entryList(m_filters, QDir::Files, QDir::Unsorted))
+          torrents << QDir(path).absoluteFilePath(file);
+        m_checker->check(torrents);
+        return;
+      }
+      std::cerr << "Error: inotify_add_watch() failed for " << qPrintable(path) << std::endl;
     }
 #endif
+    // Normal mode
+    qDebug("FS Watching is watching %s in normal mode", qPrintable(path));
+    QFileSystemWatcher::addPath(path);
+    scanLocalFolder(path);
   }
 
   void removePath(const QString & path) {
+    m_snapshots.remove(QDir(path).absolutePath());
 #ifndef Q_WS_WIN
     QDir dir(path);
     for (int i = 0; i < watched_folders.count(); ++i) {
@@ -182,6 +322,17 @@ public:
         return;
       }
     }
+#endif
+#ifdef Q_OS_LINUX
+    QHash<int, QString>::iterator it = m_inotifyWatches.begin();
+    while (it != m_inotifyWatches.end()) {
+      if (QDir(it.value()) == QDir(path)) {
+        inotify_rm_watch(m_inotifyFd, it.key());
+        m_inotifyWatches.erase(it);
+        return;
+      }
+      ++it;
+    }
 #endif
     // Normal mode
     QFileSystemWatcher::removePath(path);
@@ -190,35 +341,96 @@ public:
 protected slots:
   void scanLocalFolder(QString path) {
     qDebug("scanLocalFolder(%s) called", qPrintable(path));
-    QStringList torrents;
-    // Local folders scan
-    addTorrentsFromDir(QDir(path), torrents);
-    // Report detected torrent files
-    if (!torrents.empty()) {
-      qDebug("The following files are being reported: %s", qPrintable(torrents.join("\n")));
-      emit torrentsAdded(torrents);
-    }
+    // Wait for the burst of changes to be over
+    m_changedFolders << path;
+    scheduleChanges();
   }
 
   void scanNetworkFolders() {
 #ifndef Q_WS_WIN
     qDebug("scanNetworkFolders() called");
+    // Network folders are compared to their previous snapshot
+    foreach (const QDir &dir, watched_folders)
+      m_changedFolders << dir.path();
+    scheduleChanges();
+#endif
+  }
+
+#ifdef Q_OS_LINUX
+  void readInotifyEvents() {
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    forever {
+      const ssize_t len = ::read(m_inotifyFd, buffer, sizeof(buffer));
+      if (len <= 0)
+        break;
+      const struct inotify_event *event;
+      for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + event->len) {
+        event = reinterpret_cast<const struct inotify_event*>(ptr);
+        if (event->mask & IN_Q_OVERFLOW) {
+          // Some events were lost, list the folders again
+          qDebug("inotify queue overflow, rescanning the folders");
+          foreach (const QString &path, m_inotifyWatches.values()) {
+            foreach (const QString &file, QDir(path).entryList(m_filters, QDir::Files, QDir::Unsorted))
+              m_changedFiles << QDir(path).absoluteFilePath(file);
+          }
+          continue;
+        }
+        if (!event->len)
+          continue;
+        const QString folder = m_inotifyWatches.value(event->wd);
+        if (folder.isEmpty())
+          continue;
+        const QString file_name = QFile::decodeName(event->name);
+        if (!file_name.endsWith(".torrent", Qt::CaseInsensitive))
+          continue;
+        m_changedFiles << QDir(folder).absoluteFilePath(file_name);
+      }
+    }
+    if (!m_changedFiles.isEmpty())
+      scheduleChanges();
+  }
+#endif
+
+  void processChanges() {
+    QStringList torrents = m_changedFiles.toList();
+    m_changedFiles.clear();
+    foreach (const QString &path, m_changedFolders)
+      diffFolder(QDir(path), torrents);
+    m_changedFolders.clear();
+    // Parsing is done in the checker thread
+    m_checker->check(torrents);
+  }
+
+  void handleCheckedFiles(const QStringList &valid_paths, const QStringList &partial_paths) {
+    foreach (const QString &path, partial_paths) {
+      if (!m_partialTorrents.contains(path)) {
+        qDebug("Partial torrent detected at: %s", qPrintable(path));
+        qDebug("Delay the file's processing...");
+        m_partialTorrents.insert(path, 0);
+      }
+    }
+    if (!m_partialTorrents.empty())
+      startPartialTorrentTimer();
+    if (valid_paths.isEmpty())
+      return;
     QStringList torrents;
-    // Network folders scan
-    foreach (const QDir &dir, watched_folders) {
-      //qDebug("FSWatcher: Polling manually folder %s", qPrintable(dir.path()));
-      addTorrentsFromDir(dir, torrents);
+    foreach (const QString &path, valid_paths) {
+      // Valid torrents are removed by the session once added,
+      // ignore the ones that were reported twice
+      if (!QFile::exists(path))
+        continue;
+      m_partialTorrents.remove(path);
+      torrents << path;
     }
     // Report detected torrent files
     if (!torrents.empty()) {
       qDebug("The following files are being reported: %s", qPrintable(torrents.join("\n")));
       emit torrentsAdded(torrents);
     }
-#endif
   }
 
   void processPartialTorrents() {
-    QStringList no_longer_partial;
+    QStringList retried_torrents;
 
     // Check which torrents are still partial
     foreach (const QString& torrent_path, m_partialTorrents.keys()) {
@@ -226,37 +438,43 @@ protected slots:
         m_partialTorrents.remove(torrent_path);
         continue;
       }
-      if (misc::isValidTorrentFile(torrent_path)) {
-        no_longer_partial << torrent_path;
-         m_partialTorrents.remove(torrent_path);
+      if (m_partialTorrents[torrent_path] >= MAX_PARTIAL_RETRIES) {
+        m_partialTorrents.remove(torrent_path);
+        QFile::rename(torrent_path, torrent_path+".invalid");
       } else {
-        if (m_partialTorrents[torrent_path] >= MAX_PARTIAL_RETRIES) {
-          m_partialTorrents.remove(torrent_path);
-          QFile::rename(torrent_path, torrent_path+".invalid");
-        } else {
-          m_partialTorrents[torrent_path]++;
-        }
+        m_partialTorrents[torrent_path]++;
+        retried_torrents << torrent_path;
       }
     }
 
     // Stop the partial timer if necessary
     if (m_partialTorrents.empty()) {
-      m_partialTorrentTimer->stop();
       m_partialTorrentTimer->deleteLater();
       qDebug("No longer any partial torrent.");
     } else {
       qDebug("Still %d partial torrents after delayed processing.", m_partialTorrents.count());
       m_partialTorrentTimer->start(WATCH_INTERVAL);
     }
-    // Notify of new torrents
-    if (!no_longer_partial.isEmpty())
-      emit torrentsAdded(no_longer_partial);
+    // Check them again
+    m_checker->check(retried_torrents);
   }
 
 signals:
   void torrentsAdded(QStringList &pathList);
 
 private:
+  // Each change postpones the processing, up to MAX_DEBOUNCE_DELAY
+  // after the oldest pending one
+  void scheduleChanges() {
+    if (!m_debounceTimer.isActive()) {
+      m_firstChangeTime.start();
+      m_debounceTimer.start(DEBOUNCE_INTERVAL);
+      return;
+    }
+    const int remaining = MAX_DEBOUNCE_DELAY - m_firstChangeTime.elapsed();
+    m_debounceTimer.start(qBound(0, remaining, DEBOUNCE_INTERVAL));
+  }
+
   void startPartialTorrentTimer() {
     Q_ASSERT(!m_partialTorrents.isEmpty());
     if (!m_partialTorrentTimer) {
@@ -267,22 +485,20 @@ private:
     }
   }
 
-  void addTorrentsFromDir(const QDir &dir, QStringList &torrents) {
-    const QStringList files = dir.entryList(m_filters, QDir::Files, QDir::Unsorted);
-    foreach (const QString &file, files) {
-      const QString file_abspath = dir.absoluteFilePath(file);
-      if (misc::isValidTorrentFile(file_abspath)) {
+  // Reports the files that are new or were modified since the previous call
+  void diffFolder(const QDir &dir, QStringList &torrents) {
+    FolderSnapshot &snapshot = m_snapshots[dir.absolutePath()];
+    FolderSnapshot new_snapshot;
+    const QFileInfoList files = dir.entryInfoList(m_filters, QDir::Files, QDir::Unsorted);
+    foreach (const QFileInfo &file, files) {
+      const QString file_abspath = file.absoluteFilePath();
+      const QPair<qint64, uint> stamp(file.size(), file.lastModified().toTime_t());
+      new_snapshot.insert(file_abspath, stamp);
+      FolderSnapshot::const_iterator it = snapshot.find(file_abspath);
+      if (it == snapshot.end() || it.value() != stamp)
         torrents << file_abspath;
-      } else {
-        if (!m_partialTorrents.contains(file_abspath)) {
-          qDebug("Partial torrent detected at: %s", qPrintable(file_abspath));
-          qDebug("Delay the file's processing...");
-          m_partialTorrents.insert(file_abspath, 0);
-        }
-      }
     }
-    if (!m_partialTorrents.empty())
-      startPartialTorrentTimer();
+    snapshot = new_snapshot;
   }
 
 };
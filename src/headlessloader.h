@@ -85,6 +85,7 @@ public slots:
   // the right addTorrent function, considering
   // the parameter type.
   void processParams(const QStringList& params) {
+    QStringList torrentFiles;
     foreach (QString param, params) {
       param = param.trimmed();
       if (param.startsWith(QString::fromUtf8("http://"), Qt::CaseInsensitive) || param.startsWith(QString::fromUtf8("ftp://"), Qt::CaseInsensitive) || param.startsWith(QString::fromUtf8("https://"), Qt::CaseInsensitive)) {
@@ -97,10 +98,13 @@ public slots:
         if (param.startsWith("magnet:", Qt::CaseInsensitive)) {
           QBtSession::instance()->addMagnetUri(param);
         } else {
-          QBtSession::instance()->addTorrent(param);
+          torrentFiles << param;
         }
       }
     }
+    // Torrent files are added in bulk
+    if (!torrentFiles.isEmpty())
+      QBtSession::instance()->addTorrents(torrentFiles);
   }
 
 };
@@ -30,17 +30,17 @@
 #include <QKeyEvent>
 #include <QApplication>
 #include <QClipboard>
-#include <QListWidgetItem>
-#include <QLabel>
-#include <QRegExp>
 #include <QAction>
 #include "loglistwidget.h"
 #include "iconprovider.h"
 
-LogListWidget::LogListWidget(int max_lines, QWidget *parent) :
-  QListWidget(parent),
-  m_maxLines(max_lines)
+LogListWidget::LogListWidget(QWidget *parent) :
+  QListView(parent)
 {
+  // All the lines have the same height, this spares the view
+  // from measuring every row
+  setUniformItemSizes(true);
+  setEditTriggers(QAbstractItemView::NoEditTriggers);
   // Allow multiple selections
   setSelectionMode(QAbstractItemView::ExtendedSelection);
   // Context menu
@@ -62,28 +62,13 @@ void LogListWidget::keyPressEvent(QKeyEvent *event)
   }
 }
 
-void LogListWidget::appendLine(const QString &line)
-{
-  QListWidgetItem *item = new QListWidgetItem;
-  // We need to use QLabel here to support rich text
-  QLabel *lbl = new QLabel(line);
-  lbl->setContentsMargins(4, 2, 4, 2);
-  item->setSizeHint(lbl->sizeHint());
-  insertItem(0, item);
-  setItemWidget(item, lbl);
-  const int nbLines = count();
-  // Limit log size
-  if (nbLines > m_maxLines)
-    delete takeItem(nbLines - 1);
-}
-
 void LogListWidget::copySelection()
 {
-  static QRegExp html_tag("<[^>]+>");
-  QList<QListWidgetItem*> items = selectedItems();
+  QModelIndexList indexes = selectionModel()->selectedRows();
+  qSort(indexes);
   QStringList strings;
-  foreach (QListWidgetItem* it, items)
-    strings << static_cast<QLabel*>(itemWidget(it))->text().replace(html_tag, "");
+  foreach (const QModelIndex &index, indexes)
+    strings << index.data().toString();
 
   QApplication::clipboard()->setText(strings.join("\n"));
 }
@@ -30,21 +30,18 @@
 #ifndef LOGLISTWIDGET_H
 #define LOGLISTWIDGET_H
 
-#include <QListWidget>
+#include <QListView>
 
 QT_BEGIN_NAMESPACE
 class QKeyEvent;
 QT_END_NAMESPACE
 
-class LogListWidget : public QListWidget
+class LogListWidget : public QListView
 {
     Q_OBJECT
 
 public:
-  explicit LogListWidget(int max_lines = 100, QWidget *parent = 0);
-
-public slots:
-  void appendLine(const QString &line);
+  explicit LogListWidget(QWidget *parent = 0);
 
 protected slots:
   void copySelection();
@@ -52,9 +49,6 @@ protected slots:
 protected:
   void keyPressEvent(QKeyEvent *event);
 
-private:
-  int m_maxLines;
-
 };
 
 #endif // LOGLISTWIDGET_H
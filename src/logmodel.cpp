@@ -0,0 +1,106 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QColor>
+#include <QTimer>
+#include "logmodel.h"
+#include "logbuffer.h"
+
+LogModel::LogModel(const LogBuffer *log, QObject *parent):
+  QAbstractListModel(parent), m_log(log), m_lastId(0), m_count(0),
+  m_refreshPending(false)
+{
+  m_lastId = m_log->lastId();
+  m_count = m_log->size();
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return m_count;
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= m_count)
+    return QVariant();
+  if (role != Qt::DisplayRole && role != Qt::ForegroundRole && role != Qt::ToolTipRole)
+    return QVariant();
+  LogRecord rec;
+  // The record may have been replaced since the last refresh
+  if (!m_log->record(m_lastId - index.row(), rec))
+    return QVariant();
+  switch(role) {
+  case Qt::ForegroundRole:
+    switch(rec.severity) {
+    case LogRecord::INFO:
+      return QColor(Qt::blue);
+    case LogRecord::WARNING:
+      return QColor(255, 140, 0); // Dark orange
+    case LogRecord::CRITICAL:
+      return QColor(Qt::red);
+    default:
+      return QVariant();
+    }
+  default:
+    return rec.toPlainText();
+  }
+}
+
+void LogModel::scheduleRefresh() {
+  if (m_refreshPending) return;
+  m_refreshPending = true;
+  QTimer::singleShot(0, this, SLOT(refresh()));
+}
+
+void LogModel::refresh() {
+  m_refreshPending = false;
+  const qulonglong last_id = m_log->lastId();
+  const int size = m_log->size();
+  if (last_id == m_lastId) return;
+  const qulonglong added = last_id - m_lastId;
+  if (added >= (qulonglong)size) {
+    // None of the displayed records is left
+    beginResetModel();
+    m_lastId = last_id;
+    m_count = size;
+    endResetModel();
+    return;
+  }
+  // Oldest records were replaced by the new ones
+  const int kept = size - (int)added;
+  if (m_count > kept) {
+    beginRemoveRows(QModelIndex(), kept, m_count - 1);
+    m_count = kept;
+    endRemoveRows();
+  }
+  beginInsertRows(QModelIndex(), 0, (int)added - 1);
+  m_lastId = last_id;
+  m_count += (int)added;
+  endInsertRows();
+}
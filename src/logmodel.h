@@ -0,0 +1,65 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+
+class LogBuffer;
+
+// Read-only view of a LogBuffer, newest record first.
+// Only the visible rows are formatted, when the view asks for them.
+class LogModel : public QAbstractListModel {
+  Q_OBJECT
+  Q_DISABLE_COPY(LogModel)
+
+public:
+  explicit LogModel(const LogBuffer *log, QObject *parent = 0);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+public slots:
+  // Records are usually added in bursts, the rows are updated once
+  // control returns to the event loop
+  void scheduleRefresh();
+
+private slots:
+  void refresh();
+
+private:
+  const LogBuffer *m_log;
+  qulonglong m_lastId; // Id of the record in the first row
+  int m_count;
+  bool m_refreshPending;
+};
+
+#endif // LOGMODEL_H
@@ -923,14 +923,14 @@ void MainWindow::on_actionOpen_triggered() {
                                                               tr("Torrent Files")+QString::fromUtf8(" (*.torrent)"));
   if (!pathsList.empty()) {
     const bool useTorrentAdditionDialog = pref.useAdditionDialog();
-    const uint listSize = pathsList.size();
-    for (uint i=0; i<listSize; ++i) {
-      if (useTorrentAdditionDialog) {
+    if (useTorrentAdditionDialog) {
+      const uint listSize = pathsList.size();
+      for (uint i=0; i<listSize; ++i) {
         torrentAdditionDialog *dialog = new torrentAdditionDialog(this);
         dialog->showLoad(pathsList.at(i));
-      }else{
-        QBtSession::instance()->addTorrent(pathsList.at(i));
       }
+    }else{
+      QBtSession::instance()->addTorrents(pathsList);
     }
     // Save last dir to remember it
     QStringList top_dir = pathsList.at(0).split(QDir::separator());
@@ -950,6 +950,7 @@ void MainWindow::processParams(const QString& params_str) {
 void MainWindow::processParams(const QStringList& params) {
   Preferences pref;
   const bool useTorrentAdditionDialog = pref.useAdditionDialog();
+  QStringList torrentFiles;
   foreach (QString param, params) {
     param = param.trimmed();
     if (misc::isUrl(param)) {
@@ -971,11 +972,14 @@ void MainWindow::processParams(const QStringList& params) {
           torrentAdditionDialog *dialog = new torrentAdditionDialog(this);
           dialog->showLoad(param);
         }else{
-          QBtSession::instance()->addTorrent(param);
+          torrentFiles << param;
         }
       }
     }
   }
+  // Torrent files are added in bulk
+  if (!torrentFiles.isEmpty())
+    QBtSession::instance()->addTorrents(torrentFiles);
 }
 
 void MainWindow::addTorrent(QString path) {
@@ -983,8 +987,8 @@ void MainWindow::addTorrent(QString path) {
 }
 
 void MainWindow::processDownloadedFiles(QString path, QString url) {
-  QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent"));
-  const bool useTorrentAdditionDialog = settings.value(QString::fromUtf8("Preferences/Downloads/AdditionDialog"), true).toBool();
+  // Defaults to true here, unlike Preferences::useAdditionDialog()
+  const bool useTorrentAdditionDialog = Preferences().value(QString::fromUtf8("Preferences/Downloads/AdditionDialog"), true).toBool();
   if (useTorrentAdditionDialog) {
     torrentAdditionDialog *dialog = new torrentAdditionDialog(this);
     dialog->showLoad(path, url);
@@ -1156,8 +1160,8 @@ void MainWindow::showNotificationBaloon(QString title, QString msg) const {
  *****************************************************/
 
 void MainWindow::downloadFromURLList(const QStringList& url_list) {
-  QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent"));
-  const bool useTorrentAdditionDialog = settings.value(QString::fromUtf8("Preferences/Downloads/AdditionDialog"), true).toBool();
+  // Defaults to true here, unlike Preferences::useAdditionDialog()
+  const bool useTorrentAdditionDialog = Preferences().value(QString::fromUtf8("Preferences/Downloads/AdditionDialog"), true).toBool();
   foreach (QString url, url_list) {
     if (url.startsWith("bc://bt/", Qt::CaseInsensitive)) {
       qDebug("Converting bc link to magnet link");
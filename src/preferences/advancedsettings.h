@@ -9,8 +9,13 @@
 #include <QLineEdit>
 #include <QComboBox>
 #include <QNetworkInterface>
+#include <QDateTime>
+#include <QDir>
 #include <libtorrent/version.hpp>
 #include "preferences.h"
+#include "qbtsession.h"
+#include "misc.h"
+#include "tracer.h"
 
 enum AdvSettingsCols {PROPERTY, VALUE};
 enum AdvSettingsRows {DISK_CACHE, OUTGOING_PORT_MIN, OUTGOING_PORT_MAX, IGNORE_LIMIT_LAN, RECHECK_COMPLETED, LIST_REFRESH, RESOLVE_COUNTRIES, RESOLVE_HOSTS, MAX_HALF_OPEN, SUPER_SEEDING, NETWORK_IFACE, NETWORK_ADDRESS, PROGRAM_NOTIFICATIONS, TRACKER_STATUS, TRACKER_PORT,
@@ -21,14 +26,15 @@ enum AdvSettingsRows {DISK_CACHE, OUTGOING_PORT_MIN, OUTGOING_PORT_MAX, IGNORE_L
                       USE_ICON_THEME,
                     #endif
                       CONFIRM_DELETE_TORRENT, TRACKER_EXCHANGE,
-                      ANNOUNCE_ALL_TRACKERS,
+                      ANNOUNCE_ALL_TRACKERS, MAX_SEEDING_TIME, RECORD_TRACE,
                       ROW_COUNT};
 
 class AdvancedSettings: public QTableWidget {
   Q_OBJECT
 
 private:
-  QSpinBox spin_cache, outgoing_ports_min, outgoing_ports_max, spin_list_refresh, spin_maxhalfopen, spin_tracker_port;
+  QSpinBox spin_cache, outgoing_ports_min, outgoing_ports_max, spin_list_refresh, spin_maxhalfopen, spin_tracker_port,
+  spin_max_seeding_time;
   QCheckBox cb_ignore_limits_lan, cb_recheck_completed, cb_resolve_countries, cb_resolve_hosts,
   cb_super_seeding, cb_program_notifications, cb_tracker_status, cb_confirm_torrent_deletion,
   cb_enable_tracker_ext;
@@ -40,6 +46,7 @@ private:
   QCheckBox cb_use_icon_theme;
 #endif
   QCheckBox cb_announce_all_trackers;
+  QCheckBox cb_record_trace;
   QLineEdit txt_network_address;
 
 public:
@@ -112,6 +119,24 @@ public slots:
     // Tracker exchange
     pref.setTrackerExchangeEnabled(cb_enable_tracker_ext.isChecked());
     pref.setAnnounceToAllTrackers(cb_announce_all_trackers.isChecked());
+    // Seeding time limit
+    pref.setGlobalMaxSeedingMinutes(spin_max_seeding_time.value() > 0 ? spin_max_seeding_time.value() : -1);
+    // Performance trace (not saved)
+    if (cb_record_trace.isChecked() != Tracer::isEnabled()) {
+      if (cb_record_trace.isChecked()) {
+        Tracer::start();
+        QBtSession::instance()->addConsoleMessage(tr("Recording performance trace..."));
+      } else {
+        const QDir data_dir(misc::QDesktopServicesDataLocation());
+        if (!data_dir.exists())
+          data_dir.mkpath(data_dir.absolutePath());
+        const QString path = data_dir.absoluteFilePath("trace-"+QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")+".json");
+        if (Tracer::stop(path))
+          QBtSession::instance()->addConsoleMessage(tr("Performance trace saved to %1").arg(path));
+        else
+          QBtSession::instance()->addConsoleMessage(tr("Couldn't save performance trace to %1").arg(path), QString::fromUtf8("red"));
+      }
+    }
   }
 
 signals:
@@ -238,6 +263,15 @@ private slots:
     // Announce to all trackers
     cb_announce_all_trackers.setChecked(pref.announceToAllTrackers());
     setRow(ANNOUNCE_ALL_TRACKERS, tr("Always announce to all trackers"), &cb_announce_all_trackers);
+    // Seeding time limit
+    spin_max_seeding_time.setMinimum(0);
+    spin_max_seeding_time.setMaximum(QBtSession::MAX_SEEDING_TIME);
+    spin_max_seeding_time.setValue(qMax(pref.getGlobalMaxSeedingMinutes(), 0));
+    spin_max_seeding_time.setSuffix(tr(" min", " minutes"));
+    setRow(MAX_SEEDING_TIME, tr("Maximum seeding time [0: Disabled]"), &spin_max_seeding_time);
+    // Performance trace
+    cb_record_trace.setChecked(Tracer::isEnabled());
+    setRow(RECORD_TRACE, tr("Record performance trace"), &cb_record_trace);
   }
 
 };
@@ -36,6 +36,7 @@
 #include <QDir>
 #include <QTime>
 #include <QList>
+#include <QSettings>
 #include <QDebug>
 #include <libtorrent/version.hpp>
 
@@ -46,7 +47,7 @@
 #endif
 
 #include "misc.h"
-#include "qinisettings.h"
+#include "settingsstorage.h"
 
 #define QBT_REALM "Web UI Access"
 enum scheduler_days { EVERY_DAY, WEEK_DAYS, WEEK_ENDS, MON, TUE, WED, THU, FRI, SAT, SUN };
@@ -61,12 +62,19 @@ namespace DNS {
 enum Service { DYNDNS, NOIP, NONE = -1 };
 }
 
-class Preferences : public QIniSettings {
+// Typed accessors over the shared settings cache, cheap to construct
+class Preferences {
   Q_DISABLE_COPY(Preferences)
 
 public:
-  Preferences() : QIniSettings("qBittorrent", "qBittorrent") {
-    qDebug() << "Preferences constructor";
+  Preferences() : m_storage(SettingsStorage::instance()) {}
+
+  QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const {
+    return m_storage->value(key, defaultValue);
+  }
+
+  void setValue(const QString &key, const QVariant &value) {
+    m_storage->setValue(key, value);
   }
 
 public:
@@ -629,6 +637,15 @@ public:
     return value(QString::fromUtf8("Preferences/Bittorrent/MaxRatioAction"), PAUSE_ACTION).toInt();
   }
 
+  // -1: no limit. Reaching it triggers the max ratio action.
+  int getGlobalMaxSeedingMinutes() const {
+    return value(QString::fromUtf8("Preferences/Bittorrent/MaxSeedingMinutes"), -1).toInt();
+  }
+
+  void setGlobalMaxSeedingMinutes(int minutes) {
+    setValue(QString::fromUtf8("Preferences/Bittorrent/MaxSeedingMinutes"), minutes);
+  }
+
   // IP Filter
   bool isFilteringEnabled() const {
     return value(QString::fromUtf8("Preferences/IPFilter/Enabled"), false).toBool();
@@ -646,18 +663,16 @@ public:
     setValue(QString::fromUtf8("Preferences/IPFilter/File"), path);
   }
 
-  void banIP(const QString &ip) {
-    QStringList banned_ips = value(QString::fromUtf8("Preferences/IPFilter/BannedIPs"), QStringList()).toStringList();
-    if (!banned_ips.contains(ip)) {
-      banned_ips << ip;
-      setValue("Preferences/IPFilter/BannedIPs", banned_ips);
-    }
-  }
-
+  // Manual bans are now saved by the BanManager, these are only
+  // read once to import them
   QStringList bannedIPs() const {
     return value(QString::fromUtf8("Preferences/IPFilter/BannedIPs"), QStringList()).toStringList();
   }
 
+  void clearBannedIPs() {
+    setValue(QString::fromUtf8("Preferences/IPFilter/BannedIPs"), QStringList());
+  }
+
   // Search
   bool isSearchEnabled() const {
     return value(QString::fromUtf8("Preferences/Search/SearchEnabled"), true).toBool();
@@ -745,6 +760,15 @@ public:
     setValue("Preferences/WebUI/Port", port);
   }
 
+  // Maximum size of a Web UI request, in MiB
+  int getWebUiMaxUploadSize() const {
+    return value("Preferences/WebUI/MaxUploadSize", 100).toInt();
+  }
+
+  void setWebUiMaxUploadSize(int size_mb) {
+    setValue("Preferences/WebUI/MaxUploadSize", size_mb);
+  }
+
   bool useUPnPForWebUIPort() const {
     return value("Preferences/WebUI/UseUPnP", true).toBool();
   }
@@ -1057,6 +1081,10 @@ public:
     return value("TransferListFilters/customLabels").toStringList();
   }
 
+  void setTorrentLabels(const QStringList& labels) {
+    setValue("TransferListFilters/customLabels", labels);
+  }
+
   void addTorrentLabel(const QString& label) {
     QStringList labels = value("TransferListFilters/customLabels").toStringList();
     if (!labels.contains(label))
@@ -1081,7 +1109,7 @@ public:
 
 #ifdef Q_WS_WIN
   static QString getPythonPath() {
-    QSettings reg_python("HKEY_LOCAL_MACHINE\\SOFTWARE\\Python\\PythonCore", QIniSettings::NativeFormat);
+    QSettings reg_python("HKEY_LOCAL_MACHINE\\SOFTWARE\\Python\\PythonCore", QSettings::NativeFormat);
     QStringList versions = reg_python.childGroups();
     qDebug("Python versions nb: %d", versions.size());
     //versions = versions.filter(QRegExp("2\\..*"));
@@ -1116,7 +1144,7 @@ public:
   }
 
   static bool isTorrentFileAssocSet() {
-    QSettings settings("HKEY_CLASSES_ROOT", QIniSettings::NativeFormat);
+    QSettings settings("HKEY_CLASSES_ROOT", QSettings::NativeFormat);
     if (settings.value(".torrent/Default").toString() != "qBittorrent") {
       qDebug(".torrent != qBittorrent");
       return false;
@@ -1140,7 +1168,7 @@ public:
   }
 
   static bool isMagnetLinkAssocSet() {
-    QSettings settings("HKEY_CLASSES_ROOT", QIniSettings::NativeFormat);
+    QSettings settings("HKEY_CLASSES_ROOT", QSettings::NativeFormat);
 
     // Check magnet link assoc
     QRegExp exe_reg("\"([^\"]+)\".*");
@@ -1241,6 +1269,9 @@ public:
   void setTrayIconStyle(TrayIcon::Style style) {
     setValue(QString::fromUtf8("Preferences/Advanced/TrayIconStyle"), style);
   }
+
+private:
+  SettingsStorage *m_storage;
 };
 
 #endif // PREFERENCES_H
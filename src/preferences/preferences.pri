@@ -10,4 +10,7 @@ INCLUDEPATH += $$PWD
   FORMS += $$PWD/options.ui
 }
 
-HEADERS += $$PWD/preferences.h
+HEADERS += $$PWD/preferences.h \
+           $$PWD/settingsstorage.h
+
+SOURCES += $$PWD/settingsstorage.cpp
@@ -0,0 +1,127 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMutex>
+#include "settingsstorage.h"
+#include "qinisettings.h"
+
+// Delay between the last change and its saving
+const int SAVE_DELAY = 2000; // ms
+// Longest delay between the oldest unsaved change and its saving
+const int MAX_SAVE_DELAY = 10000; // ms
+
+SettingsStorage* SettingsStorage::m_instance = 0;
+
+SettingsStorage* SettingsStorage::instance() {
+  static QMutex mutex;
+  QMutexLocker locker(&mutex);
+  if (!m_instance) {
+    m_instance = new SettingsStorage;
+    // Changes made while the main window is destroyed are saved too
+    qAddPostRoutine(SettingsStorage::drop);
+  }
+  return m_instance;
+}
+
+void SettingsStorage::drop() {
+  if (m_instance) {
+    delete m_instance;
+    m_instance = 0;
+  }
+}
+
+SettingsStorage::SettingsStorage():
+  m_settings(new QIniSettings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent")))
+{
+  // The save timer must live in the main thread
+  if (QCoreApplication::instance()) {
+    moveToThread(QCoreApplication::instance()->thread());
+    m_saveTimer.moveToThread(QCoreApplication::instance()->thread());
+  }
+  m_saveTimer.setSingleShot(true);
+  connect(&m_saveTimer, SIGNAL(timeout()), SLOT(save()));
+}
+
+SettingsStorage::~SettingsStorage() {
+  save();
+  delete m_settings;
+}
+
+QVariant SettingsStorage::value(const QString &key, const QVariant &defaultValue) const {
+  {
+    QReadLocker locker(&m_lock);
+    QHash<QString, QVariant>::const_iterator it = m_values.constFind(key);
+    if (it != m_values.constEnd())
+      return it.value().isValid() ? it.value() : defaultValue;
+  }
+  // First access to this key
+  QWriteLocker locker(&m_lock);
+  QHash<QString, QVariant>::const_iterator it = m_values.constFind(key);
+  if (it == m_values.constEnd())
+    it = m_values.insert(key, m_settings->value(key));
+  return it.value().isValid() ? it.value() : defaultValue;
+}
+
+void SettingsStorage::setValue(const QString &key, const QVariant &value) {
+  {
+    QWriteLocker locker(&m_lock);
+    QHash<QString, QVariant>::iterator it = m_values.find(key);
+    if (it != m_values.end() && it.value() == value && it.value().type() == value.type())
+      return;
+    m_values.insert(key, value);
+    m_dirtyKeys.insert(key);
+    QMetaObject::invokeMethod(this, "scheduleSave", Qt::QueuedConnection);
+  }
+  emit changed(key);
+}
+
+// Each change postpones the saving, up to MAX_SAVE_DELAY after the
+// oldest unsaved one, so that a steady stream of changes is saved too
+void SettingsStorage::scheduleSave() {
+  if (!m_saveTimer.isActive()) {
+    m_firstChangeTime.start();
+    m_saveTimer.start(SAVE_DELAY);
+    return;
+  }
+  const int remaining = MAX_SAVE_DELAY - m_firstChangeTime.elapsed();
+  m_saveTimer.start(qBound(0, remaining, SAVE_DELAY));
+}
+
+void SettingsStorage::save() {
+  QWriteLocker locker(&m_lock);
+  if (m_dirtyKeys.isEmpty()) return;
+  qDebug("Saving %d settings", m_dirtyKeys.size());
+  foreach (const QString &key, m_dirtyKeys)
+    m_settings->setValue(key, m_values.value(key));
+  m_dirtyKeys.clear();
+  m_settings->sync();
+}
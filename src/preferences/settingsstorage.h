@@ -0,0 +1,85 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef SETTINGSSTORAGE_H
+#define SETTINGSSTORAGE_H
+
+#include <QHash>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QTime>
+#include <QTimer>
+#include <QVariant>
+
+class QIniSettings;
+
+// Process wide cache of the qBittorrent settings file.
+// Values are read from disk once, then served from memory. Changes are
+// written back in batches, a short while after the last one (but not
+// later than a few seconds after the oldest one), and when the
+// application exits. Can be used from any thread.
+class SettingsStorage : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(SettingsStorage)
+
+public:
+  static SettingsStorage* instance();
+  // Saves pending changes and deletes the instance
+  static void drop();
+
+  QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+  void setValue(const QString &key, const QVariant &value);
+
+public slots:
+  void save();
+
+signals:
+  // Emitted from the thread that changed the value
+  void changed(const QString &key);
+
+private slots:
+  void scheduleSave();
+
+private:
+  SettingsStorage();
+  ~SettingsStorage();
+
+private:
+  static SettingsStorage *m_instance;
+  QIniSettings *m_settings;
+  mutable QReadWriteLock m_lock;
+  mutable QHash<QString, QVariant> m_values; // Invalid value: key not set
+  QSet<QString> m_dirtyKeys;
+  QTimer m_saveTimer;
+  QTime m_firstChangeTime; // Of the oldest unsaved change
+};
+
+#endif // SETTINGSSTORAGE_H
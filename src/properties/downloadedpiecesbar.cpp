@@ -29,6 +29,7 @@
  */
 
 #include "downloadedpiecesbar.h"
+#include <cstring>
 
 //#include <QDebug>
 
@@ -44,93 +45,72 @@ DownloadedPiecesBar::DownloadedPiecesBar(QWidget *parent): QWidget(parent)
   updatePieceColors();
 }
 
-std::vector<float> DownloadedPiecesBar::bitfieldToFloatVector(const libtorrent::bitfield &vecin, int reqSize)
+// Number of set bits in a 32 bits word, without branches
+static inline int countBits(quint32 v)
 {
-  std::vector<float> result(reqSize, 0.0);
-
-  if (vecin.empty())
-    return result;
-
-  const float ratio = vecin.size() / (float)reqSize;
-
-  // simple linear transformation algorithm
-  // for example:
-  // image.x(0) = pieces.x(0.0 >= x < 1.7)
-  // image.x(1) = pieces.x(1.7 >= x < 3.4)
-
-  for (int x = 0; x < reqSize; ++x) {
-
-    // don't use previously calculated value "ratio" here!!!
-    // float cannot save irrational number like 7/9, if this number will be rounded up by std::ceil
-    // give you x2 == pieces.size(), and index out of range: pieces[x2]
-    // this code is safe, so keep that in mind when you try optimize more.
-    // tested with size = 3000000ul
-
-    // R - real
-    const float fromR = (x * vecin.size()) / (float)reqSize;
-    const float toR = ((x + 1) * vecin.size()) / (float)reqSize;
-
-    // C - integer
-    int fromC = fromR;// std::floor not needed
-    int toC = std::ceil(toR);
-
-    // position in pieces table
-    // libtorrent::bitfield::m_size is unsigned int(31 bits), so qlonglong is not needed
-    // tested with size = 3000000ul
-    int x2 = fromC;
+  v = v - ((v >> 1) & 0x55555555);
+  v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+  return (((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+}
 
-    // little speed up for really big pieces table, 10K+ size
-    const int toCMinusOne = toC - 1;
+// Bitfield as seen by PiecesAggregate::rebuild()
+struct BitfieldSource {
+  BitfieldSource(const libtorrent::bitfield &field): bf(field), bytes((const uchar*)field.bytes()) {}
 
-    // value in returned vector
-    float value = 0;
+  int size() const { return bf.size(); }
+  qint64 value(int piece) const { return bf[piece] ? 1 : 0; }
 
-    // case when calculated range is (15.2 >= x < 15.7)
-    if (x2 == toCMinusOne) {
-      if (vecin[x2]) {
-        value += toR - fromR;
-      }
-      ++x2;
+  // Whole bytes are counted 4 at a time
+  qint64 sum(int from, int to) const {
+    qint64 count = 0;
+    while (from < to && (from & 7)) {
+      count += value(from);
+      ++from;
     }
-    // case when (15.2 >= x < 17.8)
-    else {
-      // subcase (15.2 >= x < 16)
-      if (x2 != fromR) {
-        if (vecin[x2]) {
-          value += 1.0 - (fromR - fromC);
-        }
-        ++x2;
-      }
+    int byte = from >> 3;
+    const int end_byte = to >> 3;
+    for ( ; byte + 4 <= end_byte; byte += 4) {
+      const quint32 word = (quint32(bytes[byte]) << 24) | (quint32(bytes[byte + 1]) << 16)
+          | (quint32(bytes[byte + 2]) << 8) | quint32(bytes[byte + 3]);
+      count += countBits(word);
+    }
+    for ( ; byte < end_byte; ++byte)
+      count += countBits(bytes[byte]);
+    for (from = qMax(from, end_byte << 3); from < to; ++from)
+      count += value(from);
+    return count;
+  }
 
-      // subcase (16 >= x < 17)
-      for (; x2 < toCMinusOne; ++x2) {
-        if (vecin[x2]) {
-          value += 1.0;
-        }
-      }
+  const libtorrent::bitfield &bf;
+  const uchar *bytes;
+};
 
-      // subcase (17 >= x < 17.8)
-      if (x2 == toCMinusOne) {
-        if (vecin[x2]) {
-          value += 1.0 - (toC - toR);
-        }
-        ++x2;
+// Adds the bits that differ between old_bf and new_bf (of the same size)
+// to sums. Identical blocks of bytes are skipped with memcmp()
+static void addChangedPieces(const libtorrent::bitfield &old_bf, const libtorrent::bitfield &new_bf, PiecesAggregate &sums)
+{
+  const int BLOCK_SIZE = 64;
+  const uchar *old_bytes = (const uchar*)old_bf.bytes();
+  const uchar *new_bytes = (const uchar*)new_bf.bytes();
+  const int nb_pieces = new_bf.size();
+  const int nb_bytes = (nb_pieces + 7) / 8;
+  for (int block = 0; block < nb_bytes; block += BLOCK_SIZE) {
+    const int block_end = qMin(block + BLOCK_SIZE, nb_bytes);
+    if (memcmp(old_bytes + block, new_bytes + block, block_end - block) == 0)
+      continue;
+    for (int byte = block; byte < block_end; ++byte) {
+      const uchar diff = old_bytes[byte] ^ new_bytes[byte];
+      if (!diff) continue;
+      for (int bit = 0; bit < 8; ++bit) {
+        if (!(diff & (0x80 >> bit))) continue;
+        const int piece = byte * 8 + bit;
+        if (piece >= nb_pieces) break;
+        sums.add(piece, new_bf[piece] ? 1 : -1);
       }
     }
-
-    // normalization <0, 1>
-    value /= ratio;
-
-    // float precision sometimes gives > 1, because in not possible to store irrational numbers
-    value = qMin(value, (float)1.0);
-
-    result[x] = value;
   }
-
-  return result;
 }
 
-
 int DownloadedPiecesBar::mixTwoColors(int &rgb1, int &rgb2, float ratio)
 {
   int r1 = qRed(rgb1);
@@ -149,51 +129,101 @@ int DownloadedPiecesBar::mixTwoColors(int &rgb1, int &rgb2, float ratio)
   return qRgb(r, g, b);
 }
 
+int DownloadedPiecesBar::pixelColor(int x)
+{
+  const qint64 total = pieces_sums.pieces();
+  const qint64 done = pieces_sums.sum(x);
+  const qint64 dl = x < pieces_dl_sums.pixels() ? pieces_dl_sums.sum(x) : 0;
+  if (dl != 0) {
+    float fill_ratio = qMin((float)(done + dl) / total, (float)1.0);
+    float ratio = (float)dl / (done + dl);
+
+    int mixedColor = mixTwoColors(piece_color, piece_color_dl, ratio);
+    return mixTwoColors(bg_color, mixedColor, fill_ratio);
+  }
+  return piece_colors[qMin(done * 255 / total, (qint64)255)];
+}
+
 void DownloadedPiecesBar::updateImage()
 {
   //  qDebug() << "updateImage";
-  QImage image2(width() - 2, 1, QImage::Format_RGB888);
+  const int w = qMax(width() - 2, 1);
+  image = QImage(w, 1, QImage::Format_RGB888);
 
   if (pieces.empty()) {
-    image2.fill(0xffffff);
-    image = image2;
-    update();
+    pieces_sums.clear();
+    pieces_dl_sums.clear();
+    image.fill(0xffffff);
     return;
   }
 
-  std::vector<float> scaled_pieces = bitfieldToFloatVector(pieces, image2.width());
-  std::vector<float> scaled_pieces_dl = bitfieldToFloatVector(pieces_dl, image2.width());
-
-  // filling image
-  for (unsigned int x = 0; x < scaled_pieces.size(); ++x)
-  {
-    float pieces2_val = scaled_pieces.at(x);
-    float pieces2_val_dl = scaled_pieces_dl.at(x);
-    if (pieces2_val_dl != 0)
-    {
-      float fill_ratio = pieces2_val + pieces2_val_dl;
-      float ratio = pieces2_val_dl / fill_ratio;
+  pieces_sums.rebuild(w, BitfieldSource(pieces));
+  if (pieces_dl.size() == pieces.size())
+    pieces_dl_sums.rebuild(w, BitfieldSource(pieces_dl));
+  else
+    pieces_dl_sums.clear();
+  // The whole image is drawn below
+  int first, last;
+  pieces_sums.takeDirtyRange(first, last);
+  pieces_dl_sums.takeDirtyRange(first, last);
+  updatePixels(0, w - 1);
+}
 
-      int mixedColor = mixTwoColors(piece_color, piece_color_dl, ratio);
-      mixedColor = mixTwoColors(bg_color, mixedColor, fill_ratio);
+void DownloadedPiecesBar::updatePixels(int first, int last)
+{
+  for (int x = first; x <= last; ++x)
+    image.setPixel(x, 0, pixelColor(x));
+}
 
-      image2.setPixel(x, 0, mixedColor);
-    }
-    else
-    {
-      image2.setPixel(x, 0, piece_colors[pieces2_val * 255]);
+void DownloadedPiecesBar::updateDirtyPixels()
+{
+  int first, last, first_dl, last_dl;
+  bool dirty = pieces_sums.takeDirtyRange(first, last);
+  if (pieces_dl_sums.takeDirtyRange(first_dl, last_dl)) {
+    if (dirty) {
+      first = qMin(first, first_dl);
+      last = qMax(last, last_dl);
+    } else {
+      first = first_dl;
+      last = last_dl;
+      dirty = true;
     }
   }
-  image = image2;
+  if (!dirty || pieces.empty()) return;
+  updatePixels(first, last);
+  update();
 }
 
 void DownloadedPiecesBar::setProgress(const libtorrent::bitfield &bf, const libtorrent::bitfield &bf_dl)
 {
-  pieces = libtorrent::bitfield(bf);
-  pieces_dl = libtorrent::bitfield(bf_dl);
+  // Only the pieces that changed since the last call need to be redrawn
+  if (image.isNull() || bf.size() != pieces.size() || bf_dl.size() != pieces_dl.size()
+      || pieces_sums.pixels() != image.width() || bf_dl.size() != bf.size()) {
+    pieces = bf;
+    pieces_dl = bf_dl;
+    updateImage();
+    update();
+    return;
+  }
 
-  updateImage();
-  update();
+  addChangedPieces(pieces, bf, pieces_sums);
+  addChangedPieces(pieces_dl, bf_dl, pieces_dl_sums);
+  pieces = bf;
+  pieces_dl = bf_dl;
+  updateDirtyPixels();
+}
+
+void DownloadedPiecesBar::setPieceFinished(int piece)
+{
+  if (image.isNull() || piece < 0 || piece >= pieces.size() || pieces[piece])
+    return;
+  pieces.set_bit(piece);
+  pieces_sums.add(piece, 1);
+  if (piece < pieces_dl.size() && pieces_dl[piece]) {
+    pieces_dl.clear_bit(piece);
+    pieces_dl_sums.add(piece, -1);
+  }
+  updateDirtyPixels();
 }
 
 void DownloadedPiecesBar::updatePieceColors()
@@ -208,6 +238,10 @@ void DownloadedPiecesBar::updatePieceColors()
 void DownloadedPiecesBar::clear()
 {
   image = QImage();
+  pieces = libtorrent::bitfield();
+  pieces_dl = libtorrent::bitfield();
+  pieces_sums.clear();
+  pieces_dl_sums.clear();
   update();
 }
 
@@ -241,7 +275,8 @@ void DownloadedPiecesBar::setColors(int background, int border, int complete, in
   piece_color_dl = incomplete;
 
   updatePieceColors();
-  updateImage();
+  if (!image.isNull() && !pieces.empty())
+    updatePixels(0, image.width() - 1);
   update();
 }
 
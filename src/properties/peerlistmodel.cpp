@@ -0,0 +1,336 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QCoreApplication>
+#include "peerlistmodel.h"
+#include "peerlistdelegate.h"
+#include "geoipmanager.h"
+#include "misc.h"
+
+using namespace libtorrent;
+
+PeerListModel::PeerListModel(QObject *parent):
+  QAbstractTableModel(parent), m_displayFlags(false)
+{
+}
+
+int PeerListModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return m_peers.size();
+}
+
+int PeerListModel::columnCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return PeerListDelegate::COL_COUNT;
+}
+
+QVariant PeerListModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= m_peers.size())
+    return QVariant();
+  const Peer &peer = m_peers.at(index.row());
+  if (index.column() == PeerListDelegate::IP) {
+    switch(role) {
+    case Qt::DisplayRole:
+      return peer.hostname.isEmpty() ? peer.ip : peer.hostname;
+    case Qt::DecorationRole:
+      if (m_displayFlags) {
+        const QIcon ico = flagIcon(peer.country);
+        if (!ico.isNull())
+          return ico;
+      }
+      return QVariant();
+    case Qt::ToolTipRole:
+      if (m_displayFlags && !flagIcon(peer.country).isNull())
+        return countryName(peer.country);
+      return QVariant();
+    default:
+      return QVariant();
+    }
+  }
+  if (role != Qt::DisplayRole)
+    return QVariant();
+  switch(index.column()) {
+  case PeerListDelegate::CONNECTION:
+    return connectionString(peer.connectionType);
+  case PeerListDelegate::CLIENT:
+    return peer.client;
+  case PeerListDelegate::PROGRESS:
+    return peer.progress;
+  case PeerListDelegate::DOWN_SPEED:
+    return peer.downSpeed;
+  case PeerListDelegate::UP_SPEED:
+    return peer.upSpeed;
+  case PeerListDelegate::TOT_DOWN:
+    return peer.totalDown;
+  case PeerListDelegate::TOT_UP:
+    return peer.totalUp;
+  case PeerListDelegate::IP_HIDDEN:
+    return peer.ip;
+  default:
+    return QVariant();
+  }
+}
+
+QVariant PeerListModel::headerData(int section, Qt::Orientation orientation, int role) const {
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+  switch(section) {
+  case PeerListDelegate::IP:
+    return QCoreApplication::translate("PeerListWidget", "IP");
+  case PeerListDelegate::CONNECTION:
+    return QCoreApplication::translate("PeerListWidget", "Connection");
+  case PeerListDelegate::CLIENT:
+    return QCoreApplication::translate("PeerListWidget", "Client", "i.e.: Client application");
+  case PeerListDelegate::PROGRESS:
+    return QCoreApplication::translate("PeerListWidget", "Progress", "i.e: % downloaded");
+  case PeerListDelegate::DOWN_SPEED:
+    return QCoreApplication::translate("PeerListWidget", "Down Speed", "i.e: Download speed");
+  case PeerListDelegate::UP_SPEED:
+    return QCoreApplication::translate("PeerListWidget", "Up Speed", "i.e: Upload speed");
+  case PeerListDelegate::TOT_DOWN:
+    return QCoreApplication::translate("PeerListWidget", "Downloaded", "i.e: total data downloaded");
+  case PeerListDelegate::TOT_UP:
+    return QCoreApplication::translate("PeerListWidget", "Uploaded", "i.e: total data uploaded");
+  default:
+    return QVariant();
+  }
+}
+
+// Returns the endpoints of the peers that were added so that
+// the caller can resolve their host names
+QList<boost::asio::ip::tcp::endpoint> PeerListModel::update(const std::vector<peer_info> &peers) {
+  QList<boost::asio::ip::tcp::endpoint> added;
+  const int old_count = m_peers.size();
+  QVector<bool> seen(old_count, false);
+  QVector<bool> changed(old_count, false);
+  QVector<Peer> new_peers;
+  std::vector<peer_info>::const_iterator it = peers.begin();
+  std::vector<peer_info>::const_iterator itend = peers.end();
+  for ( ; it != itend; ++it) {
+    const QByteArray key = endpointKey(it->ip);
+    QHash<QByteArray, int>::const_iterator row_it = m_rows.constFind(key);
+    if (row_it != m_rows.constEnd()) {
+      const int row = row_it.value();
+      if (row >= old_count || seen[row]) continue; // Duplicate
+      seen[row] = true;
+      changed[row] = setPeer(m_peers[row], *it);
+      continue;
+    }
+    // New peer
+    boost::system::error_code ec;
+    const QString ip = misc::toQString(it->ip.address().to_string(ec));
+    if (ec) continue;
+    Peer peer;
+    peer.key = key;
+    peer.endpoint = it->ip;
+    peer.ip = ip;
+    setPeer(peer, *it);
+    // Make sure duplicates are ignored until the rows are appended
+    m_rows.insert(key, old_count + new_peers.size());
+    new_peers << peer;
+    added << it->ip;
+  }
+  // Updated rows, signaled before any row is moved
+  emitRowsChanged(changed);
+  // Peers that are gone
+  if (seen.count(false) > 0)
+    removeMissingRows(seen);
+  // New peers
+  if (!new_peers.isEmpty()) {
+    const int first = m_peers.size();
+    beginInsertRows(QModelIndex(), first, first + new_peers.size() - 1);
+    for (int i = 0; i < new_peers.size(); ++i) {
+      m_rows.insert(new_peers.at(i).key, first + i);
+      m_peers << new_peers.at(i);
+    }
+    endInsertRows();
+  }
+  return added;
+}
+
+void PeerListModel::setHostName(const QString &ip, const QString &hostname) {
+  // Several peers can share the same IP (but not the same port)
+  for (int row = 0; row < m_peers.size(); ++row) {
+    Peer &peer = m_peers[row];
+    if (peer.ip != ip || peer.hostname == hostname) continue;
+    peer.hostname = hostname;
+    const QModelIndex idx = index(row, PeerListDelegate::IP);
+    emit dataChanged(idx, idx);
+  }
+}
+
+void PeerListModel::setDisplayFlags(bool display) {
+  if (m_displayFlags == display) return;
+  m_displayFlags = display;
+  if (!m_peers.isEmpty())
+    emit dataChanged(index(0, PeerListDelegate::IP), index(m_peers.size() - 1, PeerListDelegate::IP));
+}
+
+void PeerListModel::clear() {
+  if (m_peers.isEmpty()) return;
+  qDebug("Cleared %d peers", m_peers.size());
+  beginRemoveRows(QModelIndex(), 0, m_peers.size() - 1);
+  m_peers.clear();
+  m_rows.clear();
+  endRemoveRows();
+}
+
+QByteArray PeerListModel::endpointKey(const boost::asio::ip::tcp::endpoint &endpoint) {
+  QByteArray key;
+  const boost::asio::ip::address addr = endpoint.address();
+  if (addr.is_v4()) {
+    const boost::asio::ip::address_v4::bytes_type bytes = addr.to_v4().to_bytes();
+    key.reserve(bytes.size() + 2);
+    key.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  } else {
+    const boost::asio::ip::address_v6::bytes_type bytes = addr.to_v6().to_bytes();
+    key.reserve(bytes.size() + 2);
+    key.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  }
+  const unsigned short port = endpoint.port();
+  key.append(static_cast<char>(port >> 8));
+  key.append(static_cast<char>(port & 0xff));
+  return key;
+}
+
+QString PeerListModel::connectionString(int connection_type) {
+  switch(connection_type) {
+#if LIBTORRENT_VERSION_MINOR > 15
+  case peer_info::bittorrent_utp:
+    return QString::fromUtf8("uTP");
+  case peer_info::http_seed:
+#endif
+  case peer_info::web_seed:
+    return QString::fromUtf8("Web");
+  default:
+    return QString::fromUtf8("BT");
+  }
+}
+
+// Copies the displayed values of info into peer.
+// Returns true if any of them changed.
+bool PeerListModel::setPeer(Peer &peer, const peer_info &info) {
+  bool changed = false;
+  if (peer.rawClient != info.client || peer.client.isNull()) {
+    peer.rawClient = info.client;
+    peer.client = misc::toQStringU(info.client);
+    changed = true;
+  }
+  if (peer.country[0] != info.country[0] || peer.country[1] != info.country[1]) {
+    peer.country[0] = info.country[0];
+    peer.country[1] = info.country[1];
+    changed = true;
+  }
+  if (peer.connectionType != info.connection_type) {
+    peer.connectionType = info.connection_type;
+    changed = true;
+  }
+  if (peer.progress != info.progress) {
+    peer.progress = info.progress;
+    changed = true;
+  }
+  if (peer.downSpeed != info.payload_down_speed) {
+    peer.downSpeed = info.payload_down_speed;
+    changed = true;
+  }
+  if (peer.upSpeed != info.payload_up_speed) {
+    peer.upSpeed = info.payload_up_speed;
+    changed = true;
+  }
+  if (peer.totalDown != (qulonglong)info.total_download) {
+    peer.totalDown = info.total_download;
+    changed = true;
+  }
+  if (peer.totalUp != (qulonglong)info.total_upload) {
+    peer.totalUp = info.total_upload;
+    changed = true;
+  }
+  return changed;
+}
+
+QIcon PeerListModel::flagIcon(const char *country) const {
+  const QByteArray iso(country, 2);
+  QHash<QByteArray, QIcon>::const_iterator it = m_flags.constFind(iso);
+  if (it != m_flags.constEnd())
+    return it.value();
+  const QIcon ico = GeoIPManager::CountryISOCodeToIcon(country);
+  m_flags.insert(iso, ico);
+  return ico;
+}
+
+QString PeerListModel::countryName(const char *country) const {
+  const QByteArray iso(country, 2);
+  QHash<QByteArray, QString>::const_iterator it = m_countries.constFind(iso);
+  if (it != m_countries.constEnd())
+    return it.value();
+  const QString name = GeoIPManager::CountryISOCodeToName(country);
+  m_countries.insert(iso, name);
+  return name;
+}
+
+// Signals consecutive changed rows as a single range
+void PeerListModel::emitRowsChanged(const QVector<bool> &changed) {
+  const int count = changed.size();
+  int row = 0;
+  while (row < count) {
+    if (!changed[row]) {
+      ++row;
+      continue;
+    }
+    const int first = row;
+    while (row < count && changed[row])
+      ++row;
+    emit dataChanged(index(first, 0), index(row - 1, PeerListDelegate::COL_COUNT - 1));
+  }
+}
+
+// Removes the rows that are not kept, one contiguous range at a time,
+// starting from the end so that the remaining row numbers stay valid
+void PeerListModel::removeMissingRows(const QVector<bool> &keep) {
+  int row = keep.size() - 1;
+  while (row >= 0) {
+    if (keep[row]) {
+      --row;
+      continue;
+    }
+    const int last = row;
+    while (row >= 0 && !keep[row])
+      --row;
+    const int first = row + 1;
+    beginRemoveRows(QModelIndex(), first, last);
+    m_peers.remove(first, last - first + 1);
+    endRemoveRows();
+  }
+  // Row numbers have shifted
+  m_rows.clear();
+  m_rows.reserve(m_peers.size());
+  for (int i = 0; i < m_peers.size(); ++i)
+    m_rows.insert(m_peers.at(i).key, i);
+}
@@ -0,0 +1,109 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef PEERLISTMODEL_H
+#define PEERLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QByteArray>
+#include <QHash>
+#include <QIcon>
+#include <QList>
+#include <QVector>
+#include <string>
+#include <vector>
+#include <libtorrent/peer_info.hpp>
+
+#include <boost/version.hpp>
+#if BOOST_VERSION < 103500
+#include <libtorrent/asio/ip/tcp.hpp>
+#else
+#include <boost/asio/ip/tcp.hpp>
+#endif
+
+// Peers of the current torrent.
+// The peers are stored in a flat vector and indexed by their endpoint
+// in binary form. Each refresh is compared to the previous one so that
+// only the rows that actually changed are signaled to the views.
+class PeerListModel : public QAbstractTableModel {
+  Q_OBJECT
+  Q_DISABLE_COPY(PeerListModel)
+
+public:
+  struct Peer {
+    Peer(): connectionType(0), progress(0.), downSpeed(0), upSpeed(0),
+      totalDown(0), totalUp(0) { country[0] = country[1] = 0; }
+
+    QByteArray key; // Address and port in binary form
+    boost::asio::ip::tcp::endpoint endpoint;
+    QString ip;
+    QString hostname;
+    char country[2];
+    int connectionType;
+    std::string rawClient;
+    QString client;
+    float progress;
+    int downSpeed;
+    int upSpeed;
+    qulonglong totalDown;
+    qulonglong totalUp;
+  };
+
+  PeerListModel(QObject *parent = 0);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+  inline const Peer& peer(int row) const { return m_peers.at(row); }
+  QList<boost::asio::ip::tcp::endpoint> update(const std::vector<libtorrent::peer_info> &peers);
+  void setHostName(const QString &ip, const QString &hostname);
+  void setDisplayFlags(bool display);
+  void clear();
+
+private:
+  static QByteArray endpointKey(const boost::asio::ip::tcp::endpoint &endpoint);
+  static QString connectionString(int connection_type);
+  static bool setPeer(Peer &peer, const libtorrent::peer_info &info);
+  QIcon flagIcon(const char *country) const;
+  QString countryName(const char *country) const;
+  void emitRowsChanged(const QVector<bool> &changed);
+  void removeMissingRows(const QVector<bool> &keep);
+
+private:
+  QVector<Peer> m_peers;
+  QHash<QByteArray, int> m_rows; // key -> row
+  bool m_displayFlags;
+  mutable QHash<QByteArray, QIcon> m_flags;
+  mutable QHash<QByteArray, QString> m_countries;
+};
+
+#endif // PEERLISTMODEL_H
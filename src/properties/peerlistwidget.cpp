@@ -30,19 +30,18 @@
 
 #include "peerlistwidget.h"
 #include "peerlistdelegate.h"
+#include "peerlistmodel.h"
 #include "reverseresolution.h"
 #include "preferences.h"
 #include "propertieswidget.h"
-#include "geoipmanager.h"
 #include "peeraddition.h"
 #include "speedlimitdlg.h"
 #include "iconprovider.h"
-#include <QStandardItemModel>
 #include <QSortFilterProxyModel>
-#include <QSet>
 #include <QHeaderView>
 #include <QMenu>
 #include <QClipboard>
+#include <QInputDialog>
 #include <vector>
 #include "qinisettings.h"
 
@@ -59,15 +58,7 @@ PeerListWidget::PeerListWidget(PropertiesWidget *parent):
   setAllColumnsShowFocus(true);
   setSelectionMode(QAbstractItemView::ExtendedSelection);
   // List Model
-  m_listModel = new QStandardItemModel(0, PeerListDelegate::COL_COUNT);
-  m_listModel->setHeaderData(PeerListDelegate::IP, Qt::Horizontal, tr("IP"));
-  m_listModel->setHeaderData(PeerListDelegate::CONNECTION, Qt::Horizontal, tr("Connection"));
-  m_listModel->setHeaderData(PeerListDelegate::CLIENT, Qt::Horizontal, tr("Client", "i.e.: Client application"));
-  m_listModel->setHeaderData(PeerListDelegate::PROGRESS, Qt::Horizontal, tr("Progress", "i.e: % downloaded"));
-  m_listModel->setHeaderData(PeerListDelegate::DOWN_SPEED, Qt::Horizontal, tr("Down Speed", "i.e: Download speed"));
-  m_listModel->setHeaderData(PeerListDelegate::UP_SPEED, Qt::Horizontal, tr("Up Speed", "i.e: Upload speed"));
-  m_listModel->setHeaderData(PeerListDelegate::TOT_DOWN, Qt::Horizontal, tr("Downloaded", "i.e: total data downloaded"));
-  m_listModel->setHeaderData(PeerListDelegate::TOT_UP, Qt::Horizontal, tr("Uploaded", "i.e: total data uploaded"));
+  m_listModel = new PeerListModel();
   // Proxy model to support sorting without actually altering the underlying model
   m_proxyModel = new QSortFilterProxyModel();
   m_proxyModel->setDynamicSortFilter(true);
@@ -117,8 +108,7 @@ void PeerListWidget::updatePeerCountryResolutionState()
 {
   if (Preferences().resolvePeerCountries() != m_displayFlags) {
     m_displayFlags = !m_displayFlags;
-    if (m_displayFlags)
-      loadPeers(m_properties->getCurrentTorrent());
+    m_listModel->setDisplayFlags(m_displayFlags);
   }
 }
 
@@ -130,10 +120,11 @@ void PeerListWidget::showPeerListMenu(const QPoint&)
   if (!h.is_valid()) return;
   QModelIndexList selectedIndexes = selectionModel()->selectedRows();
   QStringList selectedPeerIPs;
+  QList<boost::asio::ip::tcp::endpoint> selectedPeers;
   foreach (const QModelIndex &index, selectedIndexes) {
-    int row = m_proxyModel->mapToSource(index).row();
-    QString myip = m_listModel->data(m_listModel->index(row, PeerListDelegate::IP_HIDDEN)).toString();
-    selectedPeerIPs << myip;
+    const PeerListModel::Peer &peer = m_listModel->peer(m_proxyModel->mapToSource(index).row());
+    selectedPeerIPs << peer.ip;
+    selectedPeers << peer.endpoint;
   }
   // Add Peer Action
   QAction *addPeerAct = 0;
@@ -152,7 +143,7 @@ void PeerListWidget::showPeerListMenu(const QPoint&)
     dlLimitAct = menu.addAction(QIcon(":/Icons/skin/download.png"), tr("Limit download rate..."));
     upLimitAct = menu.addAction(QIcon(":/Icons/skin/seeding.png"), tr("Limit upload rate..."));
     menu.addSeparator();
-    banAct = menu.addAction(IconProvider::instance()->getIcon("user-group-delete"), tr("Ban peer permanently"));
+    banAct = menu.addAction(IconProvider::instance()->getIcon("user-group-delete"), tr("Ban peer..."));
     empty_menu = false;
   }
   if (empty_menu) return;
@@ -173,11 +164,11 @@ void PeerListWidget::showPeerListMenu(const QPoint&)
     return;
   }
   if (act == upLimitAct) {
-    limitUpRateSelectedPeers(selectedPeerIPs);
+    limitUpRateSelectedPeers(selectedPeers);
     return;
   }
   if (act == dlLimitAct) {
-    limitDlRateSelectedPeers(selectedPeerIPs);
+    limitDlRateSelectedPeers(selectedPeers);
     return;
   }
   if (act == banAct) {
@@ -195,25 +186,32 @@ void PeerListWidget::showPeerListMenu(const QPoint&)
 
 void PeerListWidget::banSelectedPeers(const QStringList& peer_ips)
 {
-  // Confirm first
-  int ret = QMessageBox::question(this, tr("Are you sure? -- qBittorrent"), tr("Are you sure you want to ban permanently the selected peers?"),
-                                  tr("&Yes"), tr("&No"),
-                                  QString(), 0, 1);
-  if (ret)
+  // Ask for the ban duration, which also confirms it
+  static const int durations[] = {3600, 86400, 7 * 86400, 0}; // s, 0: permanent
+  QStringList items;
+  items << tr("1 hour") << tr("1 day") << tr("1 week") << tr("Permanently");
+  bool ok;
+  const QString item = QInputDialog::getItem(this, tr("Ban peer"), tr("Ban the selected peers for:"),
+                                             items, 0, false, &ok);
+  if (!ok)
     return;
+  const int ttl = durations[items.indexOf(item)];
 
   foreach (const QString &ip, peer_ips) {
     qDebug("Banning peer %s...", ip.toLocal8Bit().data());
-    QBtSession::instance()->addConsoleMessage(tr("Manually banning peer %1...").arg(ip));
-    QBtSession::instance()->banIP(ip);
+    if (ttl)
+      QBtSession::instance()->addConsoleMessage(tr("Manually banning peer %1 for %2...").arg(ip).arg(item));
+    else
+      QBtSession::instance()->addConsoleMessage(tr("Manually banning peer %1...").arg(ip));
+    QBtSession::instance()->banIP(ip, ttl);
   }
   // Refresh list
   loadPeers(m_properties->getCurrentTorrent());
 }
 
-void PeerListWidget::limitUpRateSelectedPeers(const QStringList& peer_ips)
+void PeerListWidget::limitUpRateSelectedPeers(const QList<boost::asio::ip::tcp::endpoint>& peers)
 {
-  if (peer_ips.empty())
+  if (peers.empty())
     return;
   QTorrentHandle h = m_properties->getCurrentTorrent();
   if (!h.is_valid())
@@ -222,10 +220,7 @@ void PeerListWidget::limitUpRateSelectedPeers(const QStringList& peer_ips)
   bool ok = false;
   int cur_limit = -1;
 #if LIBTORRENT_VERSION_MINOR > 15
-  boost::asio::ip::tcp::endpoint first_ep = peerEndpoints.value(peer_ips.first(),
-                                                                     boost::asio::ip::tcp::endpoint());
-  if (first_ep != boost::asio::ip::tcp::endpoint())
-    cur_limit = h.get_peer_upload_limit(first_ep);
+  cur_limit = h.get_peer_upload_limit(peers.first());
 #endif
   long limit = SpeedLimitDialog::askSpeedLimit(&ok,
                                                tr("Upload rate limiting"),
@@ -234,49 +229,38 @@ void PeerListWidget::limitUpRateSelectedPeers(const QStringList& peer_ips)
   if (!ok)
     return;
 
-  foreach (const QString &ip, peer_ips) {
-    boost::asio::ip::tcp::endpoint ep = m_peerEndpoints.value(ip, boost::asio::ip::tcp::endpoint());
-    if (ep != boost::asio::ip::tcp::endpoint()) {
-      qDebug("Settings Upload limit of %.1f Kb/s to peer %s", limit/1024., ip.toLocal8Bit().data());
-      try {
-        h.set_peer_upload_limit(ep, limit);
-      } catch(std::exception) {
-        std::cerr << "Impossible to apply upload limit to peer" << std::endl;
-      }
-    } else {
-      qDebug("The selected peer no longer exists...");
+  foreach (const boost::asio::ip::tcp::endpoint &ep, peers) {
+    qDebug("Settings Upload limit of %.1f Kb/s to peer %s", limit/1024., ep.address().to_string().c_str());
+    try {
+      h.set_peer_upload_limit(ep, limit);
+    } catch(std::exception) {
+      std::cerr << "Impossible to apply upload limit to peer" << std::endl;
     }
   }
 }
 
-void PeerListWidget::limitDlRateSelectedPeers(const QStringList& peer_ips)
+void PeerListWidget::limitDlRateSelectedPeers(const QList<boost::asio::ip::tcp::endpoint>& peers)
 {
+  if (peers.empty())
+    return;
   QTorrentHandle h = m_properties->getCurrentTorrent();
   if (!h.is_valid())
     return;
   bool ok = false;
   int cur_limit = -1;
 #if LIBTORRENT_VERSION_MINOR > 15
-  boost::asio::ip::tcp::endpoint first_ep = peerEndpoints.value(peer_ips.first(),
-                                                                     boost::asio::ip::tcp::endpoint());
-  if (first_ep != boost::asio::ip::tcp::endpoint())
-    cur_limit = h.get_peer_download_limit(first_ep);
+  cur_limit = h.get_peer_download_limit(peers.first());
 #endif
   long limit = SpeedLimitDialog::askSpeedLimit(&ok, tr("Download rate limiting"), cur_limit, Preferences().getGlobalDownloadLimit()*1024.);
   if (!ok)
     return;
 
-  foreach (const QString &ip, peer_ips) {
-    boost::asio::ip::tcp::endpoint ep = m_peerEndpoints.value(ip, boost::asio::ip::tcp::endpoint());
-    if (ep != boost::asio::ip::tcp::endpoint()) {
-      qDebug("Settings Download limit of %.1f Kb/s to peer %s", limit/1024., ip.toLocal8Bit().data());
-      try {
-        h.set_peer_download_limit(ep, limit);
-      }catch(std::exception) {
-        std::cerr << "Impossible to apply download limit to peer" << std::endl;
-      }
-    } else {
-      qDebug("The selected peer no longer exists...");
+  foreach (const boost::asio::ip::tcp::endpoint &ep, peers) {
+    qDebug("Settings Download limit of %.1f Kb/s to peer %s", limit/1024., ep.address().to_string().c_str());
+    try {
+      h.set_peer_download_limit(ep, limit);
+    }catch(std::exception) {
+      std::cerr << "Impossible to apply download limit to peer" << std::endl;
     }
   }
 }
@@ -284,14 +268,7 @@ void PeerListWidget::limitDlRateSelectedPeers(const QStringList& peer_ips)
 
 void PeerListWidget::clear() {
   qDebug("clearing peer list");
-  m_peerItems.clear();
-  m_peerEndpoints.clear();
-  m_missingFlags.clear();
-  int nbrows = m_listModel->rowCount();
-  if (nbrows > 0) {
-    qDebug("Cleared %d peers", nbrows);
-    m_listModel->removeRows(0,  nbrows);
-  }
+  m_listModel->clear();
 }
 
 void PeerListWidget::loadSettings() {
@@ -307,95 +284,28 @@ void PeerListWidget::saveSettings() const {
 void PeerListWidget::loadPeers(const QTorrentHandle &h, bool force_hostname_resolution) {
   if (!h.is_valid())
     return;
-  boost::system::error_code ec;
   std::vector<peer_info> peers;
   h.get_peer_info(peers);
-  std::vector<peer_info>::const_iterator itr;
-  QSet<QString> old_peers_set = m_peerItems.keys().toSet();
-  for (itr = peers.begin(); itr != peers.end(); itr++) {
-    peer_info peer = *itr;
-    QString peer_ip = misc::toQString(peer.ip.address().to_string(ec));
-    if (ec) continue;
-    if (m_peerItems.contains(peer_ip)) {
-      // Update existing peer
-      updatePeer(peer_ip, peer);
-      old_peers_set.remove(peer_ip);
-      if (force_hostname_resolution && m_resolver) {
-        m_resolver->resolve(peer.ip);
-      }
-    } else {
-      // Add new peer
-      m_peerItems[peer_ip] = addPeer(peer_ip, peer);
-      m_peerEndpoints[peer_ip] = peer.ip;
-    }
-  }
-  // Delete peers that are gone
-  QSetIterator<QString> it(old_peers_set);
-  while(it.hasNext()) {
-    const QString& ip = it.next();
-    m_missingFlags.remove(ip);
-    m_peerEndpoints.remove(ip);
-    QStandardItem *item = m_peerItems.take(ip);
-    m_listModel->removeRow(item->row());
-  }
+  updatePeers(peers, force_hostname_resolution);
 }
 
-QStandardItem* PeerListWidget::addPeer(const QString& ip, const peer_info& peer) {
-  int row = m_listModel->rowCount();
-  // Adding Peer to peer list
-  m_listModel->insertRow(row);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP), ip);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP_HIDDEN), ip);
-  // Resolve peer host name is asked
-  if (m_resolver)
-    m_resolver->resolve(peer.ip);
-  if (m_displayFlags) {
-    const QIcon ico = GeoIPManager::CountryISOCodeToIcon(peer.country);
-    if (!ico.isNull()) {
-      m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP), ico, Qt::DecorationRole);
-      const QString country_name = GeoIPManager::CountryISOCodeToName(peer.country);
-      m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP), country_name, Qt::ToolTipRole);
-    } else {
-      m_missingFlags.insert(ip);
-    }
-  }
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::CONNECTION), getConnectionString(peer.connection_type));
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::CLIENT), misc::toQStringU(peer.client));
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::PROGRESS), peer.progress);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::DOWN_SPEED), peer.payload_down_speed);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::UP_SPEED), peer.payload_up_speed);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::TOT_DOWN), (qulonglong)peer.total_download);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::TOT_UP), (qulonglong)peer.total_upload);
-  return m_listModel->item(row, PeerListDelegate::IP);
-}
-
-void PeerListWidget::updatePeer(const QString& ip, const peer_info& peer) {
-  QStandardItem *item = m_peerItems.value(ip);
-  int row = item->row();
-  if (m_displayFlags) {
-    const QIcon ico = GeoIPManager::CountryISOCodeToIcon(peer.country);
-    if (!ico.isNull()) {
-      m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP), ico, Qt::DecorationRole);
-      const QString country_name = GeoIPManager::CountryISOCodeToName(peer.country);
-      m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP), country_name, Qt::ToolTipRole);
-      m_missingFlags.remove(ip);
-    }
+void PeerListWidget::updatePeers(const std::vector<peer_info> &peers, bool force_hostname_resolution) {
+  const QList<boost::asio::ip::tcp::endpoint> added = m_listModel->update(peers);
+  // Resolve peer host names if asked
+  if (!m_resolver)
+    return;
+  if (force_hostname_resolution) {
+    for (int row = 0; row < m_listModel->rowCount(); ++row)
+      m_resolver->resolve(m_listModel->peer(row).endpoint);
+  } else {
+    foreach (const boost::asio::ip::tcp::endpoint &ep, added)
+      m_resolver->resolve(ep);
   }
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::CONNECTION), getConnectionString(peer.connection_type));
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::CLIENT), misc::toQStringU(peer.client));
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::PROGRESS), peer.progress);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::DOWN_SPEED), peer.payload_down_speed);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::UP_SPEED), peer.payload_up_speed);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::TOT_DOWN), (qulonglong)peer.total_download);
-  m_listModel->setData(m_listModel->index(row, PeerListDelegate::TOT_UP), (qulonglong)peer.total_upload);
 }
 
 void PeerListWidget::handleResolved(const QString &ip, const QString &hostname) {
-  QStandardItem *item = m_peerItems.value(ip, 0);
-  if (item) {
-    qDebug("Resolved %s -> %s", qPrintable(ip), qPrintable(hostname));
-    item->setData(hostname, Qt::DisplayRole);
-  }
+  qDebug("Resolved %s -> %s", qPrintable(ip), qPrintable(hostname));
+  m_listModel->setHostName(ip, hostname);
 }
 
 void PeerListWidget::handleSortColumnChanged(int col)
@@ -407,23 +317,3 @@ void PeerListWidget::handleSortColumnChanged(int col)
     m_proxyModel->setSortRole(Qt::DisplayRole);
   }
 }
-
-QString PeerListWidget::getConnectionString(int connection_type)
-{
-  QString connection;
-  switch(connection_type) {
-#if LIBTORRENT_VERSION_MINOR > 15
-  case peer_info::bittorrent_utp:
-    connection = "uTP";
-    break;
-  case peer_info::http_seed:
-#endif
-  case peer_info::web_seed:
-    connection = "Web";
-    break;
-  default:
-    connection = "BT";
-    break;
-  }
-  return connection;
-}
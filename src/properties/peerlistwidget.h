@@ -32,21 +32,19 @@
 #define PEERLISTWIDGET_H
 
 #include <QTreeView>
-#include <QHash>
+#include <QList>
 #include <QPointer>
-#include <QSet>
 #include <libtorrent/peer_info.hpp>
 #include "qtorrenthandle.h"
 #include "misc.h"
 
 class PeerListDelegate;
+class PeerListModel;
 class ReverseResolution;
 class PropertiesWidget;
 
 QT_BEGIN_NAMESPACE
 class QSortFilterProxyModel;
-class QStandardItem;
-class QStandardItemModel;
 QT_END_NAMESPACE
 
 #include <boost/version.hpp>
@@ -65,8 +63,7 @@ public:
 
 public slots:
   void loadPeers(const QTorrentHandle &h, bool force_hostname_resolution = false);
-  QStandardItem*  addPeer(const QString& ip, const libtorrent::peer_info& peer);
-  void updatePeer(const QString& ip, const libtorrent::peer_info& peer);
+  void updatePeers(const std::vector<libtorrent::peer_info> &peers, bool force_hostname_resolution = false);
   void handleResolved(const QString &ip, const QString &hostname);
   void updatePeerHostNameResolutionState();
   void updatePeerCountryResolutionState();
@@ -76,21 +73,15 @@ protected slots:
   void loadSettings();
   void saveSettings() const;
   void showPeerListMenu(const QPoint&);
-  void limitUpRateSelectedPeers(const QStringList& peer_ips);
-  void limitDlRateSelectedPeers(const QStringList& peer_ips);
+  void limitUpRateSelectedPeers(const QList<boost::asio::ip::tcp::endpoint>& peers);
+  void limitDlRateSelectedPeers(const QList<boost::asio::ip::tcp::endpoint>& peers);
   void banSelectedPeers(const QStringList& peer_ips);
   void handleSortColumnChanged(int col);
 
 private:
-  static QString getConnectionString(int connection_type);
-
-private:
-  QStandardItemModel *m_listModel;
+  PeerListModel *m_listModel;
   PeerListDelegate *m_listDelegate;
   QSortFilterProxyModel *m_proxyModel;
-  QHash<QString, QStandardItem*> m_peerItems;
-  QHash<QString, boost::asio::ip::tcp::endpoint> m_peerEndpoints;
-  QSet<QString> m_missingFlags;
   QPointer<ReverseResolution> m_resolver;
   PropertiesWidget *m_properties;
   bool m_displayFlags;
@@ -29,6 +29,7 @@
  */
 
 #include "pieceavailabilitybar.h"
+#include <cstring>
 
 //#include <QDebug>
 
@@ -37,6 +38,7 @@ PieceAvailabilityBar::PieceAvailabilityBar(QWidget *parent) :
 {
   setFixedHeight(BAR_HEIGHT);
 
+  max_availability = 0;
   bg_color = 0xffffff;
   border_color = palette().color(QPalette::Dark).rgb();
   piece_color = 0x0000ff;
@@ -44,99 +46,39 @@ PieceAvailabilityBar::PieceAvailabilityBar(QWidget *parent) :
   updatePieceColors();
 }
 
-std::vector<float> PieceAvailabilityBar::intToFloatVector(const std::vector<int> &vecin, int reqSize)
-{
-  std::vector<float> result(reqSize, 0.0);
-
-  if (vecin.empty())
-    return result;
-
-  const float ratio = vecin.size() / (float)reqSize;
-
-  const int maxElement = *std::max_element(vecin.begin(), vecin.end());
-
-  // qMax bacause in normalization we don't want divide by 0
-  // if maxElement == 0 check will be disabled please enable this line:
-  // const int maxElement = qMax(*std::max_element(avail.begin(), avail.end()), 1);
-
-  if (maxElement == 0)
-    return result;
-
-  // simple linear transformation algorithm
-  // for example:
-  // image.x(0) = pieces.x(0.0 >= x < 1.7)
-  // image.x(1) = pieces.x(1.7 >= x < 3.4)
-
-  for (int x = 0; x < reqSize; ++x) {
+// Availability vector as seen by PiecesAggregate::rebuild()
+struct AvailabilitySource {
+  AvailabilitySource(const std::vector<int> &avail): v(avail) {}
 
-    // don't use previously calculated value "ratio" here!!!
-    // float cannot save irrational number like 7/9, if this number will be rounded up by std::ceil
-    // give you x2 == pieces.size(), and index out of range: pieces[x2]
-    // this code is safe, so keep that in mind when you try optimize more.
-    // tested with size = 3000000ul
+  int size() const { return v.size(); }
+  qint64 value(int piece) const { return v[piece]; }
 
-    // R - real
-    const float fromR = (x * vecin.size()) / (float)reqSize;
-    const float toR = ((x + 1) * vecin.size()) / (float)reqSize;
-
-    // C - integer
-    int fromC = fromR;// std::floor not needed
-    int toC = std::ceil(toR);
-
-    // position in pieces table
-    // libtorrent::bitfield::m_size is unsigned int(31 bits), so qlonglong is not needed
-    // tested with size = 3000000ul
-    int x2 = fromC;
-
-    // little speed up for really big pieces table, 10K+ size
-    const int toCMinusOne = toC - 1;
+  // Simple loop the compiler can vectorize
+  qint64 sum(int from, int to) const {
+    qint64 s = 0;
+    for (int i = from; i < to; ++i)
+      s += v[i];
+    return s;
+  }
 
-    // value in returned vector
-    float value = 0;
+  const std::vector<int> &v;
+};
 
-    // case when calculated range is (15.2 >= x < 15.7)
-    if (x2 == toCMinusOne) {
-      if (vecin[x2]) {
-        value += (toR - fromR) * vecin[x2];
-      }
-      ++x2;
-    }
-    // case when (15.2 >= x < 17.8)
-    else {
-      // subcase (15.2 >= x < 16)
-      if (x2 != fromR) {
-        if (vecin[x2]) {
-          value += (1.0 - (fromR - fromC)) * vecin[x2];
-        }
-        ++x2;
-      }
-
-      // subcase (16 >= x < 17)
-      for (; x2 < toCMinusOne; ++x2) {
-        if (vecin[x2]) {
-          value += vecin[x2];
-        }
-      }
-
-      // subcase (17 >= x < 17.8)
-      if (x2 == toCMinusOne) {
-        if (vecin[x2]) {
-          value += (1.0 - (toC - toR)) * vecin[x2];
-        }
-        ++x2;
-      }
+// Adds the differences between old_avail and new_avail (of the same size)
+// to sums. Identical blocks are skipped with memcmp()
+static void addChangedPieces(const std::vector<int> &old_avail, const std::vector<int> &new_avail, PiecesAggregate &sums)
+{
+  const int BLOCK_SIZE = 16;
+  const int nb_pieces = new_avail.size();
+  for (int block = 0; block < nb_pieces; block += BLOCK_SIZE) {
+    const int block_end = qMin(block + BLOCK_SIZE, nb_pieces);
+    if (memcmp(&old_avail[block], &new_avail[block], (block_end - block) * sizeof(int)) == 0)
+      continue;
+    for (int piece = block; piece < block_end; ++piece) {
+      if (old_avail[piece] != new_avail[piece])
+        sums.add(piece, new_avail[piece] - old_avail[piece]);
     }
-
-    // normalization <0, 1>
-    value /= ratio * maxElement;
-
-    // float precision sometimes gives > 1, because in not possible to store irrational numbers
-    value = qMin(value, (float)1.0);
-
-    result[x] = value;
   }
-
-  return result;
 }
 
 int PieceAvailabilityBar::mixTwoColors(int &rgb1, int &rgb2, float ratio)
@@ -157,34 +99,66 @@ int PieceAvailabilityBar::mixTwoColors(int &rgb1, int &rgb2, float ratio)
   return qRgb(r, g, b);
 }
 
+int PieceAvailabilityBar::pixelColor(int x)
+{
+  if (max_availability == 0)
+    return piece_colors[0];
+  // normalization <0, 255>
+  const qint64 max_sum = (qint64)pieces_sums.pieces() * max_availability;
+  return piece_colors[qMin(pieces_sums.sum(x) * 255 / max_sum, (qint64)255)];
+}
+
 void PieceAvailabilityBar::updateImage()
 {
   //  qDebug() << "updateImageAv";
-  QImage image2(width() - 2, 1, QImage::Format_RGB888);
+  const int w = qMax(width() - 2, 1);
+  image = QImage(w, 1, QImage::Format_RGB888);
 
   if (pieces.empty()) {
-    image2.fill(0xffffff);
-    image = image2;
-    update();
+    pieces_sums.clear();
+    image.fill(0xffffff);
     return;
   }
 
-  std::vector<float> scaled_pieces = intToFloatVector(pieces, image2.width());
+  pieces_sums.rebuild(w, AvailabilitySource(pieces));
+  // The whole image is drawn below
+  int first, last;
+  pieces_sums.takeDirtyRange(first, last);
+  updatePixels(0, w - 1);
+}
 
-  // filling image
-  for (unsigned int x = 0; x < scaled_pieces.size(); ++x)
-  {
-    float pieces2_val = scaled_pieces.at(x);
-    image2.setPixel(x, 0, piece_colors[pieces2_val * 255]);
-  }
-  image = image2;
+void PieceAvailabilityBar::updatePixels(int first, int last)
+{
+  for (int x = first; x <= last; ++x)
+    image.setPixel(x, 0, pixelColor(x));
 }
 
 void PieceAvailabilityBar::setAvailability(const std::vector<int>& avail)
 {
-  pieces = std::vector<int>(avail);
+  const int new_max = avail.empty() ? 0 : *std::max_element(avail.begin(), avail.end());
+
+  if (image.isNull() || avail.size() != pieces.size() || pieces_sums.pixels() != image.width()) {
+    pieces = avail;
+    max_availability = new_max;
+    updateImage();
+    update();
+    return;
+  }
 
-  updateImage();
+  // Only the pieces that changed since the last call need to be redrawn
+  addChangedPieces(pieces, avail, pieces_sums);
+  pieces = avail;
+  int first, last;
+  const bool dirty = pieces_sums.takeDirtyRange(first, last);
+  if (new_max != max_availability) {
+    // Every pixel is normalized by the highest availability
+    max_availability = new_max;
+    updatePixels(0, image.width() - 1);
+  } else if (dirty) {
+    updatePixels(first, last);
+  } else {
+    return;
+  }
   update();
 }
 
@@ -200,6 +174,9 @@ void PieceAvailabilityBar::updatePieceColors()
 void PieceAvailabilityBar::clear()
 {
   image = QImage();
+  pieces.clear();
+  max_availability = 0;
+  pieces_sums.clear();
   update();
 }
 
@@ -232,7 +209,8 @@ void PieceAvailabilityBar::setColors(int background, int border, int available)
   piece_color = available;
 
   updatePieceColors();
-  updateImage();
+  if (!image.isNull() && !pieces.empty())
+    updatePixels(0, image.width() - 1);
   update();
 }
 
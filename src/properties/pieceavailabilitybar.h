@@ -36,6 +36,7 @@
 #include <QImage>
 #include <cmath>
 #include <algorithm>
+#include "piecesaggregate.h"
 
 #define BAR_HEIGHT 18
 
@@ -57,17 +58,22 @@ private:
   // buffered 256 levels gradient from bg_color to piece_color
   std::vector<int> piece_colors;
 
-  // last used int vector, uses to better resize redraw
-  // TODO: make a diff pieces to new pieces and update only changed pixels, speedup when update > 20x faster
+  // last used int vector, new ones are compared to it so that
+  // only the pixels of the pieces that changed are redrawn
   std::vector<int> pieces;
-
-  // scale int vector to float vector
-  std::vector<float> intToFloatVector(const std::vector<int> &vecin, int reqSize);
+  // highest availability in pieces
+  int max_availability;
+  // pixel sums of pieces
+  PiecesAggregate pieces_sums;
 
   // mix two colors by light model, ratio <0, 1>
   int mixTwoColors(int &rgb1, int &rgb2, float ratio);
-  // draw new image and replace actual image
+  // color of a pixel in the current image
+  int pixelColor(int x);
+  // compute the pixel sums and draw a new image
   void updateImage();
+  // redraw the pixels in [first, last]
+  void updatePixels(int first, int last);
 
 public:
   PieceAvailabilityBar(QWidget *parent);
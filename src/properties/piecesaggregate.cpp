@@ -0,0 +1,76 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include "piecesaggregate.h"
+
+void PiecesAggregate::clear() {
+  m_pieces = 0;
+  m_pixels = 0;
+  m_sums.clear();
+  m_dirtyFirst = -1;
+  m_dirtyLast = -1;
+}
+
+void PiecesAggregate::add(int piece, qint64 delta) {
+  if (piece < 0 || piece >= m_pieces || m_pixels == 0 || delta == 0) return;
+  const qint64 n = m_pieces;
+  const qint64 w = m_pixels;
+  // Piece in units
+  const qint64 piece_from = piece * w;
+  const qint64 piece_to = piece_from + w;
+  const int first = piece_from / n;
+  const int last = (piece_to - 1) / n;
+  for (int x = first; x <= last; ++x) {
+    const qint64 from = qMax(x * n, piece_from);
+    const qint64 to = qMin((x + 1) * n, piece_to);
+    m_sums[x] += delta * (to - from);
+  }
+  markDirty(first, last);
+}
+
+bool PiecesAggregate::takeDirtyRange(int &first, int &last) {
+  if (m_dirtyFirst < 0) return false;
+  first = m_dirtyFirst;
+  last = m_dirtyLast;
+  m_dirtyFirst = -1;
+  m_dirtyLast = -1;
+  return true;
+}
+
+void PiecesAggregate::markDirty(int first, int last) {
+  if (last < first) return;
+  if (m_dirtyFirst < 0) {
+    m_dirtyFirst = first;
+    m_dirtyLast = last;
+    return;
+  }
+  m_dirtyFirst = qMin(m_dirtyFirst, first);
+  m_dirtyLast = qMax(m_dirtyLast, last);
+}
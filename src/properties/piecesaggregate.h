@@ -0,0 +1,99 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef PIECESAGGREGATE_H
+#define PIECESAGGREGATE_H
+
+#include <QtGlobal>
+#include <vector>
+
+// Per pixel sums of a piece array, used by the pieces bars.
+// Pixel x covers the pieces [x*N/W, (x+1)*N/W), pieces being cut at pixel
+// boundaries. To keep everything in integers, lengths are counted in
+// 1/W piece units: a piece is W units long and a pixel is N units long.
+// A pixel only covered by pieces of value v thus sums to v*N.
+class PiecesAggregate {
+public:
+  PiecesAggregate(): m_pieces(0), m_pixels(0), m_dirtyFirst(-1), m_dirtyLast(-1) {}
+
+  int pieces() const { return m_pieces; }
+  int pixels() const { return m_pixels; }
+  qint64 sum(int pixel) const { return m_sums[pixel]; }
+
+  void clear();
+  // Source must provide:
+  //  int size() const
+  //  qint64 value(int piece) const
+  //  qint64 sum(int from, int to) const (sum of the values in [from, to))
+  template <typename Source> void rebuild(int pixels, const Source &src);
+  // Adds delta to the value of a piece
+  void add(int piece, qint64 delta);
+  // Range of pixels modified since the last call, returns false if none
+  bool takeDirtyRange(int &first, int &last);
+
+private:
+  void markDirty(int first, int last);
+
+private:
+  int m_pieces;
+  int m_pixels;
+  std::vector<qint64> m_sums;
+  int m_dirtyFirst;
+  int m_dirtyLast;
+};
+
+// Every piece is visited once: the piece range of a pixel starts where
+// the one of the previous pixel ends
+template <typename Source>
+void PiecesAggregate::rebuild(int pixels, const Source &src) {
+  m_pieces = src.size();
+  m_pixels = qMax(pixels, 0);
+  m_sums.assign(m_pixels, 0);
+  markDirty(0, m_pixels - 1);
+  if (m_pieces == 0) return;
+  const qint64 n = m_pieces;
+  const qint64 w = m_pixels;
+  for (int x = 0; x < m_pixels; ++x) {
+    const qint64 from = x * n;
+    const qint64 to = from + n;
+    const int first = from / w;
+    const int last = to / w;
+    const qint64 from_rest = from % w;
+    const qint64 to_rest = to % w;
+    qint64 s = w * src.sum(first, last);
+    if (from_rest)
+      s -= from_rest * src.value(first);
+    if (to_rest)
+      s += to_rest * src.value(last);
+    m_sums[x] = s;
+  }
+}
+
+#endif // PIECESAGGREGATE_H
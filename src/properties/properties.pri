@@ -10,14 +10,20 @@ HEADERS += $$PWD/propertieswidget.h \
            $$PWD/trackerlist.h \
            $$PWD/downloadedpiecesbar.h \
            $$PWD/peerlistdelegate.h \
+           $$PWD/peerlistmodel.h \
            $$PWD/peeraddition.h \
            $$PWD/trackersadditiondlg.h \
            $$PWD/pieceavailabilitybar.h \
+           $$PWD/piecesaggregate.h \
+           $$PWD/propertiesfetcher.h \
            $$PWD/proptabbar.h
 
 SOURCES += $$PWD/propertieswidget.cpp \
            $$PWD/peerlistwidget.cpp \
+           $$PWD/peerlistmodel.cpp \
            $$PWD/trackerlist.cpp \
            $$PWD/proptabbar.cpp \
            $$PWD/downloadedpiecesbar.cpp \
-           $$PWD/pieceavailabilitybar.cpp
+           $$PWD/pieceavailabilitybar.cpp \
+           $$PWD/piecesaggregate.cpp \
+           $$PWD/propertiesfetcher.cpp
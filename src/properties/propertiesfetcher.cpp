@@ -0,0 +1,135 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QDebug>
+#include <libtorrent/version.hpp>
+#include "propertiesfetcher.h"
+
+using namespace libtorrent;
+
+PropertiesFetcher::PropertiesFetcher():
+  m_lastRequest(0), m_busy(false), m_hasPending(false),
+  m_pendingNeeds(0), m_hasResult(false)
+{
+  moveToThread(&m_thread);
+  m_thread.start(QThread::LowPriority);
+}
+
+PropertiesFetcher::~PropertiesFetcher() {
+  qDebug("Stopping properties fetcher thread...");
+  m_thread.quit();
+  m_thread.wait();
+}
+
+int PropertiesFetcher::request(const QTorrentHandle &h, int needs) {
+  QMutexLocker locker(&m_mutex);
+  m_pendingHandle = h;
+  m_pendingNeeds = needs;
+  m_hasPending = true;
+  ++m_lastRequest;
+  if (!m_busy) {
+    m_busy = true;
+    QMetaObject::invokeMethod(this, "processRequests", Qt::QueuedConnection);
+  }
+  return m_lastRequest;
+}
+
+bool PropertiesFetcher::takeResult(PropertiesData &data) {
+  QMutexLocker locker(&m_mutex);
+  if (!m_hasResult) return false;
+  data = m_result;
+  m_result = PropertiesData();
+  m_hasResult = false;
+  return true;
+}
+
+// Fetcher thread
+void PropertiesFetcher::processRequests() {
+  forever {
+    QTorrentHandle h;
+    PropertiesData data;
+    {
+      QMutexLocker locker(&m_mutex);
+      if (!m_hasPending) {
+        m_busy = false;
+        return;
+      }
+      h = m_pendingHandle;
+      data.request = m_lastRequest;
+      data.needs = m_pendingNeeds;
+      m_pendingHandle = QTorrentHandle();
+      m_hasPending = false;
+    }
+    fetch(h, data);
+    {
+      QMutexLocker locker(&m_mutex);
+      m_result = data;
+      m_hasResult = true;
+    }
+    emit resultReady();
+  }
+}
+
+// Fetcher thread
+void PropertiesFetcher::fetch(const QTorrentHandle &h, PropertiesData &data) {
+  try {
+    if (data.needs & STATUS) {
+#if LIBTORRENT_VERSION_MINOR > 15
+      data.status = h.status(torrent_handle::query_accurate_download_counters
+                             | torrent_handle::query_distributed_copies
+                             | torrent_handle::query_pieces);
+#else
+      data.status = h.status();
+#endif
+      data.upload_limit = h.upload_limit();
+      data.download_limit = h.download_limit();
+      const bool is_seed = data.status.state == torrent_status::finished
+          || data.status.state == torrent_status::seeding;
+      const bool is_checking = data.status.state == torrent_status::checking_files
+          || data.status.state == torrent_status::checking_resume_data;
+      if ((data.needs & PIECES) && !is_seed && data.status.has_metadata) {
+        data.downloading_pieces = bitfield(h.get_torrent_info().num_pieces(), false);
+        h.downloading_pieces(data.downloading_pieces);
+        if (!data.status.paused && !is_checking)
+          h.piece_availability(data.availability);
+      }
+    }
+    if (data.needs & PEERS)
+      h.get_peer_info(data.peers);
+    if ((data.needs & FILES) && h.has_metadata()) {
+      h.file_progress(data.file_progress);
+      data.file_priorities = h.file_priorities();
+    }
+    data.valid = true;
+  } catch(std::exception &e) {
+    qDebug("Could not fetch torrent properties: %s", e.what());
+    data.valid = false;
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef PROPERTIESFETCHER_H
+#define PROPERTIESFETCHER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <vector>
+#include <libtorrent/bitfield.hpp>
+#include <libtorrent/peer_info.hpp>
+#include "qtorrenthandle.h"
+
+// Dynamic data of a torrent, as needed by the properties tabs
+struct PropertiesData {
+  PropertiesData(): request(0), needs(0), valid(false),
+    upload_limit(-1), download_limit(-1) {}
+
+  int request;
+  int needs;
+  bool valid; // false if the torrent is gone
+  libtorrent::torrent_status status;
+  int upload_limit;
+  int download_limit;
+  libtorrent::bitfield downloading_pieces;
+  std::vector<int> availability;
+  std::vector<libtorrent::peer_info> peers;
+  std::vector<libtorrent::size_type> file_progress;
+  std::vector<int> file_priorities;
+};
+
+// Fetches the dynamic data of a torrent in a separate thread so that
+// the GUI does not wait for libtorrent. Everything is read in one go,
+// with a single status() call.
+// Requests do not queue up: if the thread is busy, only the latest
+// request is kept. resultReady() is emitted when a result can be taken.
+class PropertiesFetcher: public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(PropertiesFetcher)
+
+public:
+  enum Data {STATUS = 0x1, PIECES = 0x2, PEERS = 0x4, FILES = 0x8};
+
+  PropertiesFetcher();
+  ~PropertiesFetcher();
+
+  // Returns the request id, reported in PropertiesData::request
+  int request(const QTorrentHandle &h, int needs);
+  bool takeResult(PropertiesData &data);
+
+signals:
+  void resultReady();
+
+private slots:
+  void processRequests();
+
+private:
+  static void fetch(const QTorrentHandle &h, PropertiesData &data);
+
+private:
+  QThread m_thread;
+  QMutex m_mutex;
+  int m_lastRequest;
+  bool m_busy;
+  bool m_hasPending;
+  QTorrentHandle m_pendingHandle;
+  int m_pendingNeeds;
+  bool m_hasResult;
+  PropertiesData m_result;
+};
+
+#endif // PROPERTIESFETCHER_H
@@ -57,9 +57,38 @@
 #include "proptabbar.h"
 #include "iconprovider.h"
 #include "lineedit.h"
+#include "propertiesfetcher.h"
 
 using namespace libtorrent;
 
+// Refresh interval of each tab (in ms), 0 if the tab has no dynamic data
+static int tabRefreshInterval(int tab) {
+  switch(tab) {
+  case PropTabBar::MAIN_TAB:
+  case PropTabBar::PEERS_TAB:
+    return 3000;
+  case PropTabBar::TRACKERS_TAB:
+  case PropTabBar::FILES_TAB:
+    return 5000;
+  default:
+    return 0;
+  }
+}
+
+// Data to fetch for each tab
+static int tabNeeds(int tab) {
+  switch(tab) {
+  case PropTabBar::MAIN_TAB:
+    return PropertiesFetcher::STATUS | PropertiesFetcher::PIECES;
+  case PropTabBar::PEERS_TAB:
+    return PropertiesFetcher::PEERS;
+  case PropTabBar::FILES_TAB:
+    return PropertiesFetcher::FILES;
+  default:
+    return 0;
+  }
+}
+
 PropertiesWidget::PropertiesWidget(QWidget *parent, MainWindow* main_window, TransferListWidget *transferList):
   QWidget(parent), transferList(transferList), main_window(main_window) {
   setupUi(this);
@@ -98,6 +127,7 @@ PropertiesWidget::PropertiesWidget(QWidget *parent, MainWindow* main_window, Tra
   connect(stackedProperties, SIGNAL(currentChanged(int)), this, SLOT(loadDynamicData()));
   connect(QBtSession::instance(), SIGNAL(savePathChanged(QTorrentHandle)), this, SLOT(updateSavePath(QTorrentHandle)));
   connect(QBtSession::instance(), SIGNAL(metadataReceived(QTorrentHandle)), this, SLOT(updateTorrentInfos(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(pieceFinished(QTorrentHandle,int)), this, SLOT(updatePieceFinished(QTorrentHandle,int)));
 
   // Downloaded pieces progress bar
   downloaded_pieces = new DownloadedPiecesBar(this);
@@ -119,14 +149,19 @@ PropertiesWidget::PropertiesWidget(QWidget *parent, MainWindow* main_window, Tra
   connect(m_tabBar, SIGNAL(tabChanged(int)), stackedProperties, SLOT(setCurrentIndex(int)));
   connect(m_tabBar, SIGNAL(visibilityToggled(bool)), SLOT(setVisibility(bool)));
   // Dynamic data refresher
+  m_fetcher = new PropertiesFetcher;
+  m_fetchRequest = 0;
+  connect(m_fetcher, SIGNAL(resultReady()), SLOT(handleFetchedData()));
   refreshTimer = new QTimer(this);
   connect(refreshTimer, SIGNAL(timeout()), this, SLOT(loadDynamicData()));
-  refreshTimer->start(3000); // 3sec
+  connect(stackedProperties, SIGNAL(currentChanged(int)), this, SLOT(updateRefreshInterval()));
+  updateRefreshInterval();
 }
 
 PropertiesWidget::~PropertiesWidget() {
   qDebug() << Q_FUNC_INFO << "ENTER";
   delete refreshTimer;
+  delete m_fetcher;
   delete trackerList;
   delete peersList;
   delete downloaded_pieces;
@@ -203,6 +238,9 @@ void PropertiesWidget::clear() {
   listWebSeeds->clear();
   m_contentFilerLine->clear();
   PropListModel->model()->clear();
+  m_fileProgress.clear();
+  m_filePriorities.clear();
+  m_fetchRequest = 0;
   showPiecesAvailability(false);
   showPiecesDownloaded(false);
   setEnabled(false);
@@ -229,6 +267,12 @@ void PropertiesWidget::updateSavePath(const QTorrentHandle& _h) {
   }
 }
 
+void PropertiesWidget::updatePieceFinished(const QTorrentHandle &_h, int piece) {
+  // The next refresh would find it anyway, but this is cheaper
+  if (h.is_valid() && h == _h && downloaded_pieces->isVisible())
+    downloaded_pieces->setPieceFinished(piece);
+}
+
 void PropertiesWidget::updateTorrentInfos(const QTorrentHandle& _h) {
   if (h.is_valid() && h == _h) {
     loadTorrentInfos(h);
@@ -315,90 +359,110 @@ void PropertiesWidget::reloadPreferences() {
   peersList->updatePeerCountryResolutionState();
 }
 
+void PropertiesWidget::updateRefreshInterval() {
+  const int interval = tabRefreshInterval(stackedProperties->currentIndex());
+  if (interval > 0)
+    refreshTimer->start(interval);
+  else
+    refreshTimer->stop();
+}
+
 void PropertiesWidget::loadDynamicData() {
   // Refresh only if the torrent handle is valid and if visible
   if (!h.is_valid() || main_window->getCurrentTabWidget() != transferList || state != VISIBLE) return;
-  try {
-    // Transfer infos
-    if (stackedProperties->currentIndex() == PropTabBar::MAIN_TAB) {
-      wasted->setText(misc::friendlyUnit(h.total_failed_bytes()+h.total_redundant_bytes()));
-      upTotal->setText(misc::friendlyUnit(h.all_time_upload()) + " ("+misc::friendlyUnit(h.total_payload_upload())+" "+tr("this session")+")");
-      dlTotal->setText(misc::friendlyUnit(h.all_time_download()) + " ("+misc::friendlyUnit(h.total_payload_download())+" "+tr("this session")+")");
-      if (h.upload_limit() <= 0)
-        lbl_uplimit->setText(QString::fromUtf8("∞"));
-      else
-        lbl_uplimit->setText(misc::friendlyUnit(h.upload_limit())+tr("/s", "/second (i.e. per second)"));
-      if (h.download_limit() <= 0)
-        lbl_dllimit->setText(QString::fromUtf8("∞"));
-      else
-        lbl_dllimit->setText(misc::friendlyUnit(h.download_limit())+tr("/s", "/second (i.e. per second)"));
-      QString elapsed_txt = misc::userFriendlyDuration(h.active_time());
-      if (h.is_seed()) {
-        elapsed_txt += " ("+tr("Seeded for %1", "e.g. Seeded for 3m10s").arg(misc::userFriendlyDuration(h.seeding_time()))+")";
-      }
-      lbl_elapsed->setText(elapsed_txt);
-      if (h.connections_limit() > 0)
-        lbl_connections->setText(QString::number(h.num_connections())+" ("+tr("%1 max", "e.g. 10 max").arg(QString::number(h.connections_limit()))+")");
-      else
-        lbl_connections->setText(QString::number(h.num_connections()));
-      // Update next announce time
-      reannounce_lbl->setText(h.next_announce());
-      // Update ratio info
-      const qreal ratio = QBtSession::instance()->getRealRatio(h.hash());
-      if (ratio > QBtSession::MAX_RATIO)
-        shareRatio->setText(QString::fromUtf8("∞"));
-      else
-        shareRatio->setText(QString(QByteArray::number(ratio, 'f', 2)));
-      if (!h.is_seed()) {
-        showPiecesDownloaded(true);
-        // Downloaded pieces
-        bitfield bf(h.get_torrent_info().num_pieces(), 0);
-        h.downloading_pieces(bf);
-        downloaded_pieces->setProgress(h.pieces(), bf);
-        // Pieces availability
-        if (h.has_metadata() && !h.is_paused() && !h.is_queued() && !h.is_checking()) {
-          showPiecesAvailability(true);
-          std::vector<int> avail;
-          h.piece_availability(avail);
-          pieces_availability->setAvailability(avail);
-          avail_average_lbl->setText(QString::number(h.distributed_copies(), 'f', 3));
-        } else {
-          showPiecesAvailability(false);
-        }
-        // Progress
-        qreal progress = h.progress()*100.;
-        if (progress > 99.94 && progress < 100.)
-          progress = 99.9;
-        progress_lbl->setText(QString::number(progress, 'f', 1)+"%");
-      } else {
-        showPiecesAvailability(false);
-        showPiecesDownloaded(false);
-      }
-      return;
-    }
-    if (stackedProperties->currentIndex() == PropTabBar::TRACKERS_TAB) {
-      // Trackers
+  const int tab = stackedProperties->currentIndex();
+  if (tab == PropTabBar::TRACKERS_TAB) {
+    // Trackers
+    try {
       trackerList->loadTrackers();
-      return;
-    }
-    if (stackedProperties->currentIndex() == PropTabBar::PEERS_TAB) {
-      // Load peers
-      peersList->loadPeers(h);
-      return;
-    }
-    if (stackedProperties->currentIndex() == PropTabBar::FILES_TAB) {
-      // Files progress
-      if (h.is_valid() && h.has_metadata()) {
-        qDebug("Updating priorities in files tab");
-        filesList->setUpdatesEnabled(false);
-        std::vector<size_type> fp;
-        h.file_progress(fp);
-        PropListModel->model()->updateFilesPriorities(h.file_priorities());
-        PropListModel->model()->updateFilesProgress(fp);
-        filesList->setUpdatesEnabled(true);
-      }
+    } catch(invalid_handle e) {}
+    return;
+  }
+  const int needs = tabNeeds(tab);
+  if (needs)
+    m_fetchRequest = m_fetcher->request(h, needs);
+}
+
+void PropertiesWidget::handleFetchedData() {
+  PropertiesData data;
+  if (!m_fetcher->takeResult(data)) return;
+  // Discard the results of older requests (e.g. for another torrent)
+  if (data.request != m_fetchRequest || !data.valid || !h.is_valid()) return;
+  if (data.needs & PropertiesFetcher::STATUS)
+    updateTransferInfos(data);
+  if (data.needs & PropertiesFetcher::PEERS)
+    peersList->updatePeers(data.peers);
+  if (data.needs & PropertiesFetcher::FILES)
+    updateFilesProgress(data);
+}
+
+void PropertiesWidget::updateTransferInfos(const PropertiesData &data) {
+  const torrent_status &status = data.status;
+  wasted->setText(misc::friendlyUnit(status.total_failed_bytes+status.total_redundant_bytes));
+  upTotal->setText(misc::friendlyUnit(status.all_time_upload) + " ("+misc::friendlyUnit(status.total_payload_upload)+" "+tr("this session")+")");
+  dlTotal->setText(misc::friendlyUnit(status.all_time_download) + " ("+misc::friendlyUnit(status.total_payload_download)+" "+tr("this session")+")");
+  if (data.upload_limit <= 0)
+    lbl_uplimit->setText(QString::fromUtf8("∞"));
+  else
+    lbl_uplimit->setText(misc::friendlyUnit(data.upload_limit)+tr("/s", "/second (i.e. per second)"));
+  if (data.download_limit <= 0)
+    lbl_dllimit->setText(QString::fromUtf8("∞"));
+  else
+    lbl_dllimit->setText(misc::friendlyUnit(data.download_limit)+tr("/s", "/second (i.e. per second)"));
+  const bool is_seed = status.state == torrent_status::finished || status.state == torrent_status::seeding;
+  QString elapsed_txt = misc::userFriendlyDuration(status.active_time);
+  if (is_seed) {
+    elapsed_txt += " ("+tr("Seeded for %1", "e.g. Seeded for 3m10s").arg(misc::userFriendlyDuration(status.seeding_time))+")";
+  }
+  lbl_elapsed->setText(elapsed_txt);
+  if (status.connections_limit > 0)
+    lbl_connections->setText(QString::number(status.num_connections)+" ("+tr("%1 max", "e.g. 10 max").arg(QString::number(status.connections_limit))+")");
+  else
+    lbl_connections->setText(QString::number(status.num_connections));
+  // Update next announce time
+  reannounce_lbl->setText(misc::userFriendlyDuration(status.next_announce.total_seconds()));
+  // Update ratio info
+  const qreal ratio = QBtSession::getRealRatio(status);
+  if (ratio > QBtSession::MAX_RATIO)
+    shareRatio->setText(QString::fromUtf8("∞"));
+  else
+    shareRatio->setText(QString(QByteArray::number(ratio, 'f', 2)));
+  if (!is_seed) {
+    showPiecesDownloaded(true);
+    // Downloaded pieces
+    downloaded_pieces->setProgress(status.pieces, data.downloading_pieces);
+    // Pieces availability
+    const bool is_checking = status.state == torrent_status::checking_files || status.state == torrent_status::checking_resume_data;
+    if (status.has_metadata && !status.paused && !is_checking) {
+      showPiecesAvailability(true);
+      pieces_availability->setAvailability(data.availability);
+      avail_average_lbl->setText(QString::number(status.distributed_copies, 'f', 3));
+    } else {
+      showPiecesAvailability(false);
     }
-  } catch(invalid_handle e) {}
+    // Progress
+    qreal progress = status.progress*100.;
+    if (progress > 99.94 && progress < 100.)
+      progress = 99.9;
+    progress_lbl->setText(QString::number(progress, 'f', 1)+"%");
+  } else {
+    showPiecesAvailability(false);
+    showPiecesDownloaded(false);
+  }
+}
+
+void PropertiesWidget::updateFilesProgress(const PropertiesData &data) {
+  if (data.file_progress.empty()) return;
+  // Nothing to do if nothing changed since the last refresh
+  if (data.file_progress == m_fileProgress && data.file_priorities == m_filePriorities) return;
+  qDebug("Updating priorities in files tab");
+  filesList->setUpdatesEnabled(false);
+  if (data.file_priorities != m_filePriorities)
+    PropListModel->model()->updateFilesPriorities(data.file_priorities);
+  PropListModel->model()->updateFilesProgress(data.file_progress);
+  filesList->setUpdatesEnabled(true);
+  m_fileProgress = data.file_progress;
+  m_filePriorities = data.file_priorities;
 }
 
 void PropertiesWidget::loadUrlSeeds() {
@@ -718,5 +782,7 @@ void PropertiesWidget::on_changeSavePathButton_clicked() {
 void PropertiesWidget::filteredFilesChanged() {
   if (h.is_valid()) {
     applyPriorities();
+    // A refresh in progress may have read the old priorities
+    m_fetchRequest = 0;
   }
 }
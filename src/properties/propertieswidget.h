@@ -47,6 +47,8 @@ class DownloadedPiecesBar;
 class PieceAvailabilityBar;
 class PropTabBar;
 class LineEdit;
+class PropertiesFetcher;
+struct PropertiesData;
 
 QT_BEGIN_NAMESPACE
 class QAction;
@@ -71,6 +73,8 @@ public:
 protected:
   QPushButton* getButtonFromIndex(int index);
   bool applyPriorities();
+  void updateTransferInfos(const PropertiesData &data);
+  void updateFilesProgress(const PropertiesData &data);
 
 protected slots:
   void loadTorrentInfos(const QTorrentHandle &h);
@@ -84,6 +88,8 @@ protected slots:
   void showPiecesDownloaded(bool show);
   void showPiecesAvailability(bool show);
   void renameSelectedFile();
+  void updateRefreshInterval();
+  void handleFetchedData();
 
 public slots:
   void setVisibility(bool visible);
@@ -94,6 +100,7 @@ public slots:
   void reloadPreferences();
   void openDoubleClickedFile(QModelIndex);
   void updateSavePath(const QTorrentHandle& h);
+  void updatePieceFinished(const QTorrentHandle &h, int piece);
 
 private:
   TransferListWidget *transferList;
@@ -110,6 +117,11 @@ private:
   PieceAvailabilityBar *pieces_availability;
   PropTabBar *m_tabBar;
   LineEdit *m_contentFilerLine;
+  PropertiesFetcher *m_fetcher;
+  int m_fetchRequest;
+  // Last files data, unchanged data is not reloaded
+  std::vector<libtorrent::size_type> m_fileProgress;
+  std::vector<int> m_filePriorities;
 };
 
 #endif // PROPERTIESWIDGET_H
@@ -284,6 +284,7 @@ void TrackerList::askForTrackers() {
       url.tier = 0;
       h.add_tracker(url);
     }
+    QBtSession::instance()->updateTrackerIndex(h);
     // Reannounce to new trackers
     h.force_reannounce();
     // Reload tracker list
@@ -316,6 +317,7 @@ void TrackerList::deleteSelectedTrackers() {
     }
   }
   h.replace_trackers(remaining_trackers);
+  QBtSession::instance()->updateTrackerIndex(h);
   h.force_reannounce();
   // Reload Trackers
   loadTrackers();
@@ -0,0 +1,263 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <libtorrent/session.hpp>
+#include "banmanager.h"
+#include "misc.h"
+#include "preferences.h"
+
+using namespace libtorrent;
+
+// Bans made within this delay are applied together
+const int APPLY_DELAY = 500; // ms
+
+static uint now() {
+  return QDateTime::currentDateTime().toTime_t();
+}
+
+static bool parseAddress(const QString &ip, address &addr) {
+  boost::system::error_code ec;
+  addr = address::from_string(ip.toLocal8Bit().constData(), ec);
+  return !ec;
+}
+
+BanManager::BanManager(session *s, QObject *parent):
+  QObject(parent), m_session(s), m_dirty(false)
+{
+  m_applyTimer.setSingleShot(true);
+  m_applyTimer.setInterval(APPLY_DELAY);
+  connect(&m_applyTimer, SIGNAL(timeout()), SLOT(applyFilter()));
+  m_expiryTimer.setSingleShot(true);
+  connect(&m_expiryTimer, SIGNAL(timeout()), SLOT(expireBans()));
+  loadBans();
+  applyFilter();
+  scheduleExpiry();
+}
+
+bool BanManager::ban(const QString &ip, int ttl) {
+  address addr;
+  if (!parseAddress(ip, addr)) {
+    qDebug("Cannot ban invalid address %s", qPrintable(ip));
+    return false;
+  }
+  const QString key = QString::fromLocal8Bit(addr.to_string().c_str());
+  const uint expiry = (ttl > 0) ? now() + ttl : 0;
+  {
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, Ban>::iterator it = m_bans.find(key);
+    if (it == m_bans.end()) {
+      it = m_bans.insert(key, Ban());
+      addRule(key, it.value());
+    }
+    it.value().expiry = expiry;
+  }
+  qDebug("Manual ban of peer %s", qPrintable(key));
+  appendToLog(QString("+%1 %2").arg(key).arg(expiry));
+  scheduleApply();
+  if (expiry)
+    scheduleExpiry();
+  return true;
+}
+
+void BanManager::unban(const QString &ip) {
+  address addr;
+  if (!parseAddress(ip, addr)) return;
+  const QString key = QString::fromLocal8Bit(addr.to_string().c_str());
+  {
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, Ban>::iterator it = m_bans.find(key);
+    if (it == m_bans.end()) return;
+    removeRule(key, it.value());
+    m_bans.erase(it);
+  }
+  appendToLog(QString("-%1").arg(key));
+  scheduleApply();
+}
+
+QHash<QString, uint> BanManager::bans() const {
+  QMutexLocker locker(&m_mutex);
+  QHash<QString, uint> result;
+  QHash<QString, Ban>::const_iterator it;
+  for (it = m_bans.constBegin(); it != m_bans.constEnd(); ++it)
+    result.insert(it.key(), it.value().expiry);
+  return result;
+}
+
+void BanManager::setFilterList(const ip_filter &filter) {
+  QMutexLocker locker(&m_mutex);
+  m_filter = filter;
+  QHash<QString, Ban>::iterator it;
+  for (it = m_bans.begin(); it != m_bans.end(); ++it)
+    addRule(it.key(), it.value());
+  m_session->set_ip_filter(m_filter);
+  m_dirty = false;
+}
+
+void BanManager::applyFilter() {
+  QMutexLocker locker(&m_mutex);
+  if (!m_dirty) return;
+  qDebug("Applying %d manual bans", m_bans.size());
+  m_session->set_ip_filter(m_filter);
+  m_dirty = false;
+}
+
+void BanManager::expireBans() {
+  const uint t = now();
+  {
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, Ban>::iterator it = m_bans.begin();
+    while (it != m_bans.end()) {
+      if (it.value().expiry && it.value().expiry <= t) {
+        qDebug("Ban of %s expired", qPrintable(it.key()));
+        removeRule(it.key(), it.value());
+        it = m_bans.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  scheduleApply();
+  scheduleExpiry();
+}
+
+// Must be called with the mutex locked
+void BanManager::addRule(const QString &ip, Ban &ban) {
+  address addr;
+  if (!parseAddress(ip, addr)) return;
+  // If the filter list blocks it, lifting the ban must not unblock it
+  ban.covered = (m_filter.access(addr) & ip_filter::blocked) != 0;
+  if (!ban.covered) {
+    m_filter.add_rule(addr, addr, ip_filter::blocked);
+    m_dirty = true;
+  }
+}
+
+// Must be called with the mutex locked
+void BanManager::removeRule(const QString &ip, const Ban &ban) {
+  address addr;
+  if (ban.covered || !parseAddress(ip, addr)) return;
+  m_filter.add_rule(addr, addr, 0);
+  m_dirty = true;
+}
+
+void BanManager::scheduleApply() {
+  if (!m_applyTimer.isActive())
+    m_applyTimer.start();
+}
+
+void BanManager::scheduleExpiry() {
+  uint next = 0;
+  {
+    QMutexLocker locker(&m_mutex);
+    foreach (const Ban &ban, m_bans) {
+      if (ban.expiry && (!next || ban.expiry < next))
+        next = ban.expiry;
+    }
+  }
+  if (!next) {
+    m_expiryTimer.stop();
+    return;
+  }
+  const uint t = now();
+  // Checked at least daily, to stay within the timer range
+  const uint delay = next > t ? qMin(next - t, (uint)86400) : 0;
+  m_expiryTimer.start(delay * 1000);
+}
+
+// Each line of the log is either "+<ip> <expiry>" or "-<ip>"
+void BanManager::loadBans() {
+  const uint t = now();
+  int lines = 0;
+  QFile log(logPath());
+  if (log.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    QTextStream in(&log);
+    while (!in.atEnd()) {
+      const QString line = in.readLine().trimmed();
+      if (line.size() < 2) continue;
+      ++lines;
+      if (line.at(0) == '+') {
+        const QStringList parts = line.mid(1).split(' ');
+        Ban ban;
+        if (parts.size() > 1)
+          ban.expiry = parts.at(1).toUInt();
+        if (!ban.expiry || ban.expiry > t)
+          m_bans.insert(parts.first(), ban);
+        else
+          m_bans.remove(parts.first());
+      } else if (line.at(0) == '-') {
+        m_bans.remove(line.mid(1));
+      }
+    }
+    log.close();
+  }
+  // Bans from older versions
+  Preferences pref;
+  const QStringList old_bans = pref.bannedIPs();
+  if (!old_bans.isEmpty()) {
+    foreach (const QString &ip, old_bans)
+      m_bans.insert(ip, Ban());
+    pref.clearBannedIPs();
+    lines += 2 * old_bans.size() + 32; // Force rewriting
+  }
+  QHash<QString, Ban>::iterator it;
+  for (it = m_bans.begin(); it != m_bans.end(); ++it)
+    addRule(it.key(), it.value());
+  // Compact the log
+  if (lines > 2 * m_bans.size() + 32) {
+    qDebug("Compacting the banned peers log");
+    if (log.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+      QTextStream out(&log);
+      for (it = m_bans.begin(); it != m_bans.end(); ++it)
+        out << "+" << it.key() << " " << it.value().expiry << "\n";
+    }
+  }
+}
+
+void BanManager::appendToLog(const QString &line) {
+  QFile log(logPath());
+  if (!log.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+    qWarning("Cannot save the banned peers to %s", qPrintable(log.fileName()));
+    return;
+  }
+  log.write(line.toLocal8Bit() + "\n");
+}
+
+QString BanManager::logPath() {
+  const QDir data_dir(misc::QDesktopServicesDataLocation());
+  if (!data_dir.exists())
+    data_dir.mkpath(data_dir.absolutePath());
+  return data_dir.absoluteFilePath("banned_peers");
+}
@@ -0,0 +1,96 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef BANMANAGER_H
+#define BANMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QTimer>
+#include <libtorrent/ip_filter.hpp>
+
+namespace libtorrent {
+  class session;
+}
+
+// Manually banned peers, on top of the IP filter list.
+// Bans are added to the session filter in place, without copying the
+// filter list, and the session filter is replaced once per batch of
+// bans. Bans may expire. They are saved to an append only file, which
+// is compacted when loaded.
+// setFilterList() may be called from any thread, the rest only from
+// the main thread.
+class BanManager : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(BanManager)
+
+public:
+  BanManager(libtorrent::session *s, QObject *parent = 0);
+
+  // ttl in seconds, 0 for a permanent ban
+  bool ban(const QString &ip, int ttl = 0);
+  void unban(const QString &ip);
+  // ip -> expiry (time_t), 0 for a permanent ban
+  QHash<QString, uint> bans() const;
+  // Replaces the filter list (empty filter to disable it), bans are kept
+  void setFilterList(const libtorrent::ip_filter &filter);
+
+private slots:
+  void applyFilter();
+  void expireBans();
+
+private:
+  struct Ban {
+    Ban(): expiry(0), covered(false) {}
+    uint expiry; // 0: never
+    bool covered; // Already blocked by the filter list
+  };
+
+  void addRule(const QString &ip, Ban &ban);
+  void removeRule(const QString &ip, const Ban &ban);
+  void scheduleApply();
+  void scheduleExpiry();
+  void loadBans();
+  void appendToLog(const QString &line);
+  static QString logPath();
+
+private:
+  libtorrent::session *m_session;
+  mutable QMutex m_mutex;
+  libtorrent::ip_filter m_filter; // Filter list and bans, as in the session
+  QHash<QString, Ban> m_bans;
+  bool m_dirty;
+  QTimer m_applyTimer;
+  QTimer m_expiryTimer;
+};
+
+#endif // BANMANAGER_H
@@ -37,8 +37,9 @@
 #include <QStringList>
 #include <QHostAddress>
 
-#include <libtorrent/session.hpp>
 #include <libtorrent/ip_filter.hpp>
+#include "banmanager.h"
+#include "tracer.h"
 
 using namespace std;
 
@@ -55,7 +56,7 @@ class FilterParserThread : public QThread  {
   Q_OBJECT
 
 public:
-  FilterParserThread(QObject* parent, libtorrent::session *s) : QThread(parent), s(s), abort(false) {
+  FilterParserThread(QObject* parent, BanManager *bans) : QThread(parent), bans(bans), abort(false) {
 
   }
 
@@ -352,33 +353,19 @@ public:
   //  * PeerGuardian Text (P2P): http://wiki.phoenixlabs.org/wiki/P2P_Format
   //  * PeerGuardian Binary (P2B): http://wiki.phoenixlabs.org/wiki/P2B_Format
   void processFilterFile(QString _filePath) {
-    // First, import current filter
-    filter = s->get_ip_filter();
     if (isRunning()) {
       // Already parsing a filter, abort first
       abort = true;
       wait();
     }
+    // Manual bans are added by the BanManager
+    filter = libtorrent::ip_filter();
     abort = false;
     filePath = _filePath;
     // Run it
     start();
   }
 
-  static void processFilterList(libtorrent::session *s, const QStringList& IPs) {
-    // First, import current filter
-    libtorrent::ip_filter filter = s->get_ip_filter();
-    foreach (const QString &ip, IPs) {
-      qDebug("Manual ban of peer %s", ip.toLocal8Bit().constData());
-      boost::system::error_code ec;
-      libtorrent::address addr = libtorrent::address::from_string(ip.toLocal8Bit().constData(), ec);
-      Q_ASSERT(!ec);
-      if (!ec)
-        filter.add_rule(addr, addr, libtorrent::ip_filter::blocked);
-    }
-    s->set_ip_filter(filter);
-  }
-
 signals:
   void IPFilterParsed(int ruleCount);
   void IPFilterError();
@@ -393,6 +380,7 @@ protected:
   }
 
   void run() {
+    QBT_TRACE_SCOPE("ipfilter", "parseFilterFile");
     qDebug("Processing filter file");
     int ruleCount = 0;
     if (filePath.endsWith(".p2p", Qt::CaseInsensitive)) {
@@ -410,7 +398,9 @@ protected:
     if (abort)
       return;
     try {
-      s->set_ip_filter(filter);
+      bans->setFilterList(filter);
+      // The BanManager has its own copy
+      filter = libtorrent::ip_filter();
       emit IPFilterParsed(ruleCount);
     } catch(std::exception&) {
       emit IPFilterError();
@@ -419,7 +409,7 @@ protected:
   }
 
 private:
-  libtorrent::session *s;
+  BanManager *bans;
   libtorrent::ip_filter filter;
   bool abort;
   QString filePath;
@@ -0,0 +1,72 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef INFOHASH_H
+#define INFOHASH_H
+
+#include <QByteArray>
+#include <QString>
+#include <libtorrent/peer_id.hpp>
+#include "misc.h"
+
+// Torrent info hash in binary form (20 bytes), used as key of the
+// internal tables instead of its 40 characters hex string. The hex
+// form is only for the user, the Web UI and the persistent data.
+class InfoHash {
+public:
+  InfoHash() {}
+  InfoHash(const libtorrent::sha1_hash &hash): m_hash(hash) {}
+  // Null if hex is not a valid hex info hash
+  explicit InfoHash(const QString &hex) {
+    if (hex.size() != 2 * (int)libtorrent::sha1_hash::size) return;
+    const QByteArray raw = QByteArray::fromHex(hex.toAscii());
+    if (raw.size() == (int)libtorrent::sha1_hash::size)
+      m_hash = libtorrent::sha1_hash(raw.constData());
+  }
+
+  inline bool isNull() const { return m_hash.is_all_zeros(); }
+  inline const libtorrent::sha1_hash& native() const { return m_hash; }
+  inline QString toString() const { return misc::toQString(m_hash); }
+
+  inline bool operator==(const InfoHash &other) const { return m_hash == other.m_hash; }
+  inline bool operator!=(const InfoHash &other) const { return !(m_hash == other.m_hash); }
+  inline bool operator<(const InfoHash &other) const { return m_hash < other.m_hash; }
+
+private:
+  libtorrent::sha1_hash m_hash;
+};
+
+// SHA-1 output is uniformly distributed, its first bytes are a good hash
+inline uint qHash(const InfoHash &hash) {
+  const unsigned char *d = hash.native().begin();
+  return (uint(d[0]) << 24) | (uint(d[1]) << 16) | (uint(d[2]) << 8) | uint(d[3]);
+}
+
+#endif // INFOHASH_H
@@ -0,0 +1,155 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QRegExp>
+#include "logbuffer.h"
+
+QString LogRecord::time() const {
+  return QDateTime::fromTime_t(timestamp).toString(QString::fromUtf8("dd/MM/yyyy hh:mm:ss"));
+}
+
+QString LogRecord::text() const {
+  switch(type) {
+  case PEER_BLOCKED:
+    return QCoreApplication::translate("QBtSession", "<font color='red'>%1</font> <i>was blocked due to your IP filter</i>", "x.y.z.w was blocked").arg(payload);
+  case PEER_BANNED:
+    return QCoreApplication::translate("QBtSession", "<font color='red'>%1</font> <i>was banned due to corrupt pieces</i>", "x.y.z.w was banned").arg(payload);
+  default:
+    return payload;
+  }
+}
+
+static QString severityColor(LogRecord::Severity severity) {
+  switch(severity) {
+  case LogRecord::INFO:
+    return QString::fromUtf8("blue");
+  case LogRecord::WARNING:
+    return QString::fromUtf8("darkorange");
+  case LogRecord::CRITICAL:
+    return QString::fromUtf8("red");
+  default:
+    return QString();
+  }
+}
+
+QString LogRecord::toHtml() const {
+  QString html = "<font color='grey'>" + time() + "</font> - ";
+  if (type != MESSAGE)
+    return html + text();
+  const QString color = severityColor(severity);
+  if (color.isEmpty())
+    return html + "<i>" + payload + "</i>";
+  return html + "<font color='" + color + "'><i>" + payload + "</i></font>";
+}
+
+QString LogRecord::toPlainText() const {
+  if (type == MESSAGE)
+    return time() + " - " + payload;
+  // Peer messages are translated as rich text
+  QString plain = text();
+  plain.remove(QRegExp("<[^>]+>"));
+  return time() + " - " + plain;
+}
+
+QVariantMap LogRecord::toMap() const {
+  QVariantMap map;
+  map["id"] = id;
+  map["timestamp"] = timestamp;
+  map["type"] = (int)type;
+  map["severity"] = (int)severity;
+  if (type == MESSAGE) {
+    map["message"] = payload;
+  } else {
+    QString plain = text();
+    plain.remove(QRegExp("<[^>]+>"));
+    map["message"] = plain;
+  }
+  return map;
+}
+
+LogBuffer::LogBuffer(int capacity):
+  m_records(qMax(capacity, 1)), m_first(0), m_size(0), m_lastId(0)
+{
+}
+
+LogRecord LogBuffer::append(LogRecord::Type type, LogRecord::Severity severity, const QString &payload) {
+  LogRecord rec;
+  rec.timestamp = QDateTime::currentDateTime().toTime_t();
+  rec.type = type;
+  rec.severity = severity;
+  rec.payload = payload;
+  QMutexLocker locker(&m_mutex);
+  rec.id = ++m_lastId;
+  const int capacity = m_records.size();
+  if (m_size < capacity) {
+    m_records[(m_first + m_size) % capacity] = rec;
+    ++m_size;
+  } else {
+    // Replace the oldest record
+    m_records[m_first] = rec;
+    m_first = (m_first + 1) % capacity;
+  }
+  return rec;
+}
+
+int LogBuffer::size() const {
+  QMutexLocker locker(&m_mutex);
+  return m_size;
+}
+
+qulonglong LogBuffer::lastId() const {
+  QMutexLocker locker(&m_mutex);
+  return m_lastId;
+}
+
+bool LogBuffer::record(qulonglong id, LogRecord &record) const {
+  QMutexLocker locker(&m_mutex);
+  const qulonglong first_id = m_lastId - m_size + 1;
+  if (m_size == 0 || id < first_id || id > m_lastId)
+    return false;
+  record = m_records.at((m_first + (id - first_id)) % m_records.size());
+  return true;
+}
+
+QList<LogRecord> LogBuffer::records(qulonglong last_known_id, int max_count, qulonglong *next_id) const {
+  QList<LogRecord> result;
+  QMutexLocker locker(&m_mutex);
+  const qulonglong first_id = m_lastId - m_size + 1;
+  qulonglong id = qMax(last_known_id + 1, first_id);
+  for ( ; id <= m_lastId && result.size() < max_count; ++id)
+    result << m_records.at((m_first + (id - first_id)) % m_records.size());
+  if (next_id) {
+    // Ids newer than the last record come from a previous run
+    *next_id = result.isEmpty() ? qMin(last_known_id, m_lastId) : result.last().id;
+  }
+  return result;
+}
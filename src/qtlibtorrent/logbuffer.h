@@ -0,0 +1,88 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+// An entry of the execution log. Only raw data is stored, the text
+// is only built when the entry is displayed.
+struct LogRecord {
+  enum Type {MESSAGE, PEER_BLOCKED, PEER_BANNED};
+  enum Severity {NORMAL, INFO, WARNING, CRITICAL};
+
+  LogRecord(): id(0), timestamp(0), type(MESSAGE), severity(NORMAL) {}
+
+  QString time() const;
+  // Message (for peers, the reason why the peer was blocked)
+  QString text() const;
+  // Rich text, as it used to be displayed in the execution log
+  QString toHtml() const;
+  QString toPlainText() const;
+  QVariantMap toMap() const;
+
+  qulonglong id;     // Sequence number, starts at 1
+  uint timestamp;    // Seconds since epoch
+  Type type;
+  Severity severity;
+  QString payload;   // Message or peer IP
+};
+
+// Fixed capacity log: once full, each new record replaces the oldest.
+// Records can be read from any thread.
+class LogBuffer {
+  Q_DISABLE_COPY(LogBuffer)
+
+public:
+  explicit LogBuffer(int capacity);
+
+  LogRecord append(LogRecord::Type type, LogRecord::Severity severity, const QString &payload);
+  int size() const;
+  qulonglong lastId() const;
+  bool record(qulonglong id, LogRecord &record) const;
+  // At most max_count records following last_known_id, oldest first.
+  // next_id is set to the id to ask from on the next call: the id of
+  // the last returned record, or last_known_id if there is none.
+  QList<LogRecord> records(qulonglong last_known_id, int max_count, qulonglong *next_id = 0) const;
+
+private:
+  mutable QMutex m_mutex;
+  QVector<LogRecord> m_records;
+  int m_first; // Index of the oldest record
+  int m_size;
+  qulonglong m_lastId;
+};
+
+#endif // LOGBUFFER_H
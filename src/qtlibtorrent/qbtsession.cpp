@@ -35,6 +35,7 @@
 #include <QHostAddress>
 #include <QNetworkAddressEntry>
 #include <QProcess>
+#include <QtConcurrentMap>
 #include <stdlib.h>
 
 #include "smtp.h"
@@ -80,13 +81,17 @@
 #include <queue>
 #include <string.h>
 #include "dnsupdater.h"
+#include "tracer.h"
 
 using namespace libtorrent;
 
 QBtSession* QBtSession::m_instance = 0;
 const qreal QBtSession::MAX_RATIO = 9999.;
+const int QBtSession::MAX_SEEDING_TIME = 525600; // 1 year, in minutes
 
 const int MAX_TRACKER_ERRORS = 2;
+// Number of torrent files added per event loop iteration by addTorrents()
+const int BULK_ADD_CHUNK_SIZE = 50;
 
 /* Converts a QString hash into a libtorrent sha1_hash */
 static libtorrent::sha1_hash QStringToSha1(const QString& s) {
@@ -97,10 +102,45 @@ static libtorrent::sha1_hash QStringToSha1(const QString& s) {
   return ret;
 }
 
+/* Fixes up a local torrent file path given by the user */
+static QString normalizeTorrentPath(QString path) {
+#ifdef Q_WS_WIN
+  // Windows hack
+  if (!path.endsWith(".torrent"))
+    if (QFile::rename(path, path+".torrent")) path += ".torrent";
+#endif
+  if (path.startsWith("file:", Qt::CaseInsensitive))
+    path = QUrl::fromEncoded(path.toLocal8Bit()).toLocalFile();
+  return path;
+}
+
+/* Torrent file decoded by a worker thread for addTorrents() */
+struct ParsedTorrentFile {
+  QString path;
+  bool fromScanDir;
+  boost::intrusive_ptr<torrent_info> t;
+};
+
+static ParsedTorrentFile parseTorrentFile(const QPair<QString, bool> &file) {
+  ParsedTorrentFile parsed;
+  parsed.path = file.first;
+  parsed.fromScanDir = file.second;
+  try {
+    boost::intrusive_ptr<torrent_info> t = new torrent_info(file.first.toUtf8().constData());
+    if (t->is_valid())
+      parsed.t = t;
+  } catch(std::exception&) {
+    qDebug("Unable to decode torrent file: %s", qPrintable(file.first));
+  }
+  return parsed;
+}
+
 // Main constructor
 QBtSession::QBtSession()
-  : m_scanFolders(ScanFoldersModel::instance(this)),
-    preAllocateAll(false), addInPause(false), global_ratio_limit(-1),
+  : m_failedResumeDataCount(0), m_lastAlertCount(0), m_totalAlertCount(0),
+    m_scanFolders(ScanFoldersModel::instance(this)), m_bulkAdding(false),
+    m_log(MAX_LOG_RECORDS), m_peerLog(MAX_LOG_RECORDS),
+    preAllocateAll(false), addInPause(false),
     LSDEnabled(false),
     DHTEnabled(false), current_dht_port(0), queueingEnabled(false),
     torrentExport(false)
@@ -110,9 +150,6 @@ QBtSession::QBtSession()
   , m_tracker(0), m_shutdownAct(NO_SHUTDOWN),
     m_upnp(0), m_natpmp(0), m_dynDNSUpdater(0)
 {
-  BigRatioTimer = new QTimer(this);
-  BigRatioTimer->setInterval(10000);
-  connect(BigRatioTimer, SIGNAL(timeout()), SLOT(processBigRatios()));
   Preferences pref;
 #if LIBTORRENT_VERSION_MINOR < 16
   // To avoid some exceptions
@@ -146,12 +183,22 @@ QBtSession::QBtSession()
     PeXEnabled = false;
   }
   s->add_extension(&create_smart_ban_plugin);
+  m_torrentQueue = new TorrentQueue(s);
+  // Manual bans, applied right away
+  m_banManager = new BanManager(s, this);
   timerAlerts = new QTimer(this);
   connect(timerAlerts, SIGNAL(timeout()), SLOT(readAlerts()));
   timerAlerts->start(1000);
   appendLabelToSavePath = pref.appendTorrentLabel();
   appendqBExtension = pref.useIncompleteFilesExtension();
   connect(m_scanFolders, SIGNAL(torrentsAdded(QStringList&)), SLOT(addTorrentsFromScanFolder(QStringList&)));
+  // Tracker state, by torrent and by tracker host
+  m_trackerIndex = new TrackerIndex(this);
+  // Torrents by state and by label
+  m_torrentCounters = new TorrentCounters(this);
+  // Ratio and seeding time limits
+  m_seedingLimits = new SeedingLimits(s, this);
+  connect(m_seedingLimits, SIGNAL(limitReached(QTorrentHandle,int)), SLOT(handleSeedingLimitReached(QTorrentHandle,int)));
   // Apply user settings to Bittorrent session
   configureSession();
   // Torrent speed monitor
@@ -179,11 +226,10 @@ QBtSession::~QBtSession() {
   if (m_tracker)
     delete m_tracker;
   delete timerAlerts;
-  if (BigRatioTimer)
-    delete BigRatioTimer;
   if (filterParser)
     delete filterParser;
   delete downloader;
+  delete m_torrentQueue;
   if (bd_scheduler)
     delete bd_scheduler;
   // HTTP Server
@@ -208,38 +254,22 @@ void QBtSession::preAllocateAllFiles(bool b) {
   }
 }
 
-void QBtSession::processBigRatios() {
-  qDebug("Process big ratios...");
-  std::vector<torrent_handle> torrents = s->get_torrents();
-  std::vector<torrent_handle>::iterator torrentIT;
-  for (torrentIT = torrents.begin(); torrentIT != torrents.end(); torrentIT++) {
-    const QTorrentHandle h(*torrentIT);
-    if (!h.is_valid()) continue;
-    if (h.is_seed()) {
-      const QString hash = h.hash();
-      const qreal ratio = getRealRatio(hash);
-      qreal ratio_limit = TorrentPersistentData::getRatioLimit(hash);
-      if (ratio_limit == TorrentPersistentData::NO_RATIO_LIMIT)
-        continue;
-      if (ratio_limit == TorrentPersistentData::USE_GLOBAL_RATIO)
-        ratio_limit = global_ratio_limit;
-      qDebug("Ratio: %f (limit: %f)", ratio, ratio_limit);
-      Q_ASSERT(ratio_limit >= 0.f);
-      if (ratio <= MAX_RATIO && ratio >= ratio_limit) {
-        if (high_ratio_action == REMOVE_ACTION) {
-          addConsoleMessage(tr("%1 reached the maximum ratio you set.").arg(h.name()));
-          addConsoleMessage(tr("Removing torrent %1...").arg(h.name()));
-          deleteTorrent(hash);
-        } else {
-          // Pause it
-          if (!h.is_paused()) {
-            addConsoleMessage(tr("%1 reached the maximum ratio you set.").arg(h.name()));
-            addConsoleMessage(tr("Pausing torrent %1...").arg(h.name()));
-            pauseTorrent(hash);
-          }
-        }
-        //emit torrent_ratio_deleted(fileName);
-      }
+void QBtSession::handleSeedingLimitReached(const QTorrentHandle &h, int limit) {
+  if (!h.is_valid()) return;
+  const QString hash = h.hash();
+  const QString msg = (limit == SeedingLimits::SEEDING_TIME_LIMIT) ?
+        tr("%1 reached the maximum seeding time you set.").arg(h.name()) :
+        tr("%1 reached the maximum ratio you set.").arg(h.name());
+  if (high_ratio_action == REMOVE_ACTION) {
+    addConsoleMessage(msg);
+    addConsoleMessage(tr("Removing torrent %1...").arg(h.name()));
+    deleteTorrent(hash);
+  } else {
+    // Pause it
+    if (!h.is_paused()) {
+      addConsoleMessage(msg);
+      addConsoleMessage(tr("Pausing torrent %1...").arg(h.name()));
+      pauseTorrent(hash);
     }
   }
 }
@@ -262,9 +292,7 @@ void QBtSession::setUploadLimit(QString hash, long val) {
 void QBtSession::handleDownloadFailure(QString url, QString reason) {
   emit downloadFromUrlFailure(url, reason);
   // Clean up
-  const QUrl qurl = QUrl::fromEncoded(url.toUtf8());
-  url_skippingDlg.removeOne(qurl);
-  savepathLabel_fromurl.remove(qurl);
+  savepathLabel_fromurl.remove(QUrl::fromEncoded(url.toUtf8()));
 }
 
 void QBtSession::startTorrentsInPause(bool b) {
@@ -275,6 +303,11 @@ void QBtSession::setQueueingEnabled(bool enable) {
   if (queueingEnabled != enable) {
     qDebug("Queueing system is changing state...");
     queueingEnabled = enable;
+    // The queued torrents are counted as paused without queueing
+    const std::vector<torrent_handle> torrents = s->get_torrents();
+    std::vector<torrent_handle>::const_iterator it;
+    for (it = torrents.begin(); it != torrents.end(); ++it)
+      m_torrentCounters->update(QTorrentHandle(*it), queueingEnabled);
   }
 }
 
@@ -543,9 +576,8 @@ void QBtSession::configureSession() {
   // * Maximum ratio
   high_ratio_action = pref.getMaxRatioAction();
   setGlobalMaxRatio(pref.getGlobalMaxRatio());
-  updateRatioTimer();
+  setGlobalMaxSeedingTime(pref.getGlobalMaxSeedingMinutes());
   // Ip Filter
-  FilterParserThread::processFilterList(s, pref.bannedIPs());
   if (pref.isFilteringEnabled()) {
     enableIPFilter(pref.getFilter());
   }else{
@@ -592,6 +624,8 @@ void QBtSession::configureSession() {
     proxySettings.type = proxy_settings::none;
   }
   setProxySettings(proxySettings);
+  // Proxy settings of the HTTP downloads are cached
+  DownloadThread::invalidateSettings();
   // Tracker
   if (pref.isTrackerEnabled()) {
     if (!m_tracker) {
@@ -654,6 +688,7 @@ void QBtSession::initWebUi() {
 
     httpServer->setAuthorization(username, password);
     httpServer->setlocalAuthEnabled(pref.isWebUiLocalAuthEnabled());
+    httpServer->setMaxUploadSize(pref.getWebUiMaxUploadSize());
     if (!httpServer->isListening()) {
       bool success = httpServer->listen(QHostAddress::Any, port);
       if (success)
@@ -739,9 +774,12 @@ bool QBtSession::hasDownloadingTorrents() const {
   return false;
 }
 
-void QBtSession::banIP(QString ip) {
-  FilterParserThread::processFilterList(s, QStringList(ip));
-  Preferences().banIP(ip);
+bool QBtSession::banIP(QString ip, int ttl) {
+  return m_banManager->ban(ip, ttl);
+}
+
+void QBtSession::unbanIP(QString ip) {
+  m_banManager->unban(ip);
 }
 
 // Delete a torrent from the session, given its hash
@@ -792,7 +830,10 @@ void QBtSession::deleteTorrent(const QString &hash, bool delete_local_files) {
   }
   TorrentPersistentData::deletePersistentData(hash);
   // Remove tracker errors
-  trackersInfos.remove(hash);
+  m_trackerIndex->removeTorrent(InfoHash(hash));
+  m_torrentCounters->removeTorrent(InfoHash(hash));
+  m_seedingLimits->removeTorrent(InfoHash(hash));
+  m_pendingResumeData.remove(hash);
   if (delete_local_files)
     addConsoleMessage(tr("'%1' was removed from transfer list and hard disk.", "'xxx.avi' was removed...").arg(fileName));
   else
@@ -850,6 +891,83 @@ void QBtSession::resumeTorrent(const QString &hash) {
   }
 }
 
+// Applies the same action to many torrents (transfer list and Web UI).
+// Resume data changes are written once for the whole batch. The
+// result tells for each hash if the action could be applied.
+QHash<QString, bool> QBtSession::applyToTorrents(BatchAction action, const QStringList &hashes, int value) {
+  QHash<QString, bool> results;
+  QList<QPair<QString, QTorrentHandle> > handles;
+  foreach (const QString &hash, hashes) {
+    if (results.contains(hash)) continue;
+    const QTorrentHandle h = getTorrentHandle(hash);
+    results[hash] = h.is_valid();
+    if (h.is_valid())
+      handles << qMakePair(hash, h);
+  }
+
+  TorrentResumeBatch batch;
+  switch(action) {
+  case BATCH_QUEUE_UP:
+  case BATCH_QUEUE_DOWN:
+  case BATCH_QUEUE_TOP:
+  case BATCH_QUEUE_BOTTOM:
+  case BATCH_QUEUE_POSITION: {
+    QList<QTorrentHandle> torrents;
+    QList<QPair<QString, QTorrentHandle> >::const_iterator it;
+    for (it = handles.constBegin(); it != handles.constEnd(); it++)
+      torrents << it->second;
+    switch(action) {
+    case BATCH_QUEUE_UP: m_torrentQueue->move(torrents, TorrentQueue::MOVE_UP); break;
+    case BATCH_QUEUE_DOWN: m_torrentQueue->move(torrents, TorrentQueue::MOVE_DOWN); break;
+    case BATCH_QUEUE_TOP: m_torrentQueue->move(torrents, TorrentQueue::MOVE_TOP); break;
+    case BATCH_QUEUE_BOTTOM: m_torrentQueue->move(torrents, TorrentQueue::MOVE_BOTTOM); break;
+    default: m_torrentQueue->moveTo(torrents, value);
+    }
+    break;
+  }
+  default: {
+    QList<QPair<QString, QTorrentHandle> >::iterator it;
+    for (it = handles.begin(); it != handles.end(); it++) {
+      QTorrentHandle &h = it->second;
+      try {
+        switch(action) {
+        case BATCH_PAUSE:
+          if (!h.is_paused()) {
+            h.pause();
+            emit pausedTorrent(h);
+          }
+          break;
+        case BATCH_RESUME:
+          if (h.is_paused()) {
+            h.resume();
+            emit resumedTorrent(h);
+          }
+          break;
+        case BATCH_DELETE:
+        case BATCH_DELETE_FILES:
+          deleteTorrent(it->first, action == BATCH_DELETE_FILES);
+          break;
+        case BATCH_RECHECK:
+          recheckTorrent(it->first);
+          break;
+        case BATCH_UPLOAD_LIMIT:
+          h.set_upload_limit(value);
+          break;
+        case BATCH_DOWNLOAD_LIMIT:
+          h.set_download_limit(value);
+          break;
+        default:
+          break;
+        }
+      } catch(invalid_handle&) {
+        results[it->first] = false;
+      }
+    }
+  }
+  }
+  return results;
+}
+
 bool QBtSession::loadFastResumeData(const QString &hash, std::vector<char> &buf) {
   const QString fastresume_path = QDir(misc::BTBackupLocation()).absoluteFilePath(hash+QString(".fastresume"));
   qDebug("Trying to load fastresume data: %s", qPrintable(fastresume_path));
@@ -949,6 +1067,8 @@ QTorrentHandle QBtSession::addMagnetUri(QString magnet_uri, bool resumed) {
     // Start torrent because it was added in paused state
     h.resume();
   }
+  updateTrackerIndex(h);
+  m_torrentCounters->update(h, queueingEnabled);
   // Send torrent addition signal
   addConsoleMessage(tr("'%1' added to download list.", "'/home/y/xxx.torrent' was added to download list.").arg(magnet_uri));
   emit addedTorrent(h);
@@ -964,13 +1084,7 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
   if (!torrentBackup.exists()) return h;
 
   // Fix the input path if necessary
-#ifdef Q_WS_WIN
-  // Windows hack
-  if (!path.endsWith(".torrent"))
-    if (QFile::rename(path, path+".torrent")) path += ".torrent";
-#endif
-  if (path.startsWith("file:", Qt::CaseInsensitive))
-    path = QUrl::fromEncoded(path.toLocal8Bit()).toLocalFile();
+  path = normalizeTorrentPath(path);
   if (path.isEmpty()) return h;
 
   Q_ASSERT(!misc::isUrl(path));
@@ -1007,6 +1121,58 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
     return h;
   }
 
+  return addTorrentInfo(t, path, QByteArray(), fromScanDir, from_url, resumed);
+}
+
+// Add a torrent to the Bittorrent session from the content
+// of a .torrent file. No temporary file is written, only the
+// copy kept in the backup directory.
+QTorrentHandle QBtSession::addTorrentFromData(const QByteArray &data, QString from_url) {
+  QTorrentHandle h;
+
+  // Check if BT_backup directory exists
+  const QDir torrentBackup(misc::BTBackupLocation());
+  if (!torrentBackup.exists()) return h;
+
+  boost::intrusive_ptr<torrent_info> t;
+  try {
+    // The buffer is only decoded once
+    t = new torrent_info(data.constData(), data.size());
+    if (!t->is_valid())
+      throw std::exception();
+  } catch(std::exception& e) {
+    if (!from_url.isNull()) {
+      addConsoleMessage(tr("Unable to decode torrent file: '%1'", "e.g: Unable to decode torrent file: '/home/y/xxx.torrent'").arg(from_url), QString::fromUtf8("red"));
+      addConsoleMessage(QString::fromLocal8Bit(e.what()), "red");
+    }
+    addConsoleMessage(tr("This file is either corrupted or this isn't a torrent."),QString::fromUtf8("red"));
+    return h;
+  }
+
+  return addTorrentInfo(t, QString(), data, false, from_url, false);
+}
+
+// Common part of addTorrent() and addTorrentFromData(), either path
+// or data is set
+QTorrentHandle QBtSession::addTorrentInfo(boost::intrusive_ptr<torrent_info> t, const QString &path, const QByteArray &data, bool fromScanDir, const QString &from_url, bool resumed) {
+  QTorrentHandle h;
+  const QDir torrentBackup(misc::BTBackupLocation());
+  // The torrent file is temporary and must be removed when we are done
+  const bool temporary_file = !path.isEmpty() && (!from_url.isNull() || fromScanDir);
+
+  // Name to use in the console messages
+  QString displayed_name;
+  if (!from_url.isNull()) {
+    displayed_name = from_url;
+  } else if (!path.isEmpty()) {
+    displayed_name = path;
+#if defined(Q_WS_WIN) || defined(Q_OS_OS2)
+    displayed_name.replace("/", "\\");
+#endif
+  } else {
+    displayed_name = misc::toQStringU(t->name());
+  }
+
   const QString hash = misc::toQString(t->info_hash());
 
   qDebug(" -> Hash: %s", qPrintable(hash));
@@ -1016,24 +1182,14 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
   if (s->find_torrent(t->info_hash()).is_valid()) {
     qDebug("/!\\ Torrent is already in download list");
     // Update info Bar
-    if (!from_url.isNull()) {
-      addConsoleMessage(tr("'%1' is already in download list.", "e.g: 'xxx.avi' is already in download list.").arg(from_url));
-    }else{
-#if defined(Q_WS_WIN) || defined(Q_OS_OS2)
-      QString displayed_path = path;
-      displayed_path.replace("/", "\\");
-      addConsoleMessage(tr("'%1' is already in download list.", "e.g: 'xxx.avi' is already in download list.").arg(displayed_path));
-#else
-      addConsoleMessage(tr("'%1' is already in download list.", "e.g: 'xxx.avi' is already in download list.").arg(path));
-#endif
-    }
+    addConsoleMessage(tr("'%1' is already in download list.", "e.g: 'xxx.avi' is already in download list.").arg(displayed_name));
     // Check if the torrent contains trackers or url seeds we don't know about
     // and add them
     QTorrentHandle h_ex = getTorrentHandle(hash);
     mergeTorrents(h_ex, t);
 
     // Delete file if temporary
-    if (!from_url.isNull() || fromScanDir)
+    if (temporary_file)
         QFile::remove(path);
     return h;
   }
@@ -1042,7 +1198,7 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
   if (t->num_files() < 1) {
     addConsoleMessage(tr("Error: The torrent %1 does not contain any file.").arg(misc::toQStringU(t->name())));
     // Delete file if temporary
-    if (!from_url.isNull() || fromScanDir)
+    if (temporary_file)
         QFile::remove(path);
     return h;
   }
@@ -1120,7 +1276,7 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
   // Check if it worked
   if (!h.is_valid()) {
     qDebug("/!\\ Error: Invalid handle");
-    if (!from_url.isNull())
+    if (temporary_file && !from_url.isNull())
         QFile::remove(path);
     return h;
   }
@@ -1152,8 +1308,21 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
 
     // Backup torrent file
     const QString newFile = torrentBackup.absoluteFilePath(hash + ".torrent");
-    if (path != newFile)
+    if (path.isEmpty()) {
+      QFile backup_file(newFile);
+      bool saved = false;
+      if (backup_file.open(QIODevice::WriteOnly)) {
+        saved = (backup_file.write(data) == data.size());
+        backup_file.close();
+      }
+      if (!saved) {
+        // A truncated backup would fail to load on the next start
+        addConsoleMessage(tr("Couldn't save a backup of the torrent file to '%1': %2").arg(newFile).arg(backup_file.errorString()), QString::fromUtf8("red"));
+        backup_file.remove();
+      }
+    } else if (path != newFile) {
       QFile::copy(path, newFile);
+    }
     // Copy the torrent file to the export folder
     if (torrentExport)
       exportTorrentFile(h);
@@ -1165,31 +1334,24 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
   }
 
   // If temporary file, remove it
-  if (!from_url.isNull() || fromScanDir)
+  if (temporary_file)
       QFile::remove(path);
 
-  // Display console message
-  if (!from_url.isNull()) {
-    if (fastResume)
-      addConsoleMessage(tr("'%1' resumed. (fast resume)", "'/home/y/xxx.torrent' was resumed. (fast resume)").arg(from_url));
-    else
-      addConsoleMessage(tr("'%1' added to download list.", "'/home/y/xxx.torrent' was added to download list.").arg(from_url));
-  }else{
-#if defined(Q_WS_WIN) || defined(Q_OS_OS2)
-    QString displayed_path = path;
-    displayed_path.replace("/", "\\");
-    if (fastResume)
-      addConsoleMessage(tr("'%1' resumed. (fast resume)", "'/home/y/xxx.torrent' was resumed. (fast resume)").arg(displayed_path));
-    else
-      addConsoleMessage(tr("'%1' added to download list.", "'/home/y/xxx.torrent' was added to download list.").arg(displayed_path));
-#else
-    if (fastResume)
-      addConsoleMessage(tr("'%1' resumed. (fast resume)", "'/home/y/xxx.torrent' was resumed. (fast resume)").arg(path));
-    else
-      addConsoleMessage(tr("'%1' added to download list.", "'/home/y/xxx.torrent' was added to download list.").arg(path));
-#endif
+  updateTrackerIndex(h);
+  m_torrentCounters->update(h, queueingEnabled);
+
+  // Bulk additions are reported once per chunk by processBulkAddQueue()
+  if (m_bulkAdding) {
+    m_bulkAddedTorrents << h;
+    return h;
   }
 
+  // Display console message
+  if (fastResume)
+    addConsoleMessage(tr("'%1' resumed. (fast resume)", "'/home/y/xxx.torrent' was resumed. (fast resume)").arg(displayed_name));
+  else
+    addConsoleMessage(tr("'%1' added to download list.", "'/home/y/xxx.torrent' was added to download list.").arg(displayed_name));
+
   // Send torrent addition signal
   emit addedTorrent(h);
   return h;
@@ -1327,8 +1489,10 @@ void QBtSession::mergeTorrents(QTorrentHandle &h_ex, boost::intrusive_ptr<torren
     }
   }
 
-  if (trackers_added)
+  if (trackers_added) {
+    updateTrackerIndex(h_ex);
     addConsoleMessage(tr("Note: new trackers were added to the existing torrent."));
+  }
 
   bool urlseeds_added = false;
   const QStringList old_urlseeds = h_ex.url_seeds();
@@ -1550,12 +1714,19 @@ qreal QBtSession::getRealRatio(const QString &hash) const {
   if (!h.is_valid()) {
     return 0.;
   }
+#if LIBTORRENT_VERSION_MINOR > 15
+  return getRealRatio(h.status(0x0));
+#else
+  return getRealRatio(h.status());
+#endif
+}
 
-  libtorrent::size_type all_time_upload = h.all_time_upload();
-  libtorrent::size_type all_time_download = h.all_time_download();
-  if (all_time_download == 0 && h.is_seed()) {
+qreal QBtSession::getRealRatio(const libtorrent::torrent_status &status) {
+  libtorrent::size_type all_time_upload = status.all_time_upload;
+  libtorrent::size_type all_time_download = status.all_time_download;
+  if (all_time_download == 0 && (status.state == torrent_status::finished || status.state == torrent_status::seeding)) {
     // Purely seeded torrent
-    all_time_download = h.total_done();
+    all_time_download = status.total_done;
   }
 
   if (all_time_download == 0) {
@@ -1584,11 +1755,17 @@ void QBtSession::saveTempFastResumeData() {
 #endif
       if (h.state() == torrent_status::checking_files || h.state() == torrent_status::queued_for_checking) continue;
       qDebug("Saving fastresume data for %s", qPrintable(h.name()));
-      h.save_resume_data();
+      saveResumeData(h);
     }catch(std::exception e) {}
   }
 }
 
+// The torrent is counted as pending until its resume data alert
+void QBtSession::saveResumeData(const QTorrentHandle &h) {
+  m_pendingResumeData << h.hash();
+  h.save_resume_data();
+}
+
 // Only save fast resume data for unfinished and unpaused torrents (Optimization)
 // Called on exit
 void QBtSession::saveFastResumeData() {
@@ -1663,31 +1840,42 @@ void QBtSession::saveFastResumeData() {
   }
 }
 
+// Messages used to be colored, the color tells their severity
 #ifdef DISABLE_GUI
-void QBtSession::addConsoleMessage(QString msg, QString) {
-  emit newConsoleMessage(QDateTime::currentDateTime().toString("dd/MM/yyyy hh:mm:ss") + " - " + msg);
+static LogRecord::Severity colorToSeverity(const QString &color) {
+  const QString name = color.toLower();
+#else
+static LogRecord::Severity colorToSeverity(const QColor &color) {
+  const QString name = color.name();
+#endif
+  if (name == "red" || name == "#ff0000")
+    return LogRecord::CRITICAL;
+  if (name == "orange" || name == "darkorange" || name == "#ffa500" || name == "#ff8c00")
+    return LogRecord::WARNING;
+  if (name == "blue" || name == "green" || name == "#0000ff" || name == "#008000")
+    return LogRecord::INFO;
+  return LogRecord::NORMAL;
+}
+
+#ifdef DISABLE_GUI
+void QBtSession::addConsoleMessage(QString msg, QString color) {
 #else
 void QBtSession::addConsoleMessage(QString msg, QColor color) {
-  if (consoleMessages.size() > MAX_LOG_MESSAGES) {
-    consoleMessages.removeFirst();
-  }
-  msg = "<font color='grey'>"+ QDateTime::currentDateTime().toString(QString::fromUtf8("dd/MM/yyyy hh:mm:ss")) + "</font> - <font color='" + color.name() + "'><i>" + msg + "</i></font>";
-  consoleMessages.append(msg);
-  emit newConsoleMessage(msg);
 #endif
+  const LogRecord rec = m_log.append(LogRecord::MESSAGE, colorToSeverity(color), msg);
+  emit newLogRecord();
+  if (receivers(SIGNAL(newConsoleMessage(QString))) > 0) {
+#ifdef DISABLE_GUI
+    emit newConsoleMessage(rec.toPlainText());
+#else
+    emit newConsoleMessage(rec.toHtml());
+#endif
+  }
 }
 
 void QBtSession::addPeerBanMessage(QString ip, bool from_ipfilter) {
-  if (peerBanMessages.size() > MAX_LOG_MESSAGES) {
-    peerBanMessages.removeFirst();
-  }
-  QString msg;
-  if (from_ipfilter)
-    msg = "<font color='grey'>" + QDateTime::currentDateTime().toString(QString::fromUtf8("dd/MM/yyyy hh:mm:ss")) + "</font> - " + tr("<font color='red'>%1</font> <i>was blocked due to your IP filter</i>", "x.y.z.w was blocked").arg(ip);
-  else
-    msg = "<font color='grey'>" + QDateTime::currentDateTime().toString(QString::fromUtf8("dd/MM/yyyy hh:mm:ss")) + "</font> - " + tr("<font color='red'>%1</font> <i>was banned due to corrupt pieces</i>", "x.y.z.w was banned").arg(ip);
-  peerBanMessages.append(msg);
-  emit newBanMessage(msg);
+  m_peerLog.append(from_ipfilter ? LogRecord::PEER_BLOCKED : LogRecord::PEER_BANNED, LogRecord::CRITICAL, ip);
+  emit newPeerLogRecord();
 }
 
 bool QBtSession::isFilePreviewPossible(const QString &hash) const {
@@ -1705,17 +1893,74 @@ bool QBtSession::isFilePreviewPossible(const QString &hash) const {
   return false;
 }
 
+// The files were already validated by the scan folder watcher
 void QBtSession::addTorrentsFromScanFolder(QStringList &pathList) {
-  foreach (const QString &file, pathList) {
-    qDebug("File %s added", qPrintable(file));
-    try {
-      torrent_info t(file.toUtf8().constData());
-      if (t.is_valid())
-        addTorrent(file, true);
-    } catch(std::exception&) {
-      qDebug("Ignoring incomplete torrent file: %s", qPrintable(file));
+  addTorrents(pathList, true);
+}
+
+// Add a list of torrent files to the Bittorrent session. The files
+// are added asynchronously, in chunks: each chunk is decoded in
+// parallel, its resume data is written at once and a single
+// addedTorrents() signal is emitted for it.
+void QBtSession::addTorrents(const QStringList &paths, bool fromScanDir) {
+  const bool idle = m_bulkAddQueue.isEmpty();
+  foreach (const QString &path, paths) {
+    const QString file = normalizeTorrentPath(path);
+    if (file.isEmpty()) continue;
+    Q_ASSERT(!misc::isUrl(file));
+    m_bulkAddQueue << qMakePair(file, fromScanDir);
+  }
+  if (idle && !m_bulkAddQueue.isEmpty())
+    QTimer::singleShot(0, this, SLOT(processBulkAddQueue()));
+}
+
+void QBtSession::processBulkAddQueue() {
+  if (m_bulkAddQueue.isEmpty()) return;
+  // Check if BT_backup directory exists
+  if (!QDir(misc::BTBackupLocation()).exists()) {
+    m_bulkAddQueue.clear();
+    return;
+  }
+  const QList<QPair<QString, bool> > chunk = m_bulkAddQueue.mid(0, BULK_ADD_CHUNK_SIZE);
+  m_bulkAddQueue.erase(m_bulkAddQueue.begin(), m_bulkAddQueue.begin() + chunk.size());
+  qDebug("Adding %d torrents (%d left)", chunk.size(), m_bulkAddQueue.size());
+
+  // Decode the torrent files in parallel
+  const QList<ParsedTorrentFile> parsedFiles = QtConcurrent::blockingMapped<QList<ParsedTorrentFile> >(chunk, parseTorrentFile);
+
+  {
+    // Resume data is written once for the whole chunk
+    TorrentResumeBatch batch;
+    m_bulkAdding = true;
+    foreach (const ParsedTorrentFile &file, parsedFiles) {
+      if (!file.t) {
+        if (file.fromScanDir) {
+          // The file was modified after it was validated, it will be seen again
+          qDebug("Ignoring incomplete torrent file: %s", qPrintable(file.path));
+          continue;
+        }
+        QString displayed_path = file.path;
+#if defined(Q_WS_WIN) || defined(Q_OS_OS2)
+        displayed_path.replace("/", "\\");
+#endif
+        addConsoleMessage(tr("Unable to decode torrent file: '%1'", "e.g: Unable to decode torrent file: '/home/y/xxx.torrent'").arg(displayed_path), QString::fromUtf8("red"));
+        addConsoleMessage(tr("This file is either corrupted or this isn't a torrent."),QString::fromUtf8("red"));
+        continue;
+      }
+      addTorrentInfo(file.t, file.path, QByteArray(), file.fromScanDir, QString(), false);
     }
+    m_bulkAdding = false;
   }
+
+  if (!m_bulkAddedTorrents.isEmpty()) {
+    const QList<QTorrentHandle> handles = m_bulkAddedTorrents;
+    m_bulkAddedTorrents.clear();
+    addConsoleMessage(tr("%n torrent(s) added to download list.", "", handles.size()));
+    emit addedTorrents(handles);
+  }
+
+  if (!m_bulkAddQueue.isEmpty())
+    QTimer::singleShot(0, this, SLOT(processBulkAddQueue()));
 }
 
 void QBtSession::setDefaultTempPath(QString temppath) {
@@ -1921,12 +2166,14 @@ void QBtSession::setUploadRateLimit(long rate) {
 // Torrents will a ratio superior to the given value will
 // be automatically deleted
 void QBtSession::setGlobalMaxRatio(qreal ratio) {
-  if (ratio < 0) ratio = -1.;
-  if (global_ratio_limit != ratio) {
-    global_ratio_limit = ratio;
-    qDebug("* Set global deleteRatio to %.1f", global_ratio_limit);
-    updateRatioTimer();
-  }
+  qDebug("* Set global deleteRatio to %.1f", ratio);
+  m_seedingLimits->setGlobalRatioLimit(ratio);
+}
+
+// Same as the ratio, for the seeding time (-1: no limit)
+void QBtSession::setGlobalMaxSeedingTime(int minutes) {
+  qDebug("* Set global max seeding time to %d minutes", minutes);
+  m_seedingLimits->setGlobalSeedingTimeLimit(minutes);
 }
 
 void QBtSession::setMaxRatioPerTorrent(const QString &hash, qreal ratio)
@@ -1937,22 +2184,20 @@ void QBtSession::setMaxRatioPerTorrent(const QString &hash, qreal ratio)
     ratio = MAX_RATIO;
   qDebug("* Set individual max ratio for torrent %s to %.1f.",
          qPrintable(hash), ratio);
-  TorrentPersistentData::setRatioLimit(hash, ratio);
-  updateRatioTimer();
+  m_seedingLimits->setRatioLimit(InfoHash(hash), ratio);
 }
 
 void QBtSession::removeRatioPerTorrent(const QString &hash)
 {
   qDebug("* Remove individual max ratio for torrent %s.", qPrintable(hash));
-  TorrentPersistentData::setRatioLimit(hash, TorrentPersistentData::USE_GLOBAL_RATIO);
-  updateRatioTimer();
+  m_seedingLimits->setRatioLimit(InfoHash(hash), TorrentPersistentData::USE_GLOBAL_RATIO);
 }
 
 qreal QBtSession::getMaxRatioPerTorrent(const QString &hash, bool *usesGlobalRatio) const
 {
-  qreal ratio_limit = TorrentPersistentData::getRatioLimit(hash);
+  qreal ratio_limit = m_seedingLimits->ratioLimit(InfoHash(hash));
   if (ratio_limit == TorrentPersistentData::USE_GLOBAL_RATIO) {
-    ratio_limit = global_ratio_limit;
+    ratio_limit = m_seedingLimits->globalRatioLimit();
     *usesGlobalRatio = true;
   } else {
     *usesGlobalRatio = false;
@@ -1960,14 +2205,33 @@ qreal QBtSession::getMaxRatioPerTorrent(const QString &hash, bool *usesGlobalRat
   return ratio_limit;
 }
 
-void QBtSession::updateRatioTimer()
+void QBtSession::setMaxSeedingTimePerTorrent(const QString &hash, int minutes)
+{
+  if (minutes < 0)
+    minutes = -1;
+  if (minutes > MAX_SEEDING_TIME)
+    minutes = MAX_SEEDING_TIME;
+  qDebug("* Set individual max seeding time for torrent %s to %d minutes.",
+         qPrintable(hash), minutes);
+  m_seedingLimits->setSeedingTimeLimit(InfoHash(hash), minutes);
+}
+
+void QBtSession::removeSeedingTimePerTorrent(const QString &hash)
 {
-  if (global_ratio_limit == -1 && !TorrentPersistentData::hasPerTorrentRatioLimit()) {
-    if (BigRatioTimer->isActive())
-      BigRatioTimer->stop();
-  } else if (!BigRatioTimer->isActive()) {
-    BigRatioTimer->start();
+  qDebug("* Remove individual max seeding time for torrent %s.", qPrintable(hash));
+  m_seedingLimits->setSeedingTimeLimit(InfoHash(hash), TorrentPersistentData::USE_GLOBAL_SEEDING_TIME);
+}
+
+int QBtSession::getMaxSeedingTimePerTorrent(const QString &hash, bool *usesGlobalLimit) const
+{
+  int limit = m_seedingLimits->seedingTimeLimit(InfoHash(hash));
+  if (limit == TorrentPersistentData::USE_GLOBAL_SEEDING_TIME) {
+    limit = m_seedingLimits->globalSeedingTimeLimit();
+    *usesGlobalLimit = true;
+  } else {
+    *usesGlobalLimit = false;
   }
+  return limit;
 }
 
 // Set DHT port (>= 1 or 0 if same as BT)
@@ -1986,7 +2250,7 @@ void QBtSession::setDHTPort(int dht_port) {
 void QBtSession::enableIPFilter(const QString &filter_path, bool force) {
   qDebug("Enabling IPFiler");
   if (!filterParser) {
-    filterParser = new FilterParserThread(this, s);
+    filterParser = new FilterParserThread(this, m_banManager);
     connect(filterParser.data(), SIGNAL(IPFilterParsed(int)), SLOT(handleIPFilterParsed(int)));
     connect(filterParser.data(), SIGNAL(IPFilterError()), SLOT(handleIPFilterError()));
   }
@@ -1999,12 +2263,13 @@ void QBtSession::enableIPFilter(const QString &filter_path, bool force) {
 // Disable IP Filtering
 void QBtSession::disableIPFilter() {
   qDebug("Disabling IPFilter");
-  s->set_ip_filter(ip_filter());
   if (filterParser) {
     disconnect(filterParser.data(), 0, this, 0);
     delete filterParser;
   }
   filterPath = "";
+  // Manual bans remain
+  m_banManager->setFilterList(ip_filter());
 }
 
 // Set BT session settings (user_agent)
@@ -2124,11 +2389,27 @@ void QBtSession::sendNotificationEmail(const QTorrentHandle &h) {
   sender->sendMail("notification@qbittorrent.org", Preferences().getMailNotificationEmail(), tr("[qBittorrent] %1 has finished downloading").arg(h.name()), content);
 }
 
+// Alerts after which the state or the size of their torrent may have changed
+static bool changesTorrentCounters(alert *a) {
+  return dynamic_cast<state_changed_alert*>(a) || dynamic_cast<torrent_paused_alert*>(a)
+      || dynamic_cast<torrent_resumed_alert*>(a) || dynamic_cast<torrent_finished_alert*>(a)
+      || dynamic_cast<torrent_checked_alert*>(a) || dynamic_cast<metadata_received_alert*>(a)
+      || dynamic_cast<file_error_alert*>(a);
+}
+
 // Read alerts sent by the Bittorrent session
 void QBtSession::readAlerts() {
+  QBT_TRACE_SCOPE("session", "readAlerts");
+  int nb_alerts = 0;
   // look at session alerts and display some infos
   std::auto_ptr<alert> a = s->pop_alert();
   while (a.get()) {
+    ++nb_alerts;
+    if (changesTorrentCounters(a.get())) {
+      QTorrentHandle h(static_cast<torrent_alert*>(a.get())->handle);
+      if (h.is_valid())
+        m_torrentCounters->update(h, queueingEnabled);
+    }
     if (torrent_finished_alert* p = dynamic_cast<torrent_finished_alert*>(a.get())) {
       QTorrentHandle h(p->handle);
       if (h.is_valid()) {
@@ -2141,7 +2422,7 @@ void QBtSession::readAlerts() {
         const bool was_already_seeded = TorrentPersistentData::isSeed(hash);
         qDebug("Was already seeded: %d", was_already_seeded);
         if (!was_already_seeded) {
-          h.save_resume_data();
+          saveResumeData(h);
           qDebug("Checking if the torrent contains torrent files to download");
           // Check if there are torrent files inside
           for (int i=0; i<h.num_files(); ++i) {
@@ -2183,6 +2464,8 @@ void QBtSession::readAlerts() {
           // Remember finished state
           qDebug("Saving seed status");
           TorrentPersistentData::saveSeedStatus(h);
+          // Enforce the seeding limits from now on
+          m_seedingLimits->watch(h);
           // Recheck if the user asked to
           Preferences pref;
           if (pref.recheckTorrentsOnCompletion()) {
@@ -2244,6 +2527,8 @@ void QBtSession::readAlerts() {
     else if (save_resume_data_alert* p = dynamic_cast<save_resume_data_alert*>(a.get())) {
       const QDir torrentBackup(misc::BTBackupLocation());
       const QTorrentHandle h(p->handle);
+      if (h.is_valid())
+        m_pendingResumeData.remove(h.hash());
       if (h.is_valid() && p->resume_data) {
         const QString filepath = torrentBackup.absoluteFilePath(h.hash()+".fastresume");
         QFile resume_file(filepath);
@@ -2258,6 +2543,12 @@ void QBtSession::readAlerts() {
         }
       }
     }
+    else if (save_resume_data_failed_alert* p = dynamic_cast<save_resume_data_failed_alert*>(a.get())) {
+      ++m_failedResumeDataCount;
+      const QTorrentHandle h(p->handle);
+      if (h.is_valid())
+        m_pendingResumeData.remove(h.hash());
+    }
     else if (file_renamed_alert* p = dynamic_cast<file_renamed_alert*>(a.get())) {
       QTorrentHandle h(p->handle);
       if (h.is_valid()) {
@@ -2357,6 +2648,7 @@ void QBtSession::readAlerts() {
             h.move_storage(QDir(save_path).absoluteFilePath(root_folder));
           }
         }
+        updateTrackerIndex(h);
         emit metadataReceived(h);
         if (h.is_paused()) {
           // XXX: Unfortunately libtorrent-rasterbar does not send a torrent_paused_alert
@@ -2394,14 +2686,22 @@ void QBtSession::readAlerts() {
         }
       }
     }
+    else if (piece_finished_alert* p = dynamic_cast<piece_finished_alert*>(a.get())) {
+      emit pieceFinished(QTorrentHandle(p->handle), p->piece_index);
+    }
     else if (torrent_paused_alert* p = dynamic_cast<torrent_paused_alert*>(a.get())) {
       if (p->handle.is_valid()) {
         QTorrentHandle h(p->handle);
         if (!h.has_error())
-          h.save_resume_data();
+          saveResumeData(h);
+        m_seedingLimits->unwatch(h.infoHash());
         emit pausedTorrent(h);
       }
     }
+    else if (torrent_resumed_alert* p = dynamic_cast<torrent_resumed_alert*>(a.get())) {
+      // Also sent when the queueing system starts a torrent
+      m_seedingLimits->watch(QTorrentHandle(p->handle));
+    }
     else if (tracker_error_alert* p = dynamic_cast<tracker_error_alert*>(a.get())) {
       // Level: fatal
       QTorrentHandle h(p->handle);
@@ -2409,12 +2709,7 @@ void QBtSession::readAlerts() {
         // Authentication
         if (p->status_code != 401) {
           qDebug("Received a tracker error for %s: %s", p->url.c_str(), p->msg.c_str());
-          const QString tracker_url = misc::toQString(p->url);
-          QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
-          TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
-          data.last_message = misc::toQString(p->msg);
-          trackers_data.insert(tracker_url, data);
-          trackersInfos[h.hash()] = trackers_data;
+          m_trackerIndex->setFailed(h.infoHash(), misc::toQString(p->url), misc::toQString(p->msg));
         } else {
           emit trackerAuthenticationRequired(h);
         }
@@ -2425,24 +2720,13 @@ void QBtSession::readAlerts() {
       if (h.is_valid()) {
         qDebug("Received a tracker reply from %s (Num_peers=%d)", p->url.c_str(), p->num_peers);
         // Connection was successful now. Remove possible old errors
-        QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
-        const QString tracker_url = misc::toQString(p->url);
-        TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
-        data.last_message = ""; // Reset error/warning message
-        data.num_peers = p->num_peers;
-        trackers_data.insert(tracker_url, data);
-        trackersInfos[h.hash()] = trackers_data;
+        m_trackerIndex->setWorking(h.infoHash(), misc::toQString(p->url), p->num_peers);
       }
     } else if (tracker_warning_alert* p = dynamic_cast<tracker_warning_alert*>(a.get())) {
       const QTorrentHandle h(p->handle);
       if (h.is_valid()) {
         // Connection was successful now but there is a warning message
-        QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
-        const QString tracker_url = misc::toQString(p->url);
-        TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
-        data.last_message = misc::toQString(p->msg); // Store warning message
-        trackers_data.insert(tracker_url, data);
-        trackersInfos[h.hash()] = trackers_data;
+        m_trackerIndex->setWarning(h.infoHash(), misc::toQString(p->url), misc::toQString(p->msg));
         qDebug("Received a tracker warning from %s: %s", p->url.c_str(), p->msg.c_str());
       }
     }
@@ -2526,6 +2810,7 @@ void QBtSession::readAlerts() {
           }
         }
         emit torrentFinishedChecking(h);
+        m_seedingLimits->watch(h);
         if (torrentsToPausedAfterChecking.contains(hash)) {
           torrentsToPausedAfterChecking.removeOne(hash);
           h.pause();
@@ -2535,6 +2820,9 @@ void QBtSession::readAlerts() {
     }
     a = s->pop_alert();
   }
+  m_lastAlertCount = nb_alerts;
+  m_totalAlertCount += nb_alerts;
+  QBT_TRACE_COUNTER("session", "alerts", nb_alerts);
 }
 
 void QBtSession::recheckTorrent(const QString &hash) {
@@ -2551,7 +2839,22 @@ void QBtSession::recheckTorrent(const QString &hash) {
 }
 
 QHash<QString, TrackerInfos> QBtSession::getTrackersInfo(const QString &hash) const {
-  return trackersInfos.value(hash, QHash<QString, TrackerInfos>());
+  return m_trackerIndex->trackers(InfoHash(hash));
+}
+
+// To be called when the tracker list of a torrent changes
+void QBtSession::updateTrackerIndex(const QTorrentHandle &h) {
+  if (!h.is_valid()) return;
+  QStringList urls;
+  try {
+    const std::vector<announce_entry> trackers = h.trackers();
+    std::vector<announce_entry>::const_iterator it;
+    for (it = trackers.begin(); it != trackers.end(); ++it)
+      urls << misc::toQString(it->url);
+  } catch(invalid_handle&) {
+    return;
+  }
+  m_trackerIndex->setTrackers(h.infoHash(), urls);
 }
 
 int QBtSession::getListenPort() const {
@@ -2563,6 +2866,10 @@ session_status QBtSession::getSessionStatus() const {
   return s->status();
 }
 
+cache_status QBtSession::getCacheStatus() const {
+  return s->get_cache_status();
+}
+
 QString QBtSession::getSavePath(const QString &hash, bool fromScanDir, QString filePath, QString root_folder) {
   QString savePath;
   if (TorrentTempData::hasTempData(hash)) {
@@ -2641,37 +2948,36 @@ void QBtSession::downloadUrlAndSkipDialog(QString url, QString save_path, QStrin
   //emit aboutToDownloadFromUrl(url);
   const QUrl qurl = QUrl::fromEncoded(url.toUtf8());
   savepathLabel_fromurl[qurl] = qMakePair(save_path, label);
-  url_skippingDlg << qurl;
-  // Launch downloader thread
-  downloader->downloadTorrentUrl(url);
+  // Launch downloader thread, the torrent is kept in memory
+  DownloadHandler *handler = downloader->downloadTorrentUrl(url, DownloadHandler::TO_MEMORY);
+  connect(handler, SIGNAL(dataDownloaded(QString, QByteArray)), SLOT(processDownloadedData(QString, QByteArray)));
 }
 
 // Add to Bittorrent session the downloaded torrent file
 void QBtSession::processDownloadedFile(QString url, QString file_path) {
-  const int index = url_skippingDlg.indexOf(QUrl::fromEncoded(url.toUtf8()));
-  if (index < 0) {
-    // Add file to torrent download list
+  // Add file to torrent download list
 #ifdef Q_WS_WIN
-    // Windows hack
-    if (!file_path.endsWith(".torrent", Qt::CaseInsensitive)) {
-      Q_ASSERT(QFile::exists(file_path));
-      qDebug("Torrent name does not end with .torrent, from %s", qPrintable(file_path));
-      if (QFile::rename(file_path, file_path+".torrent")) {
-        file_path += ".torrent";
-      } else {
-        qDebug("Failed to rename torrent file!");
-      }
+  // Windows hack
+  if (!file_path.endsWith(".torrent", Qt::CaseInsensitive)) {
+    Q_ASSERT(QFile::exists(file_path));
+    qDebug("Torrent name does not end with .torrent, from %s", qPrintable(file_path));
+    if (QFile::rename(file_path, file_path+".torrent")) {
+      file_path += ".torrent";
+    } else {
+      qDebug("Failed to rename torrent file!");
     }
-    qDebug("Downloading torrent at path: %s", qPrintable(file_path));
-#endif
-    emit newDownloadedTorrent(file_path, url);
-  } else {
-    url_skippingDlg.removeAt(index);
-    QTorrentHandle h = addTorrent(file_path, false, url, false);
-    // Pause torrent if necessary
-    if (h.is_valid() && addInPause && Preferences().useAdditionDialog())
-        h.pause();
   }
+  qDebug("Downloading torrent at path: %s", qPrintable(file_path));
+#endif
+  emit newDownloadedTorrent(file_path, url);
+}
+
+// Add to Bittorrent session a torrent downloaded in memory
+void QBtSession::processDownloadedData(QString url, QByteArray data) {
+  QTorrentHandle h = addTorrentFromData(data, url);
+  // Pause torrent if necessary
+  if (h.is_valid() && addInPause && Preferences().useAdditionDialog())
+    h.pause();
 }
 
 // Return current download rate for the BT
@@ -2697,6 +3003,8 @@ void QBtSession::applyEncryptionSettings(pe_settings se) {
 // backup directory
 void QBtSession::startUpTorrents() {
   qDebug("Resuming unfinished torrents");
+  // Resume data is read once and written back once
+  TorrentResumeBatch batch;
   const QDir torrentBackup(misc::BTBackupLocation());
   const QStringList known_torrents = TorrentPersistentData::knownTorrents();
 
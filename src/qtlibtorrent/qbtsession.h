@@ -31,6 +31,7 @@
 #define __BITTORRENT_H__
 
 #include <QHash>
+#include <QSet>
 #include <QUrl>
 #include <QStringList>
 #ifdef DISABLE_GUI
@@ -49,6 +50,12 @@
 #include "qtracker.h"
 #include "qtorrenthandle.h"
 #include "trackerinfos.h"
+#include "trackerindex.h"
+#include "torrentcounters.h"
+#include "seedinglimits.h"
+#include "torrentqueue.h"
+#include "banmanager.h"
+#include "logbuffer.h"
 
 #define MAX_SAMPLES 20
 
@@ -61,6 +68,8 @@ class TorrentSpeedMonitor;
 class DNSUpdater;
 
 const int MAX_LOG_MESSAGES = 100;
+// Capacity of the execution and peer logs
+const int MAX_LOG_RECORDS = 5000;
 
 class QBtSession : public QObject {
   Q_OBJECT
@@ -68,6 +77,10 @@ class QBtSession : public QObject {
 
 public:
   static const qreal MAX_RATIO;
+  static const int MAX_SEEDING_TIME;
+  enum BatchAction { BATCH_PAUSE, BATCH_RESUME, BATCH_DELETE, BATCH_DELETE_FILES, BATCH_RECHECK,
+                     BATCH_QUEUE_UP, BATCH_QUEUE_DOWN, BATCH_QUEUE_TOP, BATCH_QUEUE_BOTTOM, BATCH_QUEUE_POSITION,
+                     BATCH_UPLOAD_LIMIT, BATCH_DOWNLOAD_LIMIT };
 
 private:
   explicit QBtSession();
@@ -84,26 +97,40 @@ public:
   qreal getPayloadDownloadRate() const;
   qreal getPayloadUploadRate() const;
   libtorrent::session_status getSessionStatus() const;
+  libtorrent::cache_status getCacheStatus() const;
   int getListenPort() const;
   qreal getRealRatio(const QString& hash) const;
+  static qreal getRealRatio(const libtorrent::torrent_status &status);
   QHash<QString, TrackerInfos> getTrackersInfo(const QString &hash) const;
   bool hasActiveTorrents() const;
   bool hasDownloadingTorrents() const;
   //int getMaximumActiveDownloads() const;
   //int getMaximumActiveTorrents() const;
-  inline QStringList getConsoleMessages() const { return consoleMessages; }
-  inline QStringList getPeerBanMessages() const { return peerBanMessages; }
+  inline const LogBuffer& log() const { return m_log; }
+  inline const LogBuffer& peerLog() const { return m_peerLog; }
   inline libtorrent::session* getSession() const { return s; }
   inline bool useTemporaryFolder() const { return !defaultTempPath.isEmpty(); }
   inline QString getDefaultSavePath() const { return defaultSavePath; }
   inline ScanFoldersModel* getScanFoldersModel() const {  return m_scanFolders; }
+  inline TrackerIndex* getTrackerIndex() const { return m_trackerIndex; }
+  inline TorrentCounters* getTorrentCounters() const { return m_torrentCounters; }
+  // Manual bans, ip -> expiry (time_t), 0 for a permanent ban
+  inline QHash<QString, uint> bannedIPs() const { return m_banManager->bans(); }
   inline bool isDHTEnabled() const { return DHTEnabled; }
   inline bool isLSDEnabled() const { return LSDEnabled; }
   inline bool isPexEnabled() const { return PeXEnabled; }
   inline bool isQueueingEnabled() const { return queueingEnabled; }
+  // Alerts read by the last readAlerts() and since startup
+  inline int lastAlertCount() const { return m_lastAlertCount; }
+  inline qulonglong totalAlertCount() const { return m_totalAlertCount; }
+  // Torrents whose resume data is being saved
+  inline int pendingResumeDataCount() const { return m_pendingResumeData.size(); }
+  inline qulonglong failedResumeDataCount() const { return m_failedResumeDataCount; }
 
 public slots:
   QTorrentHandle addTorrent(QString path, bool fromScanDir = false, QString from_url = QString(), bool resumed = false);
+  QTorrentHandle addTorrentFromData(const QByteArray &data, QString from_url = QString());
+  void addTorrents(const QStringList &paths, bool fromScanDir = false);
   QTorrentHandle addMagnetUri(QString magnet_uri, bool resumed=false);
   void loadSessionState();
   void saveSessionState();
@@ -118,6 +145,8 @@ public slots:
   void pauseTorrent(const QString &hash);
   void resumeTorrent(const QString &hash);
   void resumeAllTorrents();
+  // value: rate limit, or queue position for BATCH_QUEUE_POSITION
+  QHash<QString, bool> applyToTorrents(BatchAction action, const QStringList &hashes, int value = -1);
   /* End Web UI */
   void preAllocateAllFiles(bool b);
   void saveFastResumeData();
@@ -134,10 +163,15 @@ public slots:
   void setDownloadRateLimit(long rate);
   void setUploadRateLimit(long rate);
   void setGlobalMaxRatio(qreal ratio);
-  qreal getGlobalMaxRatio() const { return global_ratio_limit; }
+  qreal getGlobalMaxRatio() const { return m_seedingLimits->globalRatioLimit(); }
   void setMaxRatioPerTorrent(const QString &hash, qreal ratio);
   qreal getMaxRatioPerTorrent(const QString &hash, bool *usesGlobalRatio) const;
   void removeRatioPerTorrent(const QString &hash);
+  void setGlobalMaxSeedingTime(int minutes);
+  int getGlobalMaxSeedingTime() const { return m_seedingLimits->globalSeedingTimeLimit(); }
+  void setMaxSeedingTimePerTorrent(const QString &hash, int minutes);
+  int getMaxSeedingTimePerTorrent(const QString &hash, bool *usesGlobalLimit) const;
+  void removeSeedingTimePerTorrent(const QString &hash);
   void setDHTPort(int dht_port);
   void setProxySettings(libtorrent::proxy_settings proxySettings);
   void setSessionSettings(const libtorrent::session_settings &sessionSettings);
@@ -161,25 +195,31 @@ public slots:
 #endif
   void addPeerBanMessage(QString msg, bool from_ipfilter);
   void processDownloadedFile(QString, QString);
+  void processDownloadedData(QString url, QByteArray data);
   void addMagnetSkipAddDlg(QString uri);
   void downloadFromURLList(const QStringList& urls);
   void configureSession();
-  void banIP(QString ip);
+  // ttl in seconds, 0 for a permanent ban
+  bool banIP(QString ip, int ttl = 0);
+  void unbanIP(QString ip);
   void recursiveTorrentDownload(const QTorrentHandle &h);
+  void updateTrackerIndex(const QTorrentHandle &h);
 
 private:
+  QTorrentHandle addTorrentInfo(boost::intrusive_ptr<libtorrent::torrent_info> t, const QString &path, const QByteArray &data, bool fromScanDir, const QString &from_url, bool resumed);
   QString getSavePath(const QString &hash, bool fromScanDir = false, QString filePath = QString::null, QString root_folder=QString::null);
   bool loadFastResumeData(const QString &hash, std::vector<char> &buf);
   void loadTorrentSettings(QTorrentHandle &h);
   void loadTorrentTempData(QTorrentHandle &h, QString savePath, bool magnet);
   libtorrent::add_torrent_params initializeAddTorrentParams(const QString &hash);
+  void saveResumeData(const QTorrentHandle &h);
   libtorrent::entry generateFilePriorityResumeData(boost::intrusive_ptr<libtorrent::torrent_info> &t, const std::vector<int> &fp);
-  void updateRatioTimer();
 
 private slots:
   void addTorrentsFromScanFolder(QStringList&);
+  void processBulkAddQueue();
   void readAlerts();
-  void processBigRatios();
+  void handleSeedingLimitReached(const QTorrentHandle &h, int limit);
   void exportTorrentFiles(QString path);
   void saveTempFastResumeData();
   void sendNotificationEmail(const QTorrentHandle &h);
@@ -193,6 +233,8 @@ private slots:
 
 signals:
   void addedTorrent(const QTorrentHandle& h);
+  // Emitted instead of addedTorrent() for torrents added by addTorrents()
+  void addedTorrents(const QList<QTorrentHandle>& handles);
   void deletedTorrent(const QString &hash);
   void torrentAboutToBeRemoved(const QTorrentHandle &h);
   void pausedTorrent(const QTorrentHandle& h);
@@ -206,9 +248,12 @@ signals:
   void downloadFromUrlFailure(QString url, QString reason);
   void torrentFinishedChecking(const QTorrentHandle& h);
   void metadataReceived(const QTorrentHandle &h);
+  void pieceFinished(const QTorrentHandle &h, int piece);
   void savePathChanged(const QTorrentHandle &h);
+  // Only emitted if connected since the message has to be formatted
   void newConsoleMessage(const QString &msg);
-  void newBanMessage(const QString &msg);
+  void newLogRecord();
+  void newPeerLogRecord();
   void alternativeSpeedsModeChanged(bool alternative);
   void recursiveTorrentDownloadPossible(const QTorrentHandle &h);
   void ipFilterParsed(bool error, int ruleCount);
@@ -220,23 +265,33 @@ private:
   QPointer<QTimer> timerAlerts;
   QPointer<BandwidthScheduler> bd_scheduler;
   QMap<QUrl, QPair<QString, QString> > savepathLabel_fromurl; // Use QMap for compatibility with Qt < 4.7: qHash(QUrl)
-  QHash<QString, QHash<QString, TrackerInfos> > trackersInfos;
+  TrackerIndex *m_trackerIndex;
+  TorrentCounters *m_torrentCounters;
+  TorrentQueue *m_torrentQueue;
   QHash<QString, QString> savePathsToRemove;
   QStringList torrentsToPausedAfterChecking;
   QTimer resumeDataTimer;
-  // Ratio
-  QPointer<QTimer> BigRatioTimer;
+  QSet<QString> m_pendingResumeData;
+  qulonglong m_failedResumeDataCount;
+  // Alerts
+  int m_lastAlertCount;
+  qulonglong m_totalAlertCount;
+  // Ratio and seeding time
+  SeedingLimits *m_seedingLimits;
   // HTTP
   DownloadThread* downloader;
   // File System
   ScanFoldersModel *m_scanFolders;
+  // Bulk addition (path, fromScanDir)
+  QList<QPair<QString, bool> > m_bulkAddQueue;
+  QList<QTorrentHandle> m_bulkAddedTorrents;
+  bool m_bulkAdding;
   // Console / Log
-  QStringList consoleMessages;
-  QStringList peerBanMessages;
+  LogBuffer m_log;
+  LogBuffer m_peerLog;
   // Settings
   bool preAllocateAll;
   bool addInPause;
-  qreal global_ratio_limit;
   int high_ratio_action;
   bool LSDEnabled;
   bool DHTEnabled;
@@ -251,9 +306,9 @@ private:
   // IP filtering
   QPointer<FilterParserThread> filterParser;
   QString filterPath;
+  BanManager *m_banManager;
   // Web UI
   QPointer<HttpServer> httpServer;
-  QList<QUrl> url_skippingDlg;
   // GeoIP
 #ifndef DISABLE_GUI
   bool geoipDBLoaded;
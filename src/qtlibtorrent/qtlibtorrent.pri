@@ -5,11 +5,24 @@ HEADERS += $$PWD/qbtsession.h \
            $$PWD/bandwidthscheduler.h \
            $$PWD/trackerinfos.h \
            $$PWD/torrentspeedmonitor.h \
-           $$PWD/filterparserthread.h
+           $$PWD/filterparserthread.h \
+           $$PWD/logbuffer.h \
+           $$PWD/trackerindex.h \
+           $$PWD/torrentcounters.h \
+           $$PWD/seedinglimits.h \
+           $$PWD/torrentqueue.h \
+           $$PWD/banmanager.h \
+           $$PWD/infohash.h
 
 SOURCES += $$PWD/qbtsession.cpp \
            $$PWD/qtorrenthandle.cpp \
-           $$PWD/torrentspeedmonitor.cpp
+           $$PWD/torrentspeedmonitor.cpp \
+           $$PWD/logbuffer.cpp \
+           $$PWD/trackerindex.cpp \
+           $$PWD/torrentcounters.cpp \
+           $$PWD/seedinglimits.cpp \
+           $$PWD/torrentqueue.cpp \
+           $$PWD/banmanager.cpp
 
 !contains(DEFINES, DISABLE_GUI) {
   HEADERS += $$PWD/torrentmodel.h \
@@ -98,6 +98,10 @@ QString QTorrentHandle::hash() const {
   return misc::toQString(torrent_handle::info_hash());
 }
 
+InfoHash QTorrentHandle::infoHash() const {
+  return torrent_handle::info_hash();
+}
+
 QString QTorrentHandle::name() const {
   QString name = TorrentPersistentData::getName(hash());
   if (name.isEmpty()) {
@@ -36,6 +36,7 @@
 #include <libtorrent/torrent_info.hpp>
 
 #include <QString>
+#include "infohash.h"
 
 QT_BEGIN_NAMESPACE
 class QStringList;
@@ -58,6 +59,7 @@ public:
   // Getters
   //
   QString hash() const;
+  InfoHash infoHash() const;
   QString name() const;
   float progress() const;
   libtorrent::bitfield pieces() const;
@@ -0,0 +1,239 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QDateTime>
+#include <QDebug>
+#include <libtorrent/session.hpp>
+#include "seedinglimits.h"
+#include "qbtsession.h"
+#include "torrentpersistentdata.h"
+
+using namespace libtorrent;
+
+// Bounds of the delay between two checks of a seeding torrent. The
+// upload rate varies, so a torrent without limit in sight is still
+// checked from time to time.
+const int MIN_CHECK_DELAY = 5; // s
+const int MAX_CHECK_DELAY = 120; // s
+
+static uint now() {
+  return QDateTime::currentDateTime().toTime_t();
+}
+
+SeedingLimits::SeedingLimits(session *s, QObject *parent):
+  QObject(parent), m_session(s), m_globalRatioLimit(-1), m_globalSeedingTimeLimit(-1)
+{
+  m_timer.setSingleShot(true);
+  connect(&m_timer, SIGNAL(timeout()), SLOT(processDueTorrents()));
+}
+
+void SeedingLimits::setGlobalRatioLimit(qreal ratio) {
+  if (ratio < 0) ratio = -1;
+  if (ratio == m_globalRatioLimit) return;
+  m_globalRatioLimit = ratio;
+  watchAll();
+}
+
+void SeedingLimits::setGlobalSeedingTimeLimit(int minutes) {
+  if (minutes < 0) minutes = -1;
+  if (minutes == m_globalSeedingTimeLimit) return;
+  m_globalSeedingTimeLimit = minutes;
+  watchAll();
+}
+
+void SeedingLimits::setRatioLimit(const InfoHash &hash, qreal ratio) {
+  TorrentLimits &l = limits(hash);
+  l.ratio = ratio;
+  TorrentPersistentData::setRatioLimit(hash.toString(), ratio);
+  watch(QTorrentHandle(m_session->find_torrent(hash.native())));
+}
+
+qreal SeedingLimits::ratioLimit(const InfoHash &hash) const {
+  return lookup(hash).ratio;
+}
+
+void SeedingLimits::setSeedingTimeLimit(const InfoHash &hash, int minutes) {
+  TorrentLimits &l = limits(hash);
+  l.seedingTime = minutes;
+  TorrentPersistentData::setSeedingTimeLimit(hash.toString(), minutes);
+  watch(QTorrentHandle(m_session->find_torrent(hash.native())));
+}
+
+int SeedingLimits::seedingTimeLimit(const InfoHash &hash) const {
+  return lookup(hash).seedingTime;
+}
+
+void SeedingLimits::watch(const QTorrentHandle &h) {
+  if (!h.is_valid()) return;
+  schedule(h.infoHash(), 0);
+  rearmTimer();
+}
+
+void SeedingLimits::unwatch(const InfoHash &hash) {
+  QHash<InfoHash, TorrentLimits>::iterator it = m_torrents.find(hash);
+  if (it != m_torrents.end())
+    it.value().nextCheck = 0;
+}
+
+void SeedingLimits::removeTorrent(const InfoHash &hash) {
+  m_torrents.remove(hash);
+}
+
+void SeedingLimits::processDueTorrents() {
+  // Limits of the torrents seen for the first time are read in one go
+  TorrentResumeBatch batch;
+  const uint t = now();
+  while (!m_checks.empty() && m_checks.top().time <= t) {
+    const Check c = m_checks.top();
+    m_checks.pop();
+    QHash<InfoHash, TorrentLimits>::iterator it = m_torrents.find(c.hash);
+    if (it == m_torrents.end() || it.value().nextCheck != c.time)
+      continue;
+    it.value().nextCheck = 0;
+    const QTorrentHandle h(m_session->find_torrent(c.hash.native()));
+    if (h.is_valid())
+      check(h);
+  }
+  rearmTimer();
+}
+
+// Entry of a torrent which is watched or has its limits changed
+SeedingLimits::TorrentLimits& SeedingLimits::limits(const InfoHash &hash) {
+  TorrentLimits &l = m_torrents[hash];
+  if (!l.loaded)
+    l = lookup(hash);
+  return l;
+}
+
+// Limits of any torrent, the table is left untouched
+SeedingLimits::TorrentLimits SeedingLimits::lookup(const InfoHash &hash) const {
+  QHash<InfoHash, TorrentLimits>::const_iterator it = m_torrents.constFind(hash);
+  if (it != m_torrents.constEnd() && it.value().loaded)
+    return it.value();
+  TorrentLimits l;
+  if (it != m_torrents.constEnd())
+    l.nextCheck = it.value().nextCheck;
+  const QString hex = hash.toString();
+  l.ratio = TorrentPersistentData::getRatioLimit(hex);
+  l.seedingTime = TorrentPersistentData::getSeedingTimeLimit(hex);
+  l.loaded = true;
+  return l;
+}
+
+// Checks the limits of a torrent, or projects when it will reach them
+void SeedingLimits::check(const QTorrentHandle &h) {
+  const InfoHash hash = h.infoHash();
+#if LIBTORRENT_VERSION_MINOR > 15
+  const torrent_status status = h.status(0x0);
+#else
+  const torrent_status status = h.status();
+#endif
+  if (status.paused || (status.state != torrent_status::seeding && status.state != torrent_status::finished)) {
+    unwatch(hash);
+    return;
+  }
+  TorrentLimits &l = limits(hash);
+  l.nextCheck = 0;
+  qreal ratio_limit = l.ratio;
+  if (ratio_limit == TorrentPersistentData::USE_GLOBAL_RATIO)
+    ratio_limit = m_globalRatioLimit;
+  int time_limit = l.seedingTime;
+  if (time_limit == TorrentPersistentData::USE_GLOBAL_SEEDING_TIME)
+    time_limit = m_globalSeedingTimeLimit;
+  if (ratio_limit < 0 && time_limit < 0)
+    return;
+
+  int delay = MAX_CHECK_DELAY;
+  if (ratio_limit >= 0) {
+    const qreal ratio = QBtSession::getRealRatio(status);
+    qDebug("Ratio: %f (limit: %f)", ratio, ratio_limit);
+    if (ratio <= QBtSession::MAX_RATIO && ratio >= ratio_limit) {
+      emit limitReached(h, RATIO_LIMIT);
+      return;
+    }
+    // Same base as getRealRatio()
+    size_type downloaded = status.all_time_download;
+    if (downloaded == 0)
+      downloaded = status.total_done;
+    if (downloaded > 0 && status.upload_payload_rate > 0) {
+      const qreal missing = ratio_limit * downloaded - status.all_time_upload;
+      // The rate may go up, check again half way
+      const qreal eta = missing / status.upload_payload_rate;
+      if (eta / 2 < delay)
+        delay = qMax(MIN_CHECK_DELAY, (int)(eta / 2));
+    }
+  }
+  if (time_limit >= 0) {
+    const int remaining = time_limit * 60 - status.seeding_time;
+    if (remaining <= 0) {
+      emit limitReached(h, SEEDING_TIME_LIMIT);
+      return;
+    }
+    // Seeding time only grows with the wall clock
+    delay = qMin(delay, qMax(MIN_CHECK_DELAY, remaining));
+  }
+  schedule(hash, delay);
+}
+
+void SeedingLimits::schedule(const InfoHash &hash, int delay) {
+  const uint t = now() + delay;
+  m_torrents[hash].nextCheck = t;
+  m_checks.push(Check(t, hash));
+}
+
+void SeedingLimits::rearmTimer() {
+  // Drop the stale entries so that they do not wake us up
+  while (!m_checks.empty()) {
+    const Check &c = m_checks.top();
+    QHash<InfoHash, TorrentLimits>::const_iterator it = m_torrents.constFind(c.hash);
+    if (it != m_torrents.constEnd() && it.value().nextCheck == c.time)
+      break;
+    m_checks.pop();
+  }
+  if (m_checks.empty()) {
+    m_timer.stop();
+    return;
+  }
+  const uint t = now();
+  const uint next = m_checks.top().time;
+  m_timer.start(next > t ? (next - t) * 1000 : 0);
+}
+
+void SeedingLimits::watchAll() {
+  qDebug("Seeding limits changed, checking all the torrents");
+  std::vector<torrent_handle> torrents = m_session->get_torrents();
+  std::vector<torrent_handle>::iterator it;
+  for (it = torrents.begin(); it != torrents.end(); ++it) {
+    const QTorrentHandle h(*it);
+    if (h.is_valid())
+      schedule(h.infoHash(), 0);
+  }
+  rearmTimer();
+}
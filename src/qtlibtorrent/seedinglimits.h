@@ -0,0 +1,120 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef SEEDINGLIMITS_H
+#define SEEDINGLIMITS_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <queue>
+#include <vector>
+#include "infohash.h"
+#include "qtorrenthandle.h"
+
+namespace libtorrent {
+  class session;
+}
+
+// Enforces the ratio and seeding time limits of the seeding torrents.
+// Instead of polling every seed, the time at which a torrent may reach
+// one of its limits is projected from its upload rate and seeding time,
+// and only the torrents which are due are checked again. Per torrent
+// limits are loaded once from the persistent data and kept in memory.
+// Only used from the main thread.
+class SeedingLimits : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(SeedingLimits)
+
+public:
+  enum Limit { RATIO_LIMIT, SEEDING_TIME_LIMIT };
+
+  SeedingLimits(libtorrent::session *s, QObject *parent = 0);
+
+  // Global limits, -1 for no limit
+  void setGlobalRatioLimit(qreal ratio);
+  qreal globalRatioLimit() const { return m_globalRatioLimit; }
+  void setGlobalSeedingTimeLimit(int minutes);
+  int globalSeedingTimeLimit() const { return m_globalSeedingTimeLimit; }
+  // Per torrent limits, may also be one of the TorrentPersistentData
+  // RatioLimit and SeedingTimeLimit values
+  void setRatioLimit(const InfoHash &hash, qreal ratio);
+  qreal ratioLimit(const InfoHash &hash) const;
+  void setSeedingTimeLimit(const InfoHash &hash, int minutes);
+  int seedingTimeLimit(const InfoHash &hash) const;
+
+  // Checks the torrent as soon as possible, then regularly while it is
+  // seeding. Called when a torrent is checked, finished or resumed.
+  void watch(const QTorrentHandle &h);
+  // Paused torrents are not checked until they are watched again
+  void unwatch(const InfoHash &hash);
+  void removeTorrent(const InfoHash &hash);
+
+signals:
+  void limitReached(const QTorrentHandle &h, int limit);
+
+private slots:
+  void processDueTorrents();
+
+private:
+  struct TorrentLimits {
+    TorrentLimits(): loaded(false), ratio(-1), seedingTime(-1), nextCheck(0) {}
+    bool loaded; // Limits read from the persistent data
+    qreal ratio;
+    int seedingTime;
+    uint nextCheck; // 0 if not scheduled
+  };
+
+  struct Check {
+    Check(uint t, const InfoHash &h): time(t), hash(h) {}
+    bool operator>(const Check &other) const { return time > other.time; }
+    uint time;
+    InfoHash hash;
+  };
+
+  TorrentLimits& limits(const InfoHash &hash);
+  TorrentLimits lookup(const InfoHash &hash) const;
+  void check(const QTorrentHandle &h);
+  void schedule(const InfoHash &hash, int delay);
+  void rearmTimer();
+  void watchAll();
+
+private:
+  libtorrent::session *m_session;
+  qreal m_globalRatioLimit;
+  int m_globalSeedingTimeLimit;
+  QHash<InfoHash, TorrentLimits> m_torrents;
+  // Entries left behind by a reschedule are skipped when their time
+  // does not match the one of the torrent
+  std::priority_queue<Check, std::vector<Check>, std::greater<Check> > m_checks;
+  QTimer m_timer;
+};
+
+#endif // SEEDINGLIMITS_H
@@ -0,0 +1,111 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+
+#include "torrentcounters.h"
+#include "qtorrenthandle.h"
+#include "torrentpersistentdata.h"
+
+using namespace libtorrent;
+
+TorrentCounters::TorrentCounters(QObject *parent): QObject(parent)
+{
+}
+
+QString TorrentCounters::state(const QTorrentHandle &h, bool queueing_enabled) {
+  // Same order as the states of the Web UI
+  if (h.is_paused()) {
+    if (h.has_error())
+      return "error";
+    return h.is_seed() ? "pausedUP" : "pausedDL";
+  }
+  if (queueing_enabled && h.is_queued())
+    return h.is_seed() ? "queuedUP" : "queuedDL";
+  switch(h.state()) {
+  case torrent_status::finished:
+  case torrent_status::seeding:
+    return "uploading";
+  case torrent_status::allocating:
+  case torrent_status::checking_files:
+  case torrent_status::queued_for_checking:
+  case torrent_status::checking_resume_data:
+    return h.is_seed() ? "checkingUP" : "checkingDL";
+  case torrent_status::downloading:
+  case torrent_status::downloading_metadata:
+    return "downloading";
+  default:
+    return "unknown";
+  }
+}
+
+void TorrentCounters::update(const QTorrentHandle &h, bool queueing_enabled) {
+  Entry entry;
+  try {
+    entry.state = state(h, queueing_enabled);
+    entry.label = TorrentPersistentData::getLabel(h.hash());
+    entry.size = h.actual_size();
+  } catch(invalid_handle&) {
+    return;
+  }
+  QHash<InfoHash, Entry>::iterator it = m_torrents.find(h.infoHash());
+  if (it != m_torrents.end()) {
+    add(it.value(), -1);
+    it.value() = entry;
+  } else {
+    m_torrents.insert(h.infoHash(), entry);
+  }
+  add(entry, 1);
+}
+
+void TorrentCounters::setLabel(const InfoHash &hash, const QString &label) {
+  QHash<InfoHash, Entry>::iterator it = m_torrents.find(hash);
+  if (it == m_torrents.end() || it.value().label == label) return;
+  add(it.value(), -1);
+  it.value().label = label;
+  add(it.value(), 1);
+}
+
+void TorrentCounters::removeTorrent(const InfoHash &hash) {
+  QHash<InfoHash, Entry>::iterator it = m_torrents.find(hash);
+  if (it == m_torrents.end()) return;
+  add(it.value(), -1);
+  m_torrents.erase(it);
+}
+
+// Adds (sign 1) or removes (sign -1) a torrent from the totals
+void TorrentCounters::add(const Entry &entry, int sign) {
+  int &count = m_stateCounts[entry.state];
+  count += sign;
+  if (count == 0)
+    m_stateCounts.remove(entry.state);
+  LabelTotals &totals = m_labelTotals[entry.label];
+  totals.torrents += sign;
+  totals.size += sign * entry.size;
+  if (totals.torrents == 0)
+    m_labelTotals.remove(entry.label);
+}
@@ -0,0 +1,88 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+
+#ifndef TORRENTCOUNTERS_H
+#define TORRENTCOUNTERS_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include "infohash.h"
+
+class QTorrentHandle;
+
+// Totals of the torrents having a label
+struct LabelTotals {
+  LabelTotals(): torrents(0), size(0) {}
+
+  int torrents;
+  qlonglong size;
+};
+
+// Number of torrents in each state and totals of each label. The
+// session updates them when a torrent is added, removed, changes state
+// or gets a new label so that they can be read without visiting the
+// torrents. The states are those of the Web UI except for the stalled
+// torrents, counted as downloading or uploading: telling them apart
+// needs the transfer rates. Only used from the main thread.
+class TorrentCounters : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(TorrentCounters)
+
+public:
+  explicit TorrentCounters(QObject *parent = 0);
+
+  // Reads the state, label and size of the torrent again
+  void update(const QTorrentHandle &h, bool queueing_enabled);
+  void setLabel(const InfoHash &hash, const QString &label);
+  void removeTorrent(const InfoHash &hash);
+
+  QHash<QString, int> stateCounts() const { return m_stateCounts; }
+  QHash<QString, LabelTotals> labelTotals() const { return m_labelTotals; }
+
+  static QString state(const QTorrentHandle &h, bool queueing_enabled);
+
+private:
+  struct Entry {
+    Entry(): size(0) {}
+
+    QString state;
+    QString label;
+    qlonglong size;
+  };
+
+  void add(const Entry &entry, int sign);
+
+private:
+  QHash<InfoHash, Entry> m_torrents;
+  QHash<QString, int> m_stateCounts;
+  QHash<QString, LabelTotals> m_labelTotals;
+};
+
+#endif // TORRENTCOUNTERS_H
@@ -28,83 +28,97 @@
  * Contact : chris@qbittorrent.org
  */
 
+#include <QColor>
 #include <QDebug>
+#include <QSet>
 
 #include "torrentmodel.h"
 #include "torrentpersistentdata.h"
 #include "qbtsession.h"
+#include "tracer.h"
 
 using namespace libtorrent;
 
+// Icon and color of each state, shared by all the rows
+struct StateStyle {
+  QIcon icon;
+  QColor color;
+};
+
+static const StateStyle& stateStyle(TorrentModelItem::State state) {
+  static QVector<StateStyle> styles;
+  if (styles.isEmpty()) {
+    styles.resize(TorrentModelItem::STATE_INVALID + 1);
+    styles[TorrentModelItem::STATE_DOWNLOADING].icon = QIcon(":/Icons/skin/downloading.png");
+    styles[TorrentModelItem::STATE_DOWNLOADING].color = QColor("green");
+    styles[TorrentModelItem::STATE_STALLED_DL].icon = QIcon(":/Icons/skin/stalledDL.png");
+    styles[TorrentModelItem::STATE_STALLED_DL].color = QColor("grey");
+    styles[TorrentModelItem::STATE_STALLED_UP].icon = QIcon(":/Icons/skin/stalledUP.png");
+    styles[TorrentModelItem::STATE_STALLED_UP].color = QColor("grey");
+    styles[TorrentModelItem::STATE_SEEDING].icon = QIcon(":/Icons/skin/uploading.png");
+    styles[TorrentModelItem::STATE_SEEDING].color = QColor("orange");
+    styles[TorrentModelItem::STATE_PAUSED_DL].icon = QIcon(":/Icons/skin/paused.png");
+    styles[TorrentModelItem::STATE_PAUSED_DL].color = QColor("red");
+    styles[TorrentModelItem::STATE_PAUSED_UP] = styles[TorrentModelItem::STATE_PAUSED_DL];
+    styles[TorrentModelItem::STATE_QUEUED_DL].icon = QIcon(":/Icons/skin/queued.png");
+    styles[TorrentModelItem::STATE_QUEUED_DL].color = QColor("grey");
+    styles[TorrentModelItem::STATE_QUEUED_UP] = styles[TorrentModelItem::STATE_QUEUED_DL];
+    styles[TorrentModelItem::STATE_CHECKING_DL].icon = QIcon(":/Icons/skin/checking.png");
+    styles[TorrentModelItem::STATE_CHECKING_DL].color = QColor("grey");
+    styles[TorrentModelItem::STATE_CHECKING_UP] = styles[TorrentModelItem::STATE_CHECKING_DL];
+    styles[TorrentModelItem::STATE_INVALID].icon = QIcon(":/Icons/skin/error.png");
+    styles[TorrentModelItem::STATE_INVALID].color = QColor("red");
+  }
+  return styles.at(state);
+}
+
 TorrentModelItem::TorrentModelItem(const QTorrentHandle &h)
 {
   m_torrent = h;
-  m_hash = h.hash();
-  m_name = TorrentPersistentData::getName(h.hash());
+  m_hash = h.infoHash();
+  const QString hash = m_hash.toString();
+  m_name = TorrentPersistentData::getName(hash);
   if (m_name.isEmpty()) m_name = h.name();
-  m_addedTime = TorrentPersistentData::getAddedDate(h.hash());
-  m_seedTime = TorrentPersistentData::getSeedDate(h.hash());
-  m_label = TorrentPersistentData::getLabel(h.hash());
+  m_addedTime = TorrentPersistentData::getAddedDate(hash);
+  m_seedTime = TorrentPersistentData::getSeedDate(hash);
+  m_label = TorrentPersistentData::getLabel(hash);
+  m_state = state();
+}
+
+void TorrentModelItem::updateState()
+{
+  m_state = state();
 }
 
 TorrentModelItem::State TorrentModelItem::state() const
 {
   try {
     // Pause or Queued
-    if (m_torrent.is_paused()) {
-      m_icon = QIcon(":/Icons/skin/paused.png");
-      m_fgColor = QColor("red");
+    if (m_torrent.is_paused())
       return m_torrent.is_seed() ? STATE_PAUSED_UP : STATE_PAUSED_DL;
-    }
     if (m_torrent.is_queued()) {
       if (m_torrent.state() != torrent_status::queued_for_checking
           && m_torrent.state() != torrent_status::checking_resume_data
-          && m_torrent.state() != torrent_status::checking_files) {
-        m_icon = QIcon(":/Icons/skin/queued.png");
-        m_fgColor = QColor("grey");
+          && m_torrent.state() != torrent_status::checking_files)
         return m_torrent.is_seed() ? STATE_QUEUED_UP : STATE_QUEUED_DL;
-      }
     }
     // Other states
     switch(m_torrent.state()) {
     case torrent_status::allocating:
     case torrent_status::downloading_metadata:
-    case torrent_status::downloading: {
-      if (m_torrent.download_payload_rate() > 0) {
-        m_icon = QIcon(":/Icons/skin/downloading.png");
-        m_fgColor = QColor("green");
-        return STATE_DOWNLOADING;
-      } else {
-        m_icon = QIcon(":/Icons/skin/stalledDL.png");
-        m_fgColor = QColor("grey");
-        return STATE_STALLED_DL;
-      }
-    }
+    case torrent_status::downloading:
+      return m_torrent.download_payload_rate() > 0 ? STATE_DOWNLOADING : STATE_STALLED_DL;
     case torrent_status::finished:
     case torrent_status::seeding:
-      if (m_torrent.upload_payload_rate() > 0) {
-        m_icon = QIcon(":/Icons/skin/uploading.png");
-        m_fgColor = QColor("orange");
-        return STATE_SEEDING;
-      } else {
-        m_icon = QIcon(":/Icons/skin/stalledUP.png");
-        m_fgColor = QColor("grey");
-        return STATE_STALLED_UP;
-      }
+      return m_torrent.upload_payload_rate() > 0 ? STATE_SEEDING : STATE_STALLED_UP;
     case torrent_status::queued_for_checking:
     case torrent_status::checking_resume_data:
     case torrent_status::checking_files:
-      m_icon = QIcon(":/Icons/skin/checking.png");
-      m_fgColor = QColor("grey");
       return m_torrent.is_seed() ? STATE_CHECKING_UP : STATE_CHECKING_DL;
     default:
-      m_icon = QIcon(":/Icons/skin/error.png");
-      m_fgColor = QColor("red");
       return STATE_INVALID;
     }
   } catch(invalid_handle&) {
-    m_icon = QIcon(":/Icons/skin/error.png");
-    m_fgColor = QColor("red");
     return STATE_INVALID;
   }
 }
@@ -122,10 +136,9 @@ bool TorrentModelItem::setData(int column, const QVariant &value, int role)
   case TR_LABEL: {
     QString new_label = value.toString();
     if (m_label != new_label) {
-      QString old_label = m_label;
       m_label = new_label;
       TorrentPersistentData::saveLabel(m_torrent.hash(), new_label);
-      emit labelChanged(old_label, new_label);
+      QBtSession::instance()->getTorrentCounters()->setLabel(m_torrent.infoHash(), new_label);
     }
     return true;
   }
@@ -138,10 +151,10 @@ bool TorrentModelItem::setData(int column, const QVariant &value, int role)
 QVariant TorrentModelItem::data(int column, int role) const
 {
   if (role == Qt::DecorationRole && column == TR_NAME) {
-    return m_icon;
+    return stateStyle(m_state).icon;
   }
   if (role == Qt::ForegroundRole) {
-    return m_fgColor;
+    return stateStyle(m_state).color;
   }
   if (role != Qt::DisplayRole && role != Qt::UserRole) return QVariant();
   switch(column) {
@@ -154,7 +167,7 @@ QVariant TorrentModelItem::data(int column, int role) const
   case TR_PROGRESS:
     return m_torrent.progress();
   case TR_STATUS:
-    return state();
+    return m_state;
   case TR_SEEDS: {
     return (role == Qt::DisplayRole) ? m_torrent.num_seeds() : m_torrent.num_complete();
   }
@@ -206,14 +219,17 @@ void TorrentModel::populate() {
   // Load the torrents
   std::vector<torrent_handle> torrents = QBtSession::instance()->getSession()->get_torrents();
   std::vector<torrent_handle>::const_iterator it;
+  QList<QTorrentHandle> handles;
   for (it = torrents.begin(); it != torrents.end(); it++) {
-    addTorrent(QTorrentHandle(*it));
+    handles << QTorrentHandle(*it);
   }
+  addTorrents(handles);
   // Refresh timer
   connect(&m_refreshTimer, SIGNAL(timeout()), SLOT(forceModelRefresh()));
   m_refreshTimer.start(m_refreshInterval);
   // Listen for torrent changes
   connect(QBtSession::instance(), SIGNAL(addedTorrent(QTorrentHandle)), SLOT(addTorrent(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(addedTorrents(QList<QTorrentHandle>)), SLOT(addTorrents(QList<QTorrentHandle>)));
   connect(QBtSession::instance(), SIGNAL(torrentAboutToBeRemoved(QTorrentHandle)), SLOT(handleTorrentAboutToBeRemoved(QTorrentHandle)));
   connect(QBtSession::instance(), SIGNAL(deletedTorrent(QString)), SLOT(removeTorrent(QString)));
   connect(QBtSession::instance(), SIGNAL(finishedTorrent(QTorrentHandle)), SLOT(handleTorrentUpdate(QTorrentHandle)));
@@ -225,8 +241,8 @@ void TorrentModel::populate() {
 
 TorrentModel::~TorrentModel() {
   qDebug() << Q_FUNC_INFO << "ENTER";
-  qDeleteAll(m_torrents);
   m_torrents.clear();
+  m_rows.clear();
   qDebug() << Q_FUNC_INFO << "EXIT";
 }
 
@@ -290,7 +306,7 @@ QVariant TorrentModel::data(const QModelIndex &index, int role) const
   if (!index.isValid()) return QVariant();
   try {
     if (index.row() >= 0 && index.row() < rowCount() && index.column() >= 0 && index.column() < columnCount())
-      return m_torrents[index.row()]->data(index.column(), role);
+      return m_torrents.at(index.row()).data(index.column(), role);
   } catch(invalid_handle&) {}
   return QVariant();
 }
@@ -302,9 +318,14 @@ bool TorrentModel::setData(const QModelIndex &index, const QVariant &value, int
   qDebug("Index is valid and role is DisplayRole");
   try {
     if (index.row() >= 0 && index.row() < rowCount() && index.column() >= 0 && index.column() < columnCount()) {
-      bool change = m_torrents[index.row()]->setData(index.column(), value, role);
-      if (change)
+      TorrentModelItem &item = m_torrents[index.row()];
+      const QString old_label = item.label();
+      bool change = item.setData(index.column(), value, role);
+      if (change) {
+        if (item.label() != old_label)
+          emit torrentChangedLabel(&item, old_label, item.label());
         notifyTorrentChanged(index.row());
+      }
       return change;
     }
   } catch(invalid_handle&) {}
@@ -313,38 +334,74 @@ bool TorrentModel::setData(const QModelIndex &index, const QVariant &value, int
 
 int TorrentModel::torrentRow(const QString &hash) const
 {
-  QList<TorrentModelItem*>::const_iterator it;
-  int row = 0;
-  for (it = m_torrents.constBegin(); it != m_torrents.constEnd(); it++) {
-    if ((*it)->hash() == hash) return row;
-    ++row;
-  }
-  return -1;
+  return torrentRow(InfoHash(hash));
+}
+
+int TorrentModel::torrentRow(const InfoHash &hash) const
+{
+  return m_rows.value(hash, -1);
 }
 
 void TorrentModel::addTorrent(const QTorrentHandle &h)
 {
-  if (torrentRow(h.hash()) < 0) {
+  if (torrentRow(h.infoHash()) < 0) {
     beginInsertTorrent(m_torrents.size());
-    TorrentModelItem *item = new TorrentModelItem(h);
-    connect(item, SIGNAL(labelChanged(QString,QString)), SLOT(handleTorrentLabelChange(QString,QString)));
-    m_torrents << item;
-    emit torrentAdded(item);
+    m_torrents << TorrentModelItem(h);
+    TorrentModelItem &item = m_torrents.last();
+    m_rows.insert(item.infoHash(), m_torrents.size() - 1);
+    emit torrentAdded(&item);
     endInsertTorrent();
   }
 }
 
+// Inserts all the new torrents in a single rows insertion
+void TorrentModel::addTorrents(const QList<QTorrentHandle> &handles)
+{
+  QSet<InfoHash> new_hashes;
+  QList<QTorrentHandle> new_handles;
+  foreach (const QTorrentHandle &h, handles) {
+    const InfoHash hash = h.infoHash();
+    if (!m_rows.contains(hash) && !new_hashes.contains(hash)) {
+      new_hashes << hash;
+      new_handles << h;
+    }
+  }
+  if (new_handles.isEmpty()) return;
+
+  // The items read their resume data from memory
+  TorrentResumeBatch batch;
+  beginInsertRows(QModelIndex(), m_torrents.size(), m_torrents.size() + new_handles.size() - 1);
+  m_torrents.reserve(m_torrents.size() + new_handles.size());
+  foreach (const QTorrentHandle &h, new_handles) {
+    m_torrents << TorrentModelItem(h);
+    TorrentModelItem &item = m_torrents.last();
+    m_rows.insert(item.infoHash(), m_torrents.size() - 1);
+    emit torrentAdded(&item);
+  }
+  endInsertRows();
+}
+
 void TorrentModel::removeTorrent(const QString &hash)
 {
   const int row = torrentRow(hash);
   qDebug() << Q_FUNC_INFO << hash << row;
   if (row >= 0) {
     beginRemoveTorrent(row);
-    m_torrents.removeAt(row);
+    m_torrents.remove(row);
+    // Following rows have shifted
+    rebuildRowIndex();
     endRemoveTorrent();
   }
 }
 
+void TorrentModel::rebuildRowIndex()
+{
+  m_rows.clear();
+  m_rows.reserve(m_torrents.size());
+  for (int row = 0; row < m_torrents.size(); ++row)
+    m_rows.insert(m_torrents.at(row).infoHash(), row);
+}
+
 void TorrentModel::beginInsertTorrent(int row)
 {
   beginInsertRows(QModelIndex(), row, row);
@@ -367,8 +424,10 @@ void TorrentModel::endRemoveTorrent()
 
 void TorrentModel::handleTorrentUpdate(const QTorrentHandle &h)
 {
-  const int row = torrentRow(h.hash());
+  QBT_TRACE_SCOPE("model", "handleTorrentUpdate");
+  const int row = torrentRow(h.infoHash());
   if (row >= 0) {
+    m_torrents[row].updateState();
     notifyTorrentChanged(row);
   }
 }
@@ -387,17 +446,22 @@ void TorrentModel::setRefreshInterval(int refreshInterval)
   }
 }
 
+// The state of each torrent is computed here, once per refresh
 void TorrentModel::forceModelRefresh()
 {
+  QBT_TRACE_SCOPE("model", "forceModelRefresh");
+  QVector<TorrentModelItem>::iterator it;
+  for (it = m_torrents.begin(); it != m_torrents.end(); ++it)
+    it->updateState();
   emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
 }
 
 TorrentStatusReport TorrentModel::getTorrentStatusReport() const
 {
   TorrentStatusReport report;
-  QList<TorrentModelItem*>::const_iterator it;
+  QVector<TorrentModelItem>::const_iterator it;
   for (it = m_torrents.constBegin(); it != m_torrents.constEnd(); it++) {
-    switch((*it)->data(TorrentModelItem::TR_STATUS).toInt()) {
+    switch(it->cachedState()) {
     case TorrentModelItem::STATE_DOWNLOADING:
       ++report.nb_active;
       ++report.nb_downloading;
@@ -439,22 +503,24 @@ Qt::ItemFlags TorrentModel::flags(const QModelIndex &index) const
   return QAbstractListModel::flags(index) | Qt::ItemIsEditable;
 }
 
-void TorrentModel::handleTorrentLabelChange(QString previous, QString current)
+QString TorrentModel::torrentHash(int row) const
 {
-  emit torrentChangedLabel(static_cast<TorrentModelItem*>(sender()), previous, current);
+  if (row >= 0 && row < rowCount())
+    return m_torrents.at(row).hash();
+  return QString();
 }
 
-QString TorrentModel::torrentHash(int row) const
+InfoHash TorrentModel::torrentInfoHash(int row) const
 {
   if (row >= 0 && row < rowCount())
-    return m_torrents.at(row)->hash();
-  return QString();
+    return m_torrents.at(row).infoHash();
+  return InfoHash();
 }
 
 void TorrentModel::handleTorrentAboutToBeRemoved(const QTorrentHandle &h)
 {
-  const int row = torrentRow(h.hash());
+  const int row = torrentRow(h.infoHash());
   if (row >= 0) {
-    emit torrentAboutToBeRemoved(m_torrents.at(row));
+    emit torrentAboutToBeRemoved(&m_torrents[row]);
   }
 }
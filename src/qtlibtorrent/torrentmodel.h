@@ -32,7 +32,9 @@
 #define TORRENTMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
+#include <QVector>
 #include <QDateTime>
 #include <QIcon>
 #include <QTimer>
@@ -44,22 +46,24 @@ struct TorrentStatusReport {
   uint nb_downloading; uint nb_seeding; uint nb_active; uint nb_inactive; uint nb_paused;
 };
 
-class TorrentModelItem : public QObject {
-Q_OBJECT
-
+// A row of the transfer list. Plain value, the state is computed once
+// per refresh and the icons and colors come from a shared table.
+class TorrentModelItem {
 public:
   enum State {STATE_DOWNLOADING, STATE_STALLED_DL, STATE_STALLED_UP, STATE_SEEDING, STATE_PAUSED_DL, STATE_PAUSED_UP, STATE_QUEUED_DL, STATE_QUEUED_UP, STATE_CHECKING_UP, STATE_CHECKING_DL, STATE_INVALID};
   enum Column {TR_NAME, TR_PRIORITY, TR_SIZE, TR_PROGRESS, TR_STATUS, TR_SEEDS, TR_PEERS, TR_DLSPEED, TR_UPSPEED, TR_ETA, TR_RATIO, TR_LABEL, TR_ADD_DATE, TR_SEED_DATE, TR_TRACKER, TR_DLLIMIT, TR_UPLIMIT, TR_AMOUNT_DOWNLOADED, TR_AMOUNT_LEFT, TR_TIME_ELAPSED, NB_COLUMNS};
 
 public:
+  TorrentModelItem(): m_state(STATE_INVALID) {}
   TorrentModelItem(const QTorrentHandle& h);
   inline int columnCount() const { return NB_COLUMNS; }
   QVariant data(int column, int role = Qt::DisplayRole) const;
   bool setData(int column, const QVariant &value, int role = Qt::DisplayRole);
-  inline QString hash() const { return m_hash; }
-
-signals:
-  void labelChanged(QString previous, QString current);
+  inline QString hash() const { return m_hash.toString(); }
+  inline const InfoHash& infoHash() const { return m_hash; }
+  inline const QString& label() const { return m_label; }
+  inline State cachedState() const { return m_state; }
+  void updateState();
 
 private:
   State state() const;
@@ -70,9 +74,8 @@ private:
   QDateTime m_seedTime;
   QString m_label;
   QString m_name;
-  mutable QIcon m_icon;
-  mutable QColor m_fgColor;
-  QString m_hash; // Cached for safety reasons
+  InfoHash m_hash; // Cached for safety reasons
+  State m_state;
 };
 
 class TorrentModel : public QAbstractListModel
@@ -89,7 +92,9 @@ public:
   bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::DisplayRole);
   QVariant headerData(int section, Qt::Orientation orientation, int role) const;
   int torrentRow(const QString &hash) const;
+  int torrentRow(const InfoHash &hash) const;
   QString torrentHash(int row) const;
+  InfoHash torrentInfoHash(int row) const;
   void setRefreshInterval(int refreshInterval);
   TorrentStatusReport getTorrentStatusReport() const;
   Qt::ItemFlags flags(const QModelIndex &index) const;
@@ -102,11 +107,11 @@ signals:
 
 private slots:
   void addTorrent(const QTorrentHandle& h);
+  void addTorrents(const QList<QTorrentHandle>& handles);
   void removeTorrent(const QString &hash);
   void handleTorrentUpdate(const QTorrentHandle &h);
   void notifyTorrentChanged(int row);
   void forceModelRefresh();
-  void handleTorrentLabelChange(QString previous, QString current);
   void handleTorrentAboutToBeRemoved(const QTorrentHandle & h);
 
 private:
@@ -114,9 +119,11 @@ private:
   void endInsertTorrent();
   void beginRemoveTorrent(int row);
   void endRemoveTorrent();
+  void rebuildRowIndex();
 
 private:
-  QList<TorrentModelItem*> m_torrents;
+  QVector<TorrentModelItem> m_torrents;
+  QHash<InfoHash, int> m_rows; // hash -> row
   int m_refreshInterval;
   QTimer m_refreshTimer;
 };
@@ -0,0 +1,204 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QDebug>
+#include <QHash>
+#include <libtorrent/session.hpp>
+#include "torrentqueue.h"
+#include "infohash.h"
+#include "torrentpersistentdata.h"
+
+using namespace libtorrent;
+
+void TorrentQueue::move(const QList<QTorrentHandle> &torrents, Move move) {
+  QVector<QTorrentHandle> queue;
+  QVector<bool> selected;
+  load(torrents, queue, selected);
+  const int n = queue.size();
+  QVector<QTorrentHandle> target;
+  target.reserve(n);
+  QList<QTorrentHandle> steps;
+  switch(move) {
+  case MOVE_TOP:
+  case MOVE_BOTTOM:
+    for (int i = 0; i < n; ++i) {
+      if (selected[i] == (move == MOVE_TOP))
+        target << queue[i];
+    }
+    for (int i = 0; i < n; ++i) {
+      if (selected[i] != (move == MOVE_TOP))
+        target << queue[i];
+    }
+    break;
+  case MOVE_UP:
+    // A selected torrent goes past the unselected one above it, the
+    // ones at the top or right below another selected one stay
+    target = queue;
+    for (int i = 1; i < n; ++i) {
+      if (selected[i] && !selected[i-1]) {
+        qSwap(target[i-1], target[i]);
+        qSwap(selected[i-1], selected[i]);
+        steps << target[i-1];
+      }
+    }
+    break;
+  case MOVE_DOWN:
+    target = queue;
+    for (int i = n - 2; i >= 0; --i) {
+      if (selected[i] && !selected[i+1]) {
+        qSwap(target[i], target[i+1]);
+        qSwap(selected[i], selected[i+1]);
+        steps << target[i+1];
+      }
+    }
+    break;
+  }
+  apply(queue, target, steps, move == MOVE_UP);
+}
+
+void TorrentQueue::moveTo(const QList<QTorrentHandle> &torrents, int position) {
+  QVector<QTorrentHandle> queue;
+  QVector<bool> selected;
+  load(torrents, queue, selected);
+  QVector<QTorrentHandle> moved;
+  QVector<QTorrentHandle> others;
+  for (int i = 0; i < queue.size(); ++i) {
+    if (selected[i])
+      moved << queue[i];
+    else
+      others << queue[i];
+  }
+  const int p = qBound(0, position - 1, others.size());
+  QVector<QTorrentHandle> target;
+  target.reserve(queue.size());
+  for (int i = 0; i < p; ++i)
+    target << others[i];
+  target += moved;
+  for (int i = p; i < others.size(); ++i)
+    target << others[i];
+  apply(queue, target, QList<QTorrentHandle>(), false);
+}
+
+void TorrentQueue::load(const QList<QTorrentHandle> &torrents, QVector<QTorrentHandle> &queue, QVector<bool> &selected) const {
+  QHash<InfoHash, bool> wanted;
+  foreach (const QTorrentHandle &h, torrents) {
+    if (h.is_valid())
+      wanted.insert(h.infoHash(), true);
+  }
+  QList<QPair<int, int> > positions;
+  QVector<QTorrentHandle> handles;
+  std::vector<torrent_handle> all = m_session->get_torrents();
+  std::vector<torrent_handle>::const_iterator it;
+  for (it = all.begin(); it != all.end(); ++it) {
+    try {
+      const QTorrentHandle h(*it);
+      const int position = h.queue_position();
+      if (position > 0) {
+        positions << qMakePair(position, handles.size());
+        handles << h;
+      }
+    } catch(invalid_handle&) {}
+  }
+  qSort(positions);
+  queue.clear();
+  selected.clear();
+  queue.reserve(positions.size());
+  selected.reserve(positions.size());
+  QList<QPair<int, int> >::const_iterator pit;
+  for (pit = positions.constBegin(); pit != positions.constEnd(); ++pit) {
+    const QTorrentHandle &h = handles.at(pit->second);
+    queue << h;
+    selected << wanted.contains(h.infoHash());
+  }
+}
+
+void TorrentQueue::apply(const QVector<QTorrentHandle> &queue, const QVector<QTorrentHandle> &target,
+                         const QList<QTorrentHandle> &steps, bool steps_up) {
+  const int n = target.size();
+  Q_ASSERT(n == queue.size());
+  QHash<InfoHash, int> old_index;
+  for (int i = 0; i < n; ++i)
+    old_index.insert(queue[i].infoHash(), i);
+  // The torrents which are not moved end up together in the middle of
+  // the queue: look for the longest run of the target order which is
+  // already ordered, the others are moved to the top or the bottom
+  int best_first = 0, best_last = -1;
+  int first = 0;
+  int prev = -1;
+  bool changed = false;
+  for (int i = 0; i < n; ++i) {
+    const int idx = old_index.value(target[i].infoHash());
+    if (idx != i)
+      changed = true;
+    if (idx < prev)
+      first = i;
+    prev = idx;
+    if (i - first > best_last - best_first) {
+      best_first = first;
+      best_last = i;
+    }
+  }
+  if (!changed) return;
+  const int block_moves = n - (best_last - best_first + 1);
+
+  int moves = 0;
+  if (!steps.isEmpty() && steps.size() <= block_moves) {
+    foreach (const QTorrentHandle &h, steps) {
+      try {
+        if (steps_up)
+          h.queue_position_up();
+        else
+          h.queue_position_down();
+        ++moves;
+      } catch(invalid_handle&) {}
+    }
+  } else {
+    for (int i = best_first - 1; i >= 0; --i) {
+      try {
+        target[i].queue_position_top();
+        ++moves;
+      } catch(invalid_handle&) {}
+    }
+    for (int i = best_last + 1; i < n; ++i) {
+      try {
+        target[i].queue_position_bottom();
+        ++moves;
+      } catch(invalid_handle&) {}
+    }
+  }
+  qDebug("Queue of %d torrents reordered in %d moves", n, moves);
+
+  // Save the positions which changed
+  TorrentResumeBatch batch;
+  for (int i = 0; i < n; ++i) {
+    if (old_index.value(target[i].infoHash()) != i)
+      TorrentPersistentData::savePriority(target[i].hash(), i + 1);
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef TORRENTQUEUE_H
+#define TORRENTQUEUE_H
+
+#include <QList>
+#include <QVector>
+#include "qtorrenthandle.h"
+
+namespace libtorrent {
+  class session;
+}
+
+// Moves groups of torrents in the download queue. The final order is
+// computed first, in one pass over the queue, then reached with the
+// fewest libtorrent queue moves: either step by step moves of the
+// selected torrents or top/bottom moves around the longest part of the
+// queue which keeps its order. The new positions are saved right away.
+// Seeds are not in the queue and are ignored.
+class TorrentQueue {
+  Q_DISABLE_COPY(TorrentQueue)
+
+public:
+  enum Move { MOVE_UP, MOVE_DOWN, MOVE_TOP, MOVE_BOTTOM };
+
+  explicit TorrentQueue(libtorrent::session *s): m_session(s) {}
+
+  // The torrents keep their relative order
+  void move(const QList<QTorrentHandle> &torrents, Move move);
+  // Puts the torrents together from the given position (starting at 1)
+  void moveTo(const QList<QTorrentHandle> &torrents, int position);
+
+private:
+  // Queued torrents, by position. Selected ones are flagged.
+  void load(const QList<QTorrentHandle> &torrents, QVector<QTorrentHandle> &queue, QVector<bool> &selected) const;
+  // Applies a new order, steps are the torrents to move up (or down)
+  // one by one, in order, to reach it
+  void apply(const QVector<QTorrentHandle> &queue, const QVector<QTorrentHandle> &target,
+             const QList<QTorrentHandle> &steps, bool steps_up);
+
+private:
+  libtorrent::session *m_session;
+};
+
+#endif // TORRENTQUEUE_H
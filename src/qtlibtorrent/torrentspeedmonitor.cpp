@@ -100,12 +100,12 @@ void SpeedSample::clear()
 
 void TorrentSpeedMonitor::removeSamples(const QString &hash)
 {
-  m_samples.remove(hash);
+  m_samples.remove(InfoHash(hash));
 }
 
 void TorrentSpeedMonitor::removeSamples(const QTorrentHandle& h) {
   try {
-    m_samples.remove(h.hash());
+    m_samples.remove(h.infoHash());
   } catch(invalid_handle&) {}
 }
 
@@ -113,8 +113,9 @@ qlonglong TorrentSpeedMonitor::getETA(const QString &hash) const
 {
   QMutexLocker locker(&m_mutex);
   QTorrentHandle h = m_session->getTorrentHandle(hash);
-  if (h.is_paused() || !m_samples.contains(hash)) return -1;
-  const qreal speed_average = m_samples.value(hash).average();
+  const InfoHash info_hash(hash);
+  if (h.is_paused() || !m_samples.contains(info_hash)) return -1;
+  const qreal speed_average = m_samples.value(info_hash).average();
   if (speed_average == 0) return -1;
   return (h.total_wanted() - h.total_done()) / speed_average;
 }
@@ -128,10 +129,10 @@ void TorrentSpeedMonitor::getSamples()
 #if LIBTORRENT_VERSION_MINOR > 15
       torrent_status st = it->status(0x0);
       if (!st.paused)
-        m_samples[misc::toQString(it->info_hash())].addSample(st.download_payload_rate);
+        m_samples[it->info_hash()].addSample(st.download_payload_rate);
 #else
       if (!it->is_paused())
-        m_samples[misc::toQString(it->info_hash())].addSample(it->status().download_payload_rate);
+        m_samples[it->info_hash()].addSample(it->status().download_payload_rate);
 #endif
     } catch(invalid_handle&) {}
   }
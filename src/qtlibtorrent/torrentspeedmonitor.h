@@ -37,6 +37,7 @@
 #include <QHash>
 #include <QMutex>
 #include "qtorrenthandle.h"
+#include "infohash.h"
 
 class QBtSession;
 class SpeedSample;
@@ -66,7 +67,7 @@ private:
 private:
   bool m_abort;
   QWaitCondition m_abortCond;
-  QHash<QString, SpeedSample> m_samples;
+  QHash<InfoHash, SpeedSample> m_samples;
   mutable QMutex m_mutex;
   QBtSession *m_session;
 };
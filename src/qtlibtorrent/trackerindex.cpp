@@ -0,0 +1,140 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QSet>
+#include <QUrl>
+#include "trackerindex.h"
+
+TrackerIndex::TrackerIndex(QObject *parent): QObject(parent)
+{
+}
+
+QString TrackerIndex::hostFromUrl(const QString &url) {
+  return QUrl(url).host().toLower();
+}
+
+void TrackerIndex::setTrackers(const InfoHash &hash, const QStringList &urls) {
+  QHash<QString, TrackerInfos> &trackers = m_torrents[hash];
+  const QSet<QString> new_urls = urls.toSet();
+  QHash<QString, TrackerInfos>::iterator it = trackers.begin();
+  while (it != trackers.end()) {
+    if (new_urls.contains(it.key())) {
+      ++it;
+      continue;
+    }
+    removeFromHost(hash, it.value());
+    it = trackers.erase(it);
+  }
+  foreach (const QString &url, new_urls) {
+    if (url.isEmpty() || trackers.contains(url)) continue;
+    const TrackerInfos info(url);
+    trackers.insert(url, info);
+    addToHost(hash, info);
+  }
+}
+
+void TrackerIndex::removeTorrent(const InfoHash &hash) {
+  QHash<InfoHash, QHash<QString, TrackerInfos> >::iterator it = m_torrents.find(hash);
+  if (it == m_torrents.end()) return;
+  foreach (const TrackerInfos &info, it.value())
+    removeFromHost(hash, info);
+  m_torrents.erase(it);
+}
+
+void TrackerIndex::setWorking(const InfoHash &hash, const QString &url, unsigned long num_peers) {
+  TrackerInfos &info = entry(hash, url);
+  info.last_message = ""; // Reset error/warning message
+  info.num_peers = num_peers;
+  setStatus(info, TrackerInfos::WORKING);
+}
+
+void TrackerIndex::setWarning(const InfoHash &hash, const QString &url, const QString &msg) {
+  TrackerInfos &info = entry(hash, url);
+  info.last_message = msg;
+  setStatus(info, TrackerInfos::WARNING);
+}
+
+void TrackerIndex::setFailed(const InfoHash &hash, const QString &url, const QString &msg) {
+  TrackerInfos &info = entry(hash, url);
+  info.last_message = msg;
+  setStatus(info, TrackerInfos::FAILED);
+}
+
+QHash<QString, TrackerInfos> TrackerIndex::trackers(const InfoHash &hash) const {
+  return m_torrents.value(hash);
+}
+
+// Trackers can announce before the tracker list of their torrent
+// is known (e.g. trackers added by libtorrent)
+TrackerInfos& TrackerIndex::entry(const InfoHash &hash, const QString &url) {
+  QHash<QString, TrackerInfos> &trackers = m_torrents[hash];
+  QHash<QString, TrackerInfos>::iterator it = trackers.find(url);
+  if (it == trackers.end()) {
+    it = trackers.insert(url, TrackerInfos(url));
+    addToHost(hash, it.value());
+  }
+  return it.value();
+}
+
+void TrackerIndex::setStatus(TrackerInfos &info, TrackerInfos::Status status) {
+  if (info.status == status) return;
+  const QString host_name = hostFromUrl(info.name_or_url);
+  QHash<QString, TrackerHost>::iterator it = m_hosts.find(host_name);
+  if (it != m_hosts.end()) {
+    --it.value().counts[info.status];
+    ++it.value().counts[status];
+  }
+  info.status = status;
+  if (it != m_hosts.end())
+    emit hostChanged(host_name);
+}
+
+void TrackerIndex::addToHost(const InfoHash &hash, const TrackerInfos &info) {
+  const QString host_name = hostFromUrl(info.name_or_url);
+  if (host_name.isEmpty()) return;
+  TrackerHost &host = m_hosts[host_name];
+  ++host.torrents[hash];
+  ++host.counts[info.status];
+  emit hostChanged(host_name);
+}
+
+void TrackerIndex::removeFromHost(const InfoHash &hash, const TrackerInfos &info) {
+  const QString host_name = hostFromUrl(info.name_or_url);
+  QHash<QString, TrackerHost>::iterator it = m_hosts.find(host_name);
+  if (it == m_hosts.end()) return;
+  TrackerHost &host = it.value();
+  --host.counts[info.status];
+  QHash<InfoHash, int>::iterator tit = host.torrents.find(hash);
+  if (tit != host.torrents.end() && --tit.value() <= 0)
+    host.torrents.erase(tit);
+  if (host.torrents.isEmpty())
+    m_hosts.erase(it);
+  emit hostChanged(host_name);
+}
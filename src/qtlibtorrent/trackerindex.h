@@ -0,0 +1,91 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef TRACKERINDEX_H
+#define TRACKERINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include "trackerinfos.h"
+#include "infohash.h"
+
+// Torrents announcing to a tracker host and state of their announces
+struct TrackerHost {
+  TrackerHost() { for (int i = 0; i < 4; ++i) counts[i] = 0; }
+
+  int count(TrackerInfos::Status status) const { return counts[status]; }
+
+  QHash<InfoHash, int> torrents; // hash -> number of its trackers on this host
+  int counts[4];                // Announce URLs in each status
+};
+
+// Tracker state of every torrent, also indexed by tracker host.
+// It is updated in place from the tracker alerts so that the torrents
+// of a host and its error counters can be read without visiting the
+// torrents. Only used from the main thread.
+class TrackerIndex : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(TrackerIndex)
+
+public:
+  explicit TrackerIndex(QObject *parent = 0);
+
+  // Replaces the tracker list of a torrent, the known URLs keep their state
+  void setTrackers(const InfoHash &hash, const QStringList &urls);
+  void removeTorrent(const InfoHash &hash);
+  void setWorking(const InfoHash &hash, const QString &url, unsigned long num_peers);
+  void setWarning(const InfoHash &hash, const QString &url, const QString &msg);
+  void setFailed(const InfoHash &hash, const QString &url, const QString &msg);
+
+  QHash<QString, TrackerInfos> trackers(const InfoHash &hash) const;
+  QStringList hosts() const { return m_hosts.keys(); }
+  bool hasHost(const QString &host) const { return m_hosts.contains(host); }
+  TrackerHost host(const QString &host) const { return m_hosts.value(host); }
+
+  static QString hostFromUrl(const QString &url);
+
+signals:
+  // Counters or torrents of the host changed. The host is no longer
+  // in the index if its last torrent was removed.
+  void hostChanged(const QString &host);
+
+private:
+  TrackerInfos& entry(const InfoHash &hash, const QString &url);
+  void setStatus(TrackerInfos &info, TrackerInfos::Status status);
+  void addToHost(const InfoHash &hash, const TrackerInfos &info);
+  void removeFromHost(const InfoHash &hash, const TrackerInfos &info);
+
+private:
+  QHash<InfoHash, QHash<QString, TrackerInfos> > m_torrents; // hash -> url -> state
+  QHash<QString, TrackerHost> m_hosts;
+};
+
+#endif // TRACKERINDEX_H
@@ -35,9 +35,12 @@
 
 class TrackerInfos {
 public:
+  enum Status {NOT_CONTACTED, WORKING, WARNING, FAILED};
+
   QString name_or_url;
   QString last_message;
   unsigned long num_peers;
+  Status status;
 
   //TrackerInfos() {}
   TrackerInfos(const TrackerInfos &b) {
@@ -45,8 +48,9 @@ public:
     Q_ASSERT(!name_or_url.isEmpty());
     last_message = b.last_message;
     num_peers = b.num_peers;
+    status = b.status;
   }
-  TrackerInfos(QString name_or_url): name_or_url(name_or_url), last_message(""), num_peers(0) {
+  TrackerInfos(QString name_or_url): name_or_url(name_or_url), last_message(""), num_peers(0), status(NOT_CONTACTED) {
   }
 };
 
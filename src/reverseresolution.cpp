@@ -0,0 +1,153 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include <QDateTime>
+#include "reverseresolution.h"
+#include "misc.h"
+
+const quint32 CACHE_FILE_VERSION = 1;
+
+ReverseResolution::ReverseResolution(QObject* parent, bool persistent):
+  QObject(parent), m_persistent(persistent)
+{
+  m_cache.setMaxCost(CACHE_SIZE);
+  if (m_persistent)
+    loadCache();
+}
+
+ReverseResolution::~ReverseResolution() {
+  qDebug("Deleting host name resolver...");
+  foreach (int id, m_lookups.keys()) {
+    QHostInfo::abortHostLookup(id);
+  }
+  if (m_persistent)
+    saveCache();
+}
+
+void ReverseResolution::resolve(const libtorrent::asio::ip::tcp::endpoint &ip) {
+  boost::system::error_code ec;
+  const QString ip_str = misc::toQString(ip.address().to_string(ec));
+  if (ec) return;
+  // Duplicate requests are coalesced
+  if (m_inFlight.contains(ip_str) || m_queued.contains(ip_str))
+    return;
+  CacheEntry *entry = m_cache.object(ip_str);
+  if (entry) {
+    if (entry->expiration > QDateTime::currentDateTime().toTime_t()) {
+      if (!entry->hostname.isEmpty())
+        emit ip_resolved(ip_str, entry->hostname);
+      return;
+    }
+    m_cache.remove(ip_str);
+  }
+  if (m_queue.size() >= MAX_QUEUED_LOOKUPS) {
+    // The peer will be resolved the next time it is requested
+    qDebug("Host name resolution queue is full, ignoring %s", qPrintable(ip_str));
+    return;
+  }
+  m_queue.enqueue(ip_str);
+  m_queued.insert(ip_str);
+  startLookups();
+}
+
+void ReverseResolution::startLookups() {
+  while (!m_queue.isEmpty() && m_lookups.size() < MAX_CONCURRENT_LOOKUPS) {
+    const QString ip = m_queue.dequeue();
+    m_queued.remove(ip);
+    m_inFlight.insert(ip);
+    const int id = QHostInfo::lookupHost(ip, this, SLOT(hostResolved(QHostInfo)));
+    m_lookups.insert(id, ip);
+  }
+}
+
+void ReverseResolution::hostResolved(const QHostInfo& host) {
+  const QString ip = m_lookups.take(host.lookupId());
+  if (ip.isEmpty()) return;
+  m_inFlight.remove(ip);
+  const QString hostname = host.hostName();
+  if (host.error() == QHostInfo::NoError && !hostname.isEmpty() && hostname != ip) {
+    insertInCache(ip, hostname, POSITIVE_TTL);
+    emit ip_resolved(ip, hostname);
+  } else {
+    insertInCache(ip, QString(), NEGATIVE_TTL);
+  }
+  startLookups();
+}
+
+void ReverseResolution::insertInCache(const QString &ip, const QString &hostname, uint ttl) {
+  CacheEntry *entry = new CacheEntry;
+  entry->hostname = hostname;
+  entry->expiration = QDateTime::currentDateTime().toTime_t() + ttl;
+  m_cache.insert(ip, entry);
+}
+
+QString ReverseResolution::cacheFilePath() {
+  return QDir(misc::cacheLocation()).absoluteFilePath("hostnames.cache");
+}
+
+void ReverseResolution::loadCache() {
+  QFile file(cacheFilePath());
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+  QDataStream stream(&file);
+  quint32 version;
+  stream >> version;
+  if (version != CACHE_FILE_VERSION) return;
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  while (!stream.atEnd() && stream.status() == QDataStream::Ok) {
+    QString ip;
+    CacheEntry *entry = new CacheEntry;
+    stream >> ip >> entry->hostname >> entry->expiration;
+    if (stream.status() != QDataStream::Ok || entry->expiration <= now) {
+      delete entry;
+      continue;
+    }
+    m_cache.insert(ip, entry);
+  }
+  qDebug("Loaded %d host names from cache", m_cache.size());
+}
+
+void ReverseResolution::saveCache() const {
+  QFile file(cacheFilePath());
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+  QDataStream stream(&file);
+  stream << CACHE_FILE_VERSION;
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  foreach (const QString &ip, m_cache.keys()) {
+    const CacheEntry *entry = m_cache[ip];
+    if (entry->expiration <= now) continue;
+    stream << ip << entry->hostname << entry->expiration;
+  }
+}
@@ -31,11 +31,11 @@
 #ifndef REVERSERESOLUTION_H
 #define REVERSERESOLUTION_H
 
-#include <QList>
 #include <QCache>
-#include <QDebug>
+#include <QHash>
+#include <QSet>
+#include <QQueue>
 #include <QHostInfo>
-#include "misc.h"
 
 #include <boost/version.hpp>
 #if BOOST_VERSION < 103500
@@ -44,54 +44,52 @@
 #include <boost/asio/ip/tcp.hpp>
 #endif
 
-const int CACHE_SIZE = 500;
-
+// Resolves peer IPs to host names.
+// Lookups are queued and at most MAX_CONCURRENT_LOOKUPS of them are sent
+// to the system resolver at a time. Both successful and failed lookups
+// are cached (least recently used entries are dropped first) and the
+// cache is saved to disk so that it survives restarts.
 class ReverseResolution: public QObject {
   Q_OBJECT
   Q_DISABLE_COPY(ReverseResolution)
 
 public:
-  explicit ReverseResolution(QObject* parent): QObject(parent) {
-    m_cache.setMaxCost(CACHE_SIZE);
-  }
-
-  ~ReverseResolution() {
-    qDebug("Deleting host name resolver...");
-  }
+  explicit ReverseResolution(QObject* parent, bool persistent = true);
+  ~ReverseResolution();
 
-  void resolve(const libtorrent::asio::ip::tcp::endpoint &ip) {
-    boost::system::error_code ec;
-    const QString ip_str = misc::toQString(ip.address().to_string(ec));
-    if (ec) return;
-    if (m_cache.contains(ip_str)) {
-      qDebug("Resolved host name using cache");
-      emit ip_resolved(ip_str, *m_cache.object(ip_str));
-      return;
-    }
-    // Actually resolve the ip
-    QHostInfo::lookupHost(ip_str, this, SLOT(hostResolved(QHostInfo)));
-  }
+  void resolve(const libtorrent::asio::ip::tcp::endpoint &ip);
 
 signals:
   void ip_resolved(const QString &ip, const QString &hostname);
 
 private slots:
-  void hostResolved(const QHostInfo& host) {
-    if (host.error() == QHostInfo::NoError) {
-      const QString hostname = host.hostName();
-      if (host.addresses().isEmpty() || hostname.isEmpty()) return;
-      const QString ip = host.addresses().first().toString();
-      if (hostname != ip) {
-        //qDebug() << Q_FUNC_INFO << ip << QString("->") << hostname;
-        m_cache.insert(ip, new QString(hostname));
-        emit ip_resolved(ip, hostname);
-      }
-    }
-  }
+  void hostResolved(const QHostInfo& host);
 
 private:
-  QCache<QString, QString> m_cache;
-};
+  struct CacheEntry {
+    QString hostname; // Empty if the lookup failed
+    uint expiration;  // Seconds since epoch
+  };
+
+  void startLookups();
+  void insertInCache(const QString &ip, const QString &hostname, uint ttl);
+  void loadCache();
+  void saveCache() const;
+  static QString cacheFilePath();
 
+private:
+  static const int CACHE_SIZE = 50000;
+  static const int MAX_CONCURRENT_LOOKUPS = 8;
+  static const int MAX_QUEUED_LOOKUPS = 2000;
+  static const uint POSITIVE_TTL = 24*3600;
+  static const uint NEGATIVE_TTL = 3600;
+
+  QCache<QString, CacheEntry> m_cache;
+  QQueue<QString> m_queue;
+  QSet<QString> m_queued;
+  QHash<int, QString> m_lookups; // lookup id -> ip
+  QSet<QString> m_inFlight;
+  bool m_persistent;
+};
 
 #endif // REVERSERESOLUTION_H
@@ -50,6 +50,7 @@
 #include "rsssettings.h"
 #include "automatedrssdownloader.h"
 #include "iconprovider.h"
+#include "downloadthread.h"
 
 namespace Article {
 enum ArticleRoles {
@@ -132,6 +133,7 @@ void RSSImp::on_actionManage_cookies_triggered() {
   QList<QByteArray> raw_cookies = CookiesDlg::askForCookies(this, settings.getHostNameCookies(feed_hostname), &ok);
   if (ok) {
     settings.setHostNameCookies(feed_hostname, raw_cookies);
+    DownloadThread::invalidateSettings();
   }
 }
 
@@ -38,18 +38,16 @@
 #include "misc.h"
 #include "rssdownloadrulelist.h"
 #include "downloadthread.h"
+#include "tracer.h"
 
 RssFeed::RssFeed(RssManager* manager, RssFolder* parent, const QString &url):
   m_manager(manager), m_parent(parent), m_icon(":/Icons/oxygen/application-rss+xml.png"),
   m_refreshed(false), m_downloadFailure(false), m_loading(false) {
   qDebug() << Q_FUNC_INFO << url;
   m_url = QUrl::fromEncoded(url.toUtf8()).toString();
-  // Listen for new RSS downloads
-  connect(manager->rssDownloader(), SIGNAL(downloadFinished(QString,QString)), SLOT(handleFinishedDownload(QString,QString)));
-  connect(manager->rssDownloader(), SIGNAL(downloadFailure(QString,QString)), SLOT(handleDownloadFailure(QString,QString)));
   // Download the RSS Feed icon
   m_iconUrl = iconUrl();
-  manager->rssDownloader()->downloadUrl(m_iconUrl);
+  download(m_iconUrl);
 
   // Load old RSS articles
   loadItemsFromDisk();
@@ -91,13 +89,21 @@ void RssFeed::loadItemsFromDisk() {
 }
 
 void RssFeed::refresh() {
+  QBT_TRACE_SCOPE("rss", "refreshFeed");
   if (m_loading) {
     qWarning() << Q_FUNC_INFO << "Feed" << this->displayName() << "is already being refreshed, ignoring request";
     return;
   }
   m_loading = true;
   // Download the RSS again
-  m_manager->rssDownloader()->downloadUrl(m_url);
+  download(m_url);
+}
+
+void RssFeed::download(const QString &url) {
+  // Only listen to our own downloads
+  DownloadHandler *handler = m_manager->rssDownloader()->downloadUrl(url);
+  connect(handler, SIGNAL(downloadFinished(QString,QString)), SLOT(handleFinishedDownload(QString,QString)));
+  connect(handler, SIGNAL(downloadFailure(QString,QString)), SLOT(handleDownloadFailure(QString,QString)));
 }
 
 void RssFeed::removeAllSettings() {
@@ -222,7 +228,7 @@ void RssFeed::parseRSSChannel(QXmlStreamReader& xml)
       QString icon_path = xml.attributes().value("url").toString();
       if (!icon_path.isEmpty()) {
         m_iconUrl = icon_path;
-        m_manager->rssDownloader()->downloadUrl(m_iconUrl);
+        download(m_iconUrl);
       }
     }
     else if (xml.name() == "item") {
@@ -315,6 +321,7 @@ void RssFeed::removeOldArticles() {
 
 // existing and opening test after download
 bool RssFeed::parseXmlFile(const QString &file_path) {
+  QBT_TRACE_SCOPE("rss", "parseXmlFile");
   qDebug("openRss() called");
   QFile fileRss(file_path);
   if (!fileRss.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -78,6 +78,7 @@ private slots:
   void handleDownloadFailure(const QString &url, const QString& error);
 
 private:
+  void download(const QString &url);
   bool parseRSS(QIODevice* device);
   void parseRSSChannel(QXmlStreamReader& xml);
   void removeOldArticles();
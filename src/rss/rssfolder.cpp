@@ -35,6 +35,7 @@
 #include "qbtsession.h"
 #include "rssmanager.h"
 #include "rssfeed.h"
+#include "tracer.h"
 
 RssFolder::RssFolder(RssFolder *parent, const QString &name): m_parent(parent), m_name(name) {
 }
@@ -78,6 +79,7 @@ RssFeedPtr RssFolder::addStream(RssManager* manager, const QString &url) {
 
 // Refresh All Children
 void RssFolder::refresh() {
+  QBT_TRACE_SCOPE("rss", "refreshFolder");
   for (RssFileHash::ConstIterator it = m_children.begin(); it != m_children.end(); it++) {
     it.value()->refresh();
   }
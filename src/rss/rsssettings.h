@@ -32,12 +32,20 @@
 #define RSSSETTINGS_H
 
 #include <QStringList>
-#include "qinisettings.h"
+#include "settingsstorage.h"
 
-class RssSettings: public QIniSettings{
+class RssSettings {
 
 public:
-  RssSettings() : QIniSettings("qBittorrent", "qBittorrent") {}
+  RssSettings() : m_storage(SettingsStorage::instance()) {}
+
+  QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const {
+    return m_storage->value(key, defaultValue);
+  }
+
+  void setValue(const QString &key, const QVariant &value) {
+    m_storage->setValue(key, value);
+  }
 
   bool isRSSEnabled() const {
     return value(QString::fromUtf8("Preferences/RSS/RSSEnabled"), false).toBool();
@@ -105,6 +113,9 @@ public:
     hosts_table.insert(host_name, raw_cookies);
     setValue("Rss/hosts_cookies", hosts_table);
   }
+
+private:
+  SettingsStorage *m_storage;
 };
 
 #endif // RSSSETTINGS_H
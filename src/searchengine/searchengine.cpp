@@ -569,8 +569,7 @@ void SearchEngine::searchFinished(int exitcode,QProcess::ExitStatus) {
   if (searchTimeout->isActive()) {
     searchTimeout->stop();
   }
-  QIniSettings settings("qBittorrent", "qBittorrent");
-  bool useNotificationBalloons = settings.value("Preferences/General/NotificationBaloons", true).toBool();
+  bool useNotificationBalloons = Preferences().value("Preferences/General/NotificationBaloons", true).toBool();
   if (useNotificationBalloons && mp_mainWindow->getCurrentTabWidget() != this) {
     mp_mainWindow->showNotificationBaloon(tr("Search Engine"), tr("Search has finished"));
   }
@@ -32,6 +32,15 @@ nox {
 }
 QT += network
 
+# Micro-benchmarks instead of the program (qmake CONFIG+=benchmark)
+benchmark {
+  nox:error(The benchmarks need the graphical interface modules)
+  CONFIG += qtestlib
+  TARGET = qbittorrent-benchmark
+  # Not installed
+  INSTALLS =
+}
+
 # Vars
 LANG_PATH = lang
 ICONS_PATH = Icons
@@ -102,15 +111,22 @@ HEADERS += misc.h \
            scannedfoldersmodel.h \
            qinisettings.h \
            smtp.h \
-           dnsupdater.h
+           dnsupdater.h \
+           tracer.h
 
 
-SOURCES += main.cpp \
-           downloadthread.cpp \
+SOURCES += downloadthread.cpp \
            scannedfoldersmodel.cpp \
            misc.cpp \
            smtp.cpp \
-           dnsupdater.cpp
+           dnsupdater.cpp \
+           tracer.cpp
+
+benchmark {
+  include(benchmark/benchmark.pri)
+} else {
+  SOURCES += main.cpp
+}
 
 nox {
   HEADERS += headlessloader.h
@@ -139,7 +155,10 @@ nox {
               executionlog.h \
               iconprovider.h \
               updownratiodlg.h \
-              loglistwidget.h
+              seedingtimedlg.h \
+              loglistwidget.h \
+              logmodel.h \
+              torrentfiltermodel.h
 
   SOURCES += mainwindow.cpp \
              ico.cpp \
@@ -147,6 +166,7 @@ nox {
              torrentcontentmodel.cpp \
              torrentcontentmodelitem.cpp \
              torrentcontentfiltermodel.cpp \
+             reverseresolution.cpp \
              torrentadditiondlg.cpp \
              sessionapplication.cpp \
              torrentimportdlg.cpp \
@@ -154,7 +174,10 @@ nox {
              previewselect.cpp \
              iconprovider.cpp \
              updownratiodlg.cpp \
-             loglistwidget.cpp
+             seedingtimedlg.cpp \
+             loglistwidget.cpp \
+             logmodel.cpp \
+             torrentfiltermodel.cpp
 
   win32 {
     HEADERS += programupdater.h
@@ -105,9 +105,7 @@ torrentAdditionDialog::torrentAdditionDialog(QWidget *parent) :
     //addInPause->setEnabled(false);
   }
   // Load custom labels
-  QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent"));
-  settings.beginGroup(QString::fromUtf8("TransferListFilters"));
-  const QStringList customLabels = settings.value("customLabels", QStringList()).toStringList();
+  const QStringList customLabels = pref.getTorrentLabels();
   comboLabel->addItem("");
   foreach (const QString& label, customLabels) {
     comboLabel->addItem(label);
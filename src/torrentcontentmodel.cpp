@@ -46,13 +46,27 @@ TorrentContentModel::~TorrentContentModel()
   delete m_rootItem;
 }
 
+// Folders are updated after their children
+static void updateFoldersProgress(TorrentContentModelItem *item)
+{
+  foreach (TorrentContentModelItem *child, item->children()) {
+    if (child->isFolder())
+      updateFoldersProgress(child);
+  }
+  if (item->isFolder())
+    item->updateProgress(false);
+}
+
 void TorrentContentModel::updateFilesProgress(const std::vector<libtorrent::size_type>& fp)
 {
   emit layoutAboutToBeChanged();
   Q_ASSERT(m_filesIndex.size() == (int)fp.size());
+  // Updating the parent folders for each file would be quadratic
+  // in the number of files per folder, update them once at the end
   for (uint i=0; i<fp.size(); ++i) {
-    m_filesIndex[i]->setProgress(fp[i]);
+    m_filesIndex[i]->setProgress(fp[i], false);
   }
+  updateFoldersProgress(m_rootItem);
   emit dataChanged(index(0,0), index(rowCount(), columnCount()));
 }
 
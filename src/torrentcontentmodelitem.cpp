@@ -147,7 +147,7 @@ void TorrentContentModelItem::updateSize()
   setSize(size);
 }
 
-void TorrentContentModelItem::setProgress(qulonglong done)
+void TorrentContentModelItem::setProgress(qulonglong done, bool update_parent)
 {
   Q_ASSERT (m_type != ROOT);
   if (getPriority() == 0) return;
@@ -161,7 +161,8 @@ void TorrentContentModelItem::setProgress(qulonglong done)
     progress = 1.;
   Q_ASSERT(progress >= 0. && progress <= 1.);
   m_itemData.replace(COL_PROGRESS, progress);
-  m_parentItem->updateProgress();
+  if (update_parent)
+    m_parentItem->updateProgress();
 }
 
 qulonglong TorrentContentModelItem::getTotalDone() const
@@ -180,7 +181,7 @@ float TorrentContentModelItem::getProgress() const
   return 1.;
 }
 
-void TorrentContentModelItem::updateProgress()
+void TorrentContentModelItem::updateProgress(bool update_parent)
 {
   if (m_type == ROOT) return;
   Q_ASSERT(m_type == FOLDER);
@@ -191,7 +192,7 @@ void TorrentContentModelItem::updateProgress()
   }
   //qDebug("Folder: total_done: %llu/%llu", total_done, getSize());
   Q_ASSERT(m_totalDone <= getSize());
-  setProgress(m_totalDone);
+  setProgress(m_totalDone, update_parent);
 }
 
 int TorrentContentModelItem::getPriority() const
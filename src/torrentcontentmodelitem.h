@@ -68,9 +68,9 @@ public:
   void updateSize();
   qulonglong getTotalDone() const;
 
-  void setProgress(qulonglong done);
+  void setProgress(qulonglong done, bool update_parent=true);
   float getProgress() const;
-  void updateProgress();
+  void updateProgress(bool update_parent=true);
 
   int getPriority() const;
   void setPriority(int new_prio, bool update_parent=true);
@@ -0,0 +1,61 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include "torrentfiltermodel.h"
+#include "torrentmodel.h"
+
+TorrentFilterModel::TorrentFilterModel(QObject *parent):
+  QSortFilterProxyModel(parent), m_trackerFiltered(false)
+{
+}
+
+void TorrentFilterModel::setTrackerFilter(const QHash<InfoHash, int> &torrents) {
+  // Cheap when the torrents of the host did not change (shared data)
+  if (m_trackerFiltered && m_trackerTorrents == torrents) return;
+  m_trackerFiltered = true;
+  m_trackerTorrents = torrents;
+  invalidateFilter();
+}
+
+void TorrentFilterModel::clearTrackerFilter() {
+  if (!m_trackerFiltered) return;
+  m_trackerFiltered = false;
+  m_trackerTorrents.clear();
+  invalidateFilter();
+}
+
+bool TorrentFilterModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const {
+  if (m_trackerFiltered) {
+    const TorrentModel *model = static_cast<const TorrentModel*>(sourceModel());
+    if (!m_trackerTorrents.contains(model->torrentInfoHash(source_row)))
+      return false;
+  }
+  return QSortFilterProxyModel::filterAcceptsRow(source_row, source_parent);
+}
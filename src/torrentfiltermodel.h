@@ -0,0 +1,60 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef TORRENTFILTERMODEL_H
+#define TORRENTFILTERMODEL_H
+
+#include <QHash>
+#include <QSortFilterProxyModel>
+#include "infohash.h"
+
+// Label filter of the transfer list (regular expression on the label
+// column) combined with the tracker host filter. The torrents of the
+// host come from the tracker index, so each row is a hash lookup.
+class TorrentFilterModel : public QSortFilterProxyModel {
+  Q_OBJECT
+  Q_DISABLE_COPY(TorrentFilterModel)
+
+public:
+  explicit TorrentFilterModel(QObject *parent = 0);
+
+  // hash -> number of trackers of the torrent on the host
+  void setTrackerFilter(const QHash<InfoHash, int> &torrents);
+  void clearTrackerFilter();
+
+protected:
+  bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
+
+private:
+  bool m_trackerFiltered;
+  QHash<InfoHash, int> m_trackerTorrents;
+};
+
+#endif // TORRENTFILTERMODEL_H
@@ -41,28 +41,128 @@
 #include <vector>
 #include "qinisettings.h"
 #include <QHash>
-
-class TorrentTempData {
+#include <QSet>
+#include <QThread>
+#include <QCoreApplication>
+
+// Access to the torrent resume data. Outside of a batch, every write
+// is a full read-modify-write of the resume file. Between beginBatch()
+// and endBatch(), the data is kept in memory and written back once.
+// The batch cache is not locked: batches must only be used from the
+// main thread.
+class TorrentResumeStore {
 public:
-  static bool hasTempData(QString hash) {
+  static void beginBatch() {
+    Q_ASSERT(QThread::currentThread() == qApp->thread());
+    ++batch().depth;
+  }
+
+  static void endBatch() {
+    Q_ASSERT(QThread::currentThread() == qApp->thread());
+    Batch &b = batch();
+    Q_ASSERT(b.depth > 0);
+    if (--b.depth > 0) return;
+    if (!b.dirty.isEmpty()) {
+      QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
+      foreach (const QString &group, b.dirty) {
+        settings.setValue(group, b.groups.value(group));
+      }
+    }
+    b.groups.clear();
+    b.dirty.clear();
+  }
+
+  static QHash<QString, QVariant> allData(const QString &group) {
+    if (batch().depth > 0)
+      return cachedGroup(group);
     QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    return all_data.contains(hash);
+    return settings.value(group).toHash();
   }
 
-  static void deleteTempData(QString hash) {
+  static bool contains(const QString &group, const QString &hash) {
+    if (batch().depth > 0)
+      return cachedGroup(group).contains(hash);
+    return allData(group).contains(hash);
+  }
+
+  static QHash<QString, QVariant> torrentData(const QString &group, const QString &hash) {
+    if (batch().depth > 0)
+      return cachedGroup(group).value(hash).toHash();
+    return allData(group).value(hash).toHash();
+  }
+
+  static void setTorrentData(const QString &group, const QString &hash, const QHash<QString, QVariant> &data) {
+    if (batch().depth > 0) {
+      cachedGroup(group)[hash] = data;
+      batch().dirty << group;
+      return;
+    }
     QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
+    QHash<QString, QVariant> all_data = settings.value(group).toHash();
+    all_data[hash] = data;
+    settings.setValue(group, all_data);
+  }
+
+  static void remove(const QString &group, const QString &hash) {
+    if (batch().depth > 0) {
+      if (cachedGroup(group).remove(hash) > 0)
+        batch().dirty << group;
+      return;
+    }
+    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
+    QHash<QString, QVariant> all_data = settings.value(group).toHash();
     if (all_data.contains(hash)) {
       all_data.remove(hash);
-      settings.setValue("torrents-tmp", all_data);
+      settings.setValue(group, all_data);
     }
   }
 
+private:
+  struct Batch {
+    Batch(): depth(0) {}
+    int depth;
+    QHash<QString, QHash<QString, QVariant> > groups;
+    QSet<QString> dirty;
+  };
+
+  static Batch& batch() {
+    static Batch b;
+    return b;
+  }
+
+  static QHash<QString, QVariant>& cachedGroup(const QString &group) {
+    Q_ASSERT(QThread::currentThread() == qApp->thread());
+    Batch &b = batch();
+    if (!b.groups.contains(group)) {
+      QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
+      b.groups.insert(group, settings.value(group).toHash());
+    }
+    return b.groups[group];
+  }
+};
+
+// Groups the resume data writes made during its lifetime
+class TorrentResumeBatch {
+public:
+  TorrentResumeBatch() { TorrentResumeStore::beginBatch(); }
+  ~TorrentResumeBatch() { TorrentResumeStore::endBatch(); }
+
+private:
+  Q_DISABLE_COPY(TorrentResumeBatch)
+};
+
+class TorrentTempData {
+public:
+  static bool hasTempData(QString hash) {
+    return TorrentResumeStore::contains("torrents-tmp", hash);
+  }
+
+  static void deleteTempData(QString hash) {
+    TorrentResumeStore::remove("torrents-tmp", hash);
+  }
+
   static void setFilesPriority(QString hash,  const std::vector<int> &pp) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     std::vector<int>::const_iterator pp_it = pp.begin();
     QStringList pieces_priority;
     while(pp_it != pp.end()) {
@@ -70,96 +170,68 @@ public:
       pp_it++;
     }
     data["files_priority"] = pieces_priority;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentResumeStore::setTorrentData("torrents-tmp", hash, data);
   }
 
   static void setFilesPath(QString hash, const QStringList &path_list) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     data["files_path"] = path_list;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentResumeStore::setTorrentData("torrents-tmp", hash, data);
   }
 
   static void setSavePath(QString hash, QString save_path) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     data["save_path"] = save_path;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentResumeStore::setTorrentData("torrents-tmp", hash, data);
   }
 
   static void setLabel(QString hash, QString label) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     qDebug("Saving label %s to tmp data", label.toLocal8Bit().data());
     data["label"] = label;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentResumeStore::setTorrentData("torrents-tmp", hash, data);
   }
 
   static void setSequential(QString hash, bool sequential) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     data["sequential"] = sequential;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentResumeStore::setTorrentData("torrents-tmp", hash, data);
   }
 
   static bool isSequential(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     return data.value("sequential", false).toBool();
   }
 
   static void setSeedingMode(QString hash,bool seed) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     data["seeding"] = seed;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentResumeStore::setTorrentData("torrents-tmp", hash, data);
   }
 
   static bool isSeedingMode(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     return data.value("seeding", false).toBool();
   }
 
   static QString getSavePath(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     return data.value("save_path").toString();
   }
 
   static QStringList getFilesPath(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     return data.value("files_path").toStringList();
   }
 
   static QString getLabel(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     qDebug("Got label %s from tmp data", data.value("label", "").toString().toLocal8Bit().data());
     return data.value("label", "").toString();
   }
 
   static void getFilesPriority(QString hash, std::vector<int> &fp) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents-tmp", hash);
     const QList<int> list_var = misc::intListfromStringList(data.value("files_priority").toStringList());
     foreach (const int &var, list_var) {
       fp.push_back(var);
@@ -173,63 +245,53 @@ public:
     USE_GLOBAL_RATIO = -2,
     NO_RATIO_LIMIT = -1
   };
+  enum SeedingTimeLimit {
+    USE_GLOBAL_SEEDING_TIME = -2,
+    NO_SEEDING_TIME_LIMIT = -1
+  };
 
 public:
   static bool isKnownTorrent(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    return all_data.contains(hash);
+    return TorrentResumeStore::contains("torrents", hash);
   }
 
   static QStringList knownTorrents() {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    return all_data.keys();
+    return TorrentResumeStore::allData("torrents").keys();
   }
 
   static void setRatioLimit(const QString &hash, qreal ratio) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     data["max_ratio"] = ratio;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
   }
 
   static qreal getRatioLimit(const QString &hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("max_ratio", USE_GLOBAL_RATIO).toReal();
   }
 
-  static bool hasPerTorrentRatioLimit() {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant>::ConstIterator it;
-    for (it = all_data.constBegin(); it != all_data.constEnd(); it++) {
-      if (it.value().toHash().value("max_ratio", USE_GLOBAL_RATIO).toReal() >= 0) {
-        return true;
-      }
-    }
-    return false;
+  // In minutes, or one of the SeedingTimeLimit values
+  static void setSeedingTimeLimit(const QString &hash, int minutes) {
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
+    data["max_seeding_time"] = minutes;
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
+  }
+
+  static int getSeedingTimeLimit(const QString &hash) {
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
+    return data.value("max_seeding_time", USE_GLOBAL_SEEDING_TIME).toInt();
   }
 
   static void setAddedDate(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     if (!data.contains("add_date")) {
       data["add_date"] = QDateTime::currentDateTime();
-      all_data[hash] = data;
-      settings.setValue("torrents", all_data);
+      TorrentResumeStore::setTorrentData("torrents", hash, data);
     }
   }
 
   static QDateTime getAddedDate(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     QDateTime dt = data.value("add_date").toDateTime();
     if (!dt.isValid()) {
       setAddedDate(hash);
@@ -239,88 +301,61 @@ public:
   }
 
   static void setErrorState(QString hash, bool has_error) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     data["has_error"] = has_error;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
   }
 
   static bool hasError(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("has_error", false).toBool();
   }
 
   static void setRootFolder(QString hash, QString root_folder) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     data["root_folder"] = root_folder;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
   }
 
   static QString getRootFolder(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("root_folder").toString();
   }
 
   static void setPreviousSavePath(QString hash, QString previous_path) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     data["previous_path"] = previous_path;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
   }
 
   static QString getPreviousPath(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("previous_path").toString();
   }
   
   static void saveSeedDate(const QTorrentHandle &h) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[h.hash()].toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", h.hash());
     if (h.is_seed())
       data["seed_date"] = QDateTime::currentDateTime();
     else
       data.remove("seed_date");
-    all_data[h.hash()] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", h.hash(), data);
   }
 
   static QDateTime getSeedDate(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("seed_date").toDateTime();
   }
 
   static void deletePersistentData(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    if (all_data.contains(hash)) {
-      all_data.remove(hash);
-      settings.setValue("torrents", all_data);
-    }
+    TorrentResumeStore::remove("torrents", hash);
   }
 
   static void saveTorrentPersistentData(const QTorrentHandle &h, QString save_path = QString::null, bool is_magnet = false) {
     Q_ASSERT(h.is_valid());
     qDebug("Saving persistent data for %s", qPrintable(h.hash()));
     // Save persistent data
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(h.hash()).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", h.hash());
     data["is_magnet"] = is_magnet;
     if (is_magnet) {
       data["magnet_uri"] = misc::toQString(make_magnet_uri(h));
@@ -337,8 +372,7 @@ public:
     // Label
     data["label"] = TorrentTempData::getLabel(h.hash());
     // Save data
-    all_data[h.hash()] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", h.hash(), data);
     qDebug("TorrentPersistentData: Saving save_path %s, hash: %s", qPrintable(h.save_path()), qPrintable(h.hash()));
     // Set Added date
     setAddedDate(h.hash());
@@ -351,53 +385,44 @@ public:
   static void saveSavePath(QString hash, QString save_path) {
     Q_ASSERT(!hash.isEmpty());
     qDebug("TorrentPersistentData::saveSavePath(%s)", qPrintable(save_path));
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     data["save_path"] = save_path;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
     qDebug("TorrentPersistentData: Saving save_path: %s, hash: %s", qPrintable(save_path), qPrintable(hash));
   }
 
   static void saveLabel(QString hash, QString label) {
     Q_ASSERT(!hash.isEmpty());
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     data["label"] = label;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
   }
 
   static void saveName(QString hash, QString name) {
     Q_ASSERT(!hash.isEmpty());
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     data["name"] = name;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
   }
 
   static void savePriority(const QTorrentHandle &h) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[h.hash()].toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", h.hash());
     data["priority"] = h.queue_position();
-    all_data[h.hash()] = data;
-    settings.setValue("torrents", all_data);
+    TorrentResumeStore::setTorrentData("torrents", h.hash(), data);
+  }
+
+  static void savePriority(const QString &hash, int priority) {
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
+    data["priority"] = priority;
+    TorrentResumeStore::setTorrentData("torrents", hash, data);
   }
 
   static void saveSeedStatus(const QTorrentHandle &h) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[h.hash()].toHash();
+    QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", h.hash());
     bool was_seed = data.value("seed", false).toBool();
     if (was_seed != h.is_seed()) {
       data["seed"] = !was_seed;
-      all_data[h.hash()] = data;
-      settings.setValue("torrents", all_data);
+      TorrentResumeStore::setTorrentData("torrents", h.hash(), data);
       if (!was_seed) {
         // Save completion date
         saveSeedDate(h);
@@ -407,52 +432,38 @@ public:
 
   // Getters
   static QString getSavePath(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     //qDebug("TorrentPersistentData: getSavePath %s", data["save_path"].toString().toLocal8Bit().data());
     return data.value("save_path").toString();
   }
 
   static QString getLabel(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("label", "").toString();
   }
 
   static QString getName(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("name", "").toString();
   }
 
   static int getPriority(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("priority", -1).toInt();
   }
 
   static bool isSeed(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("seed", false).toBool();
   }
 
   static bool isMagnet(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     return data.value("is_magnet", false).toBool();
   }
 
   static QString getMagnetUri(QString hash) {
-    QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
+    const QHash<QString, QVariant> data = TorrentResumeStore::torrentData("torrents", hash);
     Q_ASSERT(data.value("is_magnet", false).toBool());
     return data.value("magnet_uri").toString();
   }
@@ -0,0 +1,225 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QThreadStorage>
+#include <libtorrent/time.hpp>
+#include "tracer.h"
+
+// Events kept per thread and per recording, the next ones are dropped
+const int BUFFER_CAPACITY = 16384;
+
+namespace {
+
+struct TraceEvent {
+  const char *category;
+  const char *name;
+  qint64 ts;
+  qint64 dur;
+  qint64 value;
+  char phase;
+};
+
+// Only written by its thread. The size is published after the event
+// is written so that the events below it can be read from the main
+// thread at any time.
+struct TraceBuffer {
+  TraceBuffer(int tid, const QString &thread_name):
+    tid(tid), threadName(thread_name), generation(-1), size(0), dropped(0), alive(1),
+    events(new TraceEvent[BUFFER_CAPACITY]) {}
+  ~TraceBuffer() { delete[] events; }
+
+  const int tid;
+  const QString threadName;
+  int generation;
+  QAtomicInt size;
+  QAtomicInt dropped;
+  QAtomicInt alive; // 0 once the thread has exited
+  TraceEvent *events;
+};
+
+// Owned by the thread storage, tells the buffer when its thread exits
+struct TraceBufferRef {
+  explicit TraceBufferRef(TraceBuffer *b): buffer(b) {}
+  ~TraceBufferRef() { buffer->alive.fetchAndStoreRelease(0); }
+  TraceBuffer *buffer;
+};
+
+QMutex s_buffersMutex;
+QList<TraceBuffer*> s_buffers;
+QThreadStorage<TraceBufferRef*> s_threadBuffer;
+volatile int s_generation = 0;
+const libtorrent::ptime s_epoch = libtorrent::time_now_hires();
+
+TraceBuffer* threadBuffer() {
+  if (!s_threadBuffer.hasLocalData()) {
+    QMutexLocker locker(&s_buffersMutex);
+    const int tid = s_buffers.size() + 1;
+    QString name = QThread::currentThread()->objectName();
+    if (name.isEmpty()) {
+      if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread())
+        name = "Main";
+      else
+        name = QString("Thread %1").arg(tid);
+    }
+    TraceBuffer *b = new TraceBuffer(tid, name);
+    s_buffers << b;
+    s_threadBuffer.setLocalData(new TraceBufferRef(b));
+  }
+  TraceBuffer *b = s_threadBuffer.localData()->buffer;
+  if (b->generation != s_generation) {
+    // New recording
+    b->size.fetchAndStoreRelaxed(0);
+    b->dropped.fetchAndStoreRelaxed(0);
+    b->generation = s_generation;
+  }
+  return b;
+}
+
+void append(const TraceEvent &e) {
+  TraceBuffer *b = threadBuffer();
+  const int i = b->size;
+  if (i >= BUFFER_CAPACITY) {
+    b->dropped.ref();
+    return;
+  }
+  b->events[i] = e;
+  b->size.fetchAndStoreRelease(i + 1);
+}
+
+// Frees the buffers of the exited threads
+void releaseBuffers() {
+  QMutexLocker locker(&s_buffersMutex);
+  QList<TraceBuffer*>::iterator it = s_buffers.begin();
+  while (it != s_buffers.end()) {
+    if ((*it)->alive.fetchAndAddAcquire(0) == 0) {
+      delete *it;
+      it = s_buffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+QByteArray escape(const QString &s) {
+  QByteArray str = s.toUtf8();
+  str.replace('\\', "\\\\");
+  str.replace('"', "\\\"");
+  return str;
+}
+
+} // namespace
+
+volatile bool Tracer::s_enabled = false;
+
+void Tracer::start() {
+  releaseBuffers();
+  ++s_generation;
+  s_enabled = true;
+  qDebug("Tracing started");
+}
+
+QByteArray Tracer::stop() {
+  s_enabled = false;
+  QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  int dropped = 0;
+  {
+    QMutexLocker locker(&s_buffersMutex);
+    foreach (TraceBuffer *b, s_buffers) {
+      if (b->generation != s_generation) continue;
+      const int n = b->size.fetchAndAddAcquire(0);
+      if (n == 0) continue;
+      dropped += b->dropped.fetchAndAddRelaxed(0);
+      if (!first) json += ',';
+      first = false;
+      json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(b->tid)
+          + ",\"args\":{\"name\":\"" + escape(b->threadName) + "\"}}";
+      for (int i = 0; i < n; ++i) {
+        const TraceEvent &e = b->events[i];
+        json += ",{\"cat\":\"";
+        json += e.category;
+        json += "\",\"name\":\"";
+        json += e.name;
+        json += "\",\"ph\":\"";
+        json += e.phase;
+        json += "\",\"pid\":1,\"tid\":" + QByteArray::number(b->tid) + ",\"ts\":" + QByteArray::number(e.ts);
+        if (e.phase == 'X')
+          json += ",\"dur\":" + QByteArray::number(e.dur) + "}";
+        else
+          json += ",\"args\":{\"value\":" + QByteArray::number(e.value) + "}}";
+      }
+    }
+  }
+  json += "]}";
+  qDebug("Tracing stopped, %d events dropped", dropped);
+  releaseBuffers();
+  return json;
+}
+
+bool Tracer::stop(const QString &path) {
+  const QByteArray json = stop();
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+  return file.write(json) == json.size();
+}
+
+void Tracer::addDuration(const char *category, const char *name, qint64 start_us, qint64 duration_us) {
+  TraceEvent e;
+  e.category = category;
+  e.name = name;
+  e.ts = start_us;
+  e.dur = duration_us;
+  e.value = 0;
+  e.phase = 'X';
+  append(e);
+}
+
+void Tracer::addCounter(const char *category, const char *name, qint64 value) {
+  TraceEvent e;
+  e.category = category;
+  e.name = name;
+  e.ts = now();
+  e.dur = 0;
+  e.value = value;
+  e.phase = 'C';
+  append(e);
+}
+
+qint64 Tracer::now() {
+  return libtorrent::total_microseconds(libtorrent::time_now_hires() - s_epoch);
+}
@@ -0,0 +1,84 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QString>
+
+// Records timings and counters in the Chrome trace event format, which
+// can be opened with chrome://tracing or Perfetto.
+// Always compiled in but disabled by default: a disabled trace point
+// costs a test. Each thread records to its own buffer, without
+// locking. Tracing is started and stopped from the main thread.
+class Tracer {
+public:
+  static inline bool isEnabled() { return s_enabled; }
+  // Clears the previous recording
+  static void start();
+  // Stops recording and returns the trace as JSON
+  static QByteArray stop();
+  // Same, saved to a file
+  static bool stop(const QString &path);
+
+  // Names must be string literals
+  static void addDuration(const char *category, const char *name, qint64 start_us, qint64 duration_us);
+  static void addCounter(const char *category, const char *name, qint64 value);
+  // Monotonic time in microseconds
+  static qint64 now();
+
+private:
+  static volatile bool s_enabled;
+};
+
+// Records the time spent in a scope
+class TraceScope {
+public:
+  TraceScope(const char *category, const char *name):
+    m_category(category), m_name(name), m_start(Tracer::isEnabled() ? Tracer::now() : -1) {}
+  ~TraceScope() {
+    if (m_start >= 0 && Tracer::isEnabled())
+      Tracer::addDuration(m_category, m_name, m_start, Tracer::now() - m_start);
+  }
+
+private:
+  const char *m_category;
+  const char *m_name;
+  const qint64 m_start;
+};
+
+#define QBT_TRACE_CONCAT2(a, b) a##b
+#define QBT_TRACE_CONCAT(a, b) QBT_TRACE_CONCAT2(a, b)
+#define QBT_TRACE_SCOPE(category, name) TraceScope QBT_TRACE_CONCAT(trace_scope_, __LINE__)(category, name)
+#define QBT_TRACE_COUNTER(category, name, value) \
+  do { if (Tracer::isEnabled()) Tracer::addCounter(category, name, value); } while (0)
+
+#endif // TRACER_H
@@ -42,6 +42,8 @@
 #include <QStandardItemModel>
 #include <QMessageBox>
 #include <QScrollBar>
+#include <QSet>
+#include <QTimer>
 
 #include "transferlistdelegate.h"
 #include "transferlistwidget.h"
@@ -49,6 +51,7 @@
 #include "qinisettings.h"
 #include "torrentmodel.h"
 #include "iconprovider.h"
+#include "qbtsession.h"
 
 class LabelFiltersList: public QListWidget {
   Q_OBJECT
@@ -173,6 +176,94 @@ private:
   
 };
 
+// Tracker hosts, read from the tracker index. The first row shows
+// all the torrents.
+class TrackerFiltersList: public QListWidget {
+  Q_OBJECT
+
+private:
+  TrackerIndex *index;
+  QHash<QString, QListWidgetItem*> hostItems;
+  QSet<QString> dirtyHosts;
+
+public:
+  TrackerFiltersList(QWidget *parent): QListWidget(parent) {
+    setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Expanding);
+    setUniformItemSizes(true);
+    QListWidgetItem *allTrackers = new QListWidgetItem(this);
+    allTrackers->setData(Qt::DisplayRole, QVariant(tr("All trackers") + " (0)"));
+    allTrackers->setData(Qt::DecorationRole, IconProvider::instance()->getIcon("network-server"));
+    index = QBtSession::instance()->getTrackerIndex();
+    foreach (const QString &host, index->hosts())
+      dirtyHosts << host;
+    updateHosts();
+    connect(index, SIGNAL(hostChanged(QString)), SLOT(hostChanged(QString)));
+  }
+
+  // Empty for all the trackers
+  QString hostFromRow(int row) const {
+    if (row <= 0) return QString();
+    return item(row)->data(Qt::UserRole).toString();
+  }
+
+  void setTorrentCount(int nb_torrents) {
+    item(0)->setText(tr("All trackers") + " (" + QString::number(nb_torrents) + ")");
+  }
+
+protected slots:
+  // Tracker replies come in bursts, rows are updated once per burst
+  void hostChanged(const QString &host) {
+    if (dirtyHosts.isEmpty())
+      QTimer::singleShot(0, this, SLOT(updateHosts()));
+    dirtyHosts << host;
+  }
+
+  void updateHosts() {
+    foreach (const QString &host, dirtyHosts) {
+      QListWidgetItem *it = hostItems.value(host, 0);
+      if (!index->hasHost(host)) {
+        if (!it) continue;
+        hostItems.remove(host);
+        const bool was_current = (currentItem() == it);
+        delete takeItem(row(it));
+        if (was_current)
+          setCurrentRow(0);
+        continue;
+      }
+      if (!it) {
+        it = new QListWidgetItem;
+        it->setData(Qt::UserRole, host);
+        insertHost(it, host);
+        hostItems.insert(host, it);
+      }
+      const TrackerHost info = index->host(host);
+      it->setText(host + " (" + QString::number(info.torrents.size()) + ")");
+      if (info.count(TrackerInfos::FAILED) > 0)
+        it->setData(Qt::DecorationRole, QIcon(":/Icons/skin/error.png"));
+      else if (info.count(TrackerInfos::WARNING) > 0)
+        it->setData(Qt::DecorationRole, IconProvider::instance()->getIcon("dialog-warning"));
+      else
+        it->setData(Qt::DecorationRole, IconProvider::instance()->getIcon("network-server"));
+      it->setToolTip(tr("Working: %1, Warnings: %2, Errors: %3, Not contacted yet: %4")
+                     .arg(info.count(TrackerInfos::WORKING)).arg(info.count(TrackerInfos::WARNING))
+                     .arg(info.count(TrackerInfos::FAILED)).arg(info.count(TrackerInfos::NOT_CONTACTED)));
+    }
+    dirtyHosts.clear();
+  }
+
+private:
+  // Keeps the hosts sorted
+  void insertHost(QListWidgetItem *it, const QString &host) {
+    for (int i=1; i<count(); ++i) {
+      if (hostFromRow(i).localeAwareCompare(host) >= 0) {
+        insertItem(i, it);
+        return;
+      }
+    }
+    addItem(it);
+  }
+};
+
 class TransferListFiltersWidget: public QFrame {
   Q_OBJECT
 
@@ -180,6 +271,7 @@ private:
   QHash<QString, int> customLabels;
   StatusFiltersWidget* statusFilters;
   LabelFiltersList* labelFilters;
+  TrackerFiltersList* trackerFilters;
   QVBoxLayout* vLayout;
   TransferListWidget *transferList;
   int nb_labeled;
@@ -194,8 +286,11 @@ public:
     vLayout->addWidget(statusFilters);
     labelFilters = new LabelFiltersList(this);
     vLayout->addWidget(labelFilters);
+    trackerFilters = new TrackerFiltersList(this);
+    vLayout->addWidget(trackerFilters);
     setLayout(vLayout);
     labelFilters->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    trackerFilters->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     statusFilters->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     statusFilters->setSpacing(0);
     setContentsMargins(0,0,0,0);
@@ -226,6 +321,7 @@ public:
     connect(transferList->getSourceModel(), SIGNAL(torrentAdded(TorrentModelItem*)), SLOT(handleNewTorrent(TorrentModelItem*)));
     connect(labelFilters, SIGNAL(currentRowChanged(int)), this, SLOT(applyLabelFilter(int)));
     connect(labelFilters, SIGNAL(torrentDropped(int)), this, SLOT(torrentDropped(int)));
+    connect(trackerFilters, SIGNAL(currentRowChanged(int)), this, SLOT(applyTrackerFilter(int)));
     connect(transferList->getSourceModel(), SIGNAL(torrentAboutToBeRemoved(TorrentModelItem*)), SLOT(torrentAboutToBeDeleted(TorrentModelItem*)));
     connect(transferList->getSourceModel(), SIGNAL(torrentChangedLabel(TorrentModelItem*,QString,QString)), SLOT(torrentChangedLabel(TorrentModelItem*, QString, QString)));
 
@@ -241,6 +337,7 @@ public:
     loadSettings();
 
     labelFilters->setCurrentRow(0);
+    trackerFilters->setCurrentRow(0);
     //labelFilters->selectionModel()->select(labelFilters->model()->index(0,0), QItemSelectionModel::Select);
 
     // Label menu
@@ -252,6 +349,7 @@ public:
     saveSettings();
     delete statusFilters;
     delete labelFilters;
+    delete trackerFilters;
     delete vLayout;
   }
 
@@ -264,7 +362,7 @@ public:
     settings.beginGroup(QString::fromUtf8("TransferListFilters"));
     settings.setValue("selectedFilterIndex", QVariant(statusFilters->currentRow()));
     //settings.setValue("selectedLabelIndex", QVariant(labelFilters->currentRow()));
-    settings.setValue("customLabels", QVariant(customLabels.keys()));
+    Preferences().setTorrentLabels(customLabels.keys());
   }
 
   void loadSettings() {
@@ -392,6 +490,10 @@ protected slots:
     }
   }
 
+  void applyTrackerFilter(int row) {
+    transferList->applyTrackerFilter(trackerFilters->hostFromRow(row));
+  }
+
   void torrentChangedLabel(TorrentModelItem *torrentItem, QString old_label, QString new_label) {
     Q_UNUSED(torrentItem);
     qDebug("Torrent label changed from %s to %s", qPrintable(old_label), qPrintable(new_label));
@@ -467,6 +569,7 @@ protected slots:
 
   void updateStickyLabelCounters() {
     labelFilters->item(0)->setText(tr("All labels") + " ("+QString::number(nb_torrents)+")");
+    trackerFilters->setTorrentCount(nb_torrents);
     labelFilters->item(1)->setText(tr("Unlabeled") + " ("+QString::number(nb_torrents-nb_labeled)+")");
   }
 
@@ -42,8 +42,6 @@
 #include <QMessageBox>
 
 #include <libtorrent/version.hpp>
-#include <vector>
-#include <queue>
 
 #include "transferlistwidget.h"
 #include "qbtsession.h"
@@ -52,10 +50,12 @@
 #include "previewselect.h"
 #include "speedlimitdlg.h"
 #include "updownratiodlg.h"
+#include "seedingtimedlg.h"
 #include "options_imp.h"
 #include "mainwindow.h"
 #include "preferences.h"
 #include "torrentmodel.h"
+#include "torrentfiltermodel.h"
 #include "deletionconfirmationdlg.h"
 #include "propertieswidget.h"
 #include "qinisettings.h"
@@ -77,7 +77,7 @@ TransferListWidget::TransferListWidget(QWidget *parent, MainWindow *main_window,
   listModel = new TorrentModel(this);
 
   // Set Sort/Filter proxy
-  labelFilterModel = new QSortFilterProxyModel();
+  labelFilterModel = new TorrentFilterModel();
   labelFilterModel->setDynamicSortFilter(true);
   labelFilterModel->setSourceModel(listModel);
   labelFilterModel->setFilterKeyColumn(TorrentModelItem::TR_LABEL);
@@ -180,8 +180,7 @@ inline QModelIndex TransferListWidget::mapFromSource(const QModelIndex &index) c
 
 
 QStringList TransferListWidget::getCustomLabels() const {
-  QIniSettings settings(QString::fromUtf8("qBittorrent"), QString::fromUtf8("qBittorrent"));
-  return settings.value("TransferListFilters/customLabels", QStringList()).toStringList();
+  return Preferences().getTorrentLabels();
 }
 
 void TransferListWidget::torrentDoubleClicked(const QModelIndex& index) {
@@ -314,71 +313,23 @@ void TransferListWidget::deleteVisibleTorrents() {
 void TransferListWidget::increasePrioSelectedTorrents() {
   qDebug() << Q_FUNC_INFO;
   if (main_window->getCurrentTabWidget() != this) return;
-  const QStringList hashes = getSelectedTorrentsHashes();
-  std::priority_queue<QPair<int, QTorrentHandle>, std::vector<QPair<int, QTorrentHandle> >, std::greater<QPair<int, QTorrentHandle> > > torrent_queue;
-  // Sort torrents by priority
-  foreach (const QString &hash, hashes) {
-    try {
-      QTorrentHandle h = BTSession->getTorrentHandle(hash);
-      if (!h.is_seed()) {
-        torrent_queue.push(qMakePair(h.queue_position(), h));
-      }
-    }catch(invalid_handle&) {}
-  }
-  // Increase torrents priority (starting with the ones with highest priority)
-  while(!torrent_queue.empty()) {
-    QTorrentHandle h = torrent_queue.top().second;
-    try {
-      h.queue_position_up();
-    } catch(invalid_handle& h) {}
-    torrent_queue.pop();
-  }
+  BTSession->applyToTorrents(QBtSession::BATCH_QUEUE_UP, getSelectedTorrentsHashes());
 }
 
 void TransferListWidget::decreasePrioSelectedTorrents() {
   qDebug() << Q_FUNC_INFO;
   if (main_window->getCurrentTabWidget() != this) return;
-  const QStringList hashes = getSelectedTorrentsHashes();
-  std::priority_queue<QPair<int, QTorrentHandle>, std::vector<QPair<int, QTorrentHandle> >, std::less<QPair<int, QTorrentHandle> > > torrent_queue;
-  // Sort torrents by priority
-  foreach (const QString &hash, hashes) {
-    try {
-      QTorrentHandle h = BTSession->getTorrentHandle(hash);
-      if (!h.is_seed()) {
-        torrent_queue.push(qMakePair(h.queue_position(), h));
-      }
-    }catch(invalid_handle&) {}
-  }
-  // Decrease torrents priority (starting with the ones with lowest priority)
-  while(!torrent_queue.empty()) {
-    QTorrentHandle h = torrent_queue.top().second;
-    try {
-      h.queue_position_down();
-    } catch(invalid_handle& h) {}
-    torrent_queue.pop();
-  }
+  BTSession->applyToTorrents(QBtSession::BATCH_QUEUE_DOWN, getSelectedTorrentsHashes());
 }
 
 void TransferListWidget::topPrioSelectedTorrents() {
   if (main_window->getCurrentTabWidget() != this) return;
-  const QStringList hashes = getSelectedTorrentsHashes();
-  foreach (const QString &hash, hashes) {
-    QTorrentHandle h = BTSession->getTorrentHandle(hash);
-    if (h.is_valid() && !h.is_seed()) {
-      h.queue_position_top();
-    }
-  }
+  BTSession->applyToTorrents(QBtSession::BATCH_QUEUE_TOP, getSelectedTorrentsHashes());
 }
 
 void TransferListWidget::bottomPrioSelectedTorrents() {
   if (main_window->getCurrentTabWidget() != this) return;
-  const QStringList hashes = getSelectedTorrentsHashes();
-  foreach (const QString &hash, hashes) {
-    QTorrentHandle h = BTSession->getTorrentHandle(hash);
-    if (h.is_valid() && !h.is_seed()) {
-      h.queue_position_bottom();
-    }
-  }
+  BTSession->applyToTorrents(QBtSession::BATCH_QUEUE_BOTTOM, getSelectedTorrentsHashes());
 }
 
 void TransferListWidget::copySelectedMagnetURIs() const {
@@ -512,6 +463,29 @@ void TransferListWidget::setMaxRatioSelectedTorrents() {
   }
 }
 
+void TransferListWidget::setMaxSeedingTimeSelectedTorrents() {
+  const QStringList hashes = getSelectedTorrentsHashes();
+  if (hashes.isEmpty())
+    return;
+  bool useGlobalValue;
+  int currentMaxSeedingTime;
+  if (hashes.count() == 1) {
+    currentMaxSeedingTime = BTSession->getMaxSeedingTimePerTorrent(hashes.first(), &useGlobalValue);
+  } else {
+    useGlobalValue = true;
+    currentMaxSeedingTime = BTSession->getGlobalMaxSeedingTime();
+  }
+  SeedingTimeDlg dlg(useGlobalValue, currentMaxSeedingTime, QBtSession::MAX_SEEDING_TIME, this);
+  if (dlg.exec() != QDialog::Accepted)
+    return;
+  foreach (const QString &hash, hashes) {
+    if (dlg.useDefault())
+      BTSession->removeSeedingTimePerTorrent(hash);
+    else
+      BTSession->setMaxSeedingTimePerTorrent(hash, dlg.seedingTime());
+  }
+}
+
 void TransferListWidget::recheckSelectedTorrents() {
   const QStringList hashes = getSelectedTorrentsHashes();
   foreach (const QString &hash, hashes) {
@@ -650,6 +624,8 @@ void TransferListWidget::displayListMenu(const QPoint&) {
   connect(&actionPreview_file, SIGNAL(triggered()), this, SLOT(previewSelectedTorrents()));
   QAction actionSet_max_ratio(QIcon(QString::fromUtf8(":/Icons/skin/ratio.png")), tr("Limit share ratio..."), 0);
   connect(&actionSet_max_ratio, SIGNAL(triggered()), this, SLOT(setMaxRatioSelectedTorrents()));
+  QAction actionSet_max_seeding_time(IconProvider::instance()->getIcon("chronometer"), tr("Limit seeding time..."), 0);
+  connect(&actionSet_max_seeding_time, SIGNAL(triggered()), this, SLOT(setMaxSeedingTimeSelectedTorrents()));
   QAction actionSet_upload_limit(QIcon(QString::fromUtf8(":/Icons/skin/seeding.png")), tr("Limit upload rate..."), 0);
   connect(&actionSet_upload_limit, SIGNAL(triggered()), this, SLOT(setUpLimitSelectedTorrents()));
   QAction actionSet_download_limit(QIcon(QString::fromUtf8(":/Icons/skin/download.png")), tr("Limit download rate..."), 0);
@@ -767,6 +743,7 @@ void TransferListWidget::displayListMenu(const QPoint&) {
   if (one_not_seed)
     listMenu.addAction(&actionSet_download_limit);
   listMenu.addAction(&actionSet_max_ratio);
+  listMenu.addAction(&actionSet_max_seeding_time);
   listMenu.addAction(&actionSet_upload_limit);
   if (!one_not_seed && all_same_super_seeding && one_has_metadata) {
     actionSuper_seeding_mode.setChecked(super_seeding_mode);
@@ -855,6 +832,28 @@ void TransferListWidget::applyLabelFilter(QString label) {
   labelFilterModel->setFilterRegExp(QRegExp("^"+label+"$", Qt::CaseSensitive));
 }
 
+// Empty host for all the trackers
+void TransferListWidget::applyTrackerFilter(QString host) {
+  TrackerIndex *index = BTSession->getTrackerIndex();
+  if (trackerFilter.isEmpty() && !host.isEmpty())
+    connect(index, SIGNAL(hostChanged(QString)), this, SLOT(trackerHostChanged(QString)));
+  else if (!trackerFilter.isEmpty() && host.isEmpty())
+    disconnect(index, SIGNAL(hostChanged(QString)), this, SLOT(trackerHostChanged(QString)));
+  trackerFilter = host;
+  if (host.isEmpty()) {
+    labelFilterModel->clearTrackerFilter();
+    return;
+  }
+  qDebug("Applying tracker filter: %s", qPrintable(host));
+  labelFilterModel->setTrackerFilter(index->host(host).torrents);
+}
+
+// Torrents were added to or removed from the host of the tracker filter
+void TransferListWidget::trackerHostChanged(const QString &host) {
+  if (host != trackerFilter) return;
+  labelFilterModel->setTrackerFilter(BTSession->getTrackerIndex()->host(host).torrents);
+}
+
 void TransferListWidget::applyNameFilter(QString name) {
   nameFilterModel->setFilterRegExp(QRegExp(name, Qt::CaseInsensitive));
 }
@@ -39,6 +39,7 @@ class QBtSession;
 class TransferListDelegate;
 class MainWindow;
 class TorrentModel;
+class TorrentFilterModel;
 
 QT_BEGIN_NAMESPACE
 class QSortFilterProxyModel;
@@ -75,12 +76,14 @@ public slots:
   void setDlLimitSelectedTorrents();
   void setUpLimitSelectedTorrents();
   void setMaxRatioSelectedTorrents();
+  void setMaxSeedingTimeSelectedTorrents();
   void previewSelectedTorrents();
   void hidePriorityColumn(bool hide);
   void displayDLHoSMenu(const QPoint&);
   void applyNameFilter(QString name);
   void applyStatusFilter(int f);
   void applyLabelFilter(QString label);
+  void applyTrackerFilter(QString host);
   void previewFile(QString filePath);
   void removeLabelFromRows(QString label);
   void renameSelectedTorrent();
@@ -103,6 +106,7 @@ protected slots:
   void toggleSelectedTorrentsSequentialDownload() const;
   void toggleSelectedFirstLastPiecePrio() const;
   void askNewLabelForSelection();
+  void trackerHostChanged(const QString &host);
 
 signals:
   void currentTorrentChanged(const QTorrentHandle &h);
@@ -112,7 +116,8 @@ private:
   TorrentModel *listModel;
   QSortFilterProxyModel *nameFilterModel;
   QSortFilterProxyModel *statusFilterModel;
-  QSortFilterProxyModel *labelFilterModel;
+  TorrentFilterModel *labelFilterModel;
+  QString trackerFilter;
   QBtSession* BTSession;
   MainWindow *main_window;
 };
@@ -37,7 +37,13 @@
 #include "preferences.h"
 //#include "proplistdelegate.h"
 #include "torrentpersistentdata.h"
+#include "metricswriter.h"
+#include <QCoreApplication>
 #include <QDebug>
+#include <QVector>
+#include <algorithm>
+#include <QTimer>
+#include <QUrl>
 #include <QTranslator>
 #ifndef QT_NO_OPENSSL
 #include <QSslCertificate>
@@ -46,13 +52,403 @@
 
 using namespace libtorrent;
 
+// Number of removed torrents remembered for the incremental updates
+const int MAX_REMOVED_TORRENTS = 1000;
+
+EventSnapshot::EventSnapshot()
+  : revision(1), oldestRevision(1), transferInfoRevision(0)
+{
+}
+
+QList<QVariantMap> EventSnapshot::getEventList() const {
+  QList<QVariantMap> list;
+  QHash<QString, TorrentListItem>::ConstIterator it;
+  for (it = items.constBegin(); it != items.constEnd(); it++) {
+    list << it.value().toMap();
+  }
+  return list;
+}
+
 EventManager::EventManager(QObject *parent)
-  : QObject(parent)
+  : QObject(parent), m_publishScheduled(false)
 {
 }
 
-QList<QVariantMap> EventManager::getEventList() const {
-  return event_list.values();
+// Returns the last published state, safe to call from any thread
+EventSnapshot EventManager::snapshot() const {
+  QMutexLocker locker(&m_publishedMutex);
+  return m_published;
+}
+
+// Changes are published once control returns to the event loop
+void EventManager::schedulePublish() {
+  if (m_publishScheduled) return;
+  m_publishScheduled = true;
+  QTimer::singleShot(0, this, SLOT(publish()));
+}
+
+void EventManager::publish() {
+  m_publishScheduled = false;
+  {
+    QMutexLocker locker(&m_publishedMutex);
+    m_published = m_state;
+  }
+  emit updated();
+}
+
+// Web UI state filter, same as the filters of the transfer list
+static bool matchesStateFilter(const QString &filter, const QString &state) {
+  if (filter.isEmpty() || filter == "all")
+    return true;
+  if (filter == "downloading")
+    return state == "downloading" || state == "stalledDL" || state == "checkingDL"
+        || state == "pausedDL" || state == "queuedDL";
+  if (filter == "completed")
+    return state == "uploading" || state == "stalledUP" || state == "checkingUP"
+        || state == "pausedUP" || state == "queuedUP";
+  if (filter == "paused")
+    return state == "pausedDL" || state == "pausedUP";
+  if (filter == "active")
+    return state == "downloading" || state == "uploading";
+  if (filter == "inactive")
+    return state != "downloading" && state != "uploading";
+  return state == filter;
+}
+
+// Returns the hashes of the torrents matching all the given filters.
+// Empty filters match every torrent. The tracker filter is a host
+// name, its torrents are read from the tracker index.
+QStringList EventManager::filterTorrents(const QString &label, const QString &state, const QString &tracker) const {
+  QStringList hashes;
+  QHash<InfoHash, int> tracker_torrents;
+  if (!tracker.isEmpty()) {
+    tracker_torrents = QBtSession::instance()->getTrackerIndex()->host(tracker.toLower()).torrents;
+    if (tracker_torrents.isEmpty())
+      return hashes;
+  }
+  QHash<QString, TorrentListItem>::ConstIterator it;
+  for (it = m_state.items.constBegin(); it != m_state.items.constEnd(); it++) {
+    if (!tracker.isEmpty() && !tracker_torrents.contains(InfoHash(it.key())))
+      continue;
+    if (!matchesStateFilter(state, it.value().state))
+      continue;
+    if (!label.isNull() && it.value().label != label)
+      continue;
+    hashes << it.key();
+  }
+  return hashes;
+}
+
+// Returns what changed since revision rid. A full update is
+// sent if rid is unknown (e.g. 0 for the first request).
+QVariantMap EventSnapshot::getUpdates(qulonglong rid) const {
+  const bool full_update = (rid < oldestRevision || rid > revision);
+  QVariantMap updates;
+  updates["rid"] = revision;
+  updates["full_update"] = full_update;
+  QVariantList changed;
+  QHash<QString, TorrentListItem>::ConstIterator it;
+  for (it = items.constBegin(); it != items.constEnd(); it++) {
+    if (full_update || torrentRevisions.value(it.key()) > rid)
+      changed << it.value().toMap();
+  }
+  updates["torrents"] = changed;
+  if (!full_update) {
+    QStringList removed;
+    QList<QPair<qulonglong, QString> >::ConstIterator rit;
+    for (rit = removedTorrents.constBegin(); rit != removedTorrents.constEnd(); rit++) {
+      if (rit->first > rid)
+        removed << rit->second;
+    }
+    updates["removed"] = removed;
+  }
+  if (full_update || transferInfoRevision > rid)
+    updates["transfer"] = transferInfo;
+  QStringList log;
+  QList<QPair<qulonglong, QString> >::ConstIterator lit;
+  for (lit = logMessages.constBegin(); lit != logMessages.constEnd(); lit++) {
+    if (full_update || lit->first > rid)
+      log << lit->second;
+  }
+  updates["log"] = log;
+  return updates;
+}
+
+QVariantMap TorrentListItem::toMap() const {
+  QVariantMap map;
+  map["hash"] = hash;
+  map["name"] = name;
+  map["state"] = state;
+  map["label"] = label;
+  map["size"] = size;
+  map["progress"] = progress;
+  map["dlspeed"] = dlspeed;
+  map["upspeed"] = upspeed;
+  map["priority"] = priority;
+  map["num_seeds"] = num_seeds;
+  map["num_complete"] = num_complete;
+  map["num_leechs"] = num_leechs;
+  map["num_incomplete"] = num_incomplete;
+  map["seed"] = seed;
+  map["ratio"] = ratio;
+  map["eta"] = eta;
+  return map;
+}
+
+bool TorrentListItem::operator==(const TorrentListItem &other) const {
+  return hash == other.hash && name == other.name && state == other.state
+      && label == other.label && size == other.size && progress == other.progress
+      && dlspeed == other.dlspeed && upspeed == other.upspeed
+      && priority == other.priority && num_seeds == other.num_seeds
+      && num_complete == other.num_complete && num_leechs == other.num_leechs
+      && num_incomplete == other.num_incomplete && seed == other.seed
+      && ratio == other.ratio && eta == other.eta;
+}
+
+enum SortColumn { SORT_NAME, SORT_SIZE, SORT_PROGRESS, SORT_DLSPEED, SORT_UPSPEED,
+                  SORT_PRIORITY, SORT_SEEDS, SORT_LEECHS, SORT_RATIO, SORT_ETA,
+                  SORT_STATE, SORT_LABEL };
+
+// Orders the torrent list, the hash keeps the order stable between pages
+class TorrentListLessThan {
+public:
+  TorrentListLessThan(SortColumn column, bool reverse): m_column(column), m_reverse(reverse) {}
+
+  bool operator()(const TorrentListItem *left, const TorrentListItem *right) const {
+    const int res = compare(left, right);
+    if (res == 0)
+      return left->hash < right->hash;
+    return m_reverse ? (res > 0) : (res < 0);
+  }
+
+private:
+  template <typename T>
+  static int compareValues(const T &left, const T &right) {
+    if (left < right) return -1;
+    if (right < left) return 1;
+    return 0;
+  }
+
+  int compare(const TorrentListItem *left, const TorrentListItem *right) const {
+    switch(m_column) {
+    case SORT_SIZE: return compareValues(left->size, right->size);
+    case SORT_PROGRESS: return compareValues(left->progress, right->progress);
+    case SORT_DLSPEED: return compareValues(left->dlspeed, right->dlspeed);
+    case SORT_UPSPEED: return compareValues(left->upspeed, right->upspeed);
+    case SORT_PRIORITY: return compareValues(left->priority, right->priority);
+    case SORT_SEEDS: return compareValues(left->num_seeds, right->num_seeds);
+    case SORT_LEECHS: return compareValues(left->num_leechs, right->num_leechs);
+    case SORT_RATIO: return compareValues(left->ratio, right->ratio);
+    case SORT_ETA: return compareValues(left->eta, right->eta);
+    case SORT_STATE: return compareValues(left->state, right->state);
+    case SORT_LABEL: return left->label.localeAwareCompare(right->label);
+    default: return left->name.localeAwareCompare(right->name);
+    }
+  }
+
+  SortColumn m_column;
+  bool m_reverse;
+};
+
+static SortColumn sortColumn(const QString &sort) {
+  if (sort == "size") return SORT_SIZE;
+  if (sort == "progress") return SORT_PROGRESS;
+  if (sort == "dlspeed") return SORT_DLSPEED;
+  if (sort == "upspeed") return SORT_UPSPEED;
+  if (sort == "priority") return SORT_PRIORITY;
+  if (sort == "num_seeds") return SORT_SEEDS;
+  if (sort == "num_leechs") return SORT_LEECHS;
+  if (sort == "ratio") return SORT_RATIO;
+  if (sort == "eta") return SORT_ETA;
+  if (sort == "state") return SORT_STATE;
+  if (sort == "label") return SORT_LABEL;
+  return SORT_NAME;
+}
+
+// Returns one page of the filtered and sorted torrent list with raw
+// values. Only the requested page is sorted and converted.
+QVariantMap EventSnapshot::getTorrentList(const QString &filter, const QString &label, const QString &name,
+                                          const QString &sort, bool reverse, int offset, int limit) const {
+  QVector<const TorrentListItem*> matching;
+  matching.reserve(items.size());
+  QHash<QString, TorrentListItem>::ConstIterator it;
+  for (it = items.constBegin(); it != items.constEnd(); it++) {
+    const TorrentListItem &item = it.value();
+    if (!matchesStateFilter(filter, item.state))
+      continue;
+    if (!label.isNull() && item.label != label)
+      continue;
+    if (!name.isEmpty() && !item.name.contains(name, Qt::CaseInsensitive))
+      continue;
+    matching << &item;
+  }
+  offset = qBound(0, offset, matching.size());
+  int end = matching.size();
+  if (limit > 0 && limit < end - offset)
+    end = offset + limit;
+  const TorrentListLessThan lessThan(sortColumn(sort), reverse);
+  std::partial_sort(matching.begin(), matching.begin() + end, matching.end(), lessThan);
+
+  QVariantList page;
+  for (int i = offset; i < end; ++i) {
+    page << matching.at(i)->toMap();
+  }
+  QVariantMap list;
+  list["rid"] = revision;
+  list["total"] = matching.size();
+  list["torrents"] = page;
+  return list;
+}
+
+// The strings keep the translation context of the former
+// HttpConnection::respondGlobalTransferInfoJson()
+QVariantMap EventManager::getTransferInfo() {
+  QVariantMap info;
+  session_status sessionStatus = QBtSession::instance()->getSessionStatus();
+  info["DlInfos"] = QCoreApplication::translate("HttpConnection", "D: %1/s - T: %2", "Download speed: x KiB/s - Transferred: x MiB").arg(misc::friendlyUnit(sessionStatus.payload_download_rate)).arg(misc::friendlyUnit(sessionStatus.total_payload_download));
+  info["UpInfos"] = QCoreApplication::translate("HttpConnection", "U: %1/s - T: %2", "Upload speed: x KiB/s - Transferred: x MiB").arg(misc::friendlyUnit(sessionStatus.payload_upload_rate)).arg(misc::friendlyUnit(sessionStatus.total_payload_upload));
+  return info;
+}
+
+void EventManager::updateTransferInfo() {
+  const QVariantMap info = getTransferInfo();
+  if (info != m_state.transferInfo) {
+    m_state.transferInfo = info;
+    m_state.transferInfoRevision = ++m_state.revision;
+    schedulePublish();
+  }
+}
+
+void EventManager::addLogMessage(const QString &msg) {
+  m_state.logMessages << qMakePair(++m_state.revision, msg);
+  if (m_state.logMessages.size() > MAX_LOG_MESSAGES)
+    m_state.logMessages.removeFirst();
+  schedulePublish();
+}
+
+static QVariantMap trackerHostInfo(const QString &name, const TrackerHost &host) {
+  QVariantMap info;
+  info["host"] = name;
+  info["torrents"] = host.torrents.size();
+  info["working"] = host.count(TrackerInfos::WORKING);
+  info["warning"] = host.count(TrackerInfos::WARNING);
+  info["error"] = host.count(TrackerInfos::FAILED);
+  info["not_contacted"] = host.count(TrackerInfos::NOT_CONTACTED);
+  return info;
+}
+
+// Announce counters of every tracker host, straight from the tracker index
+QList<QVariantMap> EventManager::getTrackerHosts() const {
+  QList<QVariantMap> hosts;
+  const TrackerIndex *index = QBtSession::instance()->getTrackerIndex();
+  foreach (const QString &name, index->hosts())
+    hosts << trackerHostInfo(name, index->host(name));
+  return hosts;
+}
+
+// Same as above for a single host, with the hashes of its torrents
+QVariantMap EventManager::getTrackerHost(const QString &name) const {
+  const TrackerHost host = QBtSession::instance()->getTrackerIndex()->host(name.toLower());
+  QVariantMap info = trackerHostInfo(name.toLower(), host);
+  QVariantList hashes;
+  QHash<InfoHash, int>::const_iterator it;
+  for (it = host.torrents.constBegin(); it != host.torrents.constEnd(); ++it)
+    hashes << it.key().toString();
+  info["hashes"] = hashes;
+  return info;
+}
+
+// Every value is read from a counter or a total kept up to date
+// by the session: the torrents are not visited.
+void EventManager::writeMetrics(MetricsWriter &writer) const {
+  const QBtSession *session = QBtSession::instance();
+  // Session
+  const session_status status = session->getSessionStatus();
+  writer.family("qbittorrent_download_bytes_per_second", MetricsWriter::GAUGE, "Download rate, protocol overhead included.");
+  writer.sample("qbittorrent_download_bytes_per_second", status.download_rate);
+  writer.family("qbittorrent_upload_bytes_per_second", MetricsWriter::GAUGE, "Upload rate, protocol overhead included.");
+  writer.sample("qbittorrent_upload_bytes_per_second", status.upload_rate);
+  writer.family("qbittorrent_payload_download_bytes_per_second", MetricsWriter::GAUGE, "Payload download rate.");
+  writer.sample("qbittorrent_payload_download_bytes_per_second", status.payload_download_rate);
+  writer.family("qbittorrent_payload_upload_bytes_per_second", MetricsWriter::GAUGE, "Payload upload rate.");
+  writer.sample("qbittorrent_payload_upload_bytes_per_second", status.payload_upload_rate);
+  writer.family("qbittorrent_downloaded_bytes_total", MetricsWriter::COUNTER, "Bytes downloaded this session.");
+  writer.sample("qbittorrent_downloaded_bytes_total", status.total_download);
+  writer.family("qbittorrent_uploaded_bytes_total", MetricsWriter::COUNTER, "Bytes uploaded this session.");
+  writer.sample("qbittorrent_uploaded_bytes_total", status.total_upload);
+  writer.family("qbittorrent_payload_downloaded_bytes_total", MetricsWriter::COUNTER, "Payload bytes downloaded this session.");
+  writer.sample("qbittorrent_payload_downloaded_bytes_total", status.total_payload_download);
+  writer.family("qbittorrent_payload_uploaded_bytes_total", MetricsWriter::COUNTER, "Payload bytes uploaded this session.");
+  writer.sample("qbittorrent_payload_uploaded_bytes_total", status.total_payload_upload);
+  writer.family("qbittorrent_wasted_bytes_total", MetricsWriter::COUNTER, "Bytes downloaded this session and discarded.");
+  writer.sample("qbittorrent_wasted_bytes_total", "reason", "redundant", status.total_redundant_bytes);
+  writer.sample("qbittorrent_wasted_bytes_total", "reason", "failed", status.total_failed_bytes);
+  writer.family("qbittorrent_peers", MetricsWriter::GAUGE, "Connected peers.");
+  writer.sample("qbittorrent_peers", status.num_peers);
+  writer.family("qbittorrent_unchoked_peers", MetricsWriter::GAUGE, "Unchoked peers.");
+  writer.sample("qbittorrent_unchoked_peers", status.num_unchoked);
+  writer.family("qbittorrent_dht_nodes", MetricsWriter::GAUGE, "Nodes in the DHT routing table.");
+  writer.sample("qbittorrent_dht_nodes", status.dht_nodes);
+  writer.family("qbittorrent_bandwidth_queue", MetricsWriter::GAUGE, "Peers waiting for bandwidth.");
+  writer.sample("qbittorrent_bandwidth_queue", "direction", "download", status.down_bandwidth_queue);
+  writer.sample("qbittorrent_bandwidth_queue", "direction", "upload", status.up_bandwidth_queue);
+  writer.family("qbittorrent_incoming_connections", MetricsWriter::GAUGE, "1 if incoming connections were received.");
+  writer.sample("qbittorrent_incoming_connections", status.has_incoming_connections ? 1 : 0);
+  // Disk cache
+  const cache_status cache = session->getCacheStatus();
+  writer.family("qbittorrent_cache_blocks_written_total", MetricsWriter::COUNTER, "Blocks written to the disk cache.");
+  writer.sample("qbittorrent_cache_blocks_written_total", cache.blocks_written);
+  writer.family("qbittorrent_cache_writes_total", MetricsWriter::COUNTER, "Disk writes.");
+  writer.sample("qbittorrent_cache_writes_total", cache.writes);
+  writer.family("qbittorrent_cache_blocks_read_total", MetricsWriter::COUNTER, "Blocks read.");
+  writer.sample("qbittorrent_cache_blocks_read_total", cache.blocks_read);
+  writer.family("qbittorrent_cache_blocks_read_hit_total", MetricsWriter::COUNTER, "Blocks read from the disk cache.");
+  writer.sample("qbittorrent_cache_blocks_read_hit_total", cache.blocks_read_hit);
+  writer.family("qbittorrent_cache_reads_total", MetricsWriter::COUNTER, "Disk reads.");
+  writer.sample("qbittorrent_cache_reads_total", cache.reads);
+  writer.family("qbittorrent_cache_size_blocks", MetricsWriter::GAUGE, "Blocks in the disk cache.");
+  writer.sample("qbittorrent_cache_size_blocks", "cache", "write", cache.cache_size - cache.read_cache_size);
+  writer.sample("qbittorrent_cache_size_blocks", "cache", "read", cache.read_cache_size);
+  // Alerts and resume data
+  writer.family("qbittorrent_alerts_total", MetricsWriter::COUNTER, "Alerts processed.");
+  writer.sample("qbittorrent_alerts_total", session->totalAlertCount());
+  writer.family("qbittorrent_alert_queue_depth", MetricsWriter::GAUGE, "Alerts queued when they were last read.");
+  writer.sample("qbittorrent_alert_queue_depth", session->lastAlertCount());
+  writer.family("qbittorrent_resume_data_pending", MetricsWriter::GAUGE, "Torrents whose resume data is being saved.");
+  writer.sample("qbittorrent_resume_data_pending", session->pendingResumeDataCount());
+  writer.family("qbittorrent_resume_data_failures_total", MetricsWriter::COUNTER, "Resume data saves that failed.");
+  writer.sample("qbittorrent_resume_data_failures_total", session->failedResumeDataCount());
+  // Torrents by state and by label
+  static const char *states[] = {"downloading", "checkingDL", "pausedDL", "queuedDL",
+                                 "uploading", "checkingUP", "pausedUP", "queuedUP",
+                                 "error", "unknown"};
+  const TorrentCounters *counters = session->getTorrentCounters();
+  const QHash<QString, int> state_counts = counters->stateCounts();
+  writer.family("qbittorrent_torrents", MetricsWriter::GAUGE, "Torrents in each state, the stalled ones included in downloading and uploading.");
+  for (uint i = 0; i < sizeof(states)/sizeof(states[0]); ++i)
+    writer.sample("qbittorrent_torrents", "state", states[i], state_counts.value(states[i]));
+  const QHash<QString, LabelTotals> label_totals = counters->labelTotals();
+  writer.family("qbittorrent_label_torrents", MetricsWriter::GAUGE, "Torrents with each label.");
+  QHash<QString, LabelTotals>::ConstIterator it;
+  for (it = label_totals.constBegin(); it != label_totals.constEnd(); ++it)
+    writer.sample("qbittorrent_label_torrents", "label", it.key(), it.value().torrents);
+  writer.family("qbittorrent_label_size_bytes", MetricsWriter::GAUGE, "Size of the torrents with each label.");
+  for (it = label_totals.constBegin(); it != label_totals.constEnd(); ++it)
+    writer.sample("qbittorrent_label_size_bytes", "label", it.key(), it.value().size);
+  // Trackers, from the tracker index
+  const TrackerIndex *index = session->getTrackerIndex();
+  const QStringList hosts = index->hosts();
+  writer.family("qbittorrent_tracker_torrents", MetricsWriter::GAUGE, "Torrents announcing to each tracker host.");
+  foreach (const QString &name, hosts)
+    writer.sample("qbittorrent_tracker_torrents", "tracker", name, index->host(name).torrents.size());
+  writer.family("qbittorrent_tracker_announces", MetricsWriter::GAUGE, "Announce URLs of each tracker host, by status.");
+  foreach (const QString &name, hosts) {
+    const TrackerHost host = index->host(name);
+    writer.sample("qbittorrent_tracker_announces", "tracker", name, "status", "working", host.count(TrackerInfos::WORKING));
+    writer.sample("qbittorrent_tracker_announces", "tracker", name, "status", "warning", host.count(TrackerInfos::WARNING));
+    writer.sample("qbittorrent_tracker_announces", "tracker", name, "status", "error", host.count(TrackerInfos::FAILED));
+    writer.sample("qbittorrent_tracker_announces", "tracker", name, "status", "not_contacted", host.count(TrackerInfos::NOT_CONTACTED));
+  }
 }
 
 QList<QVariantMap> EventManager::getPropTrackersInfo(QString hash) const {
@@ -455,40 +851,58 @@ void EventManager::addedTorrent(const QTorrentHandle& h)
   modifiedTorrent(h);
 }
 
+void EventManager::addedTorrents(const QList<QTorrentHandle>& handles)
+{
+  TorrentResumeBatch batch;
+  foreach (const QTorrentHandle &h, handles) {
+    modifiedTorrent(h);
+  }
+}
+
 void EventManager::deletedTorrent(QString hash)
 {
-  event_list.remove(hash);
+  if (!m_state.items.remove(hash)) return;
+  m_state.torrentRevisions.remove(hash);
+  m_state.removedTorrents << qMakePair(++m_state.revision, hash);
+  if (m_state.removedTorrents.size() > MAX_REMOVED_TORRENTS) {
+    // Clients older than the forgotten removal need a full update
+    m_state.oldestRevision = m_state.removedTorrents.takeFirst().first;
+  }
+  schedulePublish();
 }
 
 void EventManager::modifiedTorrent(const QTorrentHandle& h)
 {
   QString hash = h.hash();
-  QVariantMap event;
-  event["eta"] = QVariant(QString::fromUtf8("∞"));
+  // Raw values, each of them is read once from the session. The
+  // formatting is left to the clients.
+  TorrentListItem item;
+  item.hash = hash;
+  item.eta = -1;
   if (h.is_paused()) {
     if (h.has_error()) {
-      event["state"] = QVariant("error");
+      item.state = "error";
     } else {
       if (h.is_seed())
-        event["state"] = QVariant("pausedUP");
+        item.state = "pausedUP";
       else
-        event["state"] = QVariant("pausedDL");
+        item.state = "pausedDL";
     }
   } else {
     if (QBtSession::instance()->isQueueingEnabled() && h.is_queued()) {
       if (h.is_seed())
-        event["state"] = QVariant("queuedUP");
+        item.state = "queuedUP";
       else
-        event["state"] = QVariant("queuedDL");
+        item.state = "queuedDL";
     } else {
       switch(h.state())
       {
       case torrent_status::finished:
       case torrent_status::seeding:
         if (h.upload_payload_rate() > 0) {
-          event["state"] = QVariant("uploading");
+          item.state = "uploading";
         } else {
-          event["state"] = QVariant("stalledUP");
+          item.state = "stalledUP";
         }
         break;
       case torrent_status::allocating:
@@ -496,52 +910,42 @@ void EventManager::modifiedTorrent(const QTorrentHandle& h)
       case torrent_status::queued_for_checking:
       case torrent_status::checking_resume_data:
         if (h.is_seed()) {
-          event["state"] = QVariant("checkingUP");
+          item.state = "checkingUP";
         } else {
-          event["state"] = QVariant("checkingDL");
+          item.state = "checkingDL";
         }
         break;
       case torrent_status::downloading:
       case torrent_status::downloading_metadata:
         if (h.download_payload_rate() > 0)
-          event["state"] = QVariant("downloading");
+          item.state = "downloading";
         else
-          event["state"] = QVariant("stalledDL");
-        event["eta"] = misc::userFriendlyDuration(QBtSession::instance()->getETA(hash));
+          item.state = "stalledDL";
+        item.eta = QBtSession::instance()->getETA(hash);
         break;
       default:
         qDebug("No status, should not happen!!! status is %d", h.state());
-        event["state"] = QVariant();
       }
     }
   }
-  event["name"] = QVariant(h.name());
-  event["size"] = QVariant(misc::friendlyUnit(h.actual_size()));
-  event["progress"] = QVariant((double)h.progress());
-  event["dlspeed"] = QVariant(tr("%1/s", "e.g. 120 KiB/s").arg(misc::friendlyUnit(h.download_payload_rate())));
-  if (QBtSession::instance()->isQueueingEnabled()) {
-    if (h.queue_position() >= 0)
-      event["priority"] = QVariant(QString::number(h.queue_position()));
-    else
-      event["priority"] = "*";
-  } else {
-    event["priority"] = "*";
-  }
-  event["upspeed"] = QVariant(tr("%1/s", "e.g. 120 KiB/s").arg(misc::friendlyUnit(h.upload_payload_rate())));
-  QString seeds = QString::number(h.num_seeds());
-  if (h.num_complete() > 0)
-    seeds += " ("+QString::number(h.num_complete())+")";
-  event["num_seeds"] = QVariant(seeds);
-  QString leechs = QString::number(h.num_peers()-h.num_seeds());
-  if (h.num_incomplete() > 0)
-    leechs += " ("+QString::number(h.num_incomplete())+")";
-  event["num_leechs"] = QVariant(leechs);
-  event["seed"] = QVariant(h.is_seed());
-  qreal ratio = QBtSession::instance()->getRealRatio(hash);
-  if (ratio > 100.)
-    event["ratio"] = QString::fromUtf8("∞");
-  else
-    event["ratio"] = QVariant(QString::number(ratio, 'f', 1));
-  event["hash"] = QVariant(hash);
-  event_list[hash] = event;
+  item.name = h.name();
+  item.size = h.actual_size();
+  item.progress = h.progress();
+  item.dlspeed = h.download_payload_rate();
+  item.upspeed = h.upload_payload_rate();
+  item.priority = QBtSession::instance()->isQueueingEnabled() ? h.queue_position() : -1;
+  item.num_seeds = h.num_seeds();
+  item.num_complete = h.num_complete();
+  item.num_leechs = h.num_peers() - item.num_seeds;
+  item.num_incomplete = h.num_incomplete();
+  item.seed = h.is_seed();
+  item.ratio = QBtSession::instance()->getRealRatio(hash);
+  item.label = TorrentPersistentData::getLabel(hash);
+  // Only actual changes are sent to the clients
+  QHash<QString, TorrentListItem>::ConstIterator it = m_state.items.constFind(hash);
+  if (it != m_state.items.constEnd() && it.value() == item)
+    return;
+  m_state.items[hash] = item;
+  m_state.torrentRevisions[hash] = ++m_state.revision;
+  schedulePublish();
 }
@@ -34,35 +34,105 @@
 
 #include "qtorrenthandle.h"
 #include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
 #include <QVariant>
 
+class MetricsWriter;
+
+// Raw values of a torrent, formatting is left to the client
+struct TorrentListItem {
+  QVariantMap toMap() const;
+  bool operator==(const TorrentListItem &other) const;
+
+  QString hash;
+  QString name;
+  QString state;
+  QString label;
+  qlonglong size;
+  double progress;
+  int dlspeed;
+  int upspeed;
+  int priority; // -1 if not queued
+  int num_seeds;
+  int num_complete;
+  int num_leechs;
+  int num_incomplete;
+  bool seed;
+  qreal ratio;
+  qlonglong eta; // -1 if unknown
+};
+
+// State of the torrents as seen by the Web UI. The EventManager
+// publishes copies of it that the connection threads can read
+// without locking (the containers are implicitly shared).
+struct EventSnapshot {
+  EventSnapshot();
+  QList<QVariantMap> getEventList() const;
+  QVariantMap getUpdates(qulonglong rid) const;
+  inline bool hasUpdates(qulonglong rid) const { return rid != revision; }
+  QVariantMap getTorrentList(const QString &filter, const QString &label, const QString &name,
+                             const QString &sort, bool reverse, int offset, int limit) const;
+
+  QHash<QString, TorrentListItem> items;
+  // Every change is tagged with a new revision so that clients
+  // can ask for what changed since the last revision they saw
+  qulonglong revision;
+  QHash<QString, qulonglong> torrentRevisions;
+  QList<QPair<qulonglong, QString> > removedTorrents;
+  qulonglong oldestRevision; // Older revisions get a full update
+  QVariantMap transferInfo;
+  qulonglong transferInfoRevision;
+  QList<QPair<qulonglong, QString> > logMessages;
+};
+
 class EventManager : public QObject
 {
   Q_OBJECT
   Q_DISABLE_COPY(EventManager)
 
 private:
-  QHash<QString, QVariantMap> event_list;
+  EventSnapshot m_state;
+  EventSnapshot m_published;
+  mutable QMutex m_publishedMutex;
+  bool m_publishScheduled;
 
 protected:
   void update(QVariantMap event);
 
 public:
   EventManager(QObject *parent);
-  QList<QVariantMap> getEventList() const;
+  EventSnapshot snapshot() const;
+  static QVariantMap getTransferInfo();
+  QStringList filterTorrents(const QString &label, const QString &state, const QString &tracker) const;
   QVariantMap getPropGeneralInfo(QString hash) const;
   QList<QVariantMap> getPropTrackersInfo(QString hash) const;
+  QList<QVariantMap> getTrackerHosts() const;
+  QVariantMap getTrackerHost(const QString &name) const;
+  void writeMetrics(MetricsWriter &writer) const;
   QList<QVariantMap> getPropFilesInfo(QString hash) const;
   QVariantMap getGlobalPreferences() const;
   void setGlobalPreferences(QVariantMap m);
 
+private:
+  void schedulePublish();
+
 signals:
   void localeChanged(const QString &locale);
+  // Emitted when a new snapshot is published
+  void updated();
 
 public slots:
   void addedTorrent(const QTorrentHandle& h);
+  void addedTorrents(const QList<QTorrentHandle>& handles);
   void deletedTorrent(QString hash);
   void modifiedTorrent(const QTorrentHandle& h);
+  void updateTransferInfo();
+  void addLogMessage(const QString &msg);
+
+private slots:
+  void publish();
 };
 
 #endif
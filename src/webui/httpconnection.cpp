@@ -36,6 +36,8 @@
 #include "json.h"
 #include "qbtsession.h"
 #include "misc.h"
+#include "tracer.h"
+#include "metricswriter.h"
 #ifndef DISABLE_GUI
 #include "iconprovider.h"
 #endif
@@ -47,14 +49,23 @@
 #include <QFile>
 #include <QDebug>
 #include <QRegExp>
-#include <QTemporaryFile>
-#include <queue>
+#include <QThread>
+#include <QTimer>
 #include <vector>
+#include <limits>
+
+// Limit for the HTTP request header
+const int MAX_HEADER_SIZE = 16384;
+// Body size limit of the requests other than the torrent uploads
+const qint64 MAX_BODY_SIZE = 1024 * 1024;
+const int LONG_POLL_TIMEOUT = 30000; // 30 seconds
 
 using namespace libtorrent;
 
-HttpConnection::HttpConnection(QTcpSocket *socket, HttpServer *parent)
-  : QObject(parent), m_socket(socket), m_httpserver(parent)
+HttpConnection::HttpConnection(QTcpSocket *socket, HttpServer *httpserver, QObject *parent)
+  : QObject(parent), m_socket(socket), m_httpserver(httpserver),
+    m_readState(READ_HEADER), m_remainingLength(0), m_responseReady(false),
+    m_updatesRid(0), m_waitingForUpdates(false)
 {
   m_socket->setParent(this);
   connect(m_socket, SIGNAL(readyRead()), SLOT(read()));
@@ -62,6 +73,7 @@ HttpConnection::HttpConnection(QTcpSocket *socket, HttpServer *parent)
 }
 
 HttpConnection::~HttpConnection() {
+  stopWaitingForUpdates();
   delete m_socket;
 }
 
@@ -78,66 +90,99 @@ void HttpConnection::handleDownloadFailure(const QString& url,
 }
 
 void HttpConnection::read() {
-  static QByteArray input;
-  input.append(m_socket->readAll());
-
-  // Parse HTTP request header
-  int header_end = input.indexOf("\r\n\r\n");
-  if (header_end < 0) {
-    // Partial request waiting for the rest
+  if (m_readState == READ_DONE) {
+    // Only one request per connection
+    m_socket->readAll();
     return;
   }
-  QByteArray header = input.left(header_end);
-  m_parser.writeHeader(header);
-  if (m_parser.isError()) {
-    qWarning() << Q_FUNC_INFO << "header parsing error";
-    input.clear();
-    m_generator.setStatusLine(400, "Bad Request");
-    write();
-    return;
-  }
-
-  // Parse HTTP request message
-  if (m_parser.header().hasContentLength())  {
-    const int expected_length = m_parser.header().contentLength();
-    QByteArray message = input.mid(header_end + 4, expected_length);
-    input = input.mid(header_end + 4 + expected_length);
-
-    if (expected_length > 100000) {
-      qWarning() << "Bad request: message too long";
+  m_input.append(m_socket->readAll());
+
+  if (m_readState == READ_HEADER) {
+    // Parse HTTP request header
+    int header_end = m_input.indexOf("\r\n\r\n");
+    if (header_end < 0) {
+      if (m_input.size() > MAX_HEADER_SIZE) {
+        qWarning() << "Bad request: header too long";
+        m_readState = READ_DONE;
+        m_input.clear();
+        m_generator.setStatusLine(400, "Bad Request");
+        write();
+      }
+      // Partial request waiting for the rest
+      return;
+    }
+    m_parser.writeHeader(m_input.left(header_end));
+    m_input.remove(0, header_end + 4);
+    if (m_parser.isError()) {
+      qWarning() << Q_FUNC_INFO << "header parsing error";
+      m_readState = READ_DONE;
+      m_input.clear();
       m_generator.setStatusLine(400, "Bad Request");
-      input.clear();
       write();
       return;
     }
-
-    if (message.length() < expected_length) {
-      // Message too short, waiting for the rest
+    // Authenticated on the header, before the body is buffered
+    if (!authenticate()) {
+      m_readState = READ_DONE;
+      m_input.clear();
       return;
     }
+    m_remainingLength = 0;
+    if (m_parser.header().hasContentLength()) {
+      m_remainingLength = m_parser.header().contentLength();
+      const bool upload = (m_parser.url().split('/', QString::SkipEmptyParts) == QStringList() << "command" << "upload");
+      if (m_remainingLength > (upload ? m_httpserver->maxUploadSize() : MAX_BODY_SIZE)) {
+        qWarning() << "Bad request: message too long";
+        m_readState = READ_DONE;
+        m_input.clear();
+        m_generator.setStatusLine(413, "Request Entity Too Large");
+        write();
+        return;
+      }
+    }
+    m_readState = READ_BODY;
+  }
 
-    m_parser.writeMessage(message);
-  } else {
-    input.clear();
+  // Parse HTTP request message, multipart bodies are parsed as they arrive
+  if (m_remainingLength > 0 && !m_input.isEmpty()) {
+    if (m_input.size() > m_remainingLength)
+      m_input.truncate(static_cast<int>(m_remainingLength));
+    m_remainingLength -= m_input.size();
+    m_parser.appendMessage(m_input);
+    m_input.clear();
+  }
+  if (m_remainingLength > 0 && !m_parser.isError()) {
+    // Message too short, waiting for the rest
+    return;
   }
 
+  m_readState = READ_DONE;
+  m_parser.finishMessage();
   if (m_parser.isError()) {
     qWarning() << Q_FUNC_INFO << "message parsing error";
     m_generator.setStatusLine(400, "Bad Request");
     write();
   } else {
+    const qint64 start = Tracer::now();
     respond();
+    m_httpserver->recordRequest(Tracer::now() - start);
   }
 }
 
 void HttpConnection::write() {
+  if (QThread::currentThread() != thread()) {
+    // Prepared in the session thread, sent by respond()
+    m_responseReady = true;
+    return;
+  }
   m_socket->write(m_generator.toByteArray());
   m_socket->disconnectFromHost();
 }
 
 void HttpConnection::translateDocument(QString& data) {
-  static QRegExp regex(QString::fromUtf8("_\\(([\\w\\s?!:\\/\\(\\),%µ&\\-\\.]+)\\)"));
-  static QRegExp mnemonic("\\(?&([a-zA-Z]?\\))?");
+  // Not static, QRegExp cannot be shared between the I/O threads
+  QRegExp regex(QString::fromUtf8("_\\(([\\w\\s?!:\\/\\(\\),%µ&\\-\\.]+)\\)"));
+  QRegExp mnemonic("\\(?&([a-zA-Z]?\\))?");
   const std::string contexts[] = {"TransferListFiltersWidget", "TransferListWidget",
                                   "PropertiesWidget", "MainWindow", "HttpServer",
                                   "confirmDeletionDlg", "TrackerList", "TorrentFilesModel",
@@ -173,7 +218,24 @@ void HttpConnection::translateDocument(QString& data) {
   } while(found && i < data.size());
 }
 
-void HttpConnection::respond() {
+// Session token set after a successful Digest authentication
+QByteArray HttpConnection::sessionCookie() const {
+  const QByteArray cookies = m_parser.header().value("Cookie").toAscii();
+  int start = 0;
+  while (start < cookies.size()) {
+    int end = cookies.indexOf(';', start);
+    if (end < 0) end = cookies.size();
+    while (start < end && cookies[start] == ' ') ++start;
+    if (end - start > 4 && qstrncmp(cookies.constData() + start, "SID=", 4) == 0)
+      return cookies.mid(start + 4, end - start - 4).trimmed();
+    start = end + 1;
+  }
+  return QByteArray();
+}
+
+// Writes the error response and returns false if the client
+// is not authenticated
+bool HttpConnection::authenticate() {
   if ((m_socket->peerAddress() != QHostAddress::LocalHost
       && m_socket->peerAddress() != QHostAddress::LocalHostIPv6)
      || m_httpserver->isLocalAuthEnabled()) {
@@ -184,33 +246,50 @@ void HttpConnection::respond() {
       m_generator.setStatusLine(403, "Forbidden");
       m_generator.setMessage(tr("Your IP address has been banned after too many failed authentication attempts."));
       write();
-      return;
+      return false;
     }
-    QString auth = m_parser.header().value("Authorization");
-    if (auth.isEmpty()) {
-      // Return unauthorized header
-      qDebug("Auth is Empty...");
-      m_generator.setStatusLine(401, "Unauthorized");
-      m_generator.setValue("WWW-Authenticate",  "Digest realm=\""+QString(QBT_REALM)+"\", nonce=\""+m_httpserver->generateNonce()+"\", opaque=\""+m_httpserver->generateNonce()+"\", stale=\"false\", algorithm=\"MD5\", qop=\"auth\"");
-      write();
-      return;
-    }
-    //qDebug("Auth: %s", qPrintable(auth.split(" ").first()));
-    if (QString::compare(auth.split(" ").first(), "Digest", Qt::CaseInsensitive) != 0
-        || !m_httpserver->isAuthorized(auth.toLocal8Bit(), m_parser.header().method())) {
-      // Update failed attempt counter
-      m_httpserver->increaseNbFailedAttemptsForIp(peer_ip);
-      qDebug("client IP: %s (%d failed attempts)", qPrintable(peer_ip), nb_fail);
-      // Return unauthorized header
-      m_generator.setStatusLine(401, "Unauthorized");
-      m_generator.setValue("WWW-Authenticate",  "Digest realm=\""+QString(QBT_REALM)+"\", nonce=\""+m_httpserver->generateNonce()+"\", opaque=\""+m_httpserver->generateNonce()+"\", stale=\"false\", algorithm=\"MD5\", qop=\"auth\"");
-      write();
-      return;
+    // Clients that already authenticated send their session cookie
+    if (!m_httpserver->isValidSession(sessionCookie(), peer_ip)) {
+      QString auth = m_parser.header().value("Authorization");
+      if (auth.isEmpty()) {
+        // Return unauthorized header
+        qDebug("Auth is Empty...");
+        m_generator.setStatusLine(401, "Unauthorized");
+        m_generator.setValue("WWW-Authenticate", m_httpserver->authenticationChallenge());
+        write();
+        return false;
+      }
+      bool stale;
+      if (!m_httpserver->isAuthorized(auth.toLocal8Bit(), m_parser.header().method(), &stale)) {
+        if (!stale) {
+          // Update failed attempt counter
+          m_httpserver->increaseNbFailedAttemptsForIp(peer_ip);
+          qDebug("client IP: %s (%d failed attempts)", qPrintable(peer_ip), nb_fail);
+        }
+        // Return unauthorized header
+        m_generator.setStatusLine(401, "Unauthorized");
+        m_generator.setValue("WWW-Authenticate", m_httpserver->authenticationChallenge(stale));
+        write();
+        return false;
+      }
+      // Client successfully authenticated, reset number of failed attempts
+      m_httpserver->resetNbFailedAttemptsForIp(peer_ip);
+      QString cookie = "SID="+m_httpserver->createSession(peer_ip)+"; path=/; HttpOnly";
+      // The session id must not be sent over plain HTTP
+      if (m_httpserver->isHttps())
+        cookie += "; Secure";
+      m_generator.setValue("Set-Cookie", cookie);
     }
-    // Client successfully authenticated, reset number of failed attempts
-    m_httpserver->resetNbFailedAttemptsForIp(peer_ip);
   }
+  return true;
+}
+
+void HttpConnection::respond() {
+  QBT_TRACE_SCOPE("webui", "respond");
   QString url  = m_parser.url();
+  // Scrapers must not keep the Web UI refresh running
+  if (url.split('/', QString::SkipEmptyParts) != QStringList("metrics"))
+    m_httpserver->notifyActivity();
   // Favicon
   if (url.endsWith("favicon.ico")) {
     qDebug("Returning favicon");
@@ -237,57 +316,58 @@ void HttpConnection::respond() {
   if (list.isEmpty())
     list.append("index.html");
 
-  if (list.size() >= 2) {
-    if (list[0] == "json") {
-      if (list[1] == "events") {
-        respondJson();
-        return;
-      }
-      if (list.size() > 2) {
-        if (list[1] == "propertiesGeneral") {
-          const QString& hash = list[2];
-          respondGenPropertiesJson(hash);
-          return;
-        }
-        if (list[1] == "propertiesTrackers") {
-          const QString& hash = list[2];
-          respondTrackersPropertiesJson(hash);
-          return;
-        }
-        if (list[1] == "propertiesFiles") {
-          const QString& hash = list[2];
-          respondFilesPropertiesJson(hash);
-          return;
-        }
-      } else {
-        if (list[1] == "preferences") {
-          respondPreferencesJson();
-          return;
-        } else {
-          if (list[1] == "transferInfo") {
-            respondGlobalTransferInfoJson();
-            return;
-          }
-        }
-      }
+  if (list.size() == 2 && list[0] == "json") {
+    // Served from the published snapshot
+    if (list[1] == "events") {
+      respondJson();
+      return;
     }
-    if (list[0] == "command") {
-      const QString& command = list[1];
-      respondCommand(command);
-      m_generator.setStatusLine(200, "OK");
-      write();
+    if (list[1] == "updates") {
+      // Long polling: the answer is delayed until something changes
+      m_updatesRid = m_parser.get("rid").toULongLong();
+      if (m_httpserver->eventManager()->snapshot().hasUpdates(m_updatesRid))
+        respondUpdates();
+      else
+        waitForUpdates();
+      return;
+    }
+    if (list[1] == "transferInfo") {
+      respondGlobalTransferInfoJson();
       return;
     }
+    if (list[1] == "torrents") {
+      respondTorrentListJson();
+      return;
+    }
+    if (list[1] == "log") {
+      respondLogJson();
+      return;
+    }
+  }
+
+  bool needs_session = (list.size() >= 2 && (list[0] == "json" || list[0] == "command"))
+      || (list.size() == 1 && list[0] == "metrics");
+#ifndef DISABLE_GUI
+  // Theme icons may have to be rendered
+  needs_session = needs_session || (list[0] == "theme" && list.size() == 2);
+#endif
+  if (needs_session) {
+    m_sessionRequest = list;
+    m_responseReady = false;
+    if (!m_httpserver->runInSessionThread(this)) {
+      m_generator.setStatusLine(503, "Service Unavailable");
+    } else if (!m_responseReady) {
+      // Most commands have no answer
+      m_generator.setStatusLine(200, "OK");
+    }
+    write();
+    return;
   }
 
   // Icons from theme
   qDebug() << "list[0]" << list[0];
   if (list[0] == "theme" && list.size() == 2) {
-#ifdef DISABLE_GUI
     url = ":/Icons/oxygen/"+list[1]+".png";
-#else
-    url = IconProvider::instance()->getIconPath(list[1]);
-#endif
     qDebug() << "There icon:" << url;
   } else {
     if (list[0] == "images") {
@@ -299,13 +379,78 @@ void HttpConnection::respond() {
     }
     url = ":/" + list.join("/");
   }
-  QFile file(url);
+  respondFile(url);
+}
+
+// Runs in the main thread for the requests that need the session
+// (see HttpServer::runInSessionThread()). The response is sent by
+// the connection thread.
+void HttpConnection::respondSessionRequest() {
+  QBT_TRACE_SCOPE("webui", "respondSessionRequest");
+  const QStringList &list = m_sessionRequest;
+  if (list[0] == "metrics") {
+    respondMetrics();
+    return;
+  }
+#ifndef DISABLE_GUI
+  if (list[0] == "theme") {
+    respondFile(IconProvider::instance()->getIconPath(list[1]));
+    return;
+  }
+#endif
+  if (list[0] == "json") {
+    if (list.size() > 2) {
+      if (list[1] == "propertiesGeneral") {
+        const QString& hash = list[2];
+        respondGenPropertiesJson(hash);
+        return;
+      }
+      if (list[1] == "propertiesTrackers") {
+        const QString& hash = list[2];
+        respondTrackersPropertiesJson(hash);
+        return;
+      }
+      if (list[1] == "propertiesFiles") {
+        const QString& hash = list[2];
+        respondFilesPropertiesJson(hash);
+        return;
+      }
+    } else if (list[1] == "preferences") {
+      respondPreferencesJson();
+      return;
+    } else if (list[1] == "trackers") {
+      respondTrackerHostsJson();
+      return;
+    } else if (list[1] == "bannedPeers") {
+      respondBannedPeersJson();
+      return;
+    }
+    respondNotFound();
+    return;
+  }
+  respondCommand(list[1]);
+}
+
+// Prometheus scrape
+void HttpConnection::respondMetrics() {
+  MetricsWriter writer;
+  m_httpserver->eventManager()->writeMetrics(writer);
+  m_httpserver->writeMetrics(writer);
+  m_generator.setStatusLine(200, "OK");
+  m_generator.setContentType("text/plain; version=0.0.4");
+  m_generator.setMessage(writer.data());
+  write();
+}
+
+void HttpConnection::respondFile(const QString& path) {
+  QFile file(path);
   if (!file.open(QIODevice::ReadOnly)) {
-    qDebug("File %s was not found!", qPrintable(url));
+    qDebug("File %s was not found!", qPrintable(path));
     respondNotFound();
     return;
   }
-  QString ext = list.last();
+  const QString file_name = path.section('/', -1);
+  QString ext = file_name;
   int index = ext.lastIndexOf('.') + 1;
   if (index > 0)
     ext.remove(0, index);
@@ -315,10 +460,10 @@ void HttpConnection::respond() {
   file.close();
 
   // Translate the page
-  if (ext == "html" || (ext == "js" && !list.last().startsWith("excanvas"))) {
+  if (ext == "html" || (ext == "js" && !file_name.startsWith("excanvas"))) {
     QString dataStr = QString::fromUtf8(data.constData());
     translateDocument(dataStr);
-    if (url.endsWith("about.html")) {
+    if (path.endsWith("about.html")) {
       dataStr.replace("${VERSION}", VERSION);
     }
     data = dataStr.toUtf8();
@@ -336,7 +481,82 @@ void HttpConnection::respondNotFound() {
 
 void HttpConnection::respondJson() {
   EventManager* manager =  m_httpserver->eventManager();
-  QString string = json::toJson(manager->getEventList());
+  QString string = json::toJson(manager->snapshot().getEventList());
+  m_generator.setStatusLine(200, "OK");
+  m_generator.setContentTypeByExt("js");
+  m_generator.setMessage(string);
+  write();
+}
+
+// Keeps the connection open until something changes (long polling)
+void HttpConnection::waitForUpdates() {
+  m_waitingForUpdates = true;
+  m_httpserver->startWaitingForUpdates();
+  // EventManager lives in the main thread, this is a queued connection
+  connect(m_httpserver->eventManager(), SIGNAL(updated()), SLOT(onUpdated()));
+  QTimer::singleShot(LONG_POLL_TIMEOUT, this, SLOT(onUpdatesTimeout()));
+}
+
+void HttpConnection::stopWaitingForUpdates() {
+  if (!m_waitingForUpdates) return;
+  m_waitingForUpdates = false;
+  disconnect(m_httpserver->eventManager(), SIGNAL(updated()), this, SLOT(onUpdated()));
+  m_httpserver->stopWaitingForUpdates();
+}
+
+void HttpConnection::onUpdated() {
+  if (m_waitingForUpdates && m_httpserver->eventManager()->snapshot().hasUpdates(m_updatesRid))
+    respondUpdates();
+}
+
+void HttpConnection::onUpdatesTimeout() {
+  if (m_waitingForUpdates)
+    respondUpdates();
+}
+
+void HttpConnection::respondUpdates() {
+  stopWaitingForUpdates();
+  EventManager* manager =  m_httpserver->eventManager();
+  QString string = json::toJson(manager->snapshot().getUpdates(m_updatesRid));
+  m_generator.setStatusLine(200, "OK");
+  m_generator.setContentTypeByExt("js");
+  m_generator.setMessage(string);
+  write();
+}
+
+// Paged torrent list with raw values:
+// json/torrents?filter=downloading&label=x&name=x&sort=size&reverse=1&offset=0&limit=50
+void HttpConnection::respondTorrentListJson() {
+  const EventSnapshot snapshot = m_httpserver->eventManager()->snapshot();
+  QString string = json::toJson(snapshot.getTorrentList(m_parser.get("filter"), m_parser.get("label"),
+                                                        m_parser.get("name"), m_parser.get("sort"),
+                                                        m_parser.get("reverse") == "1" || m_parser.get("reverse") == "true",
+                                                        m_parser.get("offset").toInt(),
+                                                        m_parser.get("limit").toInt()));
+  m_generator.setStatusLine(200, "OK");
+  m_generator.setContentTypeByExt("js");
+  m_generator.setMessage(string);
+  write();
+}
+
+// Execution log records following a known one:
+// json/log?type=peers&last_id=42&limit=100
+// The log buffers are safe to read from this thread.
+void HttpConnection::respondLogJson() {
+  const LogBuffer &log = m_parser.get("type") == "peers" ? QBtSession::instance()->peerLog()
+                                                          : QBtSession::instance()->log();
+  int limit = m_parser.get("limit").toInt();
+  if (limit <= 0 || limit > MAX_LOG_RECORDS)
+    limit = MAX_LOG_RECORDS;
+  // The client asks for the records following the last one it got
+  qulonglong next_id;
+  QVariantList records;
+  foreach (const LogRecord &rec, log.records(m_parser.get("last_id").toULongLong(), limit, &next_id))
+    records << rec.toMap();
+  QVariantMap result;
+  result["records"] = records;
+  result["last_id"] = next_id;
+  QString string = json::toJson(result);
   m_generator.setStatusLine(200, "OK");
   m_generator.setContentTypeByExt("js");
   m_generator.setMessage(string);
@@ -370,6 +590,39 @@ void HttpConnection::respondFilesPropertiesJson(const QString& hash) {
   write();
 }
 
+// Manual bans, with their expiry (0: permanent)
+void HttpConnection::respondBannedPeersJson() {
+  const QHash<QString, uint> bans = QBtSession::instance()->bannedIPs();
+  QList<QVariantMap> list;
+  QHash<QString, uint>::const_iterator it;
+  for (it = bans.constBegin(); it != bans.constEnd(); ++it) {
+    QVariantMap ban;
+    ban["ip"] = it.key();
+    ban["expiry"] = it.value();
+    list << ban;
+  }
+  m_generator.setStatusLine(200, "OK");
+  m_generator.setContentTypeByExt("js");
+  m_generator.setMessage(json::toJson(list));
+  write();
+}
+
+// Tracker hosts and their announce counters (json/trackers),
+// or a single host with the hashes of its torrents (json/trackers?host=x)
+void HttpConnection::respondTrackerHostsJson() {
+  EventManager* manager =  m_httpserver->eventManager();
+  const QString host = m_parser.get("host");
+  QString string;
+  if (host.isEmpty())
+    string = json::toJson(manager->getTrackerHosts());
+  else
+    string = json::toJson(manager->getTrackerHost(host));
+  m_generator.setStatusLine(200, "OK");
+  m_generator.setContentTypeByExt("js");
+  m_generator.setMessage(string);
+  write();
+}
+
 void HttpConnection::respondPreferencesJson() {
   EventManager* manager =  m_httpserver->eventManager();
   QString string = json::toJson(manager->getGlobalPreferences());
@@ -380,11 +633,7 @@ void HttpConnection::respondPreferencesJson() {
 }
 
 void HttpConnection::respondGlobalTransferInfoJson() {
-  QVariantMap info;
-  session_status sessionStatus = QBtSession::instance()->getSessionStatus();
-  info["DlInfos"] = tr("D: %1/s - T: %2", "Download speed: x KiB/s - Transferred: x MiB").arg(misc::friendlyUnit(sessionStatus.payload_download_rate)).arg(misc::friendlyUnit(sessionStatus.total_payload_download));
-  info["UpInfos"] = tr("U: %1/s - T: %2", "Upload speed: x KiB/s - Transferred: x MiB").arg(misc::friendlyUnit(sessionStatus.payload_upload_rate)).arg(misc::friendlyUnit(sessionStatus.total_payload_upload));
-  QString string = json::toJson(info);
+  QString string = json::toJson(m_httpserver->eventManager()->snapshot().transferInfo);
   m_generator.setStatusLine(200, "OK");
   m_generator.setContentTypeByExt("js");
   m_generator.setMessage(string);
@@ -424,29 +673,16 @@ void HttpConnection::respondCommand(const QString& command) {
           announce_entry e(url.toStdString());
           h.add_tracker(e);
         }
+        QBtSession::instance()->updateTrackerIndex(h);
       }
     }
     return;
   }
   if (command == "upload") {
     qDebug() << Q_FUNC_INFO << "upload";
-    // Get a unique filename
-    QTemporaryFile *tmpfile = new QTemporaryFile (QDir::temp().absoluteFilePath("qBT-XXXXXX.torrent"));
-    tmpfile->setAutoRemove(false);
-    if (tmpfile->open()) {
-      QString filePath = tmpfile->fileName();
-      tmpfile->write(m_parser.torrent());
-      tmpfile->close();
-      // XXX: tmpfile needs to be deleted on Windows before using the file
-      // or it will complain that the file is used by another process.
-      delete tmpfile;
-      emit torrentReadyToBeDownloaded(filePath, false, QString(), false);
-      // Clean up
-      QFile::remove(filePath);
-    } else {
-      std::cerr << "I/O Error: Could not create temporary file" << std::endl;
-      delete tmpfile;
-      return;
+    // The torrents are added straight from memory
+    foreach (const QByteArray &torrent, m_parser.takeTorrents()) {
+      emit torrentDataReadyToBeDownloaded(torrent);
     }
     // Prepare response
     m_generator.setStatusLine(200, "OK");
@@ -483,6 +719,17 @@ void HttpConnection::respondCommand(const QString& command) {
     }
     return;
   }
+  if (command == "startTrace") {
+    Tracer::start();
+    return;
+  }
+  if (command == "stopTrace") {
+    m_generator.setStatusLine(200, "OK");
+    m_generator.setContentTypeByExt("js");
+    m_generator.setMessage(Tracer::stop());
+    write();
+    return;
+  }
   if (command == "getGlobalUpLimit") {
     m_generator.setStatusLine(200, "OK");
     m_generator.setContentTypeByExt("html");
@@ -580,78 +827,127 @@ void HttpConnection::respondCommand(const QString& command) {
     return;
   }
   if (command == "increasePrio") {
-    increaseTorrentsPriority(m_parser.post("hashes").split("|"));
+    QBtSession::instance()->applyToTorrents(QBtSession::BATCH_QUEUE_UP, m_parser.post("hashes").split("|"));
     return;
   }
   if (command == "decreasePrio") {
-    decreaseTorrentsPriority(m_parser.post("hashes").split("|"));
+    QBtSession::instance()->applyToTorrents(QBtSession::BATCH_QUEUE_DOWN, m_parser.post("hashes").split("|"));
     return;
   }
   if (command == "topPrio") {
-    foreach (const QString &hash, m_parser.post("hashes").split("|")) {
-      QTorrentHandle h = QBtSession::instance()->getTorrentHandle(hash);
-      if (h.is_valid()) h.queue_position_top();
-    }
+    QBtSession::instance()->applyToTorrents(QBtSession::BATCH_QUEUE_TOP, m_parser.post("hashes").split("|"));
     return;
   }
   if (command == "bottomPrio") {
-    foreach (const QString &hash, m_parser.post("hashes").split("|")) {
-      QTorrentHandle h = QBtSession::instance()->getTorrentHandle(hash);
-      if (h.is_valid()) h.queue_position_bottom();
-    }
+    QBtSession::instance()->applyToTorrents(QBtSession::BATCH_QUEUE_BOTTOM, m_parser.post("hashes").split("|"));
+    return;
+  }
+  if (command == "batch") {
+    respondBatchCommand();
     return;
   }
   if (command == "recheck") {
     QBtSession::instance()->recheckTorrent(m_parser.post("hash"));
     return;
   }
-}
-
-void HttpConnection::decreaseTorrentsPriority(const QStringList &hashes) {
-  qDebug() << Q_FUNC_INFO << hashes;
-  std::priority_queue<QPair<int, QTorrentHandle>,
-      std::vector<QPair<int, QTorrentHandle> >,
-      std::less<QPair<int, QTorrentHandle> > > torrent_queue;
-  // Sort torrents by priority
-  foreach (const QString &hash, hashes) {
-    try {
-      QTorrentHandle h = QBtSession::instance()->getTorrentHandle(hash);
-      if (!h.is_seed()) {
-        torrent_queue.push(qMakePair(h.queue_position(), h));
+  if (command == "banPeers") {
+    // One address per line, ttl in seconds (0 or none: permanent)
+    bool valid = true;
+    int ttl = 0;
+    if (!m_parser.post("ttl").isEmpty())
+      ttl = m_parser.post("ttl").toInt(&valid);
+    valid = valid && ttl >= 0;
+    if (valid) {
+      foreach (QString ip, m_parser.post("ips").split('\n', QString::SkipEmptyParts)) {
+        ip = ip.trimmed();
+        if (ip.isEmpty()) continue;
+        if (QBtSession::instance()->banIP(ip, ttl))
+          QBtSession::instance()->addConsoleMessage(tr("Manually banning peer %1...").arg(ip));
+        else
+          valid = false;
       }
-    }catch(invalid_handle&) {}
+    }
+    if (!valid) {
+      m_generator.setStatusLine(400, "Bad Request");
+      write();
+    }
+    return;
   }
-  // Decrease torrents priority (starting with the ones with lowest priority)
-  while(!torrent_queue.empty()) {
-    QTorrentHandle h = torrent_queue.top().second;
-    try {
-      h.queue_position_down();
-    } catch(invalid_handle& h) {}
-    torrent_queue.pop();
+  if (command == "unbanPeers") {
+    foreach (const QString &ip, m_parser.post("ips").split('\n', QString::SkipEmptyParts)) {
+      if (!ip.trimmed().isEmpty())
+        QBtSession::instance()->unbanIP(ip.trimmed());
+    }
+    return;
   }
 }
 
-void HttpConnection::increaseTorrentsPriority(const QStringList &hashes)
-{
-  qDebug() << Q_FUNC_INFO << hashes;
-  std::priority_queue<QPair<int, QTorrentHandle>,
-      std::vector<QPair<int, QTorrentHandle> >,
-      std::greater<QPair<int, QTorrentHandle> > > torrent_queue;
-  // Sort torrents by priority
-  foreach (const QString &hash, hashes) {
-    try {
-      QTorrentHandle h = QBtSession::instance()->getTorrentHandle(hash);
-      if (!h.is_seed()) {
-        torrent_queue.push(qMakePair(h.queue_position(), h));
-      }
-    }catch(invalid_handle&) {}
+// Applies one action to a list of torrents, given either as "|"
+// separated hashes or as label/state/tracker filters. Replies with
+// the result for each torrent.
+void HttpConnection::respondBatchCommand() {
+  static QHash<QString, QBtSession::BatchAction> actions;
+  if (actions.isEmpty()) {
+    actions.insert("pause", QBtSession::BATCH_PAUSE);
+    actions.insert("resume", QBtSession::BATCH_RESUME);
+    actions.insert("delete", QBtSession::BATCH_DELETE);
+    actions.insert("deletePerm", QBtSession::BATCH_DELETE_FILES);
+    actions.insert("recheck", QBtSession::BATCH_RECHECK);
+    actions.insert("increasePrio", QBtSession::BATCH_QUEUE_UP);
+    actions.insert("decreasePrio", QBtSession::BATCH_QUEUE_DOWN);
+    actions.insert("topPrio", QBtSession::BATCH_QUEUE_TOP);
+    actions.insert("bottomPrio", QBtSession::BATCH_QUEUE_BOTTOM);
+    actions.insert("setQueuePosition", QBtSession::BATCH_QUEUE_POSITION);
+    actions.insert("setUpLimit", QBtSession::BATCH_UPLOAD_LIMIT);
+    actions.insert("setDlLimit", QBtSession::BATCH_DOWNLOAD_LIMIT);
+  }
+  const QString action = m_parser.post("action");
+  if (!actions.contains(action)) {
+    m_generator.setStatusLine(400, "Bad Request");
+    write();
+    return;
+  }
+  const QString hash_list = m_parser.post("hashes");
+  // An empty label selects the torrents without label
+  QString label;
+  if (m_parser.hasPost("label"))
+    label = m_parser.post("label").isNull() ? QString("") : m_parser.post("label");
+  const bool has_filter = !label.isNull() || !m_parser.post("state").isEmpty()
+      || !m_parser.post("tracker").isEmpty();
+  // Without any selector, the filters would match every torrent
+  if (hash_list.isEmpty() && !has_filter) {
+    m_generator.setStatusLine(400, "Bad Request");
+    write();
+    return;
   }
-  // Increase torrents priority (starting with the ones with highest priority)
-  while(!torrent_queue.empty()) {
-    QTorrentHandle h = torrent_queue.top().second;
-    try {
-      h.queue_position_up();
-    } catch(invalid_handle& h) {}
-    torrent_queue.pop();
+  QStringList hashes;
+  if (!hash_list.isEmpty())
+    hashes = hash_list.split("|", QString::SkipEmptyParts);
+  else
+    hashes = m_httpserver->eventManager()->filterTorrents(label, m_parser.post("state"),
+                                                          m_parser.post("tracker"));
+  qlonglong value;
+  if (action == "setQueuePosition") {
+    // Position of the first torrent, starting at 1
+    value = qMax(m_parser.post("position").toInt(), 1);
+  } else {
+    value = m_parser.post("limit").toLongLong();
+    if (value <= 0) value = -1;
+    // libtorrent rate limits are ints: a larger value would wrap
+    if (value > std::numeric_limits<int>::max()) {
+      m_generator.setStatusLine(400, "Bad Request");
+      write();
+      return;
+    }
+  }
+  const QHash<QString, bool> results = QBtSession::instance()->applyToTorrents(actions.value(action), hashes, value);
+  QVariantMap reply;
+  QHash<QString, bool>::ConstIterator it;
+  for (it = results.constBegin(); it != results.constEnd(); it++) {
+    reply[it.key()] = it.value();
   }
+  m_generator.setStatusLine(200, "OK");
+  m_generator.setContentTypeByExt("js");
+  m_generator.setMessage(json::toJson(reply));
+  write();
 }
@@ -35,6 +35,7 @@
 #include "httprequestparser.h"
 #include "httpresponsegenerator.h"
 #include <QObject>
+#include <QStringList>
 
 class HttpServer;
 
@@ -48,33 +49,43 @@ class HttpConnection : public QObject
   Q_DISABLE_COPY(HttpConnection)
 
 public:
-  HttpConnection(QTcpSocket *m_socket, HttpServer *m_httpserver);
+  HttpConnection(QTcpSocket *m_socket, HttpServer *m_httpserver, QObject *parent);
   ~HttpConnection();
   void translateDocument(QString& data);
+  void respondSessionRequest();
 
 protected slots:
   void write();
   void respond();
   void respondJson();
+  void respondTorrentListJson();
+  void respondLogJson();
   void respondGenPropertiesJson(const QString& hash);
   void respondTrackersPropertiesJson(const QString& hash);
   void respondFilesPropertiesJson(const QString& hash);
   void respondPreferencesJson();
+  void respondTrackerHostsJson();
+  void respondBannedPeersJson();
   void respondGlobalTransferInfoJson();
+  void respondMetrics();
   void respondCommand(const QString& command);
   void respondNotFound();
+  void respondFile(const QString& path);
   void processDownloadedFile(const QString& url, const QString& file_path);
   void handleDownloadFailure(const QString& url, const QString& reason);
-  void decreaseTorrentsPriority(const QStringList& hashes);
-  void increaseTorrentsPriority(const QStringList& hashes);
+  void respondBatchCommand();
 
 private slots:
   void read();
+  void respondUpdates();
+  void onUpdated();
+  void onUpdatesTimeout();
 
 signals:
   void UrlReadyToBeDownloaded(const QString& url);
   void MagnetReadyToBeDownloaded(const QString& uri);
   void torrentReadyToBeDownloaded(const QString&, bool, const QString&, bool);
+  void torrentDataReadyToBeDownloaded(const QByteArray&);
   void deleteTorrent(const QString& hash, bool permanently);
   void resumeTorrent(const QString& hash);
   void pauseTorrent(const QString& hash);
@@ -84,10 +95,27 @@ signals:
   void pauseAllTorrents();
 
 private:
+  QByteArray sessionCookie() const;
+  bool authenticate();
+  void waitForUpdates();
+  void stopWaitingForUpdates();
+
+private:
+  enum ReadState { READ_HEADER, READ_BODY, READ_DONE };
+
   QTcpSocket *m_socket;
   HttpServer *m_httpserver;
   HttpRequestParser m_parser;
   HttpResponseGenerator m_generator;
+  ReadState m_readState;
+  QByteArray m_input;
+  qint64 m_remainingLength;
+  // Request run in the session thread
+  QStringList m_sessionRequest;
+  bool m_responseReady;
+  // Long polling
+  qulonglong m_updatesRid;
+  bool m_waitingForUpdates;
 };
 
 #endif
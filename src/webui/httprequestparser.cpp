@@ -33,7 +33,11 @@
 #include <QUrl>
 #include <QDebug>
 
-HttpRequestParser::HttpRequestParser(): m_error(false)
+// Limit for the headers of a single multipart part
+const int MAX_PART_HEADERS_SIZE = 8192;
+
+HttpRequestParser::HttpRequestParser(): m_error(false), m_multipart(false),
+  m_state(BOUNDARY), m_partIsFile(false)
 {
 }
 
@@ -49,10 +53,6 @@ QString HttpRequestParser::url() const {
   return m_path;
 }
 
-QByteArray HttpRequestParser::message() const {
-  return m_data;
-}
-
 QString HttpRequestParser::get(const QString& key) const {
   return m_getMap.value(key);
 }
@@ -61,13 +61,24 @@ QString HttpRequestParser::post(const QString& key) const {
   return m_postMap.value(key);
 }
 
-const QByteArray& HttpRequestParser::torrent() const {
-  return m_torrentContent;
+bool HttpRequestParser::hasPost(const QString& key) const {
+  return m_postMap.contains(key);
+}
+
+// Returns the uploaded torrent files and releases them
+QList<QByteArray> HttpRequestParser::takeTorrents() {
+  QList<QByteArray> torrents = m_torrents;
+  m_torrents.clear();
+  return torrents;
 }
 
 void HttpRequestParser::writeHeader(const QByteArray& ba) {
   // Parse header
   m_header = QHttpRequestHeader(ba);
+  if (!m_header.isValid()) {
+    m_error = true;
+    return;
+  }
   QUrl url = QUrl::fromEncoded(m_header.path().toAscii());
   m_path = url.path();
 
@@ -77,15 +88,49 @@ void HttpRequestParser::writeHeader(const QByteArray& ba) {
     QPair<QString, QString> pair = i.next();
     m_getMap[pair.first] = pair.second;
   }
+
+  // The full content type is needed for the boundary, contentType()
+  // drops the parameters
+  const QString content_type = m_header.value("Content-Type");
+  if (content_type.startsWith("multipart/form-data", Qt::CaseInsensitive)) {
+    const int index = content_type.indexOf("boundary=", 0, Qt::CaseInsensitive);
+    if (index < 0) {
+      m_error = true;
+      return;
+    }
+    QString boundary = content_type.mid(index + 9).section(';', 0, 0).trimmed();
+    if (boundary.startsWith('"') && boundary.endsWith('"'))
+      boundary = boundary.mid(1, boundary.length() - 2);
+    if (boundary.isEmpty()) {
+      m_error = true;
+      return;
+    }
+    m_multipart = true;
+    m_boundary = "--" + boundary.toAscii();
+    qDebug() << Q_FUNC_INFO << "Boundary is" << m_boundary;
+  }
 }
 
-void HttpRequestParser::writeMessage(const QByteArray& ba) {
-  // Parse message content
-  Q_ASSERT (m_header.hasContentLength());
+void HttpRequestParser::appendMessage(const QByteArray& ba) {
+  if (m_error) return;
+  m_data.append(ba);
+  if (m_multipart)
+    parseMultipart();
+}
 
-  m_data = ba;
+void HttpRequestParser::finishMessage() {
+  if (m_error) return;
   qDebug() << Q_FUNC_INFO << "m_data.size(): " << m_data.size();
 
+  if (m_multipart) {
+    if (m_state != FINISHED) {
+      qWarning() << Q_FUNC_INFO << "truncated multipart message";
+      m_error = true;
+    }
+    m_data.clear();
+    return;
+  }
+
   // Parse POST data
   if (m_header.contentType() == "application/x-www-form-urlencoded") {
     QUrl url;
@@ -95,12 +140,13 @@ void HttpRequestParser::writeMessage(const QByteArray& ba) {
       QPair<QString, QString> pair = i.next();
       m_postMap[pair.first] = pair.second;
     }
-    return;
   }
+  m_data.clear();
+}
 
-  // Parse multipart/form data (torrent file)
-  /**
-        m_data has the following format (if boundary is "cH2ae0GI3KM7GI3Ij5ae0ei4Ij5Ij5")
+// Parse multipart/form data (torrent files)
+/**
+      m_data has the following format (if boundary is "cH2ae0GI3KM7GI3Ij5ae0ei4Ij5Ij5")
 
 --cH2ae0GI3KM7GI3Ij5ae0ei4Ij5Ij5
 Content-Disposition: form-data; name=\"Filename\"
@@ -116,24 +162,108 @@ Content-Disposition: form-data; name=\"Upload\"
 
 Submit Query
 --cH2ae0GI3KM7GI3Ij5ae0ei4Ij5Ij5--
+
+      Only the data that could not be parsed yet is kept in m_data.
 **/
-  if (m_header.contentType().startsWith("multipart/form-data")) {
-    qDebug() << Q_FUNC_INFO << "header is: " << m_header.toString();
-
-    int filename_index = m_data.indexOf("filename=");
-    if (filename_index >= 0) {
-      QByteArray boundary = m_data.left(m_data.indexOf("\r\n"));
-      qDebug() << "Boundary is " << boundary << "\n\n";
-      qDebug() << "Before binary data: " << m_data.left(m_data.indexOf("\r\n\r\n", filename_index+9)) << "\n\n";
-      m_torrentContent = m_data.mid(m_data.indexOf("\r\n\r\n", filename_index+9) + 4);
-      int binaryend_index = m_torrentContent.indexOf("\r\n"+boundary);
-      if (binaryend_index >= 0) {
-        qDebug() << "found end boundary :)";
-        m_torrentContent = m_torrentContent.left(binaryend_index);
+void HttpRequestParser::parseMultipart() {
+  while (!m_error) {
+    switch(m_state) {
+    case BOUNDARY: {
+      const int index = m_data.indexOf(m_boundary);
+      if (index < 0) {
+        // Skip the preamble but keep what could be the start of the boundary
+        if (m_data.size() > m_boundary.size())
+          m_data.remove(0, m_data.size() - m_boundary.size());
+        return;
       }
-      qDebug() << Q_FUNC_INFO << "m_torrentContent.size(): " << m_torrentContent.size()<< "\n\n";
-    } else {
-      m_error = true;
+      const int end = index + m_boundary.size();
+      if (m_data.size() < end + 2)
+        return; // Wait for the rest
+      const QByteArray suffix = m_data.mid(end, 2);
+      if (suffix == "--") {
+        m_state = FINISHED;
+        m_data.clear();
+        return;
+      }
+      if (suffix != "\r\n") {
+        m_error = true;
+        return;
+      }
+      m_data.remove(0, end + 2);
+      m_state = PART_HEADERS;
+      break;
+    }
+    case PART_HEADERS: {
+      const int index = m_data.indexOf("\r\n\r\n");
+      if (index < 0) {
+        if (m_data.size() > MAX_PART_HEADERS_SIZE)
+          m_error = true;
+        return;
+      }
+      parsePartHeaders(m_data.left(index));
+      m_data.remove(0, index + 4);
+      m_state = PART_BODY;
+      break;
+    }
+    case PART_BODY: {
+      const QByteArray delimiter = "\r\n" + m_boundary;
+      const int index = m_data.indexOf(delimiter);
+      if (index < 0) {
+        // Move what cannot belong to the delimiter to the part
+        const int available = m_data.size() - delimiter.size() + 1;
+        if (available > 0) {
+          m_partData.append(m_data.constData(), available);
+          m_data.remove(0, available);
+        }
+        return;
+      }
+      m_partData.append(m_data.constData(), index);
+      m_data.remove(0, index + 2);
+      finishPart();
+      m_state = BOUNDARY;
+      break;
+    }
+    case FINISHED:
+      // Epilogue is ignored
+      m_data.clear();
+      return;
+    }
+  }
+}
+
+void HttpRequestParser::parsePartHeaders(const QByteArray& headers) {
+  m_partName.clear();
+  m_partIsFile = false;
+  m_partData.clear();
+  foreach (const QByteArray &line, headers.split('\n')) {
+    const QString header = QString::fromUtf8(line).trimmed();
+    if (!header.startsWith("Content-Disposition:", Qt::CaseInsensitive))
+      continue;
+    foreach (const QString &param, header.split(';')) {
+      const QString p = param.trimmed();
+      const int eq = p.indexOf('=');
+      if (eq < 0) continue;
+      const QString key = p.left(eq).toLower();
+      QString value = p.mid(eq + 1);
+      if (value.startsWith('"') && value.endsWith('"') && value.length() >= 2)
+        value = value.mid(1, value.length() - 2);
+      if (key == "name")
+        m_partName = value;
+      else if (key == "filename")
+        m_partIsFile = true;
+    }
+  }
+}
+
+void HttpRequestParser::finishPart() {
+  if (m_partIsFile) {
+    // Empty file inputs are sent without data
+    if (!m_partData.isEmpty()) {
+      qDebug() << Q_FUNC_INFO << "uploaded file size:" << m_partData.size();
+      m_torrents << m_partData;
     }
+  } else if (!m_partName.isEmpty()) {
+    m_postMap[m_partName] = QString::fromUtf8(m_partData);
   }
+  m_partData.clear();
 }
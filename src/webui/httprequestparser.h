@@ -33,7 +33,11 @@
 #define HTTPREQUESTPARSER_H
 
 #include<QHttpRequestHeader>
+#include<QList>
 
+// Parses HTTP requests. The message body can be given in several
+// chunks: multipart/form-data bodies are parsed as they arrive and
+// only the uploaded files are kept in memory.
 class HttpRequestParser {
 
 public:
@@ -41,13 +45,22 @@ public:
   ~HttpRequestParser();
   bool isError() const;
   QString url() const;
-  QByteArray message() const;
   QString get(const QString& key) const;
   QString post(const QString& key) const;
-  const QByteArray& torrent() const;
+  bool hasPost(const QString& key) const;
+  QList<QByteArray> takeTorrents();
   void writeHeader(const QByteArray& ba);
-  void writeMessage(const QByteArray& ba);
+  void appendMessage(const QByteArray& ba);
+  void finishMessage();
   inline QHttpRequestHeader& header() { return m_header; }
+  inline const QHttpRequestHeader& header() const { return m_header; }
+
+private:
+  enum MultipartState { BOUNDARY, PART_HEADERS, PART_BODY, FINISHED };
+
+  void parseMultipart();
+  void parsePartHeaders(const QByteArray& headers);
+  void finishPart();
 
 private:
   QHttpRequestHeader m_header;
@@ -56,7 +69,14 @@ private:
   QString m_path;
   QMap<QString, QString> m_postMap;
   QMap<QString, QString> m_getMap;
-  QByteArray m_torrentContent;
+  QList<QByteArray> m_torrents;
+  // Multipart parsing
+  bool m_multipart;
+  QByteArray m_boundary;
+  MultipartState m_state;
+  QString m_partName;
+  bool m_partIsFile;
+  QByteArray m_partData;
 };
 
 #endif
@@ -33,10 +33,18 @@
 #include "httpconnection.h"
 #include "eventmanager.h"
 #include "qbtsession.h"
+#include "torrentpersistentdata.h"
+#include "metricswriter.h"
+#include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QTime>
 #include <QRegExp>
 #include <QTimer>
+#include <QThread>
+#include <QFile>
+#include <QUuid>
+#include <algorithm>
+#include <vector>
 
 #ifndef QT_NO_OPENSSL
 #include <QSslSocket>
@@ -46,57 +54,127 @@
 
 using namespace libtorrent;
 
-const int BAN_TIME = 3600000; // 1 hour
+const int BAN_TIME = 3600; // 1 hour
+const int IDLE_TIMEOUT = 10000; // 10 seconds
+const int MAX_IO_THREADS = 4;
+const uint NONCE_TIMEOUT = 3600; // 1 hour
+const uint SESSION_TIMEOUT = 3600; // 1 hour, from the last request
+const int MAX_NONCES = 1000;
+const int MAX_SESSIONS = 1000;
+const quint32 NC_WINDOW = 64;
+// Upper bounds of the request latency buckets, in microseconds
+const qint64 REQUEST_BUCKETS[] = {1000, 5000, 25000, 100000, 500000, 2500000};
+const int NB_REQUEST_BUCKETS = sizeof(REQUEST_BUCKETS)/sizeof(REQUEST_BUCKETS[0]);
+
+// Unpredictable token used for the nonces and the session ids
+static QByteArray randomToken() {
+  static QAtomicInt counter;
+  QCryptographicHash sha1(QCryptographicHash::Sha1);
+  QFile urandom("/dev/urandom");
+  if (urandom.open(QIODevice::ReadOnly))
+    sha1.addData(urandom.read(16));
+  sha1.addData(QUuid::createUuid().toString().toAscii());
+  sha1.addData(QByteArray::number(counter.fetchAndAddRelaxed(1)));
+  sha1.addData(QDateTime::currentDateTime().toString("yyyyMMddhhmmsszzz").toAscii());
+  return sha1.result().toHex();
+}
 
-class UnbanTimer: public QTimer {
-public:
-  UnbanTimer(const QString& peer_ip, QObject *parent): QTimer(parent),
-    m_peerIp(peer_ip) {
-    setSingleShot(true);
-    setInterval(BAN_TIME);
+// Removes the expired entries, and the ones closest to their
+// expiration if there are still too many: the timeouts are the same
+// for all the entries, so these are the oldest ones
+template <typename T>
+static void purgeExpired(QHash<QByteArray, T> &table, uint now, int max_size) {
+  typename QHash<QByteArray, T>::Iterator it = table.begin();
+  while (it != table.end()) {
+    if (it.value().expiration <= now)
+      it = table.erase(it);
+    else
+      ++it;
   }
+  const int excess = table.size() - max_size + 1;
+  if (excess <= 0)
+    return;
+  std::vector<uint> expirations;
+  expirations.reserve(table.size());
+  for (it = table.begin(); it != table.end(); ++it)
+    expirations.push_back(it.value().expiration);
+  std::nth_element(expirations.begin(), expirations.begin() + excess - 1, expirations.end());
+  const uint cutoff = expirations[excess - 1];
+  // Entries expiring at the cutoff are only removed as needed
+  for (it = table.begin(); it != table.end(); ) {
+    if (it.value().expiration < cutoff)
+      it = table.erase(it);
+    else
+      ++it;
+  }
+  for (it = table.begin(); it != table.end() && table.size() >= max_size; ) {
+    if (it.value().expiration == cutoff)
+      it = table.erase(it);
+    else
+      ++it;
+  }
+}
 
-  inline QString peerIp() const { return m_peerIp; }
-
-private:
-  QString m_peerIp;
-};
-
-void HttpServer::UnbanTimerEvent() {
-  UnbanTimer* ubantimer = static_cast<UnbanTimer*>(sender());
-  qDebug("Ban period has expired for %s", qPrintable(ubantimer->peerIp()));
-  m_clientFailedAttempts.remove(ubantimer->peerIp());
-  ubantimer->deleteLater();
+void HttpWorker::handleConnection(int socketDescriptor) {
+  QTcpSocket *socket = m_server->createSocket(socketDescriptor);
+  if (!socket) return;
+  HttpConnection *connection = new HttpConnection(socket, m_server, this);
+  // Commands are run in the main thread, these are direct connections
+  connect(connection, SIGNAL(UrlReadyToBeDownloaded(QString)), QBtSession::instance(), SLOT(downloadUrlAndSkipDialog(QString)));
+  connect(connection, SIGNAL(MagnetReadyToBeDownloaded(QString)), QBtSession::instance(), SLOT(addMagnetSkipAddDlg(QString)));
+  connect(connection, SIGNAL(torrentReadyToBeDownloaded(QString, bool, QString, bool)), QBtSession::instance(), SLOT(addTorrent(QString, bool, QString, bool)));
+  connect(connection, SIGNAL(torrentDataReadyToBeDownloaded(QByteArray)), QBtSession::instance(), SLOT(addTorrentFromData(QByteArray)));
+  connect(connection, SIGNAL(deleteTorrent(QString, bool)), QBtSession::instance(), SLOT(deleteTorrent(QString, bool)));
+  connect(connection, SIGNAL(pauseTorrent(QString)), QBtSession::instance(), SLOT(pauseTorrent(QString)));
+  connect(connection, SIGNAL(resumeTorrent(QString)), QBtSession::instance(), SLOT(resumeTorrent(QString)));
+  connect(connection, SIGNAL(pauseAllTorrents()), QBtSession::instance(), SLOT(pauseAllTorrents()));
+  connect(connection, SIGNAL(resumeAllTorrents()), QBtSession::instance(), SLOT(resumeAllTorrents()));
 }
 
 int HttpServer::NbFailedAttemptsForIp(const QString& ip) const {
+  QMutexLocker locker(&m_mutex);
+  if (m_bannedUntil.contains(ip)) {
+    if (m_bannedUntil.value(ip) > QDateTime::currentDateTime())
+      return MAX_AUTH_FAILED_ATTEMPTS;
+    // Ban period has expired, the entries are removed on success
+    return 0;
+  }
   return m_clientFailedAttempts.value(ip, 0);
 }
 
 void HttpServer::increaseNbFailedAttemptsForIp(const QString& ip) {
+  QMutexLocker locker(&m_mutex);
+  if (m_bannedUntil.contains(ip) && m_bannedUntil.value(ip) <= QDateTime::currentDateTime()) {
+    qDebug("Ban period has expired for %s", qPrintable(ip));
+    m_bannedUntil.remove(ip);
+    m_clientFailedAttempts.remove(ip);
+  }
   const int nb_fail = m_clientFailedAttempts.value(ip, 0) + 1;
   m_clientFailedAttempts.insert(ip, nb_fail);
   if (nb_fail == MAX_AUTH_FAILED_ATTEMPTS) {
     // Max number of failed attempts reached
     // Start ban period
-    UnbanTimer* ubantimer = new UnbanTimer(ip, this);
-    connect(ubantimer, SIGNAL(timeout()), SLOT(UnbanTimerEvent()));
-    ubantimer->start();
+    m_bannedUntil.insert(ip, QDateTime::currentDateTime().addSecs(BAN_TIME));
   }
 }
 
 void HttpServer::resetNbFailedAttemptsForIp(const QString& ip) {
+  QMutexLocker locker(&m_mutex);
   m_clientFailedAttempts.remove(ip);
+  m_bannedUntil.remove(ip);
 }
 
 HttpServer::HttpServer(int msec, QObject* parent) : QTcpServer(parent),
-  m_eventManager(new EventManager(this)) {
+  m_eventManager(new EventManager(this)), m_waitingConnections(0),
+  m_shuttingDown(0), m_nextWorker(0), m_opaque(randomToken()),
+  m_requestBuckets(NB_REQUEST_BUCKETS, 0), m_requestCount(0), m_requestTotalTime(0) {
 
   const Preferences pref;
 
   m_username = pref.getWebUiUsername().toLocal8Bit();
   m_passwordSha1 = pref.getWebUiPassword().toLocal8Bit();
   m_localAuthEnabled = pref.isWebUiLocalAuthEnabled();
+  setMaxUploadSize(pref.getWebUiMaxUploadSize());
   m_needsTranslation = !Preferences().getLocale().startsWith("en");
   connect(m_eventManager, SIGNAL(localeChanged(QString)), SLOT(onLocaleChanged(QString)));
 
@@ -110,6 +188,7 @@ HttpServer::HttpServer(int msec, QObject* parent) : QTcpServer(parent),
 #endif
 
   // Add torrents
+  TorrentResumeBatch batch;
   std::vector<torrent_handle> torrents = QBtSession::instance()->getTorrents();
   std::vector<torrent_handle>::iterator torrentIT;
   for (torrentIT = torrents.begin(); torrentIT != torrents.end(); torrentIT++) {
@@ -120,11 +199,29 @@ HttpServer::HttpServer(int msec, QObject* parent) : QTcpServer(parent),
 
   //connect QBtSession::instance() to manager
   connect(QBtSession::instance(), SIGNAL(addedTorrent(QTorrentHandle)), m_eventManager, SLOT(addedTorrent(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(addedTorrents(QList<QTorrentHandle>)), m_eventManager, SLOT(addedTorrents(QList<QTorrentHandle>)));
   connect(QBtSession::instance(), SIGNAL(deletedTorrent(QString)), m_eventManager, SLOT(deletedTorrent(QString)));
-
-  //set timer
+  connect(QBtSession::instance(), SIGNAL(pausedTorrent(QTorrentHandle)), m_eventManager, SLOT(modifiedTorrent(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(resumedTorrent(QTorrentHandle)), m_eventManager, SLOT(modifiedTorrent(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(finishedTorrent(QTorrentHandle)), m_eventManager, SLOT(modifiedTorrent(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(metadataReceived(QTorrentHandle)), m_eventManager, SLOT(modifiedTorrent(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(torrentFinishedChecking(QTorrentHandle)), m_eventManager, SLOT(modifiedTorrent(QTorrentHandle)));
+  connect(QBtSession::instance(), SIGNAL(newConsoleMessage(QString)), m_eventManager, SLOT(addLogMessage(QString)));
+
+  // The timer only runs while clients are connected
   connect(&m_timer, SIGNAL(timeout()), SLOT(onTimer()));
-  m_timer.start(msec);
+  m_timer.setInterval(msec);
+
+  // I/O threads
+  const int nb_threads = qBound(1, QThread::idealThreadCount(), MAX_IO_THREADS);
+  for (int i = 0; i < nb_threads; ++i) {
+    QThread *thread = new QThread(this);
+    HttpWorker *worker = new HttpWorker(this);
+    worker->moveToThread(thread);
+    thread->start();
+    m_threads << thread;
+    m_workers << worker;
+  }
 
   // Additional translations for Web UI
   QString a = tr("File");
@@ -158,33 +255,66 @@ HttpServer::HttpServer(int msec, QObject* parent) : QTcpServer(parent),
 }
 
 HttpServer::~HttpServer() {
+  // Stop accepting session requests, then wait for the threads. The
+  // requests that are already waiting for the main thread are run.
+  m_shuttingDown = 1;
+  foreach (QThread *thread, m_threads) {
+    thread->quit();
+  }
+  foreach (QThread *thread, m_threads) {
+    while (!thread->wait(100)) {
+      QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
+  }
+  qDeleteAll(m_workers);
   delete m_eventManager;
 }
 
 #ifndef QT_NO_OPENSSL
 void HttpServer::enableHttps(const QSslCertificate &certificate,
                              const QSslKey &key) {
+  QMutexLocker locker(&m_mutex);
   m_certificate = certificate;
   m_key = key;
   m_https = true;
 }
 
 void HttpServer::disableHttps() {
+  QMutexLocker locker(&m_mutex);
   m_https = false;
   m_certificate.clear();
   m_key.clear();
 }
 #endif
 
+bool HttpServer::isHttps() const {
+#ifndef QT_NO_OPENSSL
+  QMutexLocker locker(&m_mutex);
+  return m_https;
+#else
+  return false;
+#endif
+}
+
+// The connection is handed over to the I/O threads in turn
 void HttpServer::incomingConnection(int socketDescriptor)
 {
+  QMetaObject::invokeMethod(m_workers.at(m_nextWorker), "handleConnection",
+                            Qt::QueuedConnection, Q_ARG(int, socketDescriptor));
+  m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+}
+
+// Called from the I/O threads, the socket belongs to the calling thread
+QTcpSocket* HttpServer::createSocket(int socketDescriptor)
+{
+  QMutexLocker locker(&m_mutex);
   QTcpSocket *serverSocket;
 #ifndef QT_NO_OPENSSL
   if (m_https)
-    serverSocket = new QSslSocket(this);
+    serverSocket = new QSslSocket;
   else
 #endif
-    serverSocket = new QTcpSocket(this);
+    serverSocket = new QTcpSocket;
   if (serverSocket->setSocketDescriptor(socketDescriptor)) {
 #ifndef QT_NO_OPENSSL
     if (m_https) {
@@ -194,27 +324,21 @@ void HttpServer::incomingConnection(int socketDescriptor)
       static_cast<QSslSocket*>(serverSocket)->startServerEncryption();
     }
 #endif
-    handleNewConnection(serverSocket);
-  } else {
-    serverSocket->deleteLater();
+    return serverSocket;
   }
-}
-
-void HttpServer::handleNewConnection(QTcpSocket *socket)
-{
-  HttpConnection *connection = new HttpConnection(socket, this);
-  //connect connection to QBtSession::instance()
-  connect(connection, SIGNAL(UrlReadyToBeDownloaded(QString)), QBtSession::instance(), SLOT(downloadUrlAndSkipDialog(QString)));
-  connect(connection, SIGNAL(MagnetReadyToBeDownloaded(QString)), QBtSession::instance(), SLOT(addMagnetSkipAddDlg(QString)));
-  connect(connection, SIGNAL(torrentReadyToBeDownloaded(QString, bool, QString, bool)), QBtSession::instance(), SLOT(addTorrent(QString, bool, QString, bool)));
-  connect(connection, SIGNAL(deleteTorrent(QString, bool)), QBtSession::instance(), SLOT(deleteTorrent(QString, bool)));
-  connect(connection, SIGNAL(pauseTorrent(QString)), QBtSession::instance(), SLOT(pauseTorrent(QString)));
-  connect(connection, SIGNAL(resumeTorrent(QString)), QBtSession::instance(), SLOT(resumeTorrent(QString)));
-  connect(connection, SIGNAL(pauseAllTorrents()), QBtSession::instance(), SLOT(pauseAllTorrents()));
-  connect(connection, SIGNAL(resumeAllTorrents()), QBtSession::instance(), SLOT(resumeAllTorrents()));
+  delete serverSocket;
+  return 0;
 }
 
 void HttpServer::onTimer() {
+  if (m_waitingConnections == 0 && m_lastActivity.elapsed() > IDLE_TIMEOUT) {
+    // Nobody is watching, stop refreshing the torrents
+    qDebug("Web UI is idle, stopping the refresh timer");
+    m_timer.stop();
+    return;
+  }
+  // The labels are read from the resume data
+  TorrentResumeBatch batch;
   std::vector<torrent_handle> torrents = QBtSession::instance()->getTorrents();
   std::vector<torrent_handle>::iterator torrentIT;
   for (torrentIT = torrents.begin(); torrentIT != torrents.end(); torrentIT++) {
@@ -222,110 +346,313 @@ void HttpServer::onTimer() {
     if (h.is_valid())
       m_eventManager->modifiedTorrent(h);
   }
+  m_eventManager->updateTransferInfo();
+}
+
+// Called for each client request, from the I/O threads
+void HttpServer::notifyActivity() {
+  QMetaObject::invokeMethod(this, "onActivity", Qt::QueuedConnection);
+}
+
+// (Re)starts the refresh timer
+void HttpServer::onActivity() {
+  m_lastActivity.start();
+  if (!m_timer.isActive()) {
+    m_timer.start();
+    onTimer();
+  }
+}
+
+// Long polling connections keep the refresh timer running
+void HttpServer::startWaitingForUpdates() {
+  m_waitingConnections.ref();
+  notifyActivity();
+}
+
+void HttpServer::stopWaitingForUpdates() {
+  m_waitingConnections.deref();
+}
+
+void HttpServer::recordRequest(qint64 usecs) {
+  QMutexLocker locker(&m_statsMutex);
+  for (int i = 0; i < NB_REQUEST_BUCKETS; ++i) {
+    if (usecs <= REQUEST_BUCKETS[i]) {
+      ++m_requestBuckets[i];
+      break;
+    }
+  }
+  ++m_requestCount;
+  m_requestTotalTime += usecs;
+}
+
+// The buckets are cumulative in the Prometheus format
+void HttpServer::writeMetrics(MetricsWriter &writer) const {
+  QMutexLocker locker(&m_statsMutex);
+  writer.family("qbittorrent_webui_request_duration_seconds", MetricsWriter::HISTOGRAM,
+                "Time spent answering the Web UI requests, long polling excluded.");
+  qulonglong count = 0;
+  for (int i = 0; i < NB_REQUEST_BUCKETS; ++i) {
+    count += m_requestBuckets[i];
+    writer.sample("qbittorrent_webui_request_duration_seconds_bucket", "le",
+                  QString::number(REQUEST_BUCKETS[i] / 1e6), count);
+  }
+  writer.sample("qbittorrent_webui_request_duration_seconds_bucket", "le", "+Inf", m_requestCount);
+  writer.sample("qbittorrent_webui_request_duration_seconds_sum", m_requestTotalTime / 1e6);
+  writer.sample("qbittorrent_webui_request_duration_seconds_count", m_requestCount);
+}
+
+// Runs the part of the request that needs the session in the main
+// thread, the calling I/O thread waits for it
+bool HttpServer::runInSessionThread(HttpConnection *connection) {
+  if (m_shuttingDown != 0) return false;
+  return QMetaObject::invokeMethod(this, "processSessionRequest", Qt::BlockingQueuedConnection,
+                                   Q_ARG(QObject*, connection));
+}
+
+void HttpServer::processSessionRequest(QObject *connection) {
+  static_cast<HttpConnection*>(connection)->respondSessionRequest();
+}
+
+// Creates a nonce for a Digest challenge, valid for NONCE_TIMEOUT
+QString HttpServer::generateNonce() {
+  const QByteArray nonce = randomToken();
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  QMutexLocker locker(&m_mutex);
+  if (m_nonces.size() >= MAX_NONCES)
+    purgeExpired(m_nonces, now, MAX_NONCES);
+  NonceInfo info;
+  info.expiration = now + NONCE_TIMEOUT;
+  info.maxNc = 0;
+  info.ncWindow = 0;
+  m_nonces.insert(nonce, info);
+  return nonce;
 }
 
-QString HttpServer::generateNonce() const {
-  QCryptographicHash md5(QCryptographicHash::Md5);
-  md5.addData(QTime::currentTime().toString("hhmmsszzz").toLocal8Bit());
-  md5.addData(":");
-  md5.addData(QBT_REALM);
-  return md5.result().toHex();
+QString HttpServer::authenticationChallenge(bool stale) {
+  return "Digest realm=\""+QString(QBT_REALM)+"\", nonce=\""+generateNonce()+"\", opaque=\""+m_opaque
+      +"\", stale=\""+(stale ? "true" : "false")+"\", algorithm=\"MD5\", qop=\"auth\"";
 }
 
 void HttpServer::setAuthorization(const QString& username,
                                   const QString& password_sha1) {
-  m_username = username.toLocal8Bit();
-  m_passwordSha1 = password_sha1.toLocal8Bit();
+  QMutexLocker locker(&m_mutex);
+  const QByteArray new_username = username.toLocal8Bit();
+  const QByteArray new_password = password_sha1.toLocal8Bit();
+  if (new_username == m_username && new_password == m_passwordSha1)
+    return;
+  m_username = new_username;
+  m_passwordSha1 = new_password;
+  // Clients must authenticate with the new credentials
+  m_nonces.clear();
+  m_sessions.clear();
 }
 
-// Parse HTTP AUTH string
-// http://tools.ietf.org/html/rfc2617
-bool HttpServer::isAuthorized(const QByteArray& auth,
-                              const QString& method) const {
-  //qDebug("AUTH string is %s", auth.data());
-  // Get user name
-  QRegExp regex_user(".*username=\"([^\"]+)\".*"); // Must be a quoted string
-  if (regex_user.indexIn(auth) < 0) return false;
-  QString prop_user = regex_user.cap(1);
-  //qDebug("AUTH: Proposed username is %s, real username is %s", prop_user.toLocal8Bit().data(), username.data());
-  if (prop_user != m_username) {
-    // User name is invalid, we can reject already
-    qDebug("AUTH-PROB: Username is invalid");
+// Creates a session token for an authenticated client, sent back as
+// a cookie so that the following requests skip the Digest checks
+QByteArray HttpServer::createSession(const QString& ip) {
+  const QByteArray sid = randomToken();
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  QMutexLocker locker(&m_mutex);
+  if (m_sessions.size() >= MAX_SESSIONS)
+    purgeExpired(m_sessions, now, MAX_SESSIONS);
+  SessionInfo info;
+  info.ip = ip;
+  info.expiration = now + SESSION_TIMEOUT;
+  m_sessions.insert(sid, info);
+  return sid;
+}
+
+// Sessions are bound to the client IP and expire when unused
+bool HttpServer::isValidSession(const QByteArray& sid, const QString& ip) {
+  if (sid.isEmpty()) return false;
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  QMutexLocker locker(&m_mutex);
+  QHash<QByteArray, SessionInfo>::Iterator it = m_sessions.find(sid);
+  if (it == m_sessions.end()) return false;
+  if (it.value().expiration <= now) {
+    m_sessions.erase(it);
     return false;
   }
-  // Get realm
-  QRegExp regex_realm(".*realm=\"([^\"]+)\".*"); // Must be a quoted string
-  if (regex_realm.indexIn(auth) < 0) {
-    qDebug("AUTH-PROB: Missing realm");
+  if (it.value().ip != ip) return false;
+  it.value().expiration = now + SESSION_TIMEOUT;
+  return true;
+}
+
+struct DigestParams {
+  QByteArray username;
+  QByteArray realm;
+  QByteArray nonce;
+  QByteArray uri;
+  QByteArray response;
+  QByteArray qop;
+  QByteArray nc;
+  QByteArray cnonce;
+};
+
+static inline bool isParam(const char *name, int length, const char *param) {
+  return length == int(qstrlen(param)) && qstrnicmp(name, param, length) == 0;
+}
+
+// Splits a Digest Authorization header in one pass:
+//   Digest username="admin", realm="...", nc=00000001, ...
+// Values are either quoted strings (with \ escapes) or tokens.
+static bool parseDigestHeader(const QByteArray& auth, DigestParams& params) {
+  const char *data = auth.constData();
+  const int size = auth.size();
+  int i = 0;
+  while (i < size && data[i] == ' ') ++i;
+  if (size - i < 6 || qstrnicmp(data + i, "Digest", 6) != 0)
     return false;
+  i += 6;
+  if (i < size && data[i] != ' ')
+    return false;
+  while (i < size) {
+    // Separators
+    while (i < size && (data[i] == ' ' || data[i] == '\t' || data[i] == ','))
+      ++i;
+    if (i >= size) break;
+    // Parameter name
+    const int name_start = i;
+    while (i < size && data[i] != '=' && data[i] != ' ' && data[i] != ',')
+      ++i;
+    const int name_length = i - name_start;
+    while (i < size && data[i] == ' ') ++i;
+    if (i >= size || data[i] != '=')
+      return false;
+    ++i;
+    while (i < size && data[i] == ' ') ++i;
+    // Value
+    QByteArray value;
+    if (i < size && data[i] == '"') {
+      ++i;
+      const int value_start = i;
+      bool escaped = false;
+      while (i < size && data[i] != '"') {
+        if (data[i] == '\\') {
+          escaped = true;
+          ++i;
+        }
+        ++i;
+      }
+      if (i >= size)
+        return false; // Unterminated string
+      value = QByteArray(data + value_start, i - value_start);
+      if (escaped) {
+        int w = 0;
+        for (int r = 0; r < value.size(); ++r) {
+          if (value[r] == '\\' && r + 1 < value.size()) ++r;
+          value[w++] = value[r];
+        }
+        value.truncate(w);
+      }
+      ++i;
+    } else {
+      const int value_start = i;
+      while (i < size && data[i] != ',' && data[i] != ' ')
+        ++i;
+      value = QByteArray(data + value_start, i - value_start);
+    }
+    const char *name = data + name_start;
+    if (isParam(name, name_length, "username"))
+      params.username = value;
+    else if (isParam(name, name_length, "realm"))
+      params.realm = value;
+    else if (isParam(name, name_length, "nonce"))
+      params.nonce = value;
+    else if (isParam(name, name_length, "uri"))
+      params.uri = value;
+    else if (isParam(name, name_length, "response"))
+      params.response = value;
+    else if (isParam(name, name_length, "qop"))
+      params.qop = value;
+    else if (isParam(name, name_length, "nc"))
+      params.nc = value;
+    else if (isParam(name, name_length, "cnonce"))
+      params.cnonce = value;
   }
-  QByteArray prop_realm = regex_realm.cap(1).toLocal8Bit();
-  if (prop_realm != QBT_REALM) {
-    qDebug("AUTH-PROB: Wrong realm");
+  return true;
+}
+
+// Check HTTP Digest authentication
+// http://tools.ietf.org/html/rfc2617
+// stale is set if the credentials are right but the nonce has expired,
+// the client should then retry with a new nonce.
+bool HttpServer::isAuthorized(const QByteArray& auth,
+                              const QString& method, bool *stale) {
+  if (stale) *stale = false;
+  DigestParams params;
+  if (!parseDigestHeader(auth, params))
     return false;
+  QByteArray username;
+  QByteArray ha1;
+  {
+    QMutexLocker locker(&m_mutex);
+    username = m_username;
+    ha1 = m_passwordSha1;
   }
-  // get nonce
-  QRegExp regex_nonce(".*nonce=[\"]?([\\w=]+)[\"]?.*");
-  if (regex_nonce.indexIn(auth) < 0) {
-    qDebug("AUTH-PROB: missing nonce");
+  if (params.username != username) {
+    // User name is invalid, we can reject already
+    qDebug("AUTH-PROB: Username is invalid");
     return false;
   }
-  QByteArray prop_nonce = regex_nonce.cap(1).toLocal8Bit();
-  //qDebug("prop nonce is: %s", prop_nonce.data());
-  // get uri
-  QRegExp regex_uri(".*uri=\"([^\"]+)\".*");
-  if (regex_uri.indexIn(auth) < 0) {
-    qDebug("AUTH-PROB: Missing uri");
+  if (params.realm != QBT_REALM) {
+    qDebug("AUTH-PROB: Wrong realm");
     return false;
   }
-  QByteArray prop_uri = regex_uri.cap(1).toLocal8Bit();
-  //qDebug("prop uri is: %s", prop_uri.data());
-  // get response
-  QRegExp regex_response(".*response=[\"]?([\\w=]+)[\"]?.*");
-  if (regex_response.indexIn(auth) < 0) {
-    qDebug("AUTH-PROB: Missing response");
+  if (params.nonce.isEmpty() || params.uri.isEmpty() || params.response.isEmpty()) {
+    qDebug("AUTH-PROB: Missing nonce, uri or response");
     return false;
   }
-  QByteArray prop_response = regex_response.cap(1).toLocal8Bit();
-  //qDebug("prop response is: %s", prop_response.data());
   // Compute correct reponse
   QCryptographicHash md5_ha2(QCryptographicHash::Md5);
-  md5_ha2.addData(method.toLocal8Bit() + ":" + prop_uri);
-  QByteArray ha2 = md5_ha2.result().toHex();
-  QByteArray response = "";
-  if (auth.contains("qop=")) {
-    QCryptographicHash md5_ha(QCryptographicHash::Md5);
-    // Get nc
-    QRegExp regex_nc(".*nc=[\"]?([\\w=]+)[\"]?.*");
-    if (regex_nc.indexIn(auth) < 0) {
-      qDebug("AUTH-PROB: qop but missing nc");
-      return false;
-    }
-    QByteArray prop_nc = regex_nc.cap(1).toLocal8Bit();
-    //qDebug("prop nc is: %s", prop_nc.data());
-    QRegExp regex_cnonce(".*cnonce=[\"]?([\\w=]+)[\"]?.*");
-    if (regex_cnonce.indexIn(auth) < 0) {
-      qDebug("AUTH-PROB: qop but missing cnonce");
+  md5_ha2.addData(method.toLocal8Bit() + ":" + params.uri);
+  const QByteArray ha2 = md5_ha2.result().toHex();
+  QCryptographicHash md5_ha(QCryptographicHash::Md5);
+  quint32 nc = 0;
+  if (!params.qop.isEmpty()) {
+    bool ok;
+    nc = params.nc.toUInt(&ok, 16);
+    if (params.qop != "auth" || !ok || nc == 0 || params.cnonce.isEmpty()) {
+      qDebug("AUTH-PROB: invalid qop, nc or cnonce");
       return false;
     }
-    QByteArray prop_cnonce = regex_cnonce.cap(1).toLocal8Bit();
-    //qDebug("prop cnonce is: %s", prop_cnonce.data());
-    QRegExp regex_qop(".*qop=[\"]?(\\w+)[\"]?.*");
-    if (regex_qop.indexIn(auth) < 0) {
-      qDebug("AUTH-PROB: missing qop");
-      return false;
-    }
-    QByteArray prop_qop = regex_qop.cap(1).toLocal8Bit();
-    //qDebug("prop qop is: %s", prop_qop.data());
-    md5_ha.addData(m_passwordSha1+":"+prop_nonce+":"+prop_nc+":"+prop_cnonce+":"+prop_qop+":"+ha2);
-    response = md5_ha.result().toHex();
+    md5_ha.addData(ha1+":"+params.nonce+":"+params.nc+":"+params.cnonce+":"+params.qop+":"+ha2);
   } else {
-    QCryptographicHash md5_ha(QCryptographicHash::Md5);
-    md5_ha.addData(m_passwordSha1+":"+prop_nonce+":"+ha2);
-    response = md5_ha.result().toHex();
+    md5_ha.addData(ha1+":"+params.nonce+":"+ha2);
+  }
+  if (md5_ha.result().toHex() != params.response.toLower())
+    return false;
+
+  // The nonce must be one of ours, and each nc can only be used once
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  QMutexLocker locker(&m_mutex);
+  QHash<QByteArray, NonceInfo>::Iterator it = m_nonces.find(params.nonce);
+  if (it == m_nonces.end() || it.value().expiration <= now) {
+    if (it != m_nonces.end())
+      m_nonces.erase(it);
+    qDebug("AUTH-PROB: unknown or expired nonce");
+    if (stale) *stale = true;
+    return false;
   }
-  //qDebug("AUTH: comparing reponses: (%d)", static_cast<int>(prop_response == response));
-  return prop_response == response;
+  if (nc > 0) {
+    // Requests can arrive out of order, the last NC_WINDOW values
+    // are remembered
+    NonceInfo &info = it.value();
+    if (nc > info.maxNc) {
+      const quint32 shift = nc - info.maxNc;
+      info.ncWindow = (shift >= NC_WINDOW) ? 0 : (info.ncWindow << shift);
+      info.ncWindow |= 1;
+      info.maxNc = nc;
+    } else {
+      const quint32 offset = info.maxNc - nc;
+      if (offset >= NC_WINDOW || (info.ncWindow & (Q_UINT64_C(1) << offset))) {
+        qDebug("AUTH-PROB: replayed nc");
+        return false;
+      }
+      info.ncWindow |= (Q_UINT64_C(1) << offset);
+    }
+  }
+  return true;
 }
 
 EventManager* HttpServer::eventManager() const {
@@ -333,10 +660,23 @@ EventManager* HttpServer::eventManager() const {
 }
 
 void HttpServer::setlocalAuthEnabled(bool enabled) {
+  QMutexLocker locker(&m_mutex);
   m_localAuthEnabled = enabled;
 }
 
+// Limits the size of the requests (e.g. torrent uploads)
+void HttpServer::setMaxUploadSize(int size_mb) {
+  QMutexLocker locker(&m_mutex);
+  m_maxUploadSize = qint64(qMax(1, size_mb)) * 1024 * 1024;
+}
+
+qint64 HttpServer::maxUploadSize() const {
+  QMutexLocker locker(&m_mutex);
+  return m_maxUploadSize;
+}
+
 bool HttpServer::isLocalAuthEnabled() const {
+  QMutexLocker locker(&m_mutex);
   return m_localAuthEnabled;
 }
 
@@ -37,6 +37,11 @@
 #include <QByteArray>
 #include <QHash>
 #include <QTimer>
+#include <QTime>
+#include <QDateTime>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QVector>
 
 #ifndef QT_NO_OPENSSL
 #include <QSslCertificate>
@@ -46,13 +51,38 @@
 #include "preferences.h"
 
 class EventManager;
+class MetricsWriter;
+class HttpConnection;
+class HttpServer;
 
 QT_BEGIN_NAMESPACE
 class QTimer;
+class QThread;
+class QTcpSocket;
 QT_END_NAMESPACE
 
 const int MAX_AUTH_FAILED_ATTEMPTS = 5;
 
+// Handles the Web UI connections in one of the I/O threads
+class HttpWorker : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(HttpWorker)
+
+public:
+  HttpWorker(HttpServer *server): m_server(server) {}
+
+public slots:
+  void handleConnection(int socketDescriptor);
+
+private:
+  HttpServer *m_server;
+};
+
+// The connections are read, authenticated and answered in a small
+// pool of I/O threads. Torrent lists and transfer info are served
+// from the snapshot published by the EventManager, the requests that
+// need the session are run in the main thread
+// (see runInSessionThread()).
 class HttpServer : public QTcpServer {
   Q_OBJECT
   Q_DISABLE_COPY(HttpServer)
@@ -61,40 +91,83 @@ public:
   HttpServer(int msec, QObject* parent = 0);
   ~HttpServer();
   void setAuthorization(const QString& username, const QString& password_sha1);
-  bool isAuthorized(const QByteArray& auth, const QString& method) const;
+  bool isAuthorized(const QByteArray& auth, const QString& method, bool *stale = 0);
+  QString authenticationChallenge(bool stale = false);
+  QByteArray createSession(const QString& ip);
+  bool isValidSession(const QByteArray& sid, const QString& ip);
   void setlocalAuthEnabled(bool enabled);
   bool isLocalAuthEnabled() const;
+  void setMaxUploadSize(int size_mb);
+  qint64 maxUploadSize() const;
   EventManager *eventManager() const;
-  QString generateNonce() const;
+  QString generateNonce();
   int NbFailedAttemptsForIp(const QString& ip) const;
   void increaseNbFailedAttemptsForIp(const QString& ip);
   void resetNbFailedAttemptsForIp(const QString& ip);
   bool isTranslationNeeded();
+  void notifyActivity();
+  void startWaitingForUpdates();
+  void stopWaitingForUpdates();
+  bool runInSessionThread(HttpConnection *connection);
+  QTcpSocket* createSocket(int socketDescriptor);
+  // Time spent answering a request, may be called from any thread
+  void recordRequest(qint64 usecs);
+  void writeMetrics(MetricsWriter &writer) const;
 
 #ifndef QT_NO_OPENSSL
   void enableHttps(const QSslCertificate &certificate, const QSslKey &key);
   void disableHttps();
 #endif
+  bool isHttps() const;
 
 private:
   void incomingConnection(int socketDescriptor);
 
 private slots:
+  void onActivity();
   void onTimer();
-  void UnbanTimerEvent();
   void onLocaleChanged(const QString &locale);
+  void processSessionRequest(QObject *connection);
 
 private:
-  void handleNewConnection(QTcpSocket *socket);
+  struct NonceInfo {
+    uint expiration;
+    quint32 maxNc;    // Highest nonce count used
+    quint64 ncWindow; // Bit i set if maxNc - i was used
+  };
+
+  struct SessionInfo {
+    QString ip;
+    uint expiration;
+  };
 
 private:
+  // Protects the settings, the ban list, the nonces and the
+  // sessions used by the I/O threads
+  mutable QMutex m_mutex;
   QByteArray m_username;
   QByteArray m_passwordSha1;
   EventManager *m_eventManager;
   QTimer m_timer;
+  QTime m_lastActivity;
+  QAtomicInt m_waitingConnections;
+  QAtomicInt m_shuttingDown;
+  QList<QThread*> m_threads;
+  QList<HttpWorker*> m_workers;
+  int m_nextWorker;
+  QHash<QByteArray, NonceInfo> m_nonces;
+  QHash<QByteArray, SessionInfo> m_sessions;
+  QString m_opaque;
   QHash<QString, int> m_clientFailedAttempts;
+  QHash<QString, QDateTime> m_bannedUntil;
   bool m_localAuthEnabled;
+  qint64 m_maxUploadSize; // in bytes
   bool m_needsTranslation;
+  // Request latencies
+  mutable QMutex m_statsMutex;
+  QVector<qulonglong> m_requestBuckets;
+  qulonglong m_requestCount;
+  qint64 m_requestTotalTime; // in microseconds
 #ifndef QT_NO_OPENSSL
   bool m_https;
   QSslCertificate m_certificate;
@@ -36,7 +36,9 @@
 
 namespace json {
 
-  QString toJson(const QVariant& v) {
+  inline QString toJson(const QVariantMap& m);
+
+  inline QString toJson(const QVariant& v) {
     if (v.isNull())
       return "null";
     switch(v.type())
@@ -48,6 +50,8 @@ namespace json {
     case QVariant::UInt:
     case QVariant::ULongLong:
       return v.value<QString>();
+    case QVariant::Map:
+      return toJson(v.toMap());
     case QVariant::StringList:
     case QVariant::List: {
         QStringList strList;
@@ -97,7 +101,7 @@ namespace json {
     }
   }
 
-  QString toJson(const QVariantMap& m) {
+  inline QString toJson(const QVariantMap& m) {
     QStringList vlist;
     QVariantMap::ConstIterator it;
     for (it = m.constBegin(); it != m.constEnd(); it++) {
@@ -106,7 +110,7 @@ namespace json {
     return "{"+vlist.join(",")+"}";
   }
 
-  QVariantMap fromJson(const QString& json) {
+  inline QVariantMap fromJson(const QString& json) {
     qDebug("JSON is %s", qPrintable(json));
     QVariantMap m;
     if (json.startsWith("{") && json.endsWith("}")) {
@@ -168,7 +172,7 @@ namespace json {
     return m;
   }
 
-  QString toJson(const QList<QVariantMap>& v) {
+  inline QString toJson(const QList<QVariantMap>& v) {
     QStringList res;
     foreach (QVariantMap m, v) {
       QStringList vlist;
@@ -0,0 +1,97 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#include <math.h>
+#include "metricswriter.h"
+
+void MetricsWriter::family(const char *name, Type type, const char *help) {
+  m_data += "# HELP ";
+  m_data += name;
+  m_data += ' ';
+  m_data += help;
+  m_data += "\n# TYPE ";
+  m_data += name;
+  switch(type) {
+  case COUNTER:
+    m_data += " counter\n";
+    break;
+  case GAUGE:
+    m_data += " gauge\n";
+    break;
+  case HISTOGRAM:
+    m_data += " histogram\n";
+    break;
+  }
+}
+
+void MetricsWriter::sample(const char *name, qreal value) {
+  m_data += name;
+  writeValue(value);
+}
+
+void MetricsWriter::sample(const char *name, const char *label, const QString &label_value, qreal value) {
+  m_data += name;
+  m_data += '{';
+  writeLabel(label, label_value);
+  m_data += '}';
+  writeValue(value);
+}
+
+void MetricsWriter::sample(const char *name, const char *label1, const QString &label_value1,
+                           const char *label2, const QString &label_value2, qreal value) {
+  m_data += name;
+  m_data += '{';
+  writeLabel(label1, label_value1);
+  m_data += ',';
+  writeLabel(label2, label_value2);
+  m_data += '}';
+  writeValue(value);
+}
+
+// Backslashes, double quotes and line feeds are escaped in label values
+void MetricsWriter::writeLabel(const char *label, const QString &label_value) {
+  QByteArray value = label_value.toUtf8();
+  value.replace('\\', "\\\\");
+  value.replace('"', "\\\"");
+  value.replace('\n', "\\n");
+  m_data += label;
+  m_data += "=\"";
+  m_data += value;
+  m_data += '"';
+}
+
+void MetricsWriter::writeValue(qreal value) {
+  m_data += ' ';
+  if (value == floor(value) && fabs(value) < 1e15)
+    m_data += QByteArray::number((qlonglong)value);
+  else
+    m_data += QByteArray::number(value, 'g', 17);
+  m_data += '\n';
+}
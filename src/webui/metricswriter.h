@@ -0,0 +1,60 @@
+/*
+ * Bittorrent Client using Qt4 and libtorrent.
+ * Copyright (C) 2006  Christophe Dumez
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ *
+ * Contact : chris@qbittorrent.org
+ */
+
+#ifndef METRICSWRITER_H
+#define METRICSWRITER_H
+
+#include <QByteArray>
+#include <QString>
+
+// Writes metrics in the Prometheus text format (version 0.0.4).
+// The values are written as raw numbers, integral values without
+// exponent so that byte counters keep their precision.
+class MetricsWriter {
+public:
+  enum Type { COUNTER, GAUGE, HISTOGRAM };
+
+  // Starts a metric family, its samples follow
+  void family(const char *name, Type type, const char *help);
+  void sample(const char *name, qreal value);
+  void sample(const char *name, const char *label, const QString &label_value, qreal value);
+  void sample(const char *name, const char *label1, const QString &label_value1,
+              const char *label2, const QString &label_value2, qreal value);
+  QByteArray data() const { return m_data; }
+
+private:
+  void writeLabel(const char *label, const QString &label_value);
+  void writeValue(qreal value);
+
+private:
+  QByteArray m_data;
+};
+
+#endif // METRICSWRITER_H
@@ -132,6 +132,58 @@ var BrowserDetect = {
 };
 BrowserDetect.init();
 
+// The server sends raw values, formatted here like the transfer list does
+
+// Same as misc::friendlyUnit()
+function friendlyUnit(value, isSpeed) {
+  var units = ["_(B)", "_(KiB)", "_(MiB)", "_(GiB)", "_(TiB)"];
+  if(value < 0)
+    return "_(Unknown)";
+  var i = 0;
+  while(value >= 1024. && i < units.length - 1) {
+    value /= 1024.;
+    ++i;
+  }
+  var res;
+  if(i == 0)
+    res = Math.floor(value) + " " + units[0];
+  else
+    res = value.toFixed(1) + " " + units[i];
+  if(isSpeed)
+    res = "_(%1/s)".replace("%1", res);
+  return res;
+}
+
+// Same as misc::userFriendlyDuration()
+function friendlyDuration(seconds) {
+  var MAX_ETA = 8640000;
+  if(seconds < 0 || seconds >= MAX_ETA)
+    return "∞";
+  if(seconds == 0)
+    return "0";
+  if(seconds < 60)
+    return "< 1m";
+  var minutes = Math.floor(seconds / 60);
+  if(minutes < 60)
+    return "_(%1m)".replace("%1", minutes);
+  var hours = Math.floor(minutes / 60);
+  minutes = minutes - hours*60;
+  if(hours < 24)
+    return "_(%1h %2m)".replace("%1", hours).replace("%2", minutes);
+  var days = Math.floor(hours / 24);
+  hours = hours - days*24;
+  if(days < 100)
+    return "_(%1d %2h)".replace("%1", days).replace("%2", hours);
+  return "∞";
+}
+
+// Number with the total in parentheses, e.g. seeds (swarm seeds)
+function withTotal(value, total) {
+  if(total > 0)
+    return value + " (" + total + ")";
+  return "" + value;
+}
+
 myTable = new dynamicTable();
 ajaxfn = function(){};
 setSortedColumn = function(index){
@@ -187,7 +239,6 @@ window.addEvent('load', function(){
   initializeWindows();
   var r=0;
   var waiting=false;
-  var waitingTrInfo = false;
   
   var stateToImg = function(state){
     if(state == "pausedUP" || state == "pausedDL") {
@@ -203,36 +254,15 @@ window.addEvent('load', function(){
     }
     return 'images/skin/'+state+'.png';
   };
-  var loadTransferInfo = function() {
-    var url = 'json/transferInfo';
-    if(!waitingTrInfo) {
-      waitingTrInfo = true;
-      var request = new Request.JSON({
-                    url: url,
-                    noCache: true,
-                    method: 'get',
-                    onFailure: function() {
-                      $('error_div').set('html', '_(qBittorrent client is not reachable)');
-                      waitingTrInfo=false;
-                      loadTransferInfo.delay(4000);
-                    },
-                    onSuccess: function(info) {
-                      if(info) {
-                        $("DlInfos").set('html', info.DlInfos);
-                        $("UpInfos").set('html', info.UpInfos);
-                        waitingTrInfo=false;
-                        loadTransferInfo.delay(3000);
-                      }
-                    }
-                  }).send();
-    }
-  };
   $('DlInfos').addEvent('click', globalDownloadLimitFN);
   $('UpInfos').addEvent('click', globalUploadLimitFN);
   
+	// Long polling: the server answers as soon as something changed
+	// since revision rid
+	var rid = 0;
+	var torrent_priorities = new Hash();
 	var ajaxfn = function(){
-		var queueing_enabled = false;
-		var url = 'json/events';
+		var url = 'json/updates?rid='+rid;
 		if (!waiting){
 			waiting=true;
 			var request = new Request.JSON({
@@ -244,31 +274,47 @@ window.addEvent('load', function(){
 					waiting=false;
 					ajaxfn.delay(2000);
 				},
-				onSuccess: function(events) {
+				onSuccess: function(response) {
 					 $('error_div').set('html', '');
-					if(events){
+					if(response){
+            if(response.full_update) {
+              // Remove the torrents that are not in the list anymore
+              var events_hashes = new Array();
+              response.torrents.each(function(event){
+                events_hashes[events_hashes.length] = event.hash;
+              });
+              myTable.getRowIds().each(function(hash){
+                if(!events_hashes.contains(hash)) {
+                  myTable.removeRow(hash);
+                  torrent_priorities.erase(hash);
+                }
+              });
+            } else {
+              // Remove deleted torrents
+              response.removed.each(function(hash){
+                myTable.removeRow(hash);
+                torrent_priorities.erase(hash);
+              });
+            }
             // Add new torrents or update them
             torrent_hashes = myTable.getRowIds();
-            events_hashes = new Array();
-            events.each(function(event){
-              events_hashes[events_hashes.length] = event.hash;
+            response.torrents.each(function(event){
                 var row = new Array();
                 row.length = 10;
                 row[0] = stateToImg(event.state);
                 row[1] = event.name;
-		row[2] = event.priority
-                row[3] = event.size;
+		row[2] = (event.priority >= 0) ? "" + event.priority : "*";
+                row[3] = friendlyUnit(event.size, false);
                 row[4] = (event.progress*100).round(1);
                 if(row[4] == 100.0 && event.progress != 1.0)
                   row[4] = 99.9;
-		row[5] = event.num_seeds;
-		row[6] = event.num_leechs;
-                row[7] = event.dlspeed;
-                row[8] = event.upspeed;
-		row[9] = event.eta;
-		row[10] = event.ratio;
-		if(row[2] != "*")
-			queueing_enabled = true;
+		row[5] = withTotal(event.num_seeds, event.num_complete);
+		row[6] = withTotal(event.num_leechs, event.num_incomplete);
+                row[7] = friendlyUnit(event.dlspeed, true);
+                row[8] = friendlyUnit(event.upspeed, true);
+		row[9] = friendlyDuration(event.eta);
+		row[10] = (event.ratio > 100.) ? "∞" : event.ratio.toFixed(1);
+		torrent_priorities.set(event.hash, event.priority);
                if(!torrent_hashes.contains(event.hash)) {
                   // New unfinished torrent
                   torrent_hashes[torrent_hashes.length] = event.hash;
@@ -279,12 +325,9 @@ window.addEvent('load', function(){
                   myTable.updateRow(event.hash, row, event.state);
                 }
             });
-            // Remove deleted torrents
-            torrent_hashes.each(function(hash){
-              if(!events_hashes.contains(hash)) {
-                myTable.removeRow(hash);
-              }
-            });
+	    var queueing_enabled = torrent_priorities.getValues().some(function(priority){
+		return priority >= 0;
+	    });
 	    if(queueing_enabled) {
 		$('queueingButtons').removeClass('invisible');
 		myTable.showPriority();
@@ -292,9 +335,15 @@ window.addEvent('load', function(){
 		$('queueingButtons').addClass('invisible');
 		myTable.hidePriority();
 	    }
+            // Global transfer information
+            if(response.transfer) {
+              $("DlInfos").set('html', response.transfer.DlInfos);
+              $("UpInfos").set('html', response.transfer.UpInfos);
+            }
+            rid = response.rid;
 					}
 					waiting=false;
-					ajaxfn.delay(1500);
+					ajaxfn();
 				}
 			}).send();
 		}
@@ -332,10 +381,6 @@ window.addEvent('load', function(){
 		height: prop_h
 	});
 	//ajaxfn();
-  if(BrowserDetect.browser != "Safari") {
-    // Safari has trouble with this
-    loadTransferInfo();
-  }
 
 	setFilter = function(f) {
 	  // Visually Select the right filter
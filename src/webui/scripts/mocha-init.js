@@ -179,27 +179,21 @@ initializeWindows = function(){
 	pauseFN = function() {
 		var h = myTable.selectedIds();
 		if(h.length){
-			h.each(function(hash, index){
-			  new Request({url: '/command/pause', method: 'post', data: {hash: hash}}).send();
-			});
+			new Request({url: '/command/batch', method: 'post', data: {action: 'pause', hashes: h.join("|")}}).send();
 		}
 	};
 	
 	startFN = function() {
 		var h = myTable.selectedIds();
 		if(h.length){
-			h.each(function(hash, index){
-			  new Request({url: '/command/resume', method: 'post', data: {hash: hash}}).send();
-			});
+			new Request({url: '/command/batch', method: 'post', data: {action: 'resume', hashes: h.join("|")}}).send();
 		}
 	};
 	
 	recheckFN = function() {
 		var h = myTable.selectedIds();
 		if(h.length){
-			h.each(function(hash, index){
-			  new Request({url: '/command/recheck', method: 'post', data: {hash: hash}}).send();
-			});
+			new Request({url: '/command/batch', method: 'post', data: {action: 'recheck', hashes: h.join("|")}}).send();
 		}
 	};
 
@@ -208,9 +202,7 @@ initializeWindows = function(){
 			new Event(e).stop();
 			var h = myTable.selectedIds();
 			if(h.length){
-				h.each(function(hash, index){
-				  new Request({url: '/command/'+item, method: 'post', data: {hash: hash}}).send();
-				});
+				new Request({url: '/command/batch', method: 'post', data: {action: item, hashes: h.join("|")}}).send();
 			}
 		});
 		
@@ -5,12 +5,14 @@ HEADERS += $$PWD/httpserver.h \
            $$PWD/httprequestparser.h \
            $$PWD/httpresponsegenerator.h \
            $$PWD/eventmanager.h \
-           $$PWD/json.h
+           $$PWD/json.h \
+           $$PWD/metricswriter.h
 
 SOURCES += $$PWD/httpserver.cpp \
            $$PWD/httpconnection.cpp \
            $$PWD/httprequestparser.cpp \
            $$PWD/httpresponsegenerator.cpp \
-           $$PWD/eventmanager.cpp
+           $$PWD/eventmanager.cpp \
+           $$PWD/metricswriter.cpp
 
 RESOURCES += $$PWD/webui.qrc
\ No newline at end of file